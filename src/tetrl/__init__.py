@@ -4,7 +4,9 @@ TetRL -- Tetris reinforcement-learning toolkit.
 Importing this package registers the following gymnasium environments:
 
 * ``tetrl/Step-v0`` -- step-based env with default plugins
-  (66-channel feature tensor, lock-based attack reward).
+  (66-channel feature tensor, lock-based attack reward).  Its vector
+  entry point is the natively driven ``StepVectorEnv``
+  (``gymnasium.make_vec("tetrl/Step-v0", n, vectorization_mode="vector_entry_point")``).
 """
 
 __all__ = []
@@ -14,5 +16,6 @@ import gymnasium
 gymnasium.register(
     id="tetrl/Step-v0",
     entry_point="tetrl.envs.step.env:StepEnv",
+    vector_entry_point="tetrl.envs.step.vector:StepVectorEnv",
     # feature=None and reward=None -> defaults are created automatically.
 )
@@ -0,0 +1,192 @@
+#include "render.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace tetrl {
+
+namespace {
+
+enum Tile : std::uint8_t {
+    TILE_BACKGROUND,
+    TILE_EMPTY,
+    TILE_SPAWN_ROW,        // empty cell of the row above the visible field
+    TILE_BLOCK,
+    TILE_GARBAGE,
+    TILE_HELD,             // hold piece while hold is unavailable
+    TILE_GARBAGE_READY,    // pending garbage line that arrives with the next lock
+    TILE_GARBAGE_WAITING,  // pending garbage line still delayed
+    TILE_PIECE,                                                    // + piece type
+    TILE_GHOST = TILE_PIECE + static_cast<int>(PieceType::SIZE),   // + piece type
+    TILE_COUNT = TILE_GHOST + static_cast<int>(PieceType::SIZE),
+};
+
+struct Rgb { std::uint8_t r, g, b; };
+
+constexpr Rgb piece_colors[static_cast<std::underlying_type_t<PieceType>>(PieceType::SIZE)] = {
+    // Z,           L,              O,               S,             I,              J,             T
+    {215, 15, 55}, {227, 91, 2}, {227, 159, 2}, {89, 177, 1}, {15, 155, 215}, {33, 65, 198}, {175, 41, 138},
+};
+
+constexpr Rgb scaled(Rgb c, int num, int den) {
+    return {static_cast<std::uint8_t>(c.r * num / den), static_cast<std::uint8_t>(c.g * num / den), static_cast<std::uint8_t>(c.b * num / den)};
+}
+
+// Pixels of every tile at one scale; tile t, pixel row py starts at row(t, py).
+struct TileAtlas {
+    int scale = 0;
+    std::vector<std::uint8_t> pixels;
+
+    std::size_t offset(int tile, int py) const { return (static_cast<std::size_t>(tile) * scale + py) * scale * 3; }
+    const std::uint8_t* row(int tile, int py) const { return pixels.data() + offset(tile, py); }
+    std::uint8_t* row(int tile, int py) { return pixels.data() + offset(tile, py); }
+};
+
+// Fills tile `tile` with `fill` inside a one-pixel `border` (no border below scale 4).
+void paintTile(TileAtlas& atlas, int tile, Rgb fill, Rgb border) {
+    const int s = atlas.scale;
+    const bool framed = s >= 4;
+    for (int py = 0; py < s; ++py) {
+        std::uint8_t* px = atlas.row(tile, py);
+        for (int x = 0; x < s; ++x, px += 3) {
+            const bool edge = framed && (py == 0 || x == 0 || py == s - 1 || x == s - 1);
+            const Rgb c = edge ? border : fill;
+            px[0] = c.r; px[1] = c.g; px[2] = c.b;
+        }
+    }
+}
+
+TileAtlas makeTileAtlas(int scale) {
+    TileAtlas atlas;
+    atlas.scale = scale;
+    atlas.pixels.resize(static_cast<std::size_t>(TILE_COUNT) * scale * scale * 3);
+
+    constexpr Rgb background = {0, 0, 0};
+    constexpr Rgb empty      = {20, 20, 24};
+    constexpr Rgb grid       = {34, 34, 40};
+    paintTile(atlas, TILE_BACKGROUND, background, background);
+    paintTile(atlas, TILE_EMPTY, empty, grid);
+    paintTile(atlas, TILE_SPAWN_ROW, {10, 10, 12}, {24, 24, 28});
+    paintTile(atlas, TILE_BLOCK, {150, 150, 150}, {100, 100, 100});
+    paintTile(atlas, TILE_GARBAGE, {80, 80, 80}, {55, 55, 55});
+    paintTile(atlas, TILE_HELD, {70, 70, 70}, {45, 45, 45});
+    paintTile(atlas, TILE_GARBAGE_READY, {230, 40, 40}, {150, 20, 20});
+    paintTile(atlas, TILE_GARBAGE_WAITING, {240, 200, 60}, {160, 130, 30});
+    for (int t = 0; t < static_cast<int>(PieceType::SIZE); ++t) {
+        paintTile(atlas, TILE_PIECE + t, piece_colors[t], scaled(piece_colors[t], 2, 3));
+        // ghost: outline in the piece colour; below scale 4, a dim fill instead
+        paintTile(atlas, TILE_GHOST + t, scale >= 4 ? empty : scaled(piece_colors[t], 1, 3), scaled(piece_colors[t], 2, 3));
+    }
+    return atlas;
+}
+
+const TileAtlas& tileAtlas(int scale) {
+    static std::once_flag once[RENDER_MAX_SCALE + 1];
+    static TileAtlas atlases[RENDER_MAX_SCALE + 1];
+    std::call_once(once[scale], [scale] { atlases[scale] = makeTileAtlas(scale); });
+    return atlases[scale];
+}
+
+using TileMap = std::uint8_t[RENDER_ROWS][RENDER_COLS];
+
+// Draws the 4x4 shape of a piece with its top-left corner at tile (col, row),
+// skipping cells outside [col_min, col_max] x [row_min, row_max].
+void drawPiece(TileMap& tiles, int col, int row, PieceType type, std::uint8_t orientation, std::uint8_t tile,
+               int col_min = 0, int col_max = RENDER_COLS - 1, int row_min = 0, int row_max = RENDER_ROWS - 1) {
+    const Piece& piece = ops::getPiece(type, orientation);
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (ops::getCell(piece, j, i) == Cell::EMPTY) { continue; }
+            const int c = col + j, r = row + i;
+            if (c < col_min || c > col_max || r < row_min || r > row_max) { continue; }
+            tiles[r][c] = tile;
+        }
+    }
+}
+
+void layoutTiles(const State* state, TileMap& tiles) {
+    std::memset(tiles, TILE_BACKGROUND, sizeof(TileMap));
+
+    // board (tile row 0 is the row above the visible field)
+    for (int r = 0; r < RENDER_ROWS; ++r) {
+        const Row row = state->board.data[BOARD_TOP - 1 + r];
+        for (int x = BOARD_LEFT; x <= BOARD_RIGHT; ++x) {
+            std::uint8_t tile;
+            switch (ops::getCell(row, x)) {
+            case Cell::BLOCK:   tile = TILE_BLOCK; break;
+            case Cell::GARBAGE: tile = TILE_GARBAGE; break;
+            default:            tile = r == 0 ? TILE_SPAWN_ROW : TILE_EMPTY; break;
+            }
+            tiles[r][RENDER_BOARD_COL + x - BOARD_LEFT] = tile;
+        }
+    }
+
+    // ghost and current piece, clipped to the board
+    if (state->current != PieceType::NONE) {
+        const auto type = static_cast<std::underlying_type_t<PieceType>>(state->current);
+        const Piece& piece = ops::getPiece(state->current, state->orientation);
+        int ghost_y = state->y;
+        while (ops::canPlacePiece(state->board, piece, state->x, ghost_y + 1)) { ++ghost_y; }
+        const int col = RENDER_BOARD_COL + state->x - BOARD_LEFT;
+        const int col_max = RENDER_BOARD_COL + BOARD_RIGHT - BOARD_LEFT;
+        drawPiece(tiles, col, ghost_y - (BOARD_TOP - 1), state->current, state->orientation,
+                  static_cast<std::uint8_t>(TILE_GHOST + type), RENDER_BOARD_COL, col_max);
+        drawPiece(tiles, col, state->y - (BOARD_TOP - 1), state->current, state->orientation,
+                  static_cast<std::uint8_t>(TILE_PIECE + type), RENDER_BOARD_COL, col_max);
+    }
+
+    // hold and next queue
+    if (state->hold != PieceType::NONE) {
+        const auto type = static_cast<std::underlying_type_t<PieceType>>(state->hold);
+        drawPiece(tiles, RENDER_HOLD_COL, RENDER_PANEL_ROW, state->hold, 0,
+                  static_cast<std::uint8_t>(state->has_held ? TILE_HELD : TILE_PIECE + type));
+    }
+    for (int i = 0; i < RENDER_NEXT_COUNT && i < state->next_count; ++i) {
+        const PieceType next = peekNext(state, i);
+        drawPiece(tiles, RENDER_NEXT_COL, RENDER_PANEL_ROW + i * RENDER_NEXT_SPACING, next, 0,
+                  static_cast<std::uint8_t>(TILE_PIECE + static_cast<std::underlying_type_t<PieceType>>(next)));
+    }
+
+    // pending garbage, one tile per line stacked up from the floor
+    int r = RENDER_ROWS - 1;
+    for (int i = 0; i < state->garbage_count && r >= 1; ++i) {
+        const std::uint8_t tile = peekGarbageDelay(state, i) == 0 ? TILE_GARBAGE_READY : TILE_GARBAGE_WAITING;
+        for (int lines = peekGarbageLines(state, i); lines > 0 && r >= 1; --lines, --r) {
+            tiles[r][RENDER_GARBAGE_COL] = tile;
+        }
+    }
+}
+
+void blitTiles(const TileMap& tiles, const TileAtlas& atlas, std::uint8_t* out) {
+    const int s = atlas.scale;
+    const std::size_t tile_bytes = static_cast<std::size_t>(s) * 3;
+    for (int r = 0; r < RENDER_ROWS; ++r) {
+        for (int py = 0; py < s; ++py) {
+            for (int c = 0; c < RENDER_COLS; ++c, out += tile_bytes) {
+                std::memcpy(out, atlas.row(tiles[r][c], py), tile_bytes);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void renderRgb(const State* state, std::uint8_t* out, int scale) {
+    renderRgbBatch(state, sizeof(State), 1, out, scale);
+}
+
+void renderRgbBatch(const State* states, std::size_t stride, int n, std::uint8_t* out, int scale) {
+    if (scale < 1 || scale > RENDER_MAX_SCALE) { return; }
+    const TileAtlas& atlas = tileAtlas(scale);
+    const std::size_t frame_size = renderFrameSize(scale);
+    const auto* base = reinterpret_cast<const std::byte*>(states);
+    TileMap tiles;
+    for (int i = 0; i < n; ++i) {
+        layoutTiles(reinterpret_cast<const State*>(base + i * stride), tiles);
+        blitTiles(tiles, atlas, out + i * frame_size);
+    }
+}
+
+} // namespace tetrl
@@ -0,0 +1,33 @@
+#pragma once
+#include "tetris.hpp"
+#include <cstdint>
+#include <cstddef>
+
+namespace tetrl {
+
+// Frame layout in tiles (one tile = scale x scale pixels):
+//   [hold 4][gap][garbage bar][board 10][gap][next 4]
+// The board shows the row above the visible field plus the 20 visible rows.
+constexpr int RENDER_HOLD_COL    = 0;
+constexpr int RENDER_GARBAGE_COL = 5;
+constexpr int RENDER_BOARD_COL   = 6;
+constexpr int RENDER_NEXT_COL    = 17;
+constexpr int RENDER_PANEL_ROW   = 1;  // first row of the hold / next panels
+constexpr int RENDER_NEXT_COUNT  = 5;
+constexpr int RENDER_NEXT_SPACING = 3;
+constexpr int RENDER_COLS = RENDER_NEXT_COL + 4;              // 21
+constexpr int RENDER_ROWS = BOARD_BOTTOM - BOARD_TOP + 2;     // 21
+constexpr int RENDER_MAX_SCALE = 32;
+
+// Size of one rendered frame in bytes (H x W x 3, RGB, row-major).
+constexpr std::size_t renderFrameSize(int scale) {
+    return static_cast<std::size_t>(RENDER_ROWS) * RENDER_COLS * scale * scale * 3;
+}
+
+// Rasterises board, ghost, current piece, hold, next queue and pending-garbage
+// bar into `out` (renderFrameSize(scale) bytes). scale must be in [1, RENDER_MAX_SCALE].
+void renderRgb(const State* state, std::uint8_t* out, int scale);
+// Renders n states spaced `stride` bytes apart into n consecutive frames.
+void renderRgbBatch(const State* states, std::size_t stride, int n, std::uint8_t* out, int scale);
+
+} // namespace tetrl
@@ -7,6 +7,7 @@
 #include <utility>
 #include <limits>
 #include <type_traits>
+#include <iterator>
 
 #include <cassert>
 
@@ -197,48 +198,61 @@ inline static std::uint32_t xorshf32(std::uint32_t& seed) {
     return seed;
 }
 
+// Counter-based piece stream: bag `index` of stream `key` is a pure function of (key, index),
+// so streams can be seeded per env and jumped ahead without replaying the generator.
+inline static constexpr std::uint64_t splitmix64(std::uint64_t z) {
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+inline static constexpr std::uint64_t pieceStream(std::uint32_t key, std::uint32_t index) {
+    return splitmix64(splitmix64(key) ^ index);
+}
+
 struct SevenBagPermutations {
-    struct PackedSevenBag {
-        std::uint32_t b0 : 3;
-        std::uint32_t b1 : 3;
-        std::uint32_t b2 : 3;
-        std::uint32_t b3 : 3;
-        std::uint32_t b4 : 3;
-        std::uint32_t b5 : 3;
-        std::uint32_t b6 : 3;
-    };
-    // 7! = 5040
+    // 7! = 5040, each bag packed as 7 x 3-bit piece types (piece i at bits [3i, 3i + 3))
     enum { SIZE = 5040 };
-    PackedSevenBag data[SIZE];
+    std::uint32_t data[SIZE];
 };
-inline static SevenBagPermutations generateSevenBagPermutations() {
-    SevenBagPermutations permutations;
-    PieceType next[] = { PieceType::Z, PieceType::L, PieceType::O, PieceType::S, PieceType::I, PieceType::J, PieceType::T };
-    int index = 0;
-    do {
-        auto& ref = permutations.data[index++];
-        ref.b0 = static_cast<std::uint32_t>(next[0]);
-        ref.b1 = static_cast<std::uint32_t>(next[1]);
-        ref.b2 = static_cast<std::uint32_t>(next[2]);
-        ref.b3 = static_cast<std::uint32_t>(next[3]);
-        ref.b4 = static_cast<std::uint32_t>(next[4]);
-        ref.b5 = static_cast<std::uint32_t>(next[5]);
-        ref.b6 = static_cast<std::uint32_t>(next[6]);
-    } while (std::next_permutation(next, next + 7));
-    assert(index == SevenBagPermutations::SIZE);
+// Lexicographic order of {Z, L, O, S, I, J, T}, decoded from the factorial number system.
+inline static constexpr SevenBagPermutations generateSevenBagPermutations() {
+    SevenBagPermutations permutations{};
+    for (int index = 0; index < SevenBagPermutations::SIZE; ++index) {
+        int pool[7] = {0, 1, 2, 3, 4, 5, 6};
+        int remaining = index;
+        int radix = 720; // 6!
+        std::uint32_t packed = 0;
+        for (int i = 0; i < 7; ++i) {
+            const int k = remaining / radix;
+            remaining %= radix;
+            packed |= static_cast<std::uint32_t>(pool[k]) << (3 * i);
+            for (int j = k; j < 6 - i; ++j) { pool[j] = pool[j + 1]; }
+            if (i < 6) { radix /= (6 - i); }
+        }
+        permutations.data[index] = packed;
+    }
     return permutations;
 }
+static constexpr SevenBagPermutations seven_bag_permutations = generateSevenBagPermutations();
 
-inline static void randomPieces(PieceType dest[], std::uint32_t& seed) {
-    static const SevenBagPermutations seven_bag_permutations = generateSevenBagPermutations();
-    auto& ref = seven_bag_permutations.data[xorshf32(seed) % SevenBagPermutations::SIZE];
-    dest[0] = static_cast<PieceType>(ref.b0);
-    dest[1] = static_cast<PieceType>(ref.b1);
-    dest[2] = static_cast<PieceType>(ref.b2);
-    dest[3] = static_cast<PieceType>(ref.b3);
-    dest[4] = static_cast<PieceType>(ref.b4);
-    dest[5] = static_cast<PieceType>(ref.b5);
-    dest[6] = static_cast<PieceType>(ref.b6);
+// Appends `bags` 7-bags to the ring buffer. Each bag only depends on its own counter, so the loop has no carried dependency.
+inline static void generateBags(State* state, int bags) {
+    int tail = state->next_head + state->next_count;
+    for (int b = 0; b < bags; ++b, tail += 7) {
+        const std::uint64_t r = pieceStream(state->seed, state->bag_index + static_cast<std::uint32_t>(b));
+        const std::uint32_t packed = seven_bag_permutations.data[((r >> 32) * SevenBagPermutations::SIZE) >> 32];
+        for (int i = 0; i < 7; ++i) {
+            state->next[(tail + i) & (NEXT_QUEUE_SIZE - 1)] = static_cast<PieceType>((packed >> (3 * i)) & 0b111);
+        }
+    }
+    state->bag_index += static_cast<std::uint32_t>(bags);
+    state->next_count = static_cast<std::uint8_t>(state->next_count + bags * 7);
+}
+// Tops up the queue with as many whole bags as fit, so bag generation runs once every several bags.
+inline static void refillNextQueue(State* state) {
+    if (state->next_count >= NEXT_PREVIEW) { return; }
+    generateBags(state, (NEXT_QUEUE_SIZE - state->next_count) / 7);
 }
 
 inline static void initializeBoard(Board& board) {
@@ -374,77 +388,45 @@ inline static void applyGarbage(Board& board, int lines, int hole_position) {
     }
 }
 
+// Signed distance between two piece counts (safe across wrap-around).
+inline static std::int32_t pieceCountDiff(std::uint32_t a, std::uint32_t b) { return static_cast<std::int32_t>(a - b); }
+
+inline static void popGarbage(State* state) {
+    state->garbage_lines[state->garbage_head] = 0;
+    state->garbage_arrival[state->garbage_head] = 0;
+    state->garbage_head = static_cast<std::uint8_t>((state->garbage_head + 1) & (GARBAGE_QUEUE_SIZE - 1));
+    state->garbage_count--;
+}
+
+// Counters and spawns from the front of the queue only: O(entries touched).
 inline static int processGarbageAndCounterAttack(State* state, int attack) {
-    int garbage_begin = 0, garbage_end = 0; // [begin, end) of pending garbage segments
-    // decrement delays and records the range of pending garbage
-    for (int i = 0; i < GARBAGE_QUEUE_SIZE; ++i) {
-        if (state->garbage_queue[i] > 0) {
-            if (state->garbage_delay[i] > 0) { state->garbage_delay[i]--; }
-            garbage_end = i + 1; // update end to include this entry
-        } else {
-            break; // stop at first empty entry
-        }
-    }
-    // counter garbage with attack and update the range
+    // counter the earliest arriving garbage with attack
     int remaining_attack = attack;
-    for (int i = garbage_begin; remaining_attack > 0 && i < garbage_end; ++i) {
-        assert(state->garbage_queue[i] > 0);
-        if (state->garbage_queue[i] <= remaining_attack) { // fully countered
-            remaining_attack -= state->garbage_queue[i];
-            state->garbage_queue[i] = 0;
-            state->garbage_delay[i] = 0;
-            garbage_begin++; // track begin index
+    while (remaining_attack > 0 && state->garbage_count > 0) {
+        std::uint8_t& lines = state->garbage_lines[state->garbage_head];
+        if (lines <= remaining_attack) { // fully countered
+            remaining_attack -= lines;
+            popGarbage(state);
         } else { // partially countered
-            state->garbage_queue[i] -= remaining_attack;
+            lines = static_cast<std::uint8_t>(lines - remaining_attack);
             remaining_attack = 0;
         }
     }
-    // apply pending garbage with zero delay if no garbage blocking or no lines cleared
+    // apply due garbage, up to max_garbage_spawn lines, if no garbage blocking or no lines cleared
     if (!state->garbage_blocking || state->lines_cleared == 0) {
-        std::uint16_t total_garbage_spawned = 0;
-        for (int i = garbage_begin; i < garbage_end; ++i) {
-            assert(state->garbage_queue[i] > 0);
-            if (state->garbage_delay[i] > 0) {
-                assert(garbage_begin == i);
-                break; // stop at first delayed garbage (assume delays are in order)
-            }
-            std::uint8_t lines_to_spawn = state->garbage_queue[i];
-            if (total_garbage_spawned + lines_to_spawn > state->max_garbage_spawn) {
-                lines_to_spawn = static_cast<std::uint8_t>(state->max_garbage_spawn - total_garbage_spawned);
-            }
-            assert(lines_to_spawn > 0);
-            total_garbage_spawned += lines_to_spawn;
+        int spawn_budget = state->max_garbage_spawn;
+        while (spawn_budget > 0 && state->garbage_count > 0
+               && pieceCountDiff(state->garbage_arrival[state->garbage_head], state->piece_count) <= 0) {
+            std::uint8_t& lines = state->garbage_lines[state->garbage_head];
+            const int lines_to_spawn = std::min<int>(lines, spawn_budget);
+            spawn_budget -= lines_to_spawn;
             // generate random hole position
             int hole_position = xorshf32(state->garbage_seed) % (BOARD_RIGHT - BOARD_LEFT + 1) + BOARD_LEFT;
             // apply this segment of garbage
             applyGarbage(state->board, lines_to_spawn, hole_position);
-            // update remaining garbage in this entry
-            state->garbage_queue[i] -= lines_to_spawn;
-            if (state->garbage_queue[i] == 0) {
-                state->garbage_delay[i] = 0;
-                garbage_begin++; // track begin index
-                assert(garbage_begin == i + 1);
-            } else {
-                assert(garbage_begin == i);
-                break; // stop if this entry is not fully applied (only happens when max_garbage_spawn is reached)
-            }
-        }
-    }
-    // shift remaining garbage entries to the front of the queue [garbage_begin, garbage_end) -> [0, garbage_end - garbage_begin)
-    if (garbage_begin > 0) {
-        int write_index = 0;
-        for (int read_index = garbage_begin; read_index < garbage_end; ++read_index) {
-            assert(state->garbage_queue[read_index] > 0);
-            if (write_index != read_index) {
-                state->garbage_queue[write_index] = state->garbage_queue[read_index];
-                state->garbage_delay[write_index] = state->garbage_delay[read_index];
-            }
-            write_index++;
-        }
-        // clear remaining entries after compacted data
-        for (int i = write_index; i < garbage_end; ++i) {
-            state->garbage_queue[i] = 0;
-            state->garbage_delay[i] = 0;
+            // an entry is only left partially applied when max_garbage_spawn is reached
+            lines = static_cast<std::uint8_t>(lines - lines_to_spawn);
+            if (lines == 0) { popGarbage(state); }
         }
     }
     return remaining_attack;
@@ -502,12 +484,12 @@ inline static void processPiecePlacement(State* state) {
     state->total_lines_sent += static_cast<std::uint32_t>(lines_sent);
 }
 inline static PieceType fetchNextPiece(State* state) {
-    PieceType next_piece = state->next[0];
-    // shift the next pieces
-    for (int i = 0; i < 13; i++) { state->next[i] = state->next[i + 1]; }
-    state->next[13] = PieceType::NONE;
-    // generate new random pieces if needed
-    if (state->next[7] == PieceType::NONE) { randomPieces(state->next + 7, state->seed); }
+    PieceType next_piece = peekNext(state, 0);
+    // pop the ring-buffer head
+    state->next_head = static_cast<std::uint8_t>((state->next_head + 1) & (NEXT_QUEUE_SIZE - 1));
+    state->next_count--;
+    // generate new bags if the preview runs short
+    refillNextQueue(state);
     return next_piece;
 }
 inline static bool newCurrentPiece(State* state, PieceType piece_type) {
@@ -540,7 +522,16 @@ inline static bool movePiece(State* state, int new_x, int new_y) {
     }
     return can_place;
 }
-inline static bool rotatePiece(State* state, Rotation rot) {
+// Landing of a rotation: the new orientation, the kicked position and the
+// index of the SRS kick that succeeded.
+struct RotationKick {
+    std::uint8_t orientation;
+    int x, y;
+    int index;
+};
+// Finds the first SRS kick that lets the current piece rotate by `rot`;
+// shared by rotatePiece and the action-mask probe so both agree on every kick.
+inline static bool findRotationKick(const State* state, Rotation rot, RotationKick* out) {
     constexpr std::uint8_t orientation_delta_table[static_cast<std::underlying_type_t<Rotation>>(Rotation::SIZE)] = {
         1, // CW  -> orientation + 1
         3, // CCW -> orientation - 1 (= +3 mod 4)
@@ -550,32 +541,43 @@ inline static bool rotatePiece(State* state, Rotation rot) {
     auto& new_piece = ops::getPiece(state->current, new_orientation);
     // SRS kicks for CW/CCW/180
     auto& [kicks, len] = srs_table[static_cast<std::underlying_type_t<PieceType>>(state->current)][state->orientation][static_cast<std::underlying_type_t<Rotation>>(rot)];
-    // try SRS kicks
     for (int i = 0; i < len; ++i) {
         const int test_x = state->x + kicks[i].x;
         const int test_y = state->y - kicks[i].y;
         if (ops::canPlacePiece(state->board, new_piece, test_x, test_y)) {
-            // commit rotation + kick
-            state->orientation = new_orientation;
-            state->x = static_cast<std::int8_t>(test_x);
-            state->y = static_cast<std::int8_t>(test_y);
-            state->srs_index = static_cast<std::int8_t>(i);
+            *out = RotationKick{new_orientation, test_x, test_y, i};
             return true;
         }
     }
     return false;
 }
+inline static bool rotatePiece(State* state, Rotation rot) {
+    RotationKick kick;
+    if (!findRotationKick(state, rot, &kick)) { return false; }
+    // commit rotation + kick
+    state->orientation = kick.orientation;
+    state->x = static_cast<std::int8_t>(kick.x);
+    state->y = static_cast<std::int8_t>(kick.y);
+    state->srs_index = static_cast<std::int8_t>(kick.index);
+    return true;
+}
 
 void setSeed(State* state, std::uint32_t seed, std::uint32_t garbage_seed) {
     state->seed = seed;
+    state->bag_index = 0;
     state->garbage_seed = garbage_seed;
 }
 
+void jumpPieceStream(State* state, std::uint32_t bags) {
+    state->bag_index += bags;
+}
+
 void reset(State* state) {
     initializeBoard(state->board);
     state->is_alive = true;
-    randomPieces(state->next, state->seed);
-    randomPieces(state->next + 7, state->seed);
+    state->next_head = 0;
+    state->next_count = 0;
+    refillNextQueue(state);
     state->hold = PieceType::NONE;
     state->has_held = false;
     state->current = PieceType::NONE;
@@ -596,9 +598,11 @@ void reset(State* state) {
     state->total_lines_cleared = 0;
     state->total_attack = 0;
     state->total_lines_sent = 0;
-    // initialize garbage queues
-    std::fill(std::begin(state->garbage_queue), std::end(state->garbage_queue), 0);
-    std::fill(std::begin(state->garbage_delay), std::end(state->garbage_delay), 0);
+    // initialize garbage queue
+    std::fill(std::begin(state->garbage_arrival), std::end(state->garbage_arrival), 0);
+    std::fill(std::begin(state->garbage_lines), std::end(state->garbage_lines), 0);
+    state->garbage_head = 0;
+    state->garbage_count = 0;
     // spawn current piece
     PieceType next_piece = fetchNextPiece(state);
     newCurrentPiece(state, next_piece);
@@ -728,18 +732,39 @@ bool noop(State* state) {
     return true;
 }
 
+bool canMoveCurrentPiece(const State* state, int dx, int dy) {
+    return ops::canPlacePiece(state->board, ops::getPiece(state->current, state->orientation), state->x + dx, state->y + dy);
+}
+bool canRotateCurrentPiece(const State* state, Rotation rot) {
+    RotationKick kick;
+    return findRotationKick(state, rot, &kick);
+}
+
 bool addGarbage(State* state, std::uint8_t lines, std::uint8_t delay) {
     if (lines == 0) { return false; }
-    for (int i = 0; i < GARBAGE_QUEUE_SIZE; ++i) {
-        if (state->garbage_queue[i] == 0) {
-            assert(state->garbage_delay[i] == 0);
-            state->garbage_queue[i] = lines;
-            state->garbage_delay[i] = delay;
-            return true;
-        }
+    const std::uint32_t arrival = state->piece_count + delay;
+    if (state->garbage_count >= garbageCapacity(state)) {
+        // queue full: merge into the latest entry, which then arrives with the later of both
+        const int last = garbageIndex(state, state->garbage_count - 1);
+        if (state->garbage_lines[last] + lines > std::numeric_limits<std::uint8_t>::max()) { return false; }
+        state->garbage_lines[last] = static_cast<std::uint8_t>(state->garbage_lines[last] + lines);
+        if (pieceCountDiff(arrival, state->garbage_arrival[last]) > 0) { state->garbage_arrival[last] = arrival; }
+        return true;
     }
-    // TODO: garbage queue full, maybe append to the last entry?
-    return false;
+    // insert after every entry arriving no later (usually the back, so this is O(1))
+    int i = state->garbage_count;
+    for (; i > 0; --i) {
+        const int prev = garbageIndex(state, i - 1);
+        if (pieceCountDiff(state->garbage_arrival[prev], arrival) <= 0) { break; }
+        const int slot = garbageIndex(state, i);
+        state->garbage_arrival[slot] = state->garbage_arrival[prev];
+        state->garbage_lines[slot] = state->garbage_lines[prev];
+    }
+    const int slot = garbageIndex(state, i);
+    state->garbage_arrival[slot] = arrival;
+    state->garbage_lines[slot] = lines;
+    state->garbage_count++;
+    return true;
 }
 
 void toString(State* state, char* buf, std::size_t size) {
@@ -816,18 +841,18 @@ void toString(State* state, char* buf, std::size_t size) {
         if (hold == PieceType::NONE) { return; }
         drawPiece(sl, STRING_HOLD_X, STRING_HOLD_Y, hold, 0, half_shift[static_cast<std::underlying_type_t<PieceType>>(hold)]);
     };
-    static constexpr auto drawNext = [](StringLayout& sl, const PieceType* next) {
-        for (int i = 0; i < 5; ++i) {
-            if (next[i] == PieceType::NONE) { break; }
-            drawPiece(sl, STRING_NEXT_X, STRING_NEXT_Y + i * STRING_NEXT_SPACING, next[i], 0, half_shift[static_cast<std::underlying_type_t<PieceType>>(next[i])]);
+    static constexpr auto drawNext = [](StringLayout& sl, const State* state) {
+        for (int i = 0; i < 5 && i < state->next_count; ++i) {
+            const PieceType next = peekNext(state, i);
+            drawPiece(sl, STRING_NEXT_X, STRING_NEXT_Y + i * STRING_NEXT_SPACING, next, 0, half_shift[static_cast<std::underlying_type_t<PieceType>>(next)]);
         }
     };
-    static constexpr auto drawPendingGarbageQueue = [](StringLayout& sl, std::uint8_t garbage_queue[], std::uint8_t garbage_delay[]) {
+    static constexpr auto drawPendingGarbageQueue = [](StringLayout& sl, const State* state) {
         int string_y = STRING_GARBAGE_BOTTOM;
-        for (int i = 0; i < GARBAGE_QUEUE_SIZE; ++i) {
-            if (garbage_queue[i] == 0 || string_y < STRING_GARBAGE_TOP) { break; }
-            int length = garbage_queue[i];
-            int delay = garbage_delay[i];
+        for (int i = 0; i < state->garbage_count; ++i) {
+            if (string_y < STRING_GARBAGE_TOP) { break; }
+            int length = peekGarbageLines(state, i);
+            int delay = peekGarbageDelay(state, i);
             char symbol = delay <= pending_garbage_symbol_size ? pending_garbage_symbols[delay] : pending_garbage_symbols[pending_garbage_symbol_size - 1];
             for (; string_y >= STRING_GARBAGE_TOP && length > 0; --string_y, --length) {
                 sl.board[string_y][STRING_GARBAGE_LEFT] = symbol;
@@ -872,9 +897,9 @@ void toString(State* state, char* buf, std::size_t size) {
     drawPiece(*sl, current_string_x, current_string_y, state->current, state->orientation);
     // draw hold and next pieces
     drawHold(*sl, state->hold);
-    drawNext(*sl, state->next);
+    drawNext(*sl, state);
     // draw pending garbage queue
-    drawPendingGarbageQueue(*sl, state->garbage_queue, state->garbage_delay);
+    drawPendingGarbageQueue(*sl, state);
 }
 
 void placeCurrentPiece(State* state) { ops::placePiece(state->board, ops::getPiece(state->current, state->orientation), state->x, state->y); }
@@ -18,7 +18,13 @@ constexpr int BOARD_FLOOR   = BOARD_HEIGHT - BOARD_BOTTOM - 1;  // floor wall th
 constexpr int PIECE_SPAWN_X = BOARD_LEFT + 3;
 constexpr int PIECE_SPAWN_Y = BOARD_TOP - 1;
 
-constexpr int GARBAGE_QUEUE_SIZE = 20;
+constexpr int GARBAGE_QUEUE_SIZE = 64; // ring-buffer capacity of the pending-garbage queue (power of two)
+static_assert((GARBAGE_QUEUE_SIZE & (GARBAGE_QUEUE_SIZE - 1)) == 0, "GARBAGE_QUEUE_SIZE must be a power of two");
+
+constexpr int NEXT_QUEUE_SIZE = 64; // ring-buffer capacity of the piece queue (power of two)
+constexpr int NEXT_PREVIEW    = 14; // minimum number of queued pieces after every fetch
+static_assert((NEXT_QUEUE_SIZE & (NEXT_QUEUE_SIZE - 1)) == 0, "NEXT_QUEUE_SIZE must be a power of two");
+static_assert(NEXT_QUEUE_SIZE - NEXT_PREVIEW >= 7, "piece queue must fit at least one extra bag");
 
 using Row = std::uint32_t;
 template <std::size_t N>
@@ -202,13 +208,16 @@ enum class SpinType : std::uint8_t {
 struct State {
     Board board;
     std::uint8_t /* bool */ is_alive;
-    PieceType next[14];
+    PieceType next[NEXT_QUEUE_SIZE];           // ring buffer of upcoming pieces, read through peekNext()
+    std::uint8_t next_head;                    // ring-buffer index of the next piece
+    std::uint8_t next_count;                   // number of queued pieces (>= NEXT_PREVIEW while playing)
     PieceType hold;
     std::uint8_t /* bool */ has_held;
     PieceType current;
     std::uint8_t orientation;
     std::int8_t x, y;
-    std::uint32_t seed;
+    std::uint32_t seed;                        // piece stream key (counter-based, any value is valid)
+    std::uint32_t bag_index;                   // counter of the next 7-bag drawn from the piece stream
     std::int8_t srs_index;
     std::uint32_t piece_count;
     // TODO: remove was_last_rotation and use spin_type only
@@ -224,11 +233,16 @@ struct State {
     std::uint32_t total_attack;                // Total attack accumulated
     std::uint32_t total_lines_sent;            // Total lines sent to opponent
     std::uint32_t garbage_seed;
-    std::uint8_t garbage_queue[GARBAGE_QUEUE_SIZE];
-    std::uint8_t garbage_delay[GARBAGE_QUEUE_SIZE];
+    // Pending garbage: ring buffer of entries ordered by arrival, read through peekGarbage*().
+    // An entry is due at the first lock with piece_count >= its arrival.
+    std::uint32_t garbage_arrival[GARBAGE_QUEUE_SIZE];
+    std::uint8_t garbage_lines[GARBAGE_QUEUE_SIZE];
+    std::uint8_t garbage_head;                       // ring-buffer index of the earliest entry
+    std::uint8_t garbage_count;                      // number of pending entries
     // Configurations (TODO: pack configurations into a struct?)
     std::uint8_t max_garbage_spawn = 6;              // Maximum garbage lines that can be placed at once
     std::uint8_t /* bool */ garbage_blocking = true; // If true, clears temporarily block garbage placement
+    std::uint8_t garbage_capacity = GARBAGE_QUEUE_SIZE; // Pending entries kept before new garbage merges into the last one (0 = GARBAGE_QUEUE_SIZE)
 };
 
 // Super Rotation System (https://harddrop.com/wiki/SRS)
@@ -301,7 +315,34 @@ inline constexpr bool canPlacePiece(const Board& board, const Piece& piece, int
 
 } // namespace ops
 
+// Returns the i-th upcoming piece (0 = next). Valid for i < state->next_count.
+inline constexpr PieceType peekNext(const State* state, int i) { return state->next[(state->next_head + i) & (NEXT_QUEUE_SIZE - 1)]; }
+
+// The i-th pending garbage entry (0 = earliest arrival). Valid for i < state->garbage_count.
+inline constexpr int garbageIndex(const State* state, int i) { return (state->garbage_head + i) & (GARBAGE_QUEUE_SIZE - 1); }
+inline constexpr std::uint8_t peekGarbageLines(const State* state, int i) { return state->garbage_lines[garbageIndex(state, i)]; }
+// Delay of the entry in locks, counted down from the value passed to addGarbage
+// (0 and 1 both mean it is due at the next lock).
+inline constexpr int peekGarbageDelay(const State* state, int i) {
+    const auto delay = static_cast<std::int32_t>(state->garbage_arrival[garbageIndex(state, i)] - state->piece_count);
+    return delay > 0 ? delay : 0;
+}
+// Entries the garbage queue holds before addGarbage merges into the latest one
+// (garbage_capacity, where 0 or anything above GARBAGE_QUEUE_SIZE means GARBAGE_QUEUE_SIZE).
+inline constexpr int garbageCapacity(const State* state) {
+    const int capacity = state->garbage_capacity;
+    return capacity == 0 || capacity > GARBAGE_QUEUE_SIZE ? GARBAGE_QUEUE_SIZE : capacity;
+}
+// Total pending garbage lines.
+inline constexpr int pendingGarbageLines(const State* state) {
+    int lines = 0;
+    for (int i = 0; i < state->garbage_count; ++i) { lines += peekGarbageLines(state, i); }
+    return lines;
+}
+
 void setSeed(State* state, std::uint32_t seed, std::uint32_t garbage_seed);
+// Skips `bags` 7-bags of the piece stream (applies to bags not generated yet).
+void jumpPieceStream(State* state, std::uint32_t bags);
 
 void reset(State* state);
 
@@ -318,6 +359,13 @@ bool rotate180(State* state);
 bool hold(State* state);
 bool noop(State* state);
 
+// Side-effect free probes: whether moving by (dx, dy) or rotating (with SRS kicks) would succeed.
+bool canMoveCurrentPiece(const State* state, int dx, int dy);
+bool canRotateCurrentPiece(const State* state, Rotation rot);
+
+// Queues `lines` garbage lines due `delay` locks from now. Entries are kept in
+// arrival order; once garbage_capacity entries are pending, the lines merge into
+// the latest one. Returns false if lines == 0 or a merged entry would exceed 255 lines.
 bool addGarbage(State* state, std::uint8_t lines, std::uint8_t delay);
 
 void toString(State* state, char* buf, std::size_t size);
@@ -0,0 +1,123 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include <cstdint>
+
+namespace tetrl::envs::step {
+
+constexpr int VISIBLE_ROWS = BOARD_BOTTOM - BOARD_TOP + 1;  // 20
+constexpr int VISIBLE_COLS = BOARD_RIGHT - BOARD_LEFT + 1;  // 10
+
+constexpr Row makePlayfieldMask() {
+    Row mask = 0;
+    for (int col = BOARD_LEFT; col <= BOARD_RIGHT; ++col) { mask |= ops::shift(static_cast<Row>(Cell::BLOCK), col); }
+    return mask;
+}
+// Occupied flag of every playfield cell of a row.
+constexpr Row PLAYFIELD_MASK = makePlayfieldMask();
+
+inline int countCells(Row occupied) {
+#if defined(__clang__) || defined(__GNUC__)
+    return __builtin_popcount(static_cast<unsigned int>(occupied));
+#else
+    int count = 0;
+    for (; occupied != 0; occupied &= occupied - 1) { ++count; }
+    return count;
+#endif
+}
+
+// Column statistics of the visible board, as occupied-flag masks per visible row
+// (index 0 = BOARD_TOP). Test a cell with `mask & ops::shift(Row(Cell::BLOCK), x)`.
+struct BoardAnalysis {
+    Row top[VISIBLE_ROWS];   // cells at or below the highest block of their column
+    Row holes[VISIBLE_ROWS]; // empty cells below the highest block of their column
+    int hole_count;
+    int stack_void_count;    // empty cells in and below the highest non-empty row
+};
+
+inline BoardAnalysis analyzeBoard(const Board& board) {
+    BoardAnalysis a;
+    a.hole_count = 0;
+    a.stack_void_count = 0;
+    Row filled = 0;
+    for (int r = 0; r < VISIBLE_ROWS; ++r) {
+        const Row occupied = board.data[BOARD_TOP + r] & PLAYFIELD_MASK;
+        a.holes[r] = filled & ~occupied;
+        filled |= occupied;
+        a.top[r] = filled;
+        a.hole_count += countCells(a.holes[r]);
+        if (filled != 0) { a.stack_void_count += VISIBLE_COLS - countCells(occupied); }
+    }
+    return a;
+}
+
+// Row the current piece would land on with a hard drop.
+inline std::int8_t ghostY(const State* state) {
+    const Piece& piece = ops::getPiece(state->current, state->orientation);
+    int y = state->y;
+    while (ops::canPlacePiece(state->board, piece, state->x, y + 1)) { ++y; }
+    return static_cast<std::int8_t>(y);
+}
+
+// Per-step analysis of one state, computed lazily and at most once. Plugins do
+// not own one; they query the helpers below, which reuse the analysis the
+// fused driver installs for the state being stepped (see ScopedStepAnalysis)
+// and compute directly otherwise. Plugins must leave the state unchanged
+// between queries (temporary place/remove pairs are fine).
+class StepAnalysis {
+public:
+    explicit StepAnalysis(const State* state) : state_(state) {}
+
+    const State* state() const { return state_; }
+
+    const BoardAnalysis& board() {
+        if (!has_board_) { board_ = analyzeBoard(state_->board); has_board_ = true; }
+        return board_;
+    }
+    std::int8_t ghostY() {
+        if (!has_ghost_) { ghost_y_ = step::ghostY(state_); has_ghost_ = true; }
+        return ghost_y_;
+    }
+
+private:
+    const State*  state_;
+    bool          has_board_ = false;
+    bool          has_ghost_ = false;
+    std::int8_t   ghost_y_   = 0;
+    BoardAnalysis board_;
+};
+
+inline StepAnalysis*& activeStepAnalysis() {
+    thread_local StepAnalysis* active = nullptr;
+    return active;
+}
+
+// Installs `analysis` for the lifetime of the scope.
+class ScopedStepAnalysis {
+public:
+    explicit ScopedStepAnalysis(StepAnalysis* analysis) : previous_(activeStepAnalysis()) { activeStepAnalysis() = analysis; }
+    ~ScopedStepAnalysis() { activeStepAnalysis() = previous_; }
+    ScopedStepAnalysis(const ScopedStepAnalysis&) = delete;
+    ScopedStepAnalysis& operator=(const ScopedStepAnalysis&) = delete;
+
+private:
+    StepAnalysis* previous_;
+};
+
+inline StepAnalysis* sharedAnalysis(const State* state) {
+    StepAnalysis* active = activeStepAnalysis();
+    return active != nullptr && active->state() == state ? active : nullptr;
+}
+
+// Board analysis of `state`; `scratch` receives it when no shared analysis applies.
+inline const BoardAnalysis& boardAnalysis(const State* state, BoardAnalysis* scratch) {
+    if (StepAnalysis* shared = sharedAnalysis(state)) { return shared->board(); }
+    *scratch = analyzeBoard(state->board);
+    return *scratch;
+}
+
+inline std::int8_t sharedGhostY(const State* state) {
+    if (StepAnalysis* shared = sharedAnalysis(state)) { return shared->ghostY(); }
+    return ghostY(state);
+}
+
+} // namespace tetrl::envs::step
@@ -0,0 +1,265 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/step.hpp"
+#include "envs/step/plugin.hpp"
+#include "envs/step/analysis.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace tetrl::envs::step {
+
+// Battle room: the N games ("players") of one multiplayer match, stepped
+// together in one call per tick.
+//
+// Garbage a player sends (State::lines_sent, i.e. what is left after
+// countering its own pending garbage) goes to one opponent chosen by the
+// player's targeting strategy and is queued there with addGarbage, so every
+// player's garbage queue is its incoming queue and cancelling, blocking and
+// spawning follow the engine rules. A player whose game ends is eliminated:
+// it is neither stepped nor targeted any more, gets its final place, and the
+// opponent whose garbage reached it last is credited with the KO. The match
+// is over once at most one player is left.
+//
+// A tick steps the live players (spread over threads: their games do not
+// interact within a tick), then routes the attacks and eliminates players
+// sequentially in player order, so results do not depend on the thread
+// count. Targeting draws come from a counter-based stream of the seed, the
+// match, the tick and the player, like the episode seeds of the vector env.
+
+enum BattleTargeting : std::uint8_t {
+    TARGET_RANDOM,    // a random opponent, drawn for every attack
+    TARGET_ATTACKERS, // the opponent that attacked this player last (random until someone does)
+    TARGET_KO,        // the opponent closest to topping out: most pending garbage, then highest stack
+    TARGET_BADGES,    // the opponent with the most KOs
+    TARGET_COUNT
+};
+
+struct BattleOptions {
+    std::uint64_t seed;
+    std::int32_t  garbage_delay; // receiver locks before routed garbage is due (clamped to [0, 255])
+    std::uint8_t  same_pieces;   // every player gets the piece sequence of player 0 (bool)
+    std::uint8_t  threads;       // worker threads of the step phase (0 or 1 = caller only)
+    std::uint8_t  reserved[2];
+    Config        config;
+};
+
+// Per-player match state, written by battleReset / battleStep.
+struct BattlePlayer {
+    std::int32_t  target;     // opponent of the last attack (-1: none yet)
+    std::int32_t  attacker;   // opponent whose garbage arrived last (-1: none yet)
+    std::uint32_t kos;        // opponents eliminated with this player as their last attacker
+    std::uint32_t received;   // garbage lines queued on this player
+    std::uint16_t sent;       // garbage lines this player queued on its target in the last tick
+    std::uint16_t place;      // final place (1 = winner), 0 while playing
+    std::uint8_t  strategy;   // BattleTargeting, kept across matches
+    std::uint8_t  alive;      // still in the match (bool)
+    std::uint8_t  height;     // stack height in visible rows after the last tick
+    std::uint8_t  reserved;
+};
+
+struct BattleRoom {
+    Context*      contexts;   // size
+    BattlePlayer* players;    // size
+    std::int32_t  size;
+    std::int32_t  alive;      // players still in the match
+    std::uint32_t match;      // matches started (counter of the reset seeds)
+    std::uint32_t tick;       // ticks of the running match
+    BattleOptions options;
+};
+
+namespace battle_detail {
+
+inline std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+inline std::uint64_t draw(const BattleRoom* room, int player) {
+    const std::uint64_t counter = (static_cast<std::uint64_t>(room->match) << 32 | room->tick) * 0x9e3779b97f4a7c15ull;
+    return mix(room->options.seed ^ mix(counter + static_cast<std::uint64_t>(player) + 1));
+}
+
+inline std::uint8_t stackHeight(const Board& board) {
+    for (int r = 0; r < VISIBLE_ROWS; ++r) {
+        if (board.data[BOARD_TOP + r] & PLAYFIELD_MASK) { return static_cast<std::uint8_t>(VISIBLE_ROWS - r); }
+    }
+    return 0;
+}
+
+// Whether player j can receive garbage: in the match and its game not over.
+inline bool targetable(const BattleRoom* room, int j) {
+    return room->players[j].alive && room->contexts[j].state.is_alive;
+}
+
+// The opponent of `from` with the largest score(j), uniformly at random
+// among the tied best (r picks one); -1 if there is none.
+template <typename Score>
+inline int bestOpponent(const BattleRoom* room, int from, std::uint64_t r, Score score) {
+    const int n = room->size;
+    int ties = 0;
+    decltype(score(0)) best_score{};
+    for (int j = 0; j < n; ++j) {
+        if (j == from || !targetable(room, j)) { continue; }
+        const auto s = score(j);
+        if (ties == 0 || s > best_score) {
+            best_score = s;
+            ties = 1;
+        } else if (s == best_score) {
+            ++ties;
+        }
+    }
+    if (ties == 0) { return -1; }
+    int pick = static_cast<int>(r % static_cast<std::uint64_t>(ties));
+    for (int j = 0; j < n; ++j) {
+        if (j == from || !targetable(room, j) || score(j) != best_score) { continue; }
+        if (pick-- == 0) { return j; }
+    }
+    return -1;
+}
+
+// Queues `lines` garbage lines on `state` in entries of at most 255 lines.
+// Once the queue is full, addGarbage merges into the latest entry, so chunks
+// are clamped to what that entry can still take. Returns the lines queued.
+inline int queueGarbage(State* state, int lines, std::uint8_t delay) {
+    int queued = 0;
+    while (queued < lines) {
+        int chunk = std::min(lines - queued, 255);
+        if (state->garbage_count >= garbageCapacity(state)) {
+            chunk = std::min(chunk, 255 - peekGarbageLines(state, state->garbage_count - 1));
+        }
+        if (chunk <= 0 || !addGarbage(state, static_cast<std::uint8_t>(chunk), delay)) { break; }
+        queued += chunk;
+    }
+    return queued;
+}
+
+inline int chooseTarget(const BattleRoom* room, int from) {
+    const BattlePlayer* players = room->players;
+    const std::uint64_t r = draw(room, from);
+    switch (players[from].strategy) {
+    case TARGET_ATTACKERS: {
+        const int attacker = players[from].attacker;
+        if (attacker >= 0 && attacker != from && targetable(room, attacker)) { return attacker; }
+        break;
+    }
+    case TARGET_KO:
+        return bestOpponent(room, from, r, [&](int j) {
+            return pendingGarbageLines(&room->contexts[j].state) * 32 + players[j].height;
+        });
+    case TARGET_BADGES:
+        return bestOpponent(room, from, r, [&](int j) { return players[j].kos; });
+    default:
+        break;
+    }
+    return bestOpponent(room, from, r, [](int) { return 0; });
+}
+
+// Calls body(begin, end) for contiguous player ranges spread over `threads` threads.
+template <typename Body>
+inline void forPlayers(int n, int threads, Body body) {
+    threads = std::clamp(threads, 1, std::max(n, 1));
+    if (threads == 1) {
+        body(0, n);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) { pool.emplace_back(body, n * t / threads, n * (t + 1) / threads); }
+    body(0, n / threads);
+    for (auto& thread : pool) { thread.join(); }
+}
+
+} // namespace battle_detail
+
+// Starts the next match: every player is reset with the seeds of
+// (options.seed, player, match) and is back in the game.
+inline void battleReset(BattleRoom* room) {
+    const BattleOptions& o = room->options;
+    for (int i = 0; i < room->size; ++i) {
+        Context* ctx = &room->contexts[i];
+        std::uint32_t piece_seed, garbage_seed, unused;
+        episodeSeeds(o.seed, static_cast<std::uint32_t>(i), room->match, &piece_seed, &garbage_seed);
+        if (o.same_pieces) { episodeSeeds(o.seed, 0, room->match, &piece_seed, &unused); }
+        setConfig(ctx, o.config);
+        setSeed(ctx, piece_seed, garbage_seed);
+        reset(ctx);
+        BattlePlayer& p = room->players[i];
+        const std::uint8_t strategy = p.strategy < TARGET_COUNT ? p.strategy : static_cast<std::uint8_t>(TARGET_RANDOM);
+        p = BattlePlayer{};
+        p.target   = -1;
+        p.attacker = -1;
+        p.strategy = strategy;
+        p.alive    = 1;
+    }
+    room->alive = room->size;
+    room->match++;
+    room->tick = 0;
+}
+
+// Advances the match by one tick: steps every live player with its action
+// (infos[i] is left zeroed for eliminated players), routes the garbage sent
+// by pieces locked in this tick and eliminates the players whose game ended.
+// Players eliminated in the same tick share their place. Returns the number
+// of players left; stepping a finished match does nothing.
+inline int battleStep(BattleRoom* room, const Action* actions, Info* infos) {
+    const int n = room->size;
+    BattlePlayer* players = room->players;
+    if (room->alive <= 1) {
+        for (int i = 0; i < n; ++i) {
+            infos[i] = Info{};
+            players[i].sent = 0;
+        }
+        return room->alive;
+    }
+    battle_detail::forPlayers(n, room->options.threads, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            infos[i] = Info{};
+            if (!players[i].alive) { continue; }
+            infos[i] = step(&room->contexts[i], actions[i]);
+            players[i].height = battle_detail::stackHeight(room->contexts[i].state.board);
+        }
+    });
+
+    const auto delay = static_cast<std::uint8_t>(std::clamp(room->options.garbage_delay, 0, 255));
+    for (int i = 0; i < n; ++i) {
+        BattlePlayer& p = players[i];
+        p.sent = 0;
+        const int lines = p.alive && isLockingStep(infos[i]) ? room->contexts[i].state.lines_sent : 0;
+        if (lines == 0) { continue; }
+        const int target = battle_detail::chooseTarget(room, i);
+        if (target < 0) { continue; }
+        p.target = target;
+        const int queued = battle_detail::queueGarbage(&room->contexts[target].state, lines, delay);
+        if (queued == 0) { continue; }  // the target's queue is saturated
+        p.sent = static_cast<std::uint16_t>(queued);
+        players[target].attacker = i;
+        players[target].received += static_cast<std::uint32_t>(queued);
+    }
+
+    int eliminated = 0;
+    for (int i = 0; i < n; ++i) {
+        if (players[i].alive && !room->contexts[i].state.is_alive) { ++eliminated; }
+    }
+    if (eliminated > 0) {
+        const int left = room->alive - eliminated;
+        for (int i = 0; i < n; ++i) {
+            BattlePlayer& p = players[i];
+            if (!p.alive || room->contexts[i].state.is_alive) { continue; }
+            p.alive = 0;
+            p.place = static_cast<std::uint16_t>(left + 1);
+            if (p.attacker >= 0) { players[p.attacker].kos++; }
+        }
+        room->alive = left;
+        if (left == 1) {
+            for (int i = 0; i < n; ++i) {
+                if (players[i].alive) { players[i].place = 1; }
+            }
+        }
+    }
+    room->tick++;
+    return room->alive;
+}
+
+} // namespace tetrl::envs::step
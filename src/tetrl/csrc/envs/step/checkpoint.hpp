@@ -0,0 +1,127 @@
+#pragma once
+#include "envs/step/step.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace tetrl::envs::step {
+
+// Env-pool checkpoint file (written and mapped by tetrl/envs/step/checkpoint.py):
+//
+//   CheckpointHeader
+//   sections, each starting at a multiple of CHECKPOINT_ALIGN:
+//     contexts          num_envs * sizeof(Context)
+//     feature contexts  num_envs * feature_context_size
+//     reward contexts   num_envs * reward_context_size
+//     infos             num_envs * sizeof(Info)
+//     steps             num_envs * int32
+//     episodes          num_envs * uint32
+//     observations      num_envs * feature_size * float (optional)
+//
+// The section offsets are recorded in the header, so a reader maps each one in
+// place. All values are in the writer's native byte order; `layout` rejects
+// files from builds whose Context or Info differ in any field offset or size.
+
+constexpr char          CHECKPOINT_MAGIC[8]  = {'T', 'E', 'T', 'R', 'L', 'C', 'K', 'P'};
+constexpr std::uint32_t CHECKPOINT_VERSION   = 1;
+constexpr std::uint64_t CHECKPOINT_ALIGN     = 64;
+
+enum CheckpointSection : int {
+    SECTION_CONTEXTS,
+    SECTION_FEATURE_CONTEXTS,
+    SECTION_REWARD_CONTEXTS,
+    SECTION_INFOS,
+    SECTION_STEPS,
+    SECTION_EPISODES,
+    SECTION_OBSERVATIONS,
+    SECTION_COUNT,
+};
+
+struct CheckpointHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t layout;                  // contextLayoutHash() of the writer
+    std::uint64_t file_size;
+    std::uint32_t num_envs;
+    std::uint32_t feature_size;            // floats per observation
+    std::uint64_t feature_context_size;
+    std::uint64_t reward_context_size;
+    std::uint8_t  feature_id[32];          // plugin source digests (all zero = unknown)
+    std::uint8_t  reward_id[32];
+    std::uint64_t seed;                    // VectorBuffers::seed
+    std::int32_t  max_steps;
+    std::uint32_t has_observations;
+    std::uint64_t offsets[SECTION_COUNT];  // byte offset of each section (0 = absent)
+};
+
+namespace checkpoint_detail {
+
+constexpr std::uint64_t fnv(std::uint64_t h, std::uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        h = (h ^ (v >> (8 * i) & 0xff)) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+} // namespace checkpoint_detail
+
+#define TETRL_LAYOUT_FIELD(h, type, field) \
+    checkpoint_detail::fnv(checkpoint_detail::fnv(h, offsetof(type, field)), sizeof(type::field))
+
+// Fingerprint of the byte layout of Context and Info: every field's offset and
+// size, plus the struct sizes.
+constexpr std::uint64_t contextLayoutHash() {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    h = checkpoint_detail::fnv(h, sizeof(Context));
+    h = checkpoint_detail::fnv(h, sizeof(State));
+    h = checkpoint_detail::fnv(h, sizeof(Info));
+    h = TETRL_LAYOUT_FIELD(h, State, board);
+    h = TETRL_LAYOUT_FIELD(h, State, is_alive);
+    h = TETRL_LAYOUT_FIELD(h, State, next);
+    h = TETRL_LAYOUT_FIELD(h, State, next_head);
+    h = TETRL_LAYOUT_FIELD(h, State, next_count);
+    h = TETRL_LAYOUT_FIELD(h, State, hold);
+    h = TETRL_LAYOUT_FIELD(h, State, has_held);
+    h = TETRL_LAYOUT_FIELD(h, State, current);
+    h = TETRL_LAYOUT_FIELD(h, State, orientation);
+    h = TETRL_LAYOUT_FIELD(h, State, x);
+    h = TETRL_LAYOUT_FIELD(h, State, y);
+    h = TETRL_LAYOUT_FIELD(h, State, seed);
+    h = TETRL_LAYOUT_FIELD(h, State, bag_index);
+    h = TETRL_LAYOUT_FIELD(h, State, srs_index);
+    h = TETRL_LAYOUT_FIELD(h, State, piece_count);
+    h = TETRL_LAYOUT_FIELD(h, State, was_last_rotation);
+    h = TETRL_LAYOUT_FIELD(h, State, spin_type);
+    h = TETRL_LAYOUT_FIELD(h, State, perfect_clear);
+    h = TETRL_LAYOUT_FIELD(h, State, back_to_back_count);
+    h = TETRL_LAYOUT_FIELD(h, State, combo_count);
+    h = TETRL_LAYOUT_FIELD(h, State, lines_cleared);
+    h = TETRL_LAYOUT_FIELD(h, State, attack);
+    h = TETRL_LAYOUT_FIELD(h, State, lines_sent);
+    h = TETRL_LAYOUT_FIELD(h, State, total_lines_cleared);
+    h = TETRL_LAYOUT_FIELD(h, State, total_attack);
+    h = TETRL_LAYOUT_FIELD(h, State, total_lines_sent);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_seed);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_arrival);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_lines);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_head);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_count);
+    h = TETRL_LAYOUT_FIELD(h, State, max_garbage_spawn);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_blocking);
+    h = TETRL_LAYOUT_FIELD(h, State, garbage_capacity);
+    h = TETRL_LAYOUT_FIELD(h, Context, state);
+    h = TETRL_LAYOUT_FIELD(h, Context, lifetime);
+    h = TETRL_LAYOUT_FIELD(h, Context, config);
+    h = TETRL_LAYOUT_FIELD(h, Config, piece_life);
+    h = TETRL_LAYOUT_FIELD(h, Config, auto_drop);
+    h = TETRL_LAYOUT_FIELD(h, Config, action_mask);
+    h = TETRL_LAYOUT_FIELD(h, Info, action_id);
+    h = TETRL_LAYOUT_FIELD(h, Info, action_success);
+    h = TETRL_LAYOUT_FIELD(h, Info, forced_hard_drop);
+    h = TETRL_LAYOUT_FIELD(h, Info, action_mask);
+    return h;
+}
+
+#undef TETRL_LAYOUT_FIELD
+
+} // namespace tetrl::envs::step
@@ -0,0 +1,250 @@
+#pragma once
+#include "envs/step/step.hpp"
+#include "envs/step/analysis.hpp"
+#include "envs/step/replay.hpp"
+#include "envs/step/start_states.hpp"
+#include "envs/step/telemetry.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace tetrl::envs::step {
+
+// Plugin entry points, resolved from the plugin libraries by address.
+// Batch calls operate on n contiguous Contexts / Infos; plugin_ctxs holds n
+// plugin contexts of *_context_size bytes each and feature rows are `stride`
+// floats apart.
+using FeatureResetFn     = void (*)(Context* ctx, void* plugin_ctx);
+using FeatureStepBatchFn = void (*)(Context* ctxs, Info* infos, void* plugin_ctxs, float* out, int n, std::size_t stride);
+using RewardResetFn      = void (*)(Context* ctx, void* plugin_ctx);
+using RewardStepBatchFn  = void (*)(Context* ctxs, Info* infos, void* plugin_ctxs, float* out, int n);
+// Feature and reward of one fused library (see CppFusedPlugins) evaluated together.
+using FusedStepBatchFn   = void (*)(Context* ctxs, Info* infos, void* feature_ctxs, void* reward_ctxs,
+                                    float* out, float* rewards, int n, std::size_t stride);
+
+inline void* pluginContextAt(void* plugin_ctxs, std::size_t context_size, int i) {
+    return context_size ? static_cast<std::byte*>(plugin_ctxs) + i * context_size : nullptr;
+}
+
+// Plugin entry points may be called for different contexts from several
+// threads at once (e.g. one StepVectorEnv pool per thread), so plugin code
+// keeps no mutable globals: per-env state lives in the plugin context, lookup
+// tables are constexpr, and one-time setup goes in the optional *_init() hook,
+// which runs once per library before any other entry point. Temporary buffers
+// too large for the stack come from pluginScratch().
+
+// Growable 64-byte aligned block reused across calls.
+class ScratchArena {
+public:
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+    ~ScratchArena() { release(); }
+
+    void* reserve(std::size_t bytes) {
+        if (bytes > capacity_) {
+            release();
+            capacity_ = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+            data_ = ::operator new(capacity_, std::align_val_t{ALIGN});
+        }
+        return data_;
+    }
+
+private:
+    static constexpr std::size_t ALIGN = 64;
+
+    void release() {
+        if (data_ != nullptr) { ::operator delete(data_, std::align_val_t{ALIGN}); }
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    void*       data_ = nullptr;
+    std::size_t capacity_ = 0;
+};
+
+namespace {
+
+thread_local ScratchArena plugin_scratch;  // one per thread and per library
+
+// At least `bytes` of scratch memory owned by the calling thread, valid until
+// its next pluginScratch() call; contents are not preserved between calls.
+inline void* pluginScratch(std::size_t bytes) { return plugin_scratch.reserve(bytes); }
+
+} // namespace
+
+// Default batch loops for plugins that only define the single-step entry point.
+template <void (*Step)(Context*, Info*, void*, float*)>
+inline void featureStepLoop(Context* ctxs, Info* infos, void* plugin_ctxs, std::size_t context_size,
+                            float* out, int n, std::size_t stride) {
+    for (int i = 0; i < n; ++i) {
+        Step(&ctxs[i], &infos[i], pluginContextAt(plugin_ctxs, context_size, i), out + i * stride);
+    }
+}
+
+template <float (*Step)(Context*, Info*, void*)>
+inline void rewardStepLoop(Context* ctxs, Info* infos, void* plugin_ctxs, std::size_t context_size,
+                           float* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        out[i] = Step(&ctxs[i], &infos[i], pluginContextAt(plugin_ctxs, context_size, i));
+    }
+}
+
+// Runs both single-step entry points per context under one shared StepAnalysis,
+// so quantities both plugins query are computed once and the calls inline.
+template <void (*FeatureStep)(Context*, Info*, void*, float*), float (*RewardStep)(Context*, Info*, void*)>
+inline void fusedStepLoop(Context* ctxs, Info* infos,
+                          void* feature_ctxs, std::size_t feature_context_size,
+                          void* reward_ctxs, std::size_t reward_context_size,
+                          float* out, float* rewards, int n, std::size_t stride) {
+    for (int i = 0; i < n; ++i) {
+        StepAnalysis analysis(&ctxs[i].state);
+        ScopedStepAnalysis scope(&analysis);
+        FeatureStep(&ctxs[i], &infos[i], pluginContextAt(feature_ctxs, feature_context_size, i), out + i * stride);
+        rewards[i] = RewardStep(&ctxs[i], &infos[i], pluginContextAt(reward_ctxs, reward_context_size, i));
+    }
+}
+
+// stepSequence with the rewards of a (nullable) reward plugin summed into *reward_sum.
+inline int stepSequence(Context* ctx, const Action* actions, int n, std::uint8_t stop, Info* last,
+                        RewardStepBatchFn reward_step_batch, void* reward_ctx, float* reward_sum) {
+    float total = 0.0f;
+    const int executed = stepSequence(ctx, actions, n, stop, last, [&](Info& info) {
+        if (reward_step_batch != nullptr) {
+            float reward;
+            reward_step_batch(ctx, &info, reward_ctx, &reward, 1);
+            total += reward;
+        }
+    });
+    *reward_sum = total;
+    return executed;
+}
+
+struct PluginTable {
+    FeatureResetFn     feature_reset;
+    FeatureStepBatchFn feature_step_batch;
+    RewardResetFn      reward_reset;
+    RewardStepBatchFn  reward_step_batch;
+    FusedStepBatchFn   fused_step_batch;     // nullable; replaces both batch calls when set
+    void*              feature_ctxs;         // n * feature_context_size bytes
+    void*              reward_ctxs;          // n * reward_context_size bytes
+    std::int64_t       feature_context_size;
+    std::int64_t       reward_context_size;
+    std::int64_t       feature_size;         // floats per observation row
+};
+
+struct VectorBuffers {
+    float*         obs;        // n * feature_size
+    float*         final_obs;  // n * feature_size, rows of finished episodes (nullable)
+    float*         rewards;    // n
+    std::uint8_t*  terminated; // n
+    std::uint8_t*  truncated;  // n
+    Info*          infos;      // n
+    std::int32_t*  steps;      // n, steps taken in the running episode
+    std::uint32_t* episodes;   // n, episodes started so far (counter of the reset seeds)
+    std::uint64_t  seed;
+    std::int32_t   max_steps;  // truncate after this many steps (0 = never)
+    EpisodeTelemetry* episode_telemetry;  // n, running episode totals (nullable: no telemetry)
+    Telemetry*        telemetry;          // finished episodes and placements (set with episode_telemetry)
+    const Board*      start_states;       // start_state_count boards episodes start from (nullable: empty board)
+    std::int32_t      start_state_count;
+    ReplayBuffer*     replay;             // receives every transition (nullable)
+};
+
+// Seeds of episode `episode` of env `env`: a pure function of the counters, so
+// autoreset needs no RNG state and any env can be replayed in isolation.
+inline void episodeSeeds(std::uint64_t seed, std::uint32_t env, std::uint32_t episode,
+                         std::uint32_t* piece_seed, std::uint32_t* garbage_seed) {
+    std::uint64_t z = seed + 0x9e3779b97f4a7c15ull * ((static_cast<std::uint64_t>(env) << 32 | episode) + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    *piece_seed   = static_cast<std::uint32_t>(z);
+    *garbage_seed = static_cast<std::uint32_t>(z >> 32) | 1u; // xorshift32 must not start at 0
+}
+
+// Starts the next episode of env i and writes its initial observation.
+inline void vectorResetOne(const PluginTable* t, Context* ctxs, const VectorBuffers* b, int i) {
+    Context* ctx = &ctxs[i];
+    std::uint32_t piece_seed, garbage_seed;
+    episodeSeeds(b->seed, static_cast<std::uint32_t>(i), b->episodes[i]++, &piece_seed, &garbage_seed);
+    setSeed(ctx, piece_seed, garbage_seed);
+    reset(ctx);
+    if (b->start_state_count > 0) {
+        applyStartState(ctx, b->start_states[startStateIndex(garbage_seed, static_cast<std::uint32_t>(b->start_state_count))]);
+    }
+    b->steps[i] = 0;
+
+    void* feature_ctx = pluginContextAt(t->feature_ctxs, t->feature_context_size, i);
+    t->reward_reset(ctx, pluginContextAt(t->reward_ctxs, t->reward_context_size, i));
+    t->feature_reset(ctx, feature_ctx);
+    Info info{};
+    t->feature_step_batch(ctx, &info, feature_ctx, b->obs + i * t->feature_size, 1, t->feature_size);
+}
+
+inline void vectorReset(const PluginTable* t, Context* ctxs, const VectorBuffers* b, int n) {
+    for (int i = 0; i < n; ++i) {
+        vectorResetOne(t, ctxs, b, i);
+        b->infos[i] = Info{};
+        if (b->telemetry != nullptr) { b->episode_telemetry[i] = EpisodeTelemetry{}; }
+        b->infos[i].action_mask = ctxs[i].config.action_mask ? legalActions(&ctxs[i]) : 0;
+    }
+}
+
+// Steps every env, evaluates both plugins in one batch call each and resets
+// finished envs in place (same-step autoreset: obs holds the first observation
+// of the new episode, final_obs the last one of the finished episode).
+//
+// With a replay buffer, each env's transition is written straight from these
+// buffers: the observation and action before the step, the next (or final)
+// observation, reward and flags before the autoreset.
+inline void vectorStep(const PluginTable* t, Context* ctxs, const Action* actions, const VectorBuffers* b, int n) {
+    std::uint64_t ticket = 0;
+    if (b->replay != nullptr) {
+        ticket = b->replay->reserve(n);
+        for (int i = 0; i < n; ++i) {
+            b->replay->begin(ticket + i, b->obs + i * t->feature_size, static_cast<std::uint8_t>(actions[i]));
+        }
+    }
+    if (b->telemetry != nullptr) {
+        for (int i = 0; i < n; ++i) {
+            b->infos[i] = recordedStep(&ctxs[i], actions[i], &b->episode_telemetry[i], b->telemetry);
+            ++b->steps[i];
+        }
+    } else {
+        for (int i = 0; i < n; ++i) {
+            b->infos[i] = step(&ctxs[i], actions[i]);
+            ++b->steps[i];
+        }
+    }
+    if (t->fused_step_batch != nullptr) {
+        t->fused_step_batch(ctxs, b->infos, t->feature_ctxs, t->reward_ctxs, b->obs, b->rewards, n, t->feature_size);
+    } else {
+        t->feature_step_batch(ctxs, b->infos, t->feature_ctxs, b->obs, n, t->feature_size);
+        t->reward_step_batch(ctxs, b->infos, t->reward_ctxs, b->rewards, n);
+    }
+    for (int i = 0; i < n; ++i) {
+        const bool terminated = !ctxs[i].state.is_alive;
+        const bool truncated  = !terminated && b->max_steps > 0 && b->steps[i] >= b->max_steps;
+        b->terminated[i] = terminated;
+        b->truncated[i]  = truncated;
+        if (b->replay != nullptr) {
+            b->replay->end(ticket + i, b->obs + i * t->feature_size, b->rewards[i], terminated, truncated);
+        }
+        if (!terminated && !truncated) { continue; }
+        if (b->final_obs != nullptr) {
+            std::memcpy(b->final_obs + i * t->feature_size, b->obs + i * t->feature_size,
+                        sizeof(float) * t->feature_size);
+        }
+        if (b->telemetry != nullptr) {
+            finishEpisode(&ctxs[i].state, terminated, &b->episode_telemetry[i], b->telemetry);
+        }
+        vectorResetOne(t, ctxs, b, i);
+        if (ctxs[i].config.action_mask) {
+            b->infos[i].action_mask = legalActions(&ctxs[i]);
+        }
+    }
+}
+
+} // namespace tetrl::envs::step
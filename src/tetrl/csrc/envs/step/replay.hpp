@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace tetrl::envs::step {
+
+// Fixed-capacity circular replay buffer written by the vector driver.
+//
+// Transition k (counting every transition ever written) goes to slot
+// k % capacity: the observation the action was taken on, the action, the
+// reward, both episode-end flags and the observation after the step (the
+// final one when the episode ended, before the autoreset). The arrays are
+// allocated by the Python side (so they can be viewed as numpy arrays) and
+// rows are feature_size floats, the plugin output layout.
+//
+// Producers (vector pools stepping on different threads, or add()) reserve
+// slots with one fetch_add on the cursor and then write them without locks;
+// each slot carries a version that is odd while it is written, so samplers
+// skip or retry slots in flight instead of reading torn rows. With alpha > 0,
+// a sum tree over priority^alpha drives proportional sampling. Its leaves
+// are fixed-point integers, so a leaf update is an exchange plus one
+// fetch_add per level, which keeps inserts lock-free as well; new
+// transitions get the largest priority seen so far.
+//
+// A slot must not be reserved by two producers at once: capacity has to
+// exceed the transitions in flight (the sum of the pool sizes).
+
+struct ReplayStorage {
+    float*         obs;           // capacity * feature_size
+    float*         next_obs;      // capacity * feature_size
+    std::uint8_t*  actions;       // capacity
+    float*         rewards;       // capacity
+    std::uint8_t*  terminated;    // capacity
+    std::uint8_t*  truncated;     // capacity
+    std::int64_t   capacity;
+    std::int64_t   feature_size;
+    float          alpha;         // priority exponent; 0 = uniform sampling, no sum tree
+    std::uint64_t  seed;          // sampling stream
+};
+
+// Destination of sample(): count rows / entries each.
+struct ReplayBatch {
+    float*         obs;
+    float*         next_obs;
+    std::uint8_t*  actions;
+    float*         rewards;
+    std::uint8_t*  terminated;
+    std::uint8_t*  truncated;
+    std::int64_t*  indices;       // slots, for updatePriorities()
+    float*         weights;       // importance-sampling weights, max 1 (all 1 without priorities)
+};
+
+constexpr std::int64_t REPLAY_MAX_CAPACITY = std::int64_t{1} << 24;
+
+class ReplayBuffer {
+public:
+    // Fixed-point fraction bits of the sum-tree leaves; priority^alpha is
+    // clamped to [2^-PRIORITY_BITS, 2^PRIORITY_BITS], so the sum of
+    // REPLAY_MAX_CAPACITY leaves fits in 64 bits.
+    static constexpr int PRIORITY_BITS = 20;
+
+    explicit ReplayBuffer(const ReplayStorage& storage)
+        : s_(storage),
+          versions_(new std::atomic<std::uint64_t>[static_cast<std::size_t>(storage.capacity)]()) {
+        if (s_.alpha > 0.0f) {
+            while (leaves_ < s_.capacity) { leaves_ <<= 1; }
+            tree_.reset(new std::atomic<std::uint64_t>[static_cast<std::size_t>(2 * leaves_)]());
+        }
+    }
+
+    std::int64_t capacity() const { return s_.capacity; }
+    std::int64_t featureSize() const { return s_.feature_size; }
+    bool prioritized() const { return tree_ != nullptr; }
+
+    // Transitions that can be sampled.
+    std::int64_t size() const {
+        return static_cast<std::int64_t>(std::min<std::uint64_t>(committed_.load(std::memory_order_acquire), s_.capacity));
+    }
+
+    // Reserves n consecutive transitions; returns the first ticket.
+    std::uint64_t reserve(int n) { return cursor_.fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed); }
+
+    // First half of transition `ticket`: marks its slot in flight and stores
+    // the observation acted on and the action.
+    void begin(std::uint64_t ticket, const float* obs, std::uint8_t action) {
+        const std::int64_t slot = slotOf(ticket);
+        if (tree_ != nullptr) { setLeaf(slot, 0); }
+        const std::uint64_t v = versions_[slot].load(std::memory_order_relaxed);
+        versions_[slot].store(v | 1u, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(s_.obs + slot * s_.feature_size, obs, sizeof(float) * s_.feature_size);
+        s_.actions[slot] = action;
+    }
+
+    // Second half: the outcome of the step; publishes the slot.
+    void end(std::uint64_t ticket, const float* next_obs, float reward, bool terminated, bool truncated) {
+        const std::int64_t slot = slotOf(ticket);
+        std::memcpy(s_.next_obs + slot * s_.feature_size, next_obs, sizeof(float) * s_.feature_size);
+        s_.rewards[slot] = reward;
+        s_.terminated[slot] = terminated;
+        s_.truncated[slot] = truncated;
+        const std::uint64_t v = versions_[slot].load(std::memory_order_relaxed);
+        versions_[slot].store((v | 1u) + 1, std::memory_order_release);
+        if (tree_ != nullptr) { setLeaf(slot, max_leaf_.load(std::memory_order_relaxed)); }
+        committed_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Whole transitions from contiguous rows.
+    void add(const float* obs, const float* next_obs, const std::uint8_t* actions, const float* rewards,
+             const std::uint8_t* terminated, const std::uint8_t* truncated, int n) {
+        const std::uint64_t first = reserve(n);
+        for (int i = 0; i < n; ++i) {
+            begin(first + i, obs + i * s_.feature_size, actions[i]);
+            end(first + i, next_obs + i * s_.feature_size, rewards[i], terminated[i] != 0, truncated[i] != 0);
+        }
+    }
+
+    // Draws `count` transitions into *out*: stratified over the priority mass
+    // with priorities (importance weights (size * P)^-beta, scaled to a
+    // maximum of 1 within the batch), uniformly otherwise. `stream` selects
+    // the random stream, so equal (seed, stream) pairs repeat a draw on an
+    // unchanged buffer. Returns the number drawn (0 if the buffer is empty).
+    int sample(int count, float beta, std::uint64_t stream, const ReplayBatch& out) const {
+        const std::int64_t n = size();
+        if (n == 0 || count <= 0) { return 0; }
+        Rng rng{s_.seed ^ (0xd1b54a32d192ed03ull * (stream + 1))};
+        float max_weight = 0.0f;
+        for (int k = 0; k < count; ++k) {
+            std::int64_t slot = -1;
+            std::uint64_t leaf = 0, total = 0;
+            for (int attempt = 0; attempt < 64 && slot < 0; ++attempt) {
+                if (tree_ != nullptr) {
+                    total = tree_[1].load(std::memory_order_acquire);
+                    if (total == 0) { continue; }
+                    const std::uint64_t lo = total / count * k;
+                    const std::uint64_t span = attempt == 0 ? std::max<std::uint64_t>(total / count, 1) : total;
+                    const std::uint64_t base = attempt == 0 ? lo : 0;
+                    slot = find(base + rng.below(span), &leaf);
+                    if (slot >= n || leaf == 0) { slot = -1; continue; }
+                } else {
+                    slot = static_cast<std::int64_t>(rng.below(static_cast<std::uint64_t>(n)));
+                }
+                if (!copy(slot, k, out)) { slot = -1; }
+            }
+            if (slot < 0) {  // everything drawn was in flight; take any readable slot
+                for (std::int64_t i = 0; i < n && slot < 0; ++i) {
+                    if (copy(i, k, out)) {
+                        slot = i;
+                        leaf = tree_ != nullptr ? std::max<std::uint64_t>(tree_[leaves_ + i].load(std::memory_order_relaxed), 1) : 0;
+                    }
+                }
+                if (slot < 0) { return k; }
+            }
+            out.indices[k] = slot;
+            if (tree_ != nullptr) {
+                const double p = static_cast<double>(leaf) / static_cast<double>(std::max(total, leaf));
+                out.weights[k] = static_cast<float>(std::pow(static_cast<double>(n) * p, -static_cast<double>(beta)));
+                max_weight = std::max(max_weight, out.weights[k]);
+            } else {
+                out.weights[k] = 1.0f;
+            }
+        }
+        if (tree_ != nullptr && max_weight > 0.0f) {
+            for (int k = 0; k < count; ++k) { out.weights[k] /= max_weight; }
+        }
+        return count;
+    }
+
+    // Sets the priority of each slot (e.g. |TD error| + epsilon). Slots not
+    // written yet and slots in flight are skipped; a slot rewritten since it
+    // was sampled takes the update like any other. Negative and non-finite
+    // priorities count as the smallest one.
+    void updatePriorities(const std::int64_t* slots, const float* priorities, int n) {
+        if (tree_ == nullptr) { return; }
+        const std::int64_t filled = size();
+        for (int i = 0; i < n; ++i) {
+            if (slots[i] < 0 || slots[i] >= filled) { continue; }
+            if (versions_[slots[i]].load(std::memory_order_acquire) & 1u) { continue; }  // being rewritten
+            const std::uint64_t leaf = toLeaf(priorities[i]);
+            setLeaf(slots[i], leaf);
+            for (std::uint64_t seen = max_leaf_.load(std::memory_order_relaxed);
+                 leaf > seen && !max_leaf_.compare_exchange_weak(seen, leaf, std::memory_order_relaxed);) {}
+        }
+    }
+
+    // Priority^alpha of a slot (0 while in flight or without priorities).
+    double priority(std::int64_t slot) const {
+        if (tree_ == nullptr || slot < 0 || slot >= s_.capacity) { return 0.0; }
+        return std::ldexp(static_cast<double>(tree_[leaves_ + slot].load(std::memory_order_relaxed)), -PRIORITY_BITS);
+    }
+
+private:
+    struct Rng {
+        std::uint64_t s;
+        std::uint64_t next() {
+            std::uint64_t z = (s += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+        std::uint64_t below(std::uint64_t bound) { return next() % bound; }
+    };
+
+    std::int64_t slotOf(std::uint64_t ticket) const { return static_cast<std::int64_t>(ticket % static_cast<std::uint64_t>(s_.capacity)); }
+
+    std::uint64_t toLeaf(float priority) const {
+        if (!std::isfinite(priority) || priority < 0.0f) { return 1; }
+        const double x = std::pow(static_cast<double>(priority), static_cast<double>(s_.alpha));
+        const double scaled = std::ldexp(x, PRIORITY_BITS);
+        return static_cast<std::uint64_t>(std::clamp(scaled, 1.0, std::ldexp(1.0, 2 * PRIORITY_BITS)));
+    }
+
+    // The ancestors absorb the difference with wrapping adds, so concurrent
+    // updates of different leaves commute.
+    void setLeaf(std::int64_t slot, std::uint64_t value) {
+        std::size_t node = static_cast<std::size_t>(leaves_ + slot);
+        const std::uint64_t delta = value - tree_[node].exchange(value, std::memory_order_acq_rel);
+        if (delta == 0) { return; }
+        for (node >>= 1; node >= 1; node >>= 1) { tree_[node].fetch_add(delta, std::memory_order_acq_rel); }
+    }
+
+    // Leaf whose prefix range contains `target`; inner sums read while other
+    // threads update may be slightly stale, so the walk clamps to the last
+    // non-empty child.
+    std::int64_t find(std::uint64_t target, std::uint64_t* leaf) const {
+        std::size_t node = 1;
+        while (node < static_cast<std::size_t>(leaves_)) {
+            const std::uint64_t left = tree_[2 * node].load(std::memory_order_acquire);
+            if (target < left || tree_[2 * node + 1].load(std::memory_order_acquire) == 0) {
+                node = 2 * node;
+            } else {
+                target -= left;
+                node = 2 * node + 1;
+            }
+        }
+        *leaf = tree_[node].load(std::memory_order_acquire);
+        return static_cast<std::int64_t>(node) - leaves_;
+    }
+
+    // Seqlock read of slot into row k of out; false if it was (re)written meanwhile.
+    bool copy(std::int64_t slot, int k, const ReplayBatch& out) const {
+        const std::uint64_t before = versions_[slot].load(std::memory_order_acquire);
+        if (before == 0 || (before & 1u)) { return false; }
+        const std::size_t row = sizeof(float) * s_.feature_size;
+        std::memcpy(out.obs + k * s_.feature_size, s_.obs + slot * s_.feature_size, row);
+        std::memcpy(out.next_obs + k * s_.feature_size, s_.next_obs + slot * s_.feature_size, row);
+        out.actions[k] = s_.actions[slot];
+        out.rewards[k] = s_.rewards[slot];
+        out.terminated[k] = s_.terminated[slot];
+        out.truncated[k] = s_.truncated[slot];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return versions_[slot].load(std::memory_order_relaxed) == before;
+    }
+
+    ReplayStorage                               s_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> versions_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> tree_;
+    std::int64_t                                leaves_ = 1;
+    std::atomic<std::uint64_t>                  cursor_{0};
+    std::atomic<std::uint64_t>                  committed_{0};
+    std::atomic<std::uint64_t>                  max_leaf_{std::uint64_t{1} << PRIORITY_BITS};
+};
+
+} // namespace tetrl::envs::step
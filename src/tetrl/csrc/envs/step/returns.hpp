@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace tetrl::envs::step {
+
+// Advantage and return kernels over [T, N] rollouts (row t = the N envs'
+// step t, as collected from StepVectorEnv), written into caller arrays.
+//
+// Episode ends follow the vector env: a terminated step has no successor
+// value; a truncated step (max_steps) bootstraps from the value of its final
+// observation (final_values, read only there); either way the recursion does
+// not continue across the autoreset. The last row bootstraps from
+// last_values, the values of the observations after the rollout.
+//
+// Work is split over threads by column ranges; the inner loops run over the
+// contiguous env dimension without branches, so they vectorise.
+
+struct Rollout {
+    const float*        rewards;       // [T, N]
+    const float*        values;        // [T, N], V(obs the action was taken on)
+    const std::uint8_t* terminated;    // [T, N], 0 or 1
+    const std::uint8_t* truncated;     // [T, N], 0 or 1
+    const float*        final_values;  // [T, N], V(final obs) where truncated (nullable: no truncations)
+    const float*        last_values;   // [N]
+    std::int32_t        steps;         // T
+    std::int32_t        envs;          // N
+};
+
+namespace returns_detail {
+
+// Calls body(begin, end) for column ranges of `n` spread over `threads`
+// threads, in multiples of 16 columns.
+template <typename Body>
+inline void forColumns(int n, int threads, Body body) {
+    constexpr int ALIGN = 16;
+    const int blocks = (n + ALIGN - 1) / ALIGN;
+    threads = std::clamp(threads, 1, std::max(blocks, 1));
+    if (threads == 1) {
+        body(0, n);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        const int begin = std::min(n, blocks * t / threads * ALIGN);
+        const int end   = std::min(n, blocks * (t + 1) / threads * ALIGN);
+        if (begin < end) { pool.emplace_back(body, begin, end); }
+    }
+    for (auto& thread : pool) { thread.join(); }
+}
+
+// One row of GAE over columns [0, n) of pointers already offset to the row.
+// `final_values` is always readable (callers substitute `values` when there
+// are no truncations) and the flags are 0 or 1, so the episode ends become
+// float masks and the only select is between two loaded values: the loop
+// vectorises without -ffast-math, and final values outside truncations are
+// never used (they may be NaN).
+inline void gaeRow(const float* __restrict rewards, const float* __restrict values, const std::uint8_t* __restrict terminated,
+                   const std::uint8_t* __restrict truncated, const float* __restrict final_values,
+                   const float* __restrict next_values, const float* __restrict carry, float gamma, float gamma_lambda,
+                   float* __restrict advantages, float* __restrict returns, int n) {
+    for (int i = 0; i < n; ++i) {
+        const float reward = rewards[i], value = values[i], final = final_values[i], next = next_values[i], tail = carry[i];
+        const float term = terminated[i], done = terminated[i] | truncated[i];
+        const float successor = truncated[i] ? final : next;
+        const float a = reward + gamma * (1.0f - term) * successor - value + gamma_lambda * (1.0f - done) * tail;
+        advantages[i] = a;
+        returns[i]    = a + value;
+    }
+}
+
+// Adds step t + k of an n-step window: discount * reward, the final
+// observation's value on a truncation, and ends the window at an episode end.
+inline void nStepRow(const float* __restrict rewards, const std::uint8_t* __restrict terminated, const std::uint8_t* __restrict truncated,
+                     const float* __restrict final_values, float discount, float next_discount, float* __restrict alive,
+                     float* __restrict out, int n) {
+    for (int i = 0; i < n; ++i) {
+        const float reward = rewards[i], final = final_values[i], live = alive[i];
+        const float term = terminated[i], done = terminated[i] | truncated[i];
+        const float boot = truncated[i] ? final : 0.0f;
+        out[i] += live * (discount * reward + next_discount * (1.0f - term) * boot);
+        alive[i] = live * (1.0f - done);
+    }
+}
+
+} // namespace returns_detail
+
+// Generalised advantage estimation:
+//   delta_t = r_t + gamma * (1 - terminated_t) * V(successor) - V_t
+//   A_t     = delta_t + gamma * lambda * (1 - done_t) * A_{t+1}
+// and returns_t = A_t + V_t. The outputs may not alias the inputs.
+inline void computeGae(const Rollout& r, float gamma, float lambda, float* advantages, float* returns, int threads) {
+    const std::size_t n = static_cast<std::size_t>(r.envs);
+    const float* final_values = r.final_values != nullptr ? r.final_values : r.values;
+    returns_detail::forColumns(r.envs, threads, [&](int begin, int end) {
+        const std::vector<float> zeros(static_cast<std::size_t>(end - begin));
+        for (int t = r.steps - 1; t >= 0; --t) {
+            const std::size_t at = static_cast<std::size_t>(t) * n + begin;
+            const bool last = t + 1 == r.steps;
+            returns_detail::gaeRow(r.rewards + at, r.values + at, r.terminated + at, r.truncated + at, final_values + at,
+                                   last ? r.last_values + begin : r.values + at + n, last ? zeros.data() : advantages + at + n,
+                                   gamma, gamma * lambda, advantages + at, returns + at, end - begin);
+        }
+    });
+}
+
+// n-step returns: G_t = sum_{k<m} gamma^k r_{t+k} + gamma^m V(s_{t+m}), with
+// m = min(horizon, steps to the episode end or the rollout end); the
+// bootstrap is dropped after a termination and taken from the final
+// observation after a truncation.
+inline void computeNStepReturns(const Rollout& r, int horizon, float gamma, float* out, int threads) {
+    const std::size_t n = static_cast<std::size_t>(r.envs);
+    const float* final_values = r.final_values != nullptr ? r.final_values : r.values;
+    horizon = std::max(horizon, 1);
+    returns_detail::forColumns(r.envs, threads, [&](int begin, int end) {
+        const int width = end - begin;
+        std::vector<float> alive(static_cast<std::size_t>(width));
+        for (int t = 0; t < r.steps; ++t) {
+            float* g = out + static_cast<std::size_t>(t) * n + begin;
+            std::fill(alive.begin(), alive.end(), 1.0f);
+            std::fill(g, g + width, 0.0f);
+            const int m = std::min(horizon, r.steps - t);
+            float discount = 1.0f;
+            for (int k = 0; k < m; ++k) {
+                const std::size_t at = static_cast<std::size_t>(t + k) * n + begin;
+                returns_detail::nStepRow(r.rewards + at, r.terminated + at, r.truncated + at, final_values + at,
+                                         discount, discount * gamma, alive.data(), g, width);
+                discount *= gamma;
+            }
+            const float* bootstrap = (t + m < r.steps ? r.values + static_cast<std::size_t>(t + m) * n : r.last_values) + begin;
+            for (int i = 0; i < width; ++i) { g[i] += alive[i] * discount * bootstrap[i]; }
+        }
+    });
+}
+
+} // namespace tetrl::envs::step
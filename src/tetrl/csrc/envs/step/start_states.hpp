@@ -0,0 +1,181 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/analysis.hpp"
+#include "envs/step/step.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace tetrl::envs::step {
+
+// Bulk generator of mid-game start boards for curriculum resets.
+//
+// Start state i of a seed is the board of a fresh State that gets a few garbage rows
+// (the rows applyGarbage() pushes: one hole per row, moved with probability
+// garbage_messiness) and then a stack of pieces taken from its own bag and
+// placed through the engine's moves (rotate, shift, hard drop), so every
+// stack is one a player could have built. Each piece goes to a landing that
+// opens the fewest holes, or with probability hole_rate to any landing.
+// Generation stops at a height drawn from [min_height, max_height]; boards on
+// which some piece could not spawn are rejected, so any piece can start on
+// every generated board. Only the board is kept: an episode started on it
+// takes its pieces from its own seeds and its other fields from reset().
+
+struct StartStateOptions {
+    std::uint64_t seed              = 0;
+    std::int32_t  min_height        = 4;     // stack height in rows above the floor
+    std::int32_t  max_height        = 12;
+    std::int32_t  min_garbage       = 0;     // garbage rows at the bottom (at most the height)
+    std::int32_t  max_garbage       = 4;
+    float         garbage_messiness = 0.3f;  // chance a garbage row moves the hole of the row below
+    float         hole_rate         = 0.1f;  // chance a piece goes to a random landing instead of a tidy one
+    std::int32_t  threads           = 1;
+};
+
+constexpr int START_STATE_MAX_HEIGHT = VISIBLE_ROWS - 2;  // keeps the spawn rows clear
+constexpr int START_STATE_MAX_PIECES = 256;
+
+namespace start_state_detail {
+
+struct Rng {
+    std::uint64_t s;
+    std::uint64_t next() {
+        std::uint64_t z = (s += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+    int uniform(int lo, int hi) { return lo + static_cast<int>((next() >> 32) * static_cast<std::uint64_t>(hi - lo + 1) >> 32); }
+    float unit() { return static_cast<float>(next() >> 40) * 0x1p-24f; }
+};
+
+inline int stackHeight(const Board& board) {
+    for (int y = BOARD_TOP; y <= BOARD_BOTTOM; ++y) {
+        if (board.data[y] & PLAYFIELD_MASK) { return BOARD_BOTTOM - y + 1; }
+    }
+    return 0;
+}
+
+inline bool everyPieceSpawns(const Board& board) {
+    for (int p = 0; p < static_cast<int>(PieceType::SIZE); ++p) {
+        if (!ops::canPlacePiece(board, ops::getPiece(static_cast<PieceType>(p), 0), PIECE_SPAWN_X, PIECE_SPAWN_Y)) { return false; }
+    }
+    return true;
+}
+
+enum DropResult { DROP_UNREACHABLE, DROP_TOP_OUT, DROP_PLACED };
+
+// Drops the current piece after `rotation` (0: none, 1: CW, 2: 180, 3: CCW)
+// from `shift` cells right of the left wall.
+inline DropResult dropAt(State* s, int rotation, int shift) {
+    if ((rotation == 1 && !rotateClockwise(s)) || (rotation == 2 && !rotate180(s)) || (rotation == 3 && !rotateCounterclockwise(s))) {
+        return DROP_UNREACHABLE;
+    }
+    moveLeftToWall(s);
+    for (int k = 0; k < shift; ++k) {
+        if (!moveRight(s)) { return DROP_UNREACHABLE; }
+    }
+    return hardDrop(s) && s->is_alive ? DROP_PLACED : DROP_TOP_OUT;
+}
+
+// Places the current piece of *s on a tidy (or, with probability hole_rate, a
+// random) landing; false if it cannot be placed anywhere.
+inline bool placeNext(State* s, Rng* rng, float hole_rate) {
+    struct Candidate { std::uint8_t rotation, shift; };
+    Candidate candidates[4 * VISIBLE_COLS];
+    int holes[4 * VISIBLE_COLS];
+    int count = 0, fewest = VISIBLE_ROWS * VISIBLE_COLS;
+    for (int rotation = 0; rotation < 4; ++rotation) {
+        for (int shift = 0; shift < VISIBLE_COLS; ++shift) {
+            State trial = *s;
+            const DropResult result = dropAt(&trial, rotation, shift);
+            if (result == DROP_UNREACHABLE) { break; }
+            if (result == DROP_TOP_OUT) { continue; }
+            holes[count] = analyzeBoard(trial.board).hole_count;
+            fewest = std::min(fewest, holes[count]);
+            candidates[count++] = {static_cast<std::uint8_t>(rotation), static_cast<std::uint8_t>(shift)};
+        }
+    }
+    if (count == 0) { return false; }
+    int pick;
+    if (rng->unit() < hole_rate) {
+        pick = rng->uniform(0, count - 1);
+    } else {
+        int tidy = 0;
+        for (int i = 0; i < count; ++i) { tidy += holes[i] == fewest; }
+        int nth = rng->uniform(0, tidy - 1);
+        for (pick = 0; holes[pick] != fewest || nth-- > 0; ++pick) {}
+    }
+    return dropAt(s, candidates[pick].rotation, candidates[pick].shift) == DROP_PLACED;
+}
+
+} // namespace start_state_detail
+
+// Board of start state `index` of options.seed: a pure function of both.
+// Returns false (leaving an empty board in *out) if no valid board was found.
+inline bool generateStartState(const StartStateOptions& o, std::uint32_t index, Board* out) {
+    using namespace start_state_detail;
+    Rng rng{o.seed ^ (0xd1b54a32d192ed03ull * (static_cast<std::uint64_t>(index) + 1))};
+    const int max_height = std::clamp(o.max_height, 0, START_STATE_MAX_HEIGHT);
+    const int min_height = std::clamp(o.min_height, 0, max_height);
+    const int max_garbage = std::max(o.max_garbage, 0);
+    const int min_garbage = std::clamp(o.min_garbage, 0, max_garbage);
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        State s{};
+        const std::uint64_t seeds = rng.next();
+        setSeed(&s, static_cast<std::uint32_t>(seeds), static_cast<std::uint32_t>(seeds >> 32) | 1u);
+        reset(&s);
+        const int height = rng.uniform(min_height, max_height);
+        const int garbage = std::min(rng.uniform(min_garbage, max_garbage), height);
+        int hole = rng.uniform(BOARD_LEFT, BOARD_RIGHT);
+        for (int r = 0; r < garbage; ++r) {
+            if (r > 0 && rng.unit() < o.garbage_messiness) { hole = rng.uniform(BOARD_LEFT, BOARD_RIGHT); }
+            s.board.data[BOARD_BOTTOM - r] = ROW_GARBAGE & ~ops::shift(CELL_MASK, hole);
+        }
+        bool alive = true;
+        for (int p = 0; p < START_STATE_MAX_PIECES && alive && stackHeight(s.board) < height; ++p) {
+            alive = placeNext(&s, &rng, o.hole_rate);
+        }
+        if (!alive || stackHeight(s.board) > max_height || !everyPieceSpawns(s.board)) { continue; }
+        *out = s.board;
+        return true;
+    }
+    State empty{};
+    reset(&empty);
+    *out = empty.board;
+    return false;
+}
+
+// Start states first .. first + count - 1 over options.threads threads;
+// returns how many fell back to an empty board.
+inline int generateStartStates(const StartStateOptions& o, std::uint32_t first, int count, Board* out) {
+    std::atomic<int> next{0};
+    std::atomic<int> failed{0};
+    auto run = [&] {
+        for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            if (!generateStartState(o, first + static_cast<std::uint32_t>(i), &out[i])) { failed.fetch_add(1, std::memory_order_relaxed); }
+        }
+    };
+    const int threads = std::clamp<int>(o.threads, 1, std::max(count, 1));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) { pool.emplace_back(run); }
+    run();
+    for (auto& thread : pool) { thread.join(); }
+    return failed.load();
+}
+
+// Pool entry for the episode seeded with garbage_seed (see episodeSeeds), by
+// multiply-shift so any pool size is drawn from evenly.
+inline std::uint32_t startStateIndex(std::uint32_t garbage_seed, std::uint32_t count) {
+    return static_cast<std::uint32_t>(static_cast<std::uint64_t>(garbage_seed) * count >> 32);
+}
+
+// Puts the start board under the freshly reset ctx. The current piece stays
+// at the spawn, where every generated board leaves room.
+inline void applyStartState(Context* ctx, const Board& start) {
+    ctx->state.board = start;
+}
+
+} // namespace tetrl::envs::step
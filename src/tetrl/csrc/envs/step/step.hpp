@@ -25,15 +25,21 @@ enum class Action : std::uint8_t {
     SIZE
 };
 
+// Bit i is set when Action i would succeed in the current state.
+using ActionMask = std::uint16_t;
+static_assert(static_cast<int>(Action::SIZE) <= 16, "ActionMask is too narrow");
+
 struct Info {
     Action                  action_id;        // which action the agent chose
     std::uint8_t /* bool */ action_success;   // whether the action executed successfully
     std::uint8_t /* bool */ forced_hard_drop; // whether lifetime expired and a hard drop was forced
+    ActionMask              action_mask;      // legal actions of the resulting state (0 unless Config::action_mask)
 };
 
 struct Config {
-    std::int32_t            piece_life = 20; // steps before forced hard drop
-    std::uint8_t /* bool */ auto_drop  = 1;  // simulate gravity each step (bool)
+    std::int32_t            piece_life  = 20; // steps before forced hard drop
+    std::uint8_t /* bool */ auto_drop   = 1;  // simulate gravity each step (bool)
+    std::uint8_t /* bool */ action_mask = 0;  // fill Info::action_mask after every step (bool)
 };
 
 struct Context {
@@ -55,11 +61,27 @@ inline void reset(Context* ctx) {
     ctx->lifetime = ctx->config.piece_life;
 }
 
+inline ActionMask legalActions(const Context* ctx) {
+    const State* s = &ctx->state;
+    if (!s->is_alive) { return 0; }
+    constexpr auto bit = [](Action action) { return static_cast<ActionMask>(1u << static_cast<int>(action)); };
+    ActionMask mask = bit(Action::HARD_DROP) | bit(Action::NOOP);
+    if (canMoveCurrentPiece(s, -1, 0))               { mask |= bit(Action::MOVE_LEFT)  | bit(Action::MOVE_LEFT_TO_WALL); }
+    if (canMoveCurrentPiece(s, 1, 0))                { mask |= bit(Action::MOVE_RIGHT) | bit(Action::MOVE_RIGHT_TO_WALL); }
+    if (canMoveCurrentPiece(s, 0, 1))                { mask |= bit(Action::SOFT_DROP)  | bit(Action::SOFT_DROP_TO_FLOOR); }
+    if (canRotateCurrentPiece(s, Rotation::CW))      { mask |= bit(Action::ROTATE_CW); }
+    if (canRotateCurrentPiece(s, Rotation::CCW))     { mask |= bit(Action::ROTATE_CCW); }
+    if (canRotateCurrentPiece(s, Rotation::HALF))    { mask |= bit(Action::ROTATE_180); }
+    if (!s->has_held)                                { mask |= bit(Action::HOLD); }
+    return mask;
+}
+
 inline Info step(Context* ctx, Action action) {
     Info info{
         .action_id        = action,
         .action_success   = false,
-        .forced_hard_drop = false
+        .forced_hard_drop = false,
+        .action_mask      = 0
     };
     // game already over
     if (!ctx->state.is_alive) {
@@ -130,7 +152,51 @@ inline Info step(Context* ctx, Action action) {
             info.forced_hard_drop = true;
         }
     }
+    if (ctx->config.action_mask) {
+        info.action_mask = legalActions(ctx);
+    }
     return info;
 }
 
+// Whether the step locked a piece (hard drop, or forced by the lifetime).
+inline bool isLockingStep(const Info& info) {
+    return info.action_id == Action::HARD_DROP || info.forced_hard_drop;
+}
+
+// Early-exit conditions of stepSequence (bit flags).
+enum SequenceStop : std::uint8_t {
+    STOP_NEVER    = 0,
+    STOP_ON_DEATH = 1 << 0,
+    STOP_ON_LOCK  = 1 << 1,
+};
+
+// Executes up to n actions on one context, calling on_step(info) after each
+// (e.g. to accumulate a reward), and stops after the step that ends the game /
+// locks a piece when requested by `stop`. *last receives the Info of the final
+// executed step; returns the number of executed actions.
+template <typename OnStep>
+inline int stepSequence(Context* ctx, const Action* actions, int n, std::uint8_t stop, Info* last, OnStep&& on_step) {
+    int executed = 0;
+    while (executed < n) {
+        *last = step(ctx, actions[executed++]);
+        on_step(*last);
+        if (((stop & STOP_ON_DEATH) && !ctx->state.is_alive)
+            || ((stop & STOP_ON_LOCK) && isLockingStep(*last))) {
+            break;
+        }
+    }
+    return executed;
+}
+
+// Steps n independent contexts. When `masks` is non-null, the legal-action mask of every
+// resulting state is written to masks[i] regardless of Config::action_mask.
+inline void stepBatch(Context* ctxs, const Action* actions, Info* infos, ActionMask* masks, int n) {
+    for (int i = 0; i < n; ++i) {
+        infos[i] = step(&ctxs[i], actions[i]);
+        if (masks != nullptr) {
+            masks[i] = ctxs[i].config.action_mask ? infos[i].action_mask : legalActions(&ctxs[i]);
+        }
+    }
+}
+
 } // namespace tetrl::envs::step
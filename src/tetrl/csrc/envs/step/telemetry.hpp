@@ -0,0 +1,141 @@
+#pragma once
+#include "envs/step/step.hpp"
+#include <cstdint>
+
+namespace tetrl::envs::step {
+
+// Game telemetry gathered by the vector driver while it steps.
+//
+// Each env keeps an EpisodeTelemetry with the running totals of its current
+// episode; every locking step adds one placement (read from the per-placement
+// State fields processPiecePlacement() just wrote) and every finished episode
+// is folded into a Telemetry block. A block is only ever written by the thread
+// that steps its envs, so it needs no atomics or locks; blocks of different
+// env pools / threads are combined with mergeTelemetry() when read.
+
+constexpr int TELEMETRY_BINS   = 64;
+constexpr int TELEMETRY_PIECES = static_cast<int>(PieceType::SIZE);
+constexpr int TELEMETRY_SPINS  = 3; // SpinType::NONE, SPIN, SPIN_MINI
+constexpr int TELEMETRY_CLEARS = 5; // lines cleared by one placement, 0..4
+
+enum TelemetryHistogram : int {
+    // per finished episode, logBin() bins
+    HIST_EPISODE_STEPS,
+    HIST_EPISODE_PIECES,
+    HIST_EPISODE_LINES,
+    HIST_EPISODE_ATTACK,
+    HIST_EPISODE_GARBAGE,
+    // per finished episode, bin = floor(16 * attack / pieces)
+    HIST_EPISODE_APP,
+    // per placement, linear bins
+    HIST_PLACEMENT_ATTACK,
+    HIST_PLACEMENT_GARBAGE,
+    // per broken (or episode-ending) chain, linear bins of its length
+    HIST_BACK_TO_BACK,
+    HIST_COMBO,
+    TELEMETRY_HISTOGRAMS,
+};
+
+struct EpisodeTelemetry {
+    std::uint32_t steps;
+    std::uint32_t pieces;
+    std::uint32_t lines;
+    std::uint32_t attack;
+    std::uint32_t garbage;  // garbage lines pushed into the board
+};
+
+struct Telemetry {
+    std::uint64_t episodes;        // finished (terminated or truncated)
+    std::uint64_t terminated;
+    std::uint64_t steps;           // every step, including those of running episodes
+    std::uint64_t pieces;
+    std::uint64_t lines;
+    std::uint64_t attack;
+    std::uint64_t garbage;
+    std::uint64_t perfect_clears;
+    std::uint64_t clears[TELEMETRY_CLEARS];                         // placements by lines cleared
+    std::uint64_t spins[TELEMETRY_PIECES][TELEMETRY_SPINS][TELEMETRY_CLEARS];  // placements by piece, spin, lines
+    std::uint64_t histograms[TELEMETRY_HISTOGRAMS][TELEMETRY_BINS];
+};
+
+// Log-linear bin of v: exact below 8, then four bins per power of two
+// (relative width <= 25%), saturating at 2^16.
+inline int logBin(std::uint32_t v) {
+    if (v < 8) { return static_cast<int>(v); }
+    const int e = 31 - __builtin_clz(v);
+    const int bin = 8 + (e - 3) * 4 + static_cast<int>(v >> (e - 2) & 3);
+    return bin < TELEMETRY_BINS ? bin : TELEMETRY_BINS - 1;
+}
+
+inline int linearBin(std::uint32_t v) {
+    return v < TELEMETRY_BINS ? static_cast<int>(v) : TELEMETRY_BINS - 1;
+}
+
+// Closes the back-to-back and combo chains still open at the end of an episode.
+inline void closeChains(const State* s, Telemetry* t) {
+    if (s->back_to_back_count >= 0) { ++t->histograms[HIST_BACK_TO_BACK][linearBin(s->back_to_back_count + 1)]; }
+    if (s->combo_count >= 0) { ++t->histograms[HIST_COMBO][linearBin(s->combo_count + 1)]; }
+}
+
+// step() with the step, and the placement it may lock, recorded in e and t.
+inline Info recordedStep(Context* ctx, Action action, EpisodeTelemetry* e, Telemetry* t) {
+    State* s = &ctx->state;
+    const std::uint32_t pieces = s->piece_count;
+    const int piece = static_cast<int>(s->current);  // the piece a lock places; current is the next one afterwards
+    const std::int32_t back_to_back = s->back_to_back_count;
+    const std::int32_t combo = s->combo_count;
+    const int pending = s->garbage_count != 0 ? pendingGarbageLines(s) : 0;
+
+    const Info info = step(ctx, action);
+    ++e->steps;
+    ++t->steps;
+    if (s->piece_count == pieces) { return info; }
+
+    // One lock per step: the per-placement fields describe it.
+    const int lines = s->lines_cleared;
+    const std::uint32_t garbage = static_cast<std::uint32_t>(
+        pending - (s->garbage_count != 0 ? pendingGarbageLines(s) : 0) - (s->attack - s->lines_sent));
+    ++e->pieces;
+    e->lines += lines;
+    e->attack += s->attack;
+    e->garbage += garbage;
+    ++t->pieces;
+    t->lines += lines;
+    t->attack += s->attack;
+    t->garbage += garbage;
+    t->perfect_clears += s->perfect_clear && lines > 0;
+    const int clear = lines < TELEMETRY_CLEARS ? lines : TELEMETRY_CLEARS - 1;
+    ++t->clears[clear];
+    ++t->spins[piece][static_cast<int>(s->spin_type)][clear];
+    ++t->histograms[HIST_PLACEMENT_ATTACK][linearBin(s->attack)];
+    ++t->histograms[HIST_PLACEMENT_GARBAGE][linearBin(garbage)];
+    if (back_to_back >= 0 && s->back_to_back_count < 0) { ++t->histograms[HIST_BACK_TO_BACK][linearBin(back_to_back + 1)]; }
+    if (combo >= 0 && s->combo_count < 0) { ++t->histograms[HIST_COMBO][linearBin(combo + 1)]; }
+    return info;
+}
+
+// Folds the finished episode of env state s into t and clears e.
+inline void finishEpisode(const State* s, bool terminated, EpisodeTelemetry* e, Telemetry* t) {
+    ++t->episodes;
+    t->terminated += terminated;
+    closeChains(s, t);
+    ++t->histograms[HIST_EPISODE_STEPS][logBin(e->steps)];
+    ++t->histograms[HIST_EPISODE_PIECES][logBin(e->pieces)];
+    ++t->histograms[HIST_EPISODE_LINES][logBin(e->lines)];
+    ++t->histograms[HIST_EPISODE_ATTACK][logBin(e->attack)];
+    ++t->histograms[HIST_EPISODE_GARBAGE][logBin(e->garbage)];
+    if (e->pieces != 0) {
+        ++t->histograms[HIST_EPISODE_APP][linearBin(static_cast<std::uint32_t>(16ull * e->attack / e->pieces))];
+    }
+    *e = EpisodeTelemetry{};
+}
+
+// into += from, field by field.
+inline void mergeTelemetry(Telemetry* into, const Telemetry* from) {
+    static_assert(sizeof(Telemetry) % sizeof(std::uint64_t) == 0);
+    auto* dst = reinterpret_cast<std::uint64_t*>(into);
+    const auto* src = reinterpret_cast<const std::uint64_t*>(from);
+    for (std::size_t i = 0; i < sizeof(Telemetry) / sizeof(std::uint64_t); ++i) { dst[i] += src[i]; }
+}
+
+} // namespace tetrl::envs::step
@@ -0,0 +1,127 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/analysis.hpp"
+#include "envs/step/step.hpp"
+#include "search/heuristic.hpp"
+#include "search/movegen.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace tetrl::search {
+
+// Afterstates of every candidate placement, for afterstate-value methods.
+//
+// The placements of the current piece (and, with hold, of the piece HOLD
+// brings in) are enumerated like generatePlacements(); each one is locked
+// and its full lines cleared on a copy of the board's row masks
+// (heuristic_detail::lockPiece), so the live State is never touched and no
+// State is cloned. Row k of the [K, F] output holds, depending on the
+// options, the 20x10 occupancy planes of the visible rows after the lock and
+// AFTERSTATE_STATS scalar statistics: the heuristic features (in
+// HeuristicFeature order), then the entries of AfterstateStat. All
+// statistics come from the bit-parallel row-mask kernels, one 16-bit mask
+// per row for all ten columns.
+
+enum AfterstateStat : int {
+    AFTERSTATE_LINES = HEURISTIC_FEATURES,  // lines cleared by the placement
+    AFTERSTATE_PERFECT_CLEAR,               // 1 if the board is empty afterwards
+    AFTERSTATE_MAX_HEIGHT,
+    AFTERSTATE_AGGREGATE_HEIGHT,            // column heights, summed
+    AFTERSTATE_BUMPINESS,                   // |height difference| of neighbouring columns, summed
+    AFTERSTATE_COLUMN_HEIGHTS,              // VISIBLE_COLS entries, left to right
+    AFTERSTATE_STATS = AFTERSTATE_COLUMN_HEIGHTS + envs::step::VISIBLE_COLS,
+};
+
+constexpr int AFTERSTATE_PLANE_SIZE = envs::step::VISIBLE_ROWS * envs::step::VISIBLE_COLS;
+
+struct AfterstateOptions {
+    std::uint8_t use_hold = 0;
+    std::uint8_t planes   = 1;  // occupancy planes, AFTERSTATE_PLANE_SIZE floats
+    std::uint8_t stats    = 1;  // AFTERSTATE_STATS floats, after the planes
+};
+
+inline int afterstateFeatureSize(const AfterstateOptions& o) {
+    return (o.planes ? AFTERSTATE_PLANE_SIZE : 0) + (o.stats ? AFTERSTATE_STATS : 0);
+}
+
+namespace afterstate_detail {
+
+using heuristic_detail::ROWS;
+
+// Column heights above the floor, plus their maximum, sum and bumpiness.
+inline void heightStats(const std::uint16_t (&rows)[ROWS], float* f) {
+    constexpr int COLS = envs::step::VISIBLE_COLS;
+    int heights[COLS] = {};
+    std::uint32_t covered = 0;
+    for (int y = 0; y < ROWS && covered != heuristic_detail::FULL; ++y) {
+        for (std::uint32_t fresh = rows[y] & ~covered; fresh != 0; fresh &= fresh - 1) { heights[__builtin_ctz(fresh)] = ROWS - y; }
+        covered |= rows[y];
+    }
+    int max_height = 0, aggregate = 0, bumpiness = 0;
+    for (int c = 0; c < COLS; ++c) {
+        max_height = std::max(max_height, heights[c]);
+        aggregate += heights[c];
+        if (c > 0) { bumpiness += std::abs(heights[c] - heights[c - 1]); }
+        f[AFTERSTATE_COLUMN_HEIGHTS + c] = static_cast<float>(heights[c]);
+    }
+    f[AFTERSTATE_MAX_HEIGHT] = static_cast<float>(max_height);
+    f[AFTERSTATE_AGGREGATE_HEIGHT] = static_cast<float>(aggregate);
+    f[AFTERSTATE_BUMPINESS] = static_cast<float>(bumpiness);
+}
+
+inline void planes(const std::uint16_t (&rows)[ROWS], float* out) {
+    constexpr int COLS = envs::step::VISIBLE_COLS;
+    for (int y = 0; y < envs::step::VISIBLE_ROWS; ++y) {
+        const std::uint32_t r = rows[BOARD_TOP + y];
+        for (int c = 0; c < COLS; ++c) { out[y * COLS + c] = static_cast<float>(r >> c & 1u); }
+    }
+}
+
+inline void features(const std::uint16_t (&rows)[ROWS], PieceType type, Position p, const AfterstateOptions& o, float* out) {
+    std::uint16_t after[ROWS];
+    const heuristic_detail::Lock lock = heuristic_detail::lockPiece(rows, type, p, after);
+    if (o.planes) {
+        planes(after, out);
+        out += AFTERSTATE_PLANE_SIZE;
+    }
+    if (!o.stats) { return; }
+    double f[HEURISTIC_FEATURES];
+    f[LANDING_HEIGHT] = ROWS - (lock.top + lock.bottom) / 2.0;
+    f[ERODED_CELLS] = lock.cleared * lock.eroded;
+    heuristic_detail::boardFeatures(after, f);
+    for (int i = 0; i < HEURISTIC_FEATURES; ++i) { out[i] = static_cast<float>(f[i]); }
+    out[AFTERSTATE_LINES] = static_cast<float>(lock.cleared);
+    out[AFTERSTATE_PERFECT_CLEAR] = lock.cleared > 0 && std::all_of(std::begin(after), std::end(after), [](std::uint16_t r) { return r == 0; });
+    heightStats(after, out);
+}
+
+} // namespace afterstate_detail
+
+// Placements of ctx's current piece (then, with o.use_hold, of the hold
+// piece) with their paths into `placements`, and the afterstate features of
+// each into row k of `features` (afterstateFeatureSize(o) floats per row).
+// Returns the number of placements written, at most `capacity`. With
+// neither planes nor stats only the placements are written.
+inline int generateAfterstates(const envs::step::Context* ctx, const AfterstateOptions& o, MoveGenerator* movegen,
+                               PlacementPath* placements, float* features, int capacity) {
+    std::uint16_t rows[heuristic_detail::ROWS];
+    heuristic_detail::playfieldRows(ctx->state.board, rows);
+    const int size = afterstateFeatureSize(o);
+    int count = 0;
+    for (int h = 0; h < (o.use_hold ? 2 : 1) && count < capacity; ++h) {
+        PieceType type;
+        Position start;
+        MoveRules rules;
+        if (!placementQuery(ctx, h != 0, &type, &start, &rules)) { continue; }
+        movegen->generate(ctx->state.board, type, start, rules);
+        const int written = writePlacements(*movegen, h != 0, placements + count, capacity - count);
+        for (int k = count; size > 0 && k < count + written; ++k) {
+            afterstate_detail::features(rows, type, placements[k].position, o, features + static_cast<std::ptrdiff_t>(k) * size);
+        }
+        count += written;
+    }
+    return count;
+}
+
+} // namespace tetrl::search
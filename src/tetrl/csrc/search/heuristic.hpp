@@ -0,0 +1,284 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/analysis.hpp"
+#include "envs/step/plugin.hpp"
+#include "envs/step/step.hpp"
+#include "search/movegen.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace tetrl::search {
+
+// Greedy placement player driven by a linear evaluation of classic board
+// features (Dellacherie / BCTS), for tuning the weights by evolution
+// strategies. Each game runs on a step-env Context: every piece goes to the
+// reachable landing (of the current piece or, with hold, of the piece HOLD
+// brings in) with the highest weighted feature sum, and the chosen path is
+// replayed through envs::step::step(), so spins, attack and the lifetime
+// rules are exactly those of the env.
+
+enum HeuristicFeature : int {
+    LANDING_HEIGHT,      // mean height of the piece's top and bottom cells
+    ERODED_CELLS,        // lines cleared * piece cells in those lines
+    ROW_TRANSITIONS,     // filled/empty changes along rows, walls filled
+    COLUMN_TRANSITIONS,  // filled/empty changes down columns, floor filled
+    HOLES,               // empty cells below a filled one
+    CUMULATIVE_WELLS,    // sum over open wells of 1 + 2 + ... + depth
+    HOLE_DEPTH,          // filled cells above each hole, summed
+    ROWS_WITH_HOLES,
+    HEURISTIC_FEATURES,
+};
+
+struct HeuristicOptions {
+    std::int32_t        games       = 1;     // games per weight vector
+    std::int32_t        max_pieces  = 1000;  // pieces per game (0 = until top-out)
+    std::uint64_t       seed        = 0;     // game k uses the seeds of episode k of env 0 (envs::step::episodeSeeds)
+    std::uint8_t        use_hold    = 1;
+    std::uint8_t        threads     = 1;
+    envs::step::Config  config{};
+};
+
+// Per weight vector; variances are unbiased sample variances over the games.
+struct HeuristicResult {
+    double lines_mean, lines_var;
+    double attack_mean, attack_var;
+    double pieces_mean;
+};
+
+namespace heuristic_detail {
+
+constexpr int ROWS = BOARD_BOTTOM + 1;  // the visible rows and the spawn rows above them
+constexpr int COLS = envs::step::VISIBLE_COLS;
+constexpr std::uint32_t FULL = (1u << COLS) - 1;
+constexpr int PLANES = 5;  // bit-sliced per-column counters up to 31 >= ROWS
+
+inline int popcount(std::uint32_t v) { return envs::step::countCells(v); }
+
+// Per-column counters kept as bit planes: column c counts sum_p bit c of plane p << p.
+inline void increment(std::uint32_t (&planes)[PLANES], std::uint32_t mask) {
+    for (int p = 0; p < PLANES && mask != 0; ++p) {
+        const std::uint32_t carry = planes[p] & mask;
+        planes[p] ^= mask;
+        mask = carry;
+    }
+}
+
+inline int total(const std::uint32_t (&planes)[PLANES], std::uint32_t mask) {
+    int sum = 0;
+    for (int p = 0; p < PLANES; ++p) { sum += popcount(planes[p] & mask) << p; }
+    return sum;
+}
+
+// Playfield rows as column masks (bit c = column BOARD_LEFT + c).
+inline void playfieldRows(const Board& board, std::uint16_t (&rows)[ROWS]) {
+    std::uint32_t occupied[BOARD_HEIGHT];
+    occupancyRows(board, occupied);
+    for (int y = 0; y < ROWS; ++y) { rows[y] = static_cast<std::uint16_t>(occupied[y] >> BOARD_LEFT & FULL); }
+}
+
+// Board features of `rows` (everything but LANDING_HEIGHT and ERODED_CELLS),
+// one row mask at a time.
+inline void boardFeatures(const std::uint16_t (&rows)[ROWS], double* f) {
+    constexpr std::uint32_t WALLS = 1u | 1u << (COLS + 1);
+    int row_transitions = 0, column_transitions = 0, holes = 0, hole_depth = 0, rows_with_holes = 0, wells = 0;
+    std::uint32_t covered = 0;
+    std::uint32_t above[PLANES] = {};  // filled cells above, per column
+    std::uint32_t well[PLANES] = {};   // depth of the open well a cell is in, per column
+    int first = 0;  // empty rows above the stack only add their two wall transitions
+    while (first < ROWS && rows[first] == 0) { ++first; }
+    row_transitions += 2 * first;
+    if (first > 0) { column_transitions += popcount(first < ROWS ? rows[first] : FULL); }  // into the stack or the floor
+    for (int y = first; y < ROWS; ++y) {
+        const std::uint32_t r = rows[y];
+        const std::uint32_t walled = r << 1 | WALLS;
+        row_transitions += popcount((walled ^ walled >> 1) & (FULL << 1 | 1));
+        column_transitions += popcount(r ^ (y + 1 < ROWS ? rows[y + 1] : FULL));
+        const std::uint32_t hole = ~r & covered & FULL;
+        holes += popcount(hole);
+        rows_with_holes += hole != 0;
+        hole_depth += total(above, hole);
+        increment(above, r);
+        covered |= r;
+        const std::uint32_t open = ~r & ~covered & FULL & (r << 1 | 1) & (r >> 1 | 1u << (COLS - 1));
+        for (std::uint32_t& plane : well) { plane &= open; }
+        increment(well, open);
+        wells += total(well, open);
+    }
+    f[ROW_TRANSITIONS] = row_transitions;
+    f[COLUMN_TRANSITIONS] = column_transitions;
+    f[HOLES] = holes;
+    f[CUMULATIVE_WELLS] = wells;
+    f[HOLE_DEPTH] = hole_depth;
+    f[ROWS_WITH_HOLES] = rows_with_holes;
+}
+
+// Result of lockPiece(): rows spanned by the piece and the lines it cleared.
+struct Lock {
+    int top, bottom;
+    int cleared;
+    int eroded;  // piece cells in the cleared lines
+};
+
+// `rows` with `type` locked at `p` and full lines cleared, into `after`.
+inline Lock lockPiece(const std::uint16_t (&rows)[ROWS], PieceType type, Position p, std::uint16_t (&after)[ROWS]) {
+    std::copy(std::begin(rows), std::end(rows), std::begin(after));
+    const Piece& piece = ops::getPiece(type, p.orientation);
+    Lock lock{ROWS, -1, 0, 0};
+    for (int i = 0; i < Piece::SIZE; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            if (!(piece.data[i] & ops::shift(static_cast<Row>(Cell::BLOCK), c))) { continue; }
+            const int y = p.y + i;
+            after[y] = static_cast<std::uint16_t>(after[y] | 1u << (p.x + c - BOARD_LEFT));
+            lock.top = std::min(lock.top, y);
+            lock.bottom = std::max(lock.bottom, y);
+        }
+    }
+    for (int y = lock.bottom; y >= lock.top; --y) {
+        if (after[y] != FULL) { continue; }
+        ++lock.cleared;
+        lock.eroded += popcount(after[y] & ~rows[y]);
+    }
+    if (lock.cleared != 0) {
+        int to = lock.bottom;
+        for (int y = lock.bottom; y >= 0; --y) {
+            if (after[y] != FULL) { after[to--] = after[y]; }
+        }
+        while (to >= 0) { after[to--] = 0; }
+    }
+    return lock;
+}
+
+// Features after locking `type` at `p` on `rows`.
+inline void placementFeatures(const std::uint16_t (&rows)[ROWS], PieceType type, Position p, double* f) {
+    std::uint16_t after[ROWS];
+    const Lock lock = lockPiece(rows, type, p, after);
+    f[LANDING_HEIGHT] = ROWS - (lock.top + lock.bottom) / 2.0;
+    f[ERODED_CELLS] = lock.cleared * lock.eroded;
+    boardFeatures(after, f);
+}
+
+struct Choice {
+    bool     hold;
+    Position position;
+};
+
+// Best landing of the current piece (or the hold piece) under `weights`;
+// false if no piece can be placed.
+inline bool choosePlacement(const envs::step::Context& ctx, const double* weights, bool use_hold, MoveGenerator* movegen,
+                            Choice* best) {
+    std::uint16_t rows[ROWS];
+    playfieldRows(ctx.state.board, rows);
+    double best_score = 0.0;
+    bool found = false;
+    for (int h = 0; h < (use_hold ? 2 : 1); ++h) {
+        PieceType type;
+        Position start;
+        MoveRules rules;
+        if (!placementQuery(&ctx, h != 0, &type, &start, &rules)) { continue; }
+        movegen->generateLandingMap(ctx.state.board, type, start, rules);
+        const auto& land = movegen->landingMap();
+        for (int o = 0; o < 4; ++o) {
+            for (int y = 0; y < BOARD_HEIGHT; ++y) {
+                for (std::uint32_t bits = land[o][y]; bits != 0; bits &= bits - 1) {
+                    const Position p{static_cast<std::int8_t>(__builtin_ctz(bits)), static_cast<std::int8_t>(y),
+                                     static_cast<std::uint8_t>(o)};
+                    double f[HEURISTIC_FEATURES];
+                    placementFeatures(rows, type, p, f);
+                    double score = 0.0;
+                    for (int i = 0; i < HEURISTIC_FEATURES; ++i) { score += weights[i] * f[i]; }
+                    if (!found || score > best_score) {
+                        found = true;
+                        best_score = score;
+                        *best = {h != 0, p};
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
+
+// Steps `choice` (HOLD first if it asks for it, then the shortest path to its
+// landing) through the env; false if the landing is no longer reachable, in
+// which case only the HOLD may have been stepped.
+inline bool playChoice(envs::step::Context* ctx, const Choice& choice, MoveGenerator* movegen) {
+    using namespace envs::step;
+    if (choice.hold) { step(ctx, Action::HOLD); }
+    const State& s = ctx->state;
+    movegen->generate(s.board, s.current, {s.x, s.y, s.orientation}, currentMoveRules(ctx), &choice.position);
+    // generate() stops at the target, so the last landing is the target only if it was reached
+    if (movegen->landingCount() == 0 || !(movegen->landings()[movegen->landingCount() - 1].position == choice.position)) { return false; }
+    Action path[PLACEMENT_PATH_CAPACITY];
+    const int length = movegen->pathTo(movegen->landings()[movegen->landingCount() - 1], path, PLACEMENT_PATH_CAPACITY);
+    if (length < 0) { return false; }
+    Info last;
+    stepSequence(ctx, path, length, STOP_ON_LOCK, &last, [](const Info&) {});
+    return true;
+}
+
+struct GameResult {
+    std::uint32_t lines, attack, pieces;
+};
+
+inline GameResult playGame(const double* weights, const HeuristicOptions& options, int game, MoveGenerator* movegen) {
+    using namespace envs::step;
+    Context ctx{};
+    setConfig(&ctx, options.config);
+    std::uint32_t piece_seed, garbage_seed;
+    episodeSeeds(options.seed, 0, static_cast<std::uint32_t>(game), &piece_seed, &garbage_seed);
+    setSeed(&ctx, piece_seed, garbage_seed);
+    reset(&ctx);
+    std::uint32_t pieces = 0;
+    while (ctx.state.is_alive && (options.max_pieces <= 0 || pieces < static_cast<std::uint32_t>(options.max_pieces))) {
+        Choice choice;
+        if (!choosePlacement(ctx, weights, options.use_hold != 0, movegen, &choice)) { break; }
+        if (!playChoice(&ctx, choice, movegen)) { break; }
+        ++pieces;
+    }
+    return {ctx.state.total_lines_cleared, ctx.state.total_attack, pieces};
+}
+
+} // namespace heuristic_detail
+
+// Plays options.games games for each of the `count` weight vectors
+// (weights[v * HEURISTIC_FEATURES + i]) over options.threads threads; game k
+// is dealt the same pieces for every vector.
+inline void evaluateHeuristics(const double* weights, int count, const HeuristicOptions& options, HeuristicResult* out) {
+    using heuristic_detail::GameResult;
+    const int games = std::max(1, options.games);
+    const int jobs = count * games;
+    std::vector<GameResult> results(static_cast<std::size_t>(jobs));
+    std::atomic<int> next{0};
+    auto run = [&] {
+        auto movegen = std::make_unique<MoveGenerator>();
+        for (int job; (job = next.fetch_add(1, std::memory_order_relaxed)) < jobs;) {
+            results[job] = heuristic_detail::playGame(weights + static_cast<std::ptrdiff_t>(job / games) * HEURISTIC_FEATURES, options,
+                                                      job % games, movegen.get());
+        }
+    };
+    const int threads = std::clamp<int>(options.threads, 1, std::max(jobs, 1));
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) { pool.emplace_back(run); }
+    run();
+    for (auto& thread : pool) { thread.join(); }
+
+    for (int v = 0; v < count; ++v) {
+        const GameResult* r = results.data() + static_cast<std::ptrdiff_t>(v) * games;
+        double lines = 0, attack = 0, pieces = 0;
+        for (int g = 0; g < games; ++g) { lines += r[g].lines; attack += r[g].attack; pieces += r[g].pieces; }
+        lines /= games; attack /= games; pieces /= games;
+        double lines_var = 0, attack_var = 0;
+        for (int g = 0; g < games; ++g) {
+            lines_var += (r[g].lines - lines) * (r[g].lines - lines);
+            attack_var += (r[g].attack - attack) * (r[g].attack - attack);
+        }
+        const int dof = std::max(games - 1, 1);
+        out[v] = {lines, lines_var / dof, attack, attack_var / dof, pieces};
+    }
+}
+
+} // namespace tetrl::search
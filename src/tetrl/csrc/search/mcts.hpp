@@ -0,0 +1,615 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/plugin.hpp"
+#include "envs/step/step.hpp"
+#include "search/afterstate.hpp"
+#include "search/heuristic.hpp"
+#include "search/movegen.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace tetrl::search {
+
+// AlphaZero-style Monte Carlo tree search over placements, for policy-guided
+// self-play at training time.
+//
+// A service owns one tree per root game. A move is a placement of the
+// current piece (or, with hold, of the piece HOLD brings in) and a node is
+// the step-env Context after it, built by replaying the placement's path
+// through envs::step::step() on a copy of the parent's Context the first
+// time the node is reached, so garbage, spins, attack and the piece queue
+// follow the env exactly. Each placement earns
+//   attack_weight * attack + lines_weight * lines_cleared (+ top_out_reward on a top out)
+// and values are discounted returns: Q(s, a) = r(a) + gamma * V(s').
+//
+// search() runs rounds until every root has `simulations` more visits. In a
+// round the trees are split over the worker threads; each tree descends by
+// PUCT up to its share of batch_size times, adding virtual visits (counted as
+// losses) on the way so that the descents of one round spread over the tree,
+// and stops early on reaching a leaf already waiting for evaluation. The
+// leaves of all trees are then handed to the evaluator in one batch: their
+// observations and, per candidate placement,
+// its (hold, x, y, orientation) and optional afterstate features
+// (afterstate.hpp), to which it answers a value per leaf and a prior per
+// placement. The workers then expand the leaves and back the values up.
+// Q values are min-max normalised per tree, as in MuZero, since returns are
+// not bounded; unvisited placements take their parent's value.
+//
+// Leaf observations come from the env's feature plugin (plugin.hpp): every
+// node keeps its own plugin context, copied from its parent's and stepped
+// once with the Info of the placement's last action, so a leaf sees the
+// observation StepEnv.step_many(placement) returns for the same state.
+// Without a plugin (feature_step_batch == nullptr) leaves use the fixed
+// MCTS_OBSERVATION_SIZE encoding below.
+
+constexpr int MCTS_NEXT = 5;  // queued pieces in the observation
+constexpr int MCTS_PIECE_TYPES = static_cast<int>(PieceType::SIZE);
+// Fixed observation of a leaf: the visible 20x10 occupancy planes, one-hots of the
+// current piece, the hold piece and the next MCTS_NEXT pieces (piece order
+// Z, L, O, S, I, J, T; all zero for none), then has_held, back-to-back,
+// combo / 12 and pending garbage lines / 20, the last two clipped to 1.
+constexpr int MCTS_OBSERVATION_SIZE = AFTERSTATE_PLANE_SIZE + (2 + MCTS_NEXT) * MCTS_PIECE_TYPES + 4;
+constexpr int MCTS_MAX_CHILDREN = 1024;
+
+struct MctsOptions {
+    std::uint64_t seed              = 0;      // root noise
+    float         c_puct            = 1.25f;
+    float         gamma             = 0.99f;
+    float         attack_weight     = 1.0f;
+    float         lines_weight      = 0.0f;
+    float         top_out_reward    = -1.0f;
+    float         dirichlet_alpha   = 0.3f;
+    float         dirichlet_epsilon = 0.0f;   // weight of the root noise (0 = none)
+    std::int32_t  batch_size        = 64;     // leaves per evaluator call, at most
+    std::int32_t  virtual_loss      = 1;      // virtual visits per pending descent
+    std::uint8_t  use_hold          = 1;
+    std::uint8_t  threads           = 1;
+    std::uint8_t  afterstate_planes = 0;      // afterstate features of every placement, see afterstate.hpp
+    std::uint8_t  afterstate_stats  = 0;
+    envs::step::FeatureResetFn     feature_reset        = nullptr;
+    envs::step::FeatureStepBatchFn feature_step_batch   = nullptr;  // nullptr: fixed observations
+    std::int64_t                   feature_context_size = 0;
+    std::int64_t                   feature_size         = 0;        // floats per observation
+};
+
+inline int mctsObservationSize(const MctsOptions& o) {
+    return o.feature_step_batch != nullptr ? static_cast<int>(o.feature_size) : MCTS_OBSERVATION_SIZE;
+}
+
+// One evaluator call: `leaves` leaves with `children` candidate placements in
+// total; those of leaf i are rows offsets[i] .. offsets[i + 1] - 1.
+struct MctsBatch {
+    const float*        observations;     // [leaves, observation_size]
+    const float*        afterstates;      // [children, afterstate_size]
+    const std::int8_t*  placements;       // [children, 4]: hold, x, y, orientation
+    const std::int32_t* offsets;          // [leaves + 1]
+    float*              priors;           // [children], written by the evaluator
+    float*              values;           // [leaves], written by the evaluator
+    std::int32_t        leaves;
+    std::int32_t        children;
+    std::int32_t        afterstate_size;
+    std::int32_t        observation_size;
+};
+
+// Evaluates a batch in place; a non-zero result aborts the search with it.
+using MctsEvaluateFn = std::int32_t (*)(void* user, const MctsBatch* batch);
+
+// Statistics of a root or of one of its placements.
+struct MctsStats {
+    std::int32_t visits;
+    float        prior;
+    float        q;  // mean return; for a placement including its reward
+};
+
+namespace mcts_detail {
+
+enum class NodeState : std::uint8_t { UNEXPANDED, PENDING, EXPANDED, TERMINAL };
+
+struct Node {
+    std::int32_t parent;
+    std::int32_t first_child;
+    std::int32_t child_count;
+    std::int32_t context;         // into Tree::contexts, -1 until the node is reached
+    std::int32_t visits;
+    std::int32_t virtual_visits;
+    float        prior;
+    float        reward;          // of the placement from the parent
+    double       value_sum;       // backed-up returns from this node's state
+    NodeState    state;
+};
+
+// A leaf waiting for the evaluator, with its placements in Tree::pending.
+struct Leaf {
+    std::int32_t node;
+    std::int32_t first;
+    std::int32_t count;
+};
+
+struct Tree {
+    std::vector<Node>                 nodes;
+    std::vector<PlacementPath>        paths;      // paths[k]: the placement leading to node k
+    std::vector<envs::step::Context>  contexts;
+    std::vector<std::byte>            feature_contexts;  // one plugin context per context
+    std::vector<std::vector<float>>   rows;       // per context: its plugin observation until the node is expanded
+    std::vector<Leaf>                 leaves;     // this round's pending evaluations
+    std::vector<PlacementPath>        pending;
+    std::vector<float>                observations;
+    std::vector<float>                afterstates;
+    std::int32_t                      quota = 0;  // descents this round
+    std::int32_t                      target = 0; // root visits to reach
+    std::int32_t                      batch_leaf = 0, batch_child = 0;
+    float                             q_min = std::numeric_limits<float>::infinity();
+    float                             q_max = -std::numeric_limits<float>::infinity();
+    std::mt19937_64                   rng;
+
+    // Empties the tree; the root node takes the next context added with take().
+    void reset(std::uint64_t seed) {
+        nodes.assign(1, Node{-1, -1, 0, 0, 0, 0, 1.0f, 0.0f, 0.0, NodeState::UNEXPANDED});
+        paths.assign(1, PlacementPath{});
+        contexts.clear();
+        feature_contexts.clear();
+        rows.clear();
+        q_min = std::numeric_limits<float>::infinity();
+        q_max = -std::numeric_limits<float>::infinity();
+        rng.seed(seed);
+    }
+
+    // Appends context k of `from` with its plugin context and observation;
+    // returns its index here.
+    std::int32_t take(Tree* from, int k, std::size_t feature_bytes) {
+        contexts.push_back(from->contexts[k]);
+        const std::size_t at = feature_contexts.size();
+        feature_contexts.resize(at + feature_bytes);
+        if (feature_bytes > 0) { std::memcpy(feature_contexts.data() + at, from->feature_contexts.data() + k * feature_bytes, feature_bytes); }
+        rows.push_back(std::move(from->rows[k]));
+        return static_cast<std::int32_t>(contexts.size() - 1);
+    }
+
+    void* featureContext(int k, std::size_t feature_bytes) { return envs::step::pluginContextAt(feature_contexts.data(), feature_bytes, k); }
+
+    bool done() const { return nodes[0].state == NodeState::TERMINAL || nodes[0].visits >= target; }
+
+    float normalized(float q) const { return q_max > q_min ? (q - q_min) / (q_max - q_min) : 0.5f; }
+
+    void observe(float q) {
+        q_min = std::min(q_min, q);
+        q_max = std::max(q_max, q);
+    }
+};
+
+struct Worker {
+    MoveGenerator              movegen;
+    std::vector<PlacementPath> paths = std::vector<PlacementPath>(MCTS_MAX_CHILDREN);
+    std::vector<float>         features;
+};
+
+inline std::uint64_t treeSeed(std::uint64_t seed, int tree, std::uint64_t resets) {
+    std::uint64_t z = seed + 0x9E3779B97F4A7C15ull * (static_cast<std::uint64_t>(tree) + 1) + (resets << 32);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline void observation(const envs::step::Context& ctx, float* out) {
+    const State& s = ctx.state;
+    std::uint16_t rows[heuristic_detail::ROWS];
+    heuristic_detail::playfieldRows(s.board, rows);
+    afterstate_detail::planes(rows, out);
+    float* f = out + AFTERSTATE_PLANE_SIZE;
+    std::fill(f, out + MCTS_OBSERVATION_SIZE, 0.0f);
+    auto oneHot = [](PieceType type, float* at) {
+        if (type != PieceType::NONE) { at[static_cast<int>(type)] = 1.0f; }
+    };
+    oneHot(s.current, f);
+    oneHot(s.hold, f + MCTS_PIECE_TYPES);
+    for (int i = 0; i < MCTS_NEXT && i < s.next_count; ++i) { oneHot(peekNext(&s, i), f + (2 + i) * MCTS_PIECE_TYPES); }
+    f += (2 + MCTS_NEXT) * MCTS_PIECE_TYPES;
+    f[0] = s.has_held ? 1.0f : 0.0f;
+    f[1] = s.back_to_back_count > 0 ? 1.0f : 0.0f;
+    f[2] = std::clamp(s.combo_count / 12.0f, 0.0f, 1.0f);
+    f[3] = std::min(pendingGarbageLines(&s) / 20.0f, 1.0f);
+}
+
+// Mixes Dirichlet(alpha) noise into the priors of the root's placements.
+inline void addRootNoise(Tree* tree, const MctsOptions& o) {
+    const Node& root = tree->nodes[0];
+    if (o.dirichlet_epsilon <= 0.0f || root.state != NodeState::EXPANDED || root.child_count == 0) { return; }
+    std::gamma_distribution<float> gamma(std::max(o.dirichlet_alpha, 1e-3f), 1.0f);
+    std::vector<float> noise(static_cast<std::size_t>(root.child_count));
+    float sum = 0.0f;
+    for (float& x : noise) { sum += x = gamma(tree->rng); }
+    if (!(sum > 0.0f)) { return; }
+    for (int k = 0; k < root.child_count; ++k) {
+        Node& child = tree->nodes[root.first_child + k];
+        child.prior = (1.0f - o.dirichlet_epsilon) * child.prior + o.dirichlet_epsilon * noise[k] / sum;
+    }
+}
+
+// Returns `value` (the return from `leaf`'s state) up the tree, removing
+// `virtual_visits` from every node on the way.
+inline void backup(Tree* tree, int leaf, double value, int virtual_visits, float gamma) {
+    double g = value;
+    for (int i = leaf; i != -1;) {
+        Node& n = tree->nodes[i];
+        ++n.visits;
+        n.value_sum += g;
+        n.virtual_visits -= virtual_visits;
+        if (n.parent != -1) {
+            tree->observe(n.reward + gamma * static_cast<float>(n.value_sum / n.visits));
+            g = n.reward + gamma * g;
+        }
+        i = n.parent;
+    }
+}
+
+inline int bestChild(const Tree& tree, int node, const MctsOptions& o) {
+    const Node& p = tree.nodes[node];
+    const float parent_value = p.visits > 0 ? static_cast<float>(p.value_sum / p.visits) : 0.0f;
+    const float explore = o.c_puct * std::sqrt(static_cast<float>(std::max(p.visits + p.virtual_visits, 1)));
+    int best = p.first_child;
+    float best_score = -std::numeric_limits<float>::infinity();
+    for (int i = p.first_child; i < p.first_child + p.child_count; ++i) {
+        const Node& c = tree.nodes[i];
+        const int n = c.visits, seen = c.visits + c.virtual_visits;
+        float q = tree.normalized(n > 0 ? c.reward + o.gamma * static_cast<float>(c.value_sum / n) : parent_value);
+        if (seen > 0) { q = q * static_cast<float>(n) / static_cast<float>(seen); }
+        const float score = q + explore * c.prior / static_cast<float>(1 + seen);
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Replays the placement leading to `node` on its parent's Context and, with
+// a feature plugin, steps a copy of the parent's plugin context once with the
+// Info of the last action, keeping the observation for the node's evaluation.
+inline void materialize(Tree* tree, int node, const MctsOptions& o) {
+    Node& n = tree->nodes[node];
+    if (n.context != -1) { return; }
+    const int parent = tree->nodes[n.parent].context;
+    envs::step::Context ctx = tree->contexts[parent];
+    const PlacementPath& path = tree->paths[node];
+    envs::step::Info last;
+    envs::step::stepSequence(&ctx, path.path, path.path_length, envs::step::STOP_ON_LOCK, &last, [](const envs::step::Info&) {});
+    const State& s = ctx.state;
+    n.reward = o.attack_weight * s.attack + o.lines_weight * s.lines_cleared + (s.is_alive ? 0.0f : o.top_out_reward);
+    if (!s.is_alive) { n.state = NodeState::TERMINAL; }
+    n.context = static_cast<std::int32_t>(tree->contexts.size());
+    tree->contexts.push_back(ctx);
+    tree->rows.emplace_back();
+    if (o.feature_step_batch == nullptr) { return; }
+    const auto bytes = static_cast<std::size_t>(o.feature_context_size);
+    tree->feature_contexts.resize(tree->feature_contexts.size() + bytes);
+    if (bytes > 0) { std::memcpy(tree->featureContext(n.context, bytes), tree->featureContext(parent, bytes), bytes); }
+    if (n.state == NodeState::TERMINAL) { return; }  // never evaluated
+    std::vector<float>& row = tree->rows.back();
+    row.resize(static_cast<std::size_t>(o.feature_size));
+    o.feature_step_batch(&ctx, &last, tree->featureContext(n.context, bytes), row.data(), 1, row.size());
+}
+
+// Sets up the plugin context and observation of the root (context 0): copies
+// of `feature_ctx` and `observation` when given, otherwise as StepEnv.reset
+// does, by feature_reset and one step with an empty Info.
+inline void initRootFeature(Tree* tree, const MctsOptions& o, const void* feature_ctx, const float* observation) {
+    if (o.feature_step_batch == nullptr) { return; }
+    const auto bytes = static_cast<std::size_t>(o.feature_context_size);
+    tree->feature_contexts.assign(bytes, std::byte{0});
+    void* plugin_ctx = tree->featureContext(0, bytes);
+    envs::step::Context ctx = tree->contexts[0];
+    if (feature_ctx != nullptr) {
+        if (bytes > 0) { std::memcpy(plugin_ctx, feature_ctx, bytes); }
+    } else {
+        o.feature_reset(&ctx, plugin_ctx);
+    }
+    std::vector<float>& row = tree->rows[0];
+    row.resize(static_cast<std::size_t>(o.feature_size));
+    if (observation != nullptr) {
+        std::copy(observation, observation + row.size(), row.begin());
+    } else {
+        envs::step::Info info{};
+        o.feature_step_batch(&ctx, &info, plugin_ctx, row.data(), 1, row.size());
+    }
+}
+
+enum class Descent { LEAF, TERMINAL, COLLISION };
+
+// One PUCT descent from the root. A new leaf is queued for evaluation with
+// virtual visits along its path; a terminal node is backed up at once.
+inline Descent descend(Tree* tree, const MctsOptions& o, Worker* w) {
+    int node = 0;
+    while (tree->nodes[node].state == NodeState::EXPANDED) {
+        node = bestChild(*tree, node, o);
+        materialize(tree, node, o);
+    }
+    Node& n = tree->nodes[node];
+    if (n.state == NodeState::PENDING) { return Descent::COLLISION; }
+    if (n.state == NodeState::UNEXPANDED) {
+        AfterstateOptions ao;
+        ao.use_hold = o.use_hold;
+        ao.planes = o.afterstate_planes;
+        ao.stats = o.afterstate_stats;
+        const int size = afterstateFeatureSize(ao);
+        w->features.resize(static_cast<std::size_t>(MCTS_MAX_CHILDREN) * size);
+        const envs::step::Context& ctx = tree->contexts[n.context];
+        const int count = generateAfterstates(&ctx, ao, &w->movegen, w->paths.data(), w->features.data(), MCTS_MAX_CHILDREN);
+        if (count == 0) {
+            n.state = NodeState::TERMINAL;
+            std::vector<float>().swap(tree->rows[n.context]);
+        } else {
+            n.state = NodeState::PENDING;
+            tree->leaves.push_back({node, static_cast<std::int32_t>(tree->pending.size()), count});
+            tree->pending.insert(tree->pending.end(), w->paths.begin(), w->paths.begin() + count);
+            tree->afterstates.insert(tree->afterstates.end(), w->features.begin(), w->features.begin() + static_cast<std::ptrdiff_t>(count) * size);
+            const std::size_t at = tree->observations.size();
+            tree->observations.resize(at + mctsObservationSize(o));
+            if (o.feature_step_batch != nullptr) {
+                const std::vector<float>& row = tree->rows[n.context];
+                std::copy(row.begin(), row.end(), tree->observations.begin() + static_cast<std::ptrdiff_t>(at));
+            } else {
+                observation(ctx, tree->observations.data() + at);
+            }
+            for (int i = node; i != -1; i = tree->nodes[i].parent) { tree->nodes[i].virtual_visits += o.virtual_loss; }
+            return Descent::LEAF;
+        }
+    }
+    backup(tree, node, 0.0, 0, o.gamma);
+    return Descent::TERMINAL;
+}
+
+// Expands the pending leaves of `tree` with the evaluator's answers.
+inline void expand(Tree* tree, const MctsBatch& batch, const MctsOptions& o) {
+    for (std::size_t l = 0; l < tree->leaves.size(); ++l) {
+        const Leaf& leaf = tree->leaves[l];
+        const int row = tree->batch_leaf + static_cast<int>(l);
+        const float* priors = batch.priors + batch.offsets[row];
+        float sum = 0.0f;
+        for (int k = 0; k < leaf.count; ++k) { sum += priors[k] > 0.0f ? priors[k] : 0.0f; }  // NaN counts as 0
+        const int first = static_cast<int>(tree->nodes.size());
+        for (int k = 0; k < leaf.count; ++k) {
+            const float p = sum > 0.0f ? (priors[k] > 0.0f ? priors[k] / sum : 0.0f) : 1.0f / leaf.count;
+            tree->nodes.push_back(Node{leaf.node, -1, 0, -1, 0, 0, p, 0.0f, 0.0, NodeState::UNEXPANDED});
+            tree->paths.push_back(tree->pending[leaf.first + k]);
+        }
+        Node& n = tree->nodes[leaf.node];
+        n.first_child = first;
+        n.child_count = leaf.count;
+        n.state = NodeState::EXPANDED;
+        std::vector<float>().swap(tree->rows[n.context]);
+        if (leaf.node == 0) { addRootNoise(tree, o); }
+        const float value = batch.values[row];
+        backup(tree, leaf.node, std::isfinite(value) ? value : 0.0, o.virtual_loss, o.gamma);
+    }
+}
+
+inline void clearRound(Tree* tree) {
+    tree->leaves.clear();
+    tree->pending.clear();
+    tree->observations.clear();
+    tree->afterstates.clear();
+}
+
+// Returns the pending leaves of an aborted round to their unexpanded state.
+inline void cancelRound(Tree* tree, const MctsOptions& o) {
+    for (const Leaf& leaf : tree->leaves) {
+        tree->nodes[leaf.node].state = NodeState::UNEXPANDED;
+        for (int i = leaf.node; i != -1; i = tree->nodes[i].parent) { tree->nodes[i].virtual_visits -= o.virtual_loss; }
+    }
+    clearRound(tree);
+}
+
+} // namespace mcts_detail
+
+class MctsService {
+public:
+    MctsService(int roots, const MctsOptions& options) : options_(options), trees_(static_cast<std::size_t>(std::max(roots, 0))) {
+        options_.batch_size = std::max(options_.batch_size, 1);
+        options_.virtual_loss = std::max(options_.virtual_loss, 0);
+        options_.threads = std::max<std::uint8_t>(options_.threads, 1);
+        for (int t = 0; t < options_.threads; ++t) { workers_.push_back(std::make_unique<mcts_detail::Worker>()); }
+        if (options_.feature_step_batch == nullptr) { options_.feature_size = 0; }
+        options_.feature_context_size = std::max<std::int64_t>(options_.feature_context_size, 0);
+        const envs::step::Context empty{};
+        for (int i = 0; i < roots; ++i) { setRoot(i, empty); }
+    }
+
+    int roots() const { return static_cast<int>(trees_.size()); }
+
+    // Starts a new tree at `ctx` for root game i. With a feature plugin, the
+    // root's plugin context and observation are copied from `feature_ctx` and
+    // `observation` (the env's, each nullable; see initRootFeature).
+    void setRoot(int i, const envs::step::Context& ctx, const void* feature_ctx = nullptr, const float* observation = nullptr) {
+        mcts_detail::Tree& tree = trees_[i];
+        tree.reset(mcts_detail::treeSeed(options_.seed, i, resets_++));
+        tree.contexts.push_back(ctx);
+        tree.rows.emplace_back();
+        mcts_detail::initRootFeature(&tree, options_, feature_ctx, observation);
+        if (!ctx.state.is_alive) { tree.nodes[0].state = mcts_detail::NodeState::TERMINAL; }
+    }
+
+    // Makes placement k of root i the new root, keeping its subtree. Returns
+    // false if there is no such placement.
+    bool advance(int i, int k) {
+        using mcts_detail::Node;
+        mcts_detail::Tree& tree = trees_[i];
+        const Node& root = tree.nodes[0];
+        if (root.state != mcts_detail::NodeState::EXPANDED || k < 0 || k >= root.child_count) { return false; }
+        const int child = root.first_child + k;
+        mcts_detail::materialize(&tree, child, options_);
+        const auto feature_bytes = static_cast<std::size_t>(options_.feature_context_size);
+        mcts_detail::Tree next;
+        next.reset(mcts_detail::treeSeed(options_.seed, i, resets_++));
+        next.take(&tree, tree.nodes[child].context, feature_bytes);
+        next.nodes[0] = tree.nodes[child];
+        next.nodes[0].parent = -1;
+        next.nodes[0].context = 0;
+        // Breadth-first copy: the children of a node stay contiguous.
+        for (std::size_t at = 0; at < next.nodes.size(); ++at) {
+            const int old_first = next.nodes[at].first_child, count = next.nodes[at].child_count;
+            if (count == 0) { continue; }
+            next.nodes[at].first_child = static_cast<std::int32_t>(next.nodes.size());
+            for (int c = old_first; c < old_first + count; ++c) {
+                Node copy = tree.nodes[c];
+                copy.parent = static_cast<std::int32_t>(at);
+                if (copy.context != -1) { copy.context = next.take(&tree, copy.context, feature_bytes); }
+                next.nodes.push_back(copy);
+                next.paths.push_back(tree.paths[c]);
+            }
+        }
+        next.q_min = tree.q_min;
+        next.q_max = tree.q_max;
+        tree = std::move(next);
+        mcts_detail::addRootNoise(&tree, options_);
+        return true;
+    }
+
+    // Adds `simulations` visits to every live root, calling `evaluate` once
+    // per round with the leaves of all trees. Returns 0, or the evaluator's
+    // non-zero result (the trees are left as before that round's descents).
+    int search(int simulations, MctsEvaluateFn evaluate, void* user) {
+        using namespace mcts_detail;
+        for (Tree& tree : trees_) { tree.target = tree.nodes[0].visits + std::max(simulations, 0); }
+        std::vector<int> active;
+        std::vector<int> busy;
+        for (;;) {
+            active.clear();
+            for (int i = 0; i < roots(); ++i) {
+                if (!trees_[i].done()) { active.push_back(i); }
+            }
+            if (active.empty()) { return 0; }
+
+            // Shares of the batch, round-robin when there are more trees than leaves.
+            const int share = std::max(1, options_.batch_size / static_cast<int>(active.size()));
+            int budget = options_.batch_size;
+            busy.clear();
+            for (std::size_t j = 0; j < active.size() && budget > 0; ++j) {
+                const int i = active[(cursor_ + j) % active.size()];
+                Tree& tree = trees_[i];
+                tree.quota = std::min({share, budget, tree.target - tree.nodes[0].visits});
+                budget -= tree.quota;
+                busy.push_back(i);
+            }
+            cursor_ = (cursor_ + busy.size()) % active.size();
+
+            parallel(busy, [&](int i, Worker* w) {
+                Tree& tree = trees_[i];
+                clearRound(&tree);
+                for (int d = 0; d < tree.quota && !tree.done(); ++d) {
+                    if (descend(&tree, options_, w) == Descent::COLLISION) { break; }
+                }
+            });
+
+            MctsBatch batch = gather(busy);
+            if (batch.leaves == 0) { continue; }
+            const std::int32_t status = evaluate(user, &batch);
+            if (status != 0) {
+                for (int i : busy) { cancelRound(&trees_[i], options_); }
+                return status;
+            }
+            parallel(busy, [&](int i, Worker*) {
+                expand(&trees_[i], batch, options_);
+                clearRound(&trees_[i]);
+            });
+        }
+    }
+
+    MctsStats rootStats(int i) const {
+        const mcts_detail::Node& root = trees_[i].nodes[0];
+        return {root.visits, 1.0f, root.visits > 0 ? static_cast<float>(root.value_sum / root.visits) : 0.0f};
+    }
+
+    // The placements of root i with their statistics; returns how many were
+    // written (0 before the root is expanded).
+    int children(int i, PlacementPath* paths, MctsStats* stats, int capacity) const {
+        const mcts_detail::Tree& tree = trees_[i];
+        const mcts_detail::Node& root = tree.nodes[0];
+        if (root.state != mcts_detail::NodeState::EXPANDED) { return 0; }
+        const int count = std::min(root.child_count, capacity);
+        for (int k = 0; k < count; ++k) {
+            const mcts_detail::Node& c = tree.nodes[root.first_child + k];
+            paths[k] = tree.paths[root.first_child + k];
+            stats[k] = {c.visits, c.prior, c.visits > 0 ? c.reward + options_.gamma * static_cast<float>(c.value_sum / c.visits) : 0.0f};
+        }
+        return count;
+    }
+
+    const envs::step::Context& rootContext(int i) const { return trees_[i].contexts[0]; }
+
+    std::size_t nodes(int i) const { return trees_[i].nodes.size(); }
+
+private:
+    // Calls body(tree, worker) for every tree of `ids` over the worker threads.
+    template <typename Body>
+    void parallel(const std::vector<int>& ids, Body body) {
+        const int threads = std::clamp<int>(static_cast<int>(workers_.size()), 1, std::max<int>(static_cast<int>(ids.size()), 1));
+        std::atomic<int> next{0};
+        auto run = [&](int t) {
+            for (int j; (j = next.fetch_add(1, std::memory_order_relaxed)) < static_cast<int>(ids.size());) { body(ids[j], workers_[t].get()); }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t) { pool.emplace_back(run, t); }
+        run(0);
+        for (auto& thread : pool) { thread.join(); }
+    }
+
+    // Concatenates the pending leaves of the trees of `ids` into the batch buffers.
+    MctsBatch gather(const std::vector<int>& ids) {
+        int leaves = 0, children = 0;
+        for (int i : ids) {
+            mcts_detail::Tree& tree = trees_[i];
+            tree.batch_leaf = leaves;
+            tree.batch_child = children;
+            leaves += static_cast<int>(tree.leaves.size());
+            children += static_cast<int>(tree.pending.size());
+        }
+        AfterstateOptions ao;
+        ao.planes = options_.afterstate_planes;
+        ao.stats = options_.afterstate_stats;
+        const int size = afterstateFeatureSize(ao);
+        const int observation_size = mctsObservationSize(options_);
+        observations_.resize(static_cast<std::size_t>(leaves) * observation_size);
+        afterstates_.resize(static_cast<std::size_t>(children) * size);
+        placements_.resize(static_cast<std::size_t>(children) * 4);
+        offsets_.resize(static_cast<std::size_t>(leaves) + 1);
+        priors_.assign(static_cast<std::size_t>(children), 0.0f);
+        values_.assign(static_cast<std::size_t>(leaves), 0.0f);
+        for (int i : ids) {
+            const mcts_detail::Tree& tree = trees_[i];
+            std::copy(tree.observations.begin(), tree.observations.end(), observations_.begin() + static_cast<std::ptrdiff_t>(tree.batch_leaf) * observation_size);
+            std::copy(tree.afterstates.begin(), tree.afterstates.end(), afterstates_.begin() + static_cast<std::ptrdiff_t>(tree.batch_child) * size);
+            for (std::size_t l = 0; l < tree.leaves.size(); ++l) { offsets_[tree.batch_leaf + l] = tree.batch_child + tree.leaves[l].first; }
+            for (std::size_t k = 0; k < tree.pending.size(); ++k) {
+                const PlacementPath& p = tree.pending[k];
+                std::int8_t* row = placements_.data() + (tree.batch_child + k) * 4;
+                row[0] = p.path_length > 0 && p.path[0] == Action::HOLD;
+                row[1] = p.position.x;
+                row[2] = p.position.y;
+                row[3] = static_cast<std::int8_t>(p.position.orientation);
+            }
+        }
+        offsets_[leaves] = children;
+        return {observations_.data(), afterstates_.data(), placements_.data(), offsets_.data(), priors_.data(), values_.data(),
+                leaves, children, size, observation_size};
+    }
+
+    MctsOptions                                     options_;
+    std::vector<mcts_detail::Tree>                  trees_;
+    std::vector<std::unique_ptr<mcts_detail::Worker>> workers_;
+    std::uint64_t                                   resets_ = 0;
+    std::size_t                                     cursor_ = 0;
+    std::vector<float>                              observations_, afterstates_, priors_, values_;
+    std::vector<std::int8_t>                        placements_;
+    std::vector<std::int32_t>                       offsets_;
+};
+
+} // namespace tetrl::search
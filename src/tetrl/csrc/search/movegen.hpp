@@ -0,0 +1,408 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/step.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+namespace tetrl::search {
+
+using envs::step::Action;
+using envs::step::Context;
+
+// Piece position, with the same meaning as State::x / State::y / State::orientation.
+struct Position {
+    std::int8_t  x, y;
+    std::uint8_t orientation;
+};
+
+inline bool operator==(const Position& a, const Position& b) {
+    return a.x == b.x && a.y == b.y && a.orientation == b.orientation;
+}
+
+// How inputs move a piece. The step env applies gravity (one soft drop) after
+// every input but HARD_DROP and forces a hard drop once the piece lifetime runs
+// out, so at most lifetime - 1 inputs precede the HARD_DROP.
+struct MoveRules {
+    bool gravity;
+    int  max_inputs;
+};
+
+// Rules for the current piece of `ctx` (remaining lifetime) and for pieces
+// spawned later (a full piece_life).
+inline MoveRules currentMoveRules(const Context* ctx) {
+    return {ctx->config.auto_drop != 0, std::max(0, ctx->lifetime - 1)};
+}
+inline MoveRules spawnMoveRules(const Context* ctx) {
+    return {ctx->config.auto_drop != 0, std::max(0, ctx->config.piece_life - 1)};
+}
+
+inline bool canPlace(const Board& board, PieceType type, Position p) {
+    return ops::canPlacePiece(board, ops::getPiece(type, p.orientation), p.x, p.y);
+}
+
+// Where a freshly spawned piece starts; after a HOLD, gravity has already acted once.
+inline Position spawnPosition(const Board& board, PieceType type, bool gravity) {
+    Position p{static_cast<std::int8_t>(PIECE_SPAWN_X), static_cast<std::int8_t>(PIECE_SPAWN_Y), 0};
+    if (gravity && canPlace(board, type, {p.x, static_cast<std::int8_t>(p.y + 1), 0})) { ++p.y; }
+    return p;
+}
+
+inline Position dropPosition(const Board& board, PieceType type, Position p) {
+    while (canPlace(board, type, {p.x, static_cast<std::int8_t>(p.y + 1), p.orientation})) { ++p.y; }
+    return p;
+}
+
+// Per-row occupancy masks of `board`: bit x of occupied[y] is set for a block
+// at (x, y); bits beyond the last column count as wall.
+inline void occupancyRows(const Board& board, std::uint32_t (&occupied)[BOARD_HEIGHT]) {
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        std::uint32_t bits = ~std::uint32_t{0} << BOARD_WIDTH;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            if (board.data[y] & ops::shift(static_cast<Row>(Cell::BLOCK), x)) { bits |= std::uint32_t{1} << x; }
+        }
+        occupied[y] = bits;
+    }
+}
+
+// Final (hard-dropped) position reachable by the inputs of a MoveGenerator.
+struct Landing {
+    Position      position;
+    std::uint16_t node;  // BFS node whose hard drop lands here (see MoveGenerator::pathTo)
+};
+
+// Breadth-first search over piece positions with the engine's own movement
+// and SRS kick rules. Every landing is reported once, reached by a shortest
+// input sequence. Positions are stamped per search, so one generator can be
+// reused without clearing.
+class MoveGenerator {
+public:
+    static constexpr int NODES = 4 * BOARD_HEIGHT * BOARD_WIDTH;
+
+    // Explores every position reachable from `start` (which must fit) and
+    // collects the distinct landings in BFS order. With a `target`, stops as
+    // soon as that landing is found (it is then the last one).
+    void generate(const Board& board, PieceType type, Position start, const MoveRules& rules,
+                  const Position* target = nullptr) {
+        type_ = type;
+        buildFitMap(board, type);
+        if (++stamp_ == 0) {  // stamp wrapped: invalidate everything once
+            std::fill(std::begin(seen_), std::end(seen_), 0u);
+            std::fill(std::begin(landed_), std::end(landed_), 0u);
+            stamp_ = 1;
+        }
+        landing_count_ = 0;
+        if (!fits(start)) { return; }
+
+        int head = 0, tail = 0;
+        const int root = nodeOf(start);
+        seen_[root] = stamp_;
+        parent_[root] = static_cast<std::uint16_t>(root);
+        depth_[root] = 0;
+        queue_[tail++] = static_cast<std::uint16_t>(root);
+        while (head < tail) {
+            const int node = queue_[head++];
+            const Position p = positionOf(node);
+            const Position landing = drop(p);
+            addLanding(node, landing);
+            if (target != nullptr && landing == *target) { return; }
+            if (depth_[node] >= rules.max_inputs) { continue; }
+            for (int a = 0; a < INPUT_COUNT; ++a) {
+                Position q;
+                if (!applyInput(inputs[a], p, rules.gravity, &q)) { continue; }
+                const int next = nodeOf(q);
+                if (seen_[next] == stamp_) { continue; }
+                seen_[next] = stamp_;
+                parent_[next] = static_cast<std::uint16_t>(node);
+                via_[next] = inputs[a];
+                depth_[next] = static_cast<std::uint16_t>(depth_[node] + 1);
+                queue_[tail++] = static_cast<std::uint16_t>(next);
+            }
+        }
+    }
+
+    int landingCount() const { return landing_count_; }
+    const Landing* landings() const { return landings_; }
+
+    // Same reachable set as generate(), without paths: a breadth-first search
+    // over whole rows of positions at once (bit x of a row mask = column x).
+    // Afterwards landingMap()[o][y] has bit x set for every landing (x, y, o).
+    void generateLandingMap(const Board& board, PieceType type, Position start, const MoveRules& rules) {
+        type_ = type;
+        buildFitMap(board, type);
+        std::fill(&reached_[0][0], &reached_[0][0] + 4 * BOARD_HEIGHT, std::uint16_t{0});
+        std::fill(&land_[0][0], &land_[0][0] + 4 * BOARD_HEIGHT, std::uint16_t{0});
+        if (!fits(start)) { return; }
+
+        std::uint16_t frontier[4][BOARD_HEIGHT] = {};
+        std::uint16_t next[4][BOARD_HEIGHT];
+        frontier[start.orientation][start.y] = reached_[start.orientation][start.y] = static_cast<std::uint16_t>(1u << start.x);
+        for (int depth = 0; depth < rules.max_inputs; ++depth) {
+            std::fill(&next[0][0], &next[0][0] + 4 * BOARD_HEIGHT, std::uint16_t{0});
+            bool any = false;
+            auto push = [&](int o, int y, std::uint32_t bits, bool gravity) {
+                if (gravity) {
+                    const std::uint32_t down = bits & fitRow(o, y + 1);
+                    bits &= ~down;
+                    if (down != 0) { reach(o, y + 1, down, next, &any); }
+                }
+                if (bits != 0) { reach(o, y, bits, next, &any); }
+            };
+            for (int o = 0; o < 4; ++o) {
+                for (int y = 0; y < BOARD_HEIGHT; ++y) {
+                    const std::uint32_t f = frontier[o][y];
+                    if (f == 0) { continue; }
+                    const std::uint32_t fit = fit_[o][y];
+                    const std::uint32_t below = fitRow(o, y + 1);
+                    push(o, y, (f >> 1) & fit, rules.gravity);                       // MOVE_LEFT
+                    push(o, y, (f << 1) & fit, rules.gravity);                       // MOVE_RIGHT
+                    if (f & below) { push(o, y + 1, f & below, rules.gravity); }     // SOFT_DROP
+                    for (int r = 0; r < 3; ++r) {                                     // ROTATE_*
+                        rotateRow(o, y, f, static_cast<Rotation>(r), rules.gravity, push);
+                    }
+                    std::uint32_t run = f & (fit << 1);                               // MOVE_LEFT_TO_WALL
+                    for (std::uint32_t grown = 0; grown != run;) { grown = run; run |= (run >> 1) & fit; }
+                    push(o, y, run & ~(fit << 1), rules.gravity);
+                    run = f & (fit >> 1);                                             // MOVE_RIGHT_TO_WALL
+                    for (std::uint32_t grown = 0; grown != run;) { grown = run; run |= (run << 1) & fit; }
+                    push(o, y, run & ~(fit >> 1) & 0xffffu, rules.gravity);
+                    std::uint32_t fall = f & below;                                   // SOFT_DROP_TO_FLOOR
+                    for (int yy = y + 1; fall != 0; ++yy) {
+                        const std::uint32_t rest = fall & ~fitRow(o, yy + 1);
+                        if (rest != 0) { push(o, yy, rest, false); }
+                        fall &= ~rest;
+                    }
+                    if (rules.gravity && (f & below)) { push(o, y + 1, f & below, false); }  // NOOP
+                }
+            }
+            if (!any) { break; }
+            std::copy(&next[0][0], &next[0][0] + 4 * BOARD_HEIGHT, &frontier[0][0]);
+        }
+        for (int o = 0; o < 4; ++o) {
+            std::uint32_t carry = 0;
+            for (int y = 0; y < BOARD_HEIGHT; ++y) {
+                carry |= reached_[o][y];
+                const std::uint32_t below = fitRow(o, y + 1);
+                land_[o][y] = static_cast<std::uint16_t>(carry & ~below);
+                carry &= below;
+            }
+        }
+    }
+
+    const std::uint16_t (&landingMap() const)[4][BOARD_HEIGHT] { return land_; }
+
+    // Writes the inputs reaching `landing` followed by HARD_DROP; returns their
+    // number, or -1 if they do not fit in `capacity`.
+    int pathTo(const Landing& landing, Action* path, int capacity) const {
+        const int length = depth_[landing.node] + 1;
+        if (length > capacity) { return -1; }
+        path[length - 1] = Action::HARD_DROP;
+        for (int node = landing.node, i = length - 2; i >= 0; node = parent_[node], --i) { path[i] = via_[node]; }
+        return length;
+    }
+
+private:
+    static constexpr Action inputs[] = {
+        Action::MOVE_LEFT, Action::MOVE_RIGHT, Action::SOFT_DROP,
+        Action::ROTATE_CW, Action::ROTATE_CCW, Action::ROTATE_180,
+        Action::MOVE_LEFT_TO_WALL, Action::MOVE_RIGHT_TO_WALL, Action::SOFT_DROP_TO_FLOOR,
+        Action::NOOP,  // only moves the piece under gravity
+    };
+    static constexpr int INPUT_COUNT = sizeof(inputs) / sizeof(inputs[0]);
+
+    static int nodeOf(Position p) { return (p.orientation * BOARD_HEIGHT + p.y) * BOARD_WIDTH + p.x; }
+    static Position positionOf(int node) {
+        return {static_cast<std::int8_t>(node % BOARD_WIDTH), static_cast<std::int8_t>(node / BOARD_WIDTH % BOARD_HEIGHT),
+                static_cast<std::uint8_t>(node / (BOARD_WIDTH * BOARD_HEIGHT))};
+    }
+
+    // fit_[o][y] has bit x set iff the piece fits at (x, y) in orientation o;
+    // built once per search from per-row occupancy masks.
+    void buildFitMap(const Board& board, PieceType type) {
+        std::uint32_t occupied[BOARD_HEIGHT];
+        occupancyRows(board, occupied);
+        for (int o = 0; o < 4; ++o) {
+            const Piece& piece = ops::getPiece(type, static_cast<std::uint8_t>(o));
+            for (int y = 0; y < BOARD_HEIGHT; ++y) {
+                if (y + Piece::SIZE > BOARD_HEIGHT) { fit_[o][y] = 0; continue; }
+                std::uint32_t blocked = 0;
+                for (int i = 0; i < Piece::SIZE; ++i) {
+                    for (int c = 0; c < 4; ++c) {
+                        if (piece.data[i] & ops::shift(static_cast<Row>(Cell::BLOCK), c)) { blocked |= occupied[y + i] >> c; }
+                    }
+                }
+                fit_[o][y] = static_cast<std::uint16_t>(~blocked);
+            }
+        }
+    }
+
+    std::uint32_t fitRow(int o, int y) const { return y >= 0 && y < BOARD_HEIGHT ? fit_[o][y] : 0u; }
+
+    void reach(int o, int y, std::uint32_t bits, std::uint16_t (&next)[4][BOARD_HEIGHT], bool* any) {
+        bits &= ~static_cast<std::uint32_t>(reached_[o][y]);
+        if (bits == 0) { return; }
+        reached_[o][y] = static_cast<std::uint16_t>(reached_[o][y] | bits);
+        next[o][y] = static_cast<std::uint16_t>(next[o][y] | bits);
+        *any = true;
+    }
+
+    // Row-parallel rotate(): each position takes the first kick that fits.
+    template <typename Push>
+    void rotateRow(int o, int y, std::uint32_t f, Rotation rot, bool gravity, Push& push) const {
+        constexpr int orientation_delta[] = {1, 3, 2};  // CW, CCW, 180
+        const auto r = static_cast<std::underlying_type_t<Rotation>>(rot);
+        const int to = (o + orientation_delta[r]) % 4;
+        auto& [kicks, len] = srs_table[static_cast<std::underlying_type_t<PieceType>>(type_)][o][r];
+        for (int i = 0; i < len && f != 0; ++i) {
+            const int ty = y - kicks[i].y;
+            const int dx = kicks[i].x;
+            const std::uint32_t moved = dx >= 0 ? f << dx : f >> -dx;
+            const std::uint32_t ok = moved & fitRow(to, ty);
+            if (ok == 0) { continue; }
+            f &= ~(dx >= 0 ? ok >> dx : ok << -dx);
+            push(to, ty, ok, gravity);
+        }
+    }
+
+    bool fits(Position p) const {
+        return p.x >= 0 && p.x < BOARD_WIDTH && p.y >= 0 && p.y < BOARD_HEIGHT && (fit_[p.orientation][p.y] >> p.x & 1);
+    }
+
+    Position drop(Position p) const {
+        while (fits({p.x, static_cast<std::int8_t>(p.y + 1), p.orientation})) { ++p.y; }
+        return p;
+    }
+
+    bool slide(Position p, int dx, int dy, Position* out) const {
+        Position q = p;
+        for (Position r = q;; q = r) {
+            r.x = static_cast<std::int8_t>(r.x + dx);
+            r.y = static_cast<std::int8_t>(r.y + dy);
+            if (!fits(r)) { break; }
+        }
+        *out = q;
+        return !(q == p);
+    }
+
+    bool rotate(Position p, Rotation rot, Position* out) const {
+        constexpr std::uint8_t orientation_delta[] = {1, 3, 2};  // CW, CCW, 180
+        const auto r = static_cast<std::underlying_type_t<Rotation>>(rot);
+        const auto orientation = static_cast<std::uint8_t>((p.orientation + orientation_delta[r]) % 4);
+        auto& [kicks, len] = srs_table[static_cast<std::underlying_type_t<PieceType>>(type_)][p.orientation][r];
+        for (int i = 0; i < len; ++i) {
+            const Position q{static_cast<std::int8_t>(p.x + kicks[i].x), static_cast<std::int8_t>(p.y - kicks[i].y), orientation};
+            if (fits(q)) { *out = q; return true; }
+        }
+        return false;
+    }
+
+    // Position after one step with `input` (gravity included); false if the
+    // step leaves the piece where it was.
+    bool applyInput(Action input, Position p, bool gravity, Position* out) const {
+        Position q = p;
+        bool moved = false;
+        switch (input) {
+        case Action::MOVE_LEFT:          q.x = static_cast<std::int8_t>(p.x - 1); moved = fits(q); break;
+        case Action::MOVE_RIGHT:         q.x = static_cast<std::int8_t>(p.x + 1); moved = fits(q); break;
+        case Action::SOFT_DROP:          q.y = static_cast<std::int8_t>(p.y + 1); moved = fits(q); break;
+        case Action::MOVE_LEFT_TO_WALL:  moved = slide(p, -1, 0, &q); break;
+        case Action::MOVE_RIGHT_TO_WALL: moved = slide(p, 1, 0, &q); break;
+        case Action::SOFT_DROP_TO_FLOOR: moved = slide(p, 0, 1, &q); break;
+        case Action::ROTATE_CW:          moved = rotate(p, Rotation::CW, &q); break;
+        case Action::ROTATE_CCW:         moved = rotate(p, Rotation::CCW, &q); break;
+        case Action::ROTATE_180:         moved = rotate(p, Rotation::HALF, &q); break;
+        default:                         break;  // NOOP
+        }
+        if (!moved) {
+            if (input != Action::NOOP) { return false; }  // a failed input acts like NOOP
+            q = p;
+        }
+        if (gravity) {
+            Position down = q;
+            down.y = static_cast<std::int8_t>(q.y + 1);
+            if (fits(down)) { q = down; }
+        }
+        *out = q;
+        return !(q == p);
+    }
+
+    void addLanding(int node, Position landing) {
+        const int key = nodeOf(landing);
+        if (landed_[key] == stamp_) { return; }
+        landed_[key] = stamp_;
+        landings_[landing_count_++] = {landing, static_cast<std::uint16_t>(node)};
+    }
+
+    PieceType     type_ = PieceType::NONE;
+    std::uint16_t fit_[4][BOARD_HEIGHT];
+    std::uint16_t reached_[4][BOARD_HEIGHT];
+    std::uint16_t land_[4][BOARD_HEIGHT];
+    std::uint32_t stamp_ = 0;
+    std::uint32_t seen_[NODES] = {};
+    std::uint32_t landed_[NODES] = {};
+    std::uint16_t parent_[NODES];
+    std::uint16_t depth_[NODES];
+    Action        via_[NODES];
+    std::uint16_t queue_[NODES];
+    Landing       landings_[NODES];
+    int           landing_count_ = 0;
+};
+
+constexpr int PLACEMENT_PATH_CAPACITY = 64;
+
+// A landing together with the step-env actions that reach it.
+struct PlacementPath {
+    Position     position;
+    std::uint8_t path_length;
+    Action       path[PLACEMENT_PATH_CAPACITY];
+};
+
+// The piece, start position and rules of the placements of the current piece
+// of `ctx` (or, with `hold`, of the piece HOLD brings in); false if there is
+// nothing to place.
+inline bool placementQuery(const Context* ctx, bool hold, PieceType* piece, Position* start, MoveRules* rules) {
+    const State& s = ctx->state;
+    if (!s.is_alive || s.current == PieceType::NONE || (hold && (s.has_held || (s.hold == PieceType::NONE && s.next_count == 0)))) {
+        return false;
+    }
+    *piece = s.current;
+    *start = {s.x, s.y, s.orientation};
+    *rules = currentMoveRules(ctx);
+    if (hold) {
+        *piece = s.hold != PieceType::NONE ? s.hold : peekNext(&s, 0);
+        *rules = spawnMoveRules(ctx);
+        *start = spawnPosition(s.board, *piece, rules->gravity);
+    }
+    return true;
+}
+
+// Writes the landings of the last search of `movegen` with their paths
+// (prefixed by HOLD with `hold`); returns how many were written.
+inline int writePlacements(const MoveGenerator& movegen, bool hold, PlacementPath* out, int capacity) {
+    const int offset = hold ? 1 : 0;
+    int count = 0;
+    for (int i = 0; i < movegen.landingCount() && count < capacity; ++i) {
+        PlacementPath& p = out[count];
+        const int length = movegen.pathTo(movegen.landings()[i], p.path + offset, PLACEMENT_PATH_CAPACITY - offset);
+        if (length < 0) { continue; }
+        if (hold) { p.path[0] = Action::HOLD; }
+        p.position = movegen.landings()[i].position;
+        p.path_length = static_cast<std::uint8_t>(length + offset);
+        ++count;
+    }
+    return count;
+}
+
+// Landings of the current piece of `ctx` (or, with `hold`, of the piece HOLD
+// brings in; its paths start with HOLD). Returns how many were written.
+inline int generatePlacements(const Context* ctx, bool hold, MoveGenerator* movegen, PlacementPath* out, int capacity) {
+    PieceType piece;
+    Position start;
+    MoveRules rules;
+    if (!placementQuery(ctx, hold, &piece, &start, &rules)) { return 0; }
+    movegen->generate(ctx->state.board, piece, start, rules);
+    return writePlacements(*movegen, hold, out, capacity);
+}
+
+} // namespace tetrl::search
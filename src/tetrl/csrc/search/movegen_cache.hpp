@@ -0,0 +1,266 @@
+#pragma once
+#include "search/movegen.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tetrl::search {
+
+// Move-generation cache keyed by the part of the board a piece can reach.
+//
+// The surface of a board is the set of empty cells connected to the piece's
+// start cells, where a cell counts as connected to its eight neighbours. Every
+// input (including each SRS kick of tetris.cpp) leaves at least one cell of
+// the piece next to one of its old cells, and a piece's cells are themselves
+// connected, so every position the MoveGenerator can reach lies inside the
+// surface, and every position it tests fits on the board iff it fits on the
+// surface alone. Boards with the same surface, piece, start and move rules
+// therefore have the same placements, whatever lies deeper in the stack.
+
+struct SurfaceKey {
+    std::uint16_t surface[BOARD_HEIGHT];  // bit x of row y: empty cell (x, y) inside the surface
+    std::uint16_t max_inputs;
+    Position      start;
+    std::int8_t   piece;
+    std::uint8_t  gravity;
+    std::uint8_t  reserved;
+};
+static_assert(sizeof(SurfaceKey) == 2 * BOARD_HEIGHT + 8, "SurfaceKey must not contain padding");
+
+inline bool operator==(const SurfaceKey& a, const SurfaceKey& b) { return std::memcmp(&a, &b, sizeof(SurfaceKey)) == 0; }
+
+// Key of the placements of `type` from `start` on `board`; `start` must fit.
+inline SurfaceKey surfaceKey(const Board& board, PieceType type, Position start, const MoveRules& rules) {
+    SurfaceKey key{};
+    key.max_inputs = static_cast<std::uint16_t>(std::min(rules.max_inputs, 0xffff));
+    key.start = start;
+    key.piece = static_cast<std::int8_t>(type);
+    key.gravity = rules.gravity ? 1 : 0;
+
+    std::uint32_t occupied[BOARD_HEIGHT];
+    occupancyRows(board, occupied);
+    const Piece& piece = ops::getPiece(type, start.orientation);
+    for (int i = 0; i < Piece::SIZE && start.y + i < BOARD_HEIGHT; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            if (piece.data[i] & ops::shift(static_cast<Row>(Cell::BLOCK), c)) {
+                key.surface[start.y + i] = static_cast<std::uint16_t>(key.surface[start.y + i] | 1u << (start.x + c));
+            }
+        }
+    }
+    // Flood the empty cells, sweeping down and up until nothing grows.
+    auto grow = [&](int y) {
+        std::uint32_t near = key.surface[y];
+        if (y > 0) { near |= key.surface[y - 1]; }
+        if (y + 1 < BOARD_HEIGHT) { near |= key.surface[y + 1]; }
+        near |= near << 1 | near >> 1;
+        const auto rows = static_cast<std::uint16_t>(key.surface[y] | (near & ~occupied[y]));
+        const bool grown = rows != key.surface[y];
+        key.surface[y] = rows;
+        return grown;
+    };
+    for (bool grown = true; grown;) {
+        grown = false;
+        for (int y = 0; y < BOARD_HEIGHT; ++y) { grown |= grow(y); }
+        for (int y = BOARD_HEIGHT - 1; y >= 0; --y) { grown |= grow(y); }
+    }
+    return key;
+}
+
+inline std::uint64_t surfaceHash(const SurfaceKey& key) {
+    auto mix = [](std::uint64_t h, std::uint64_t v) {
+        h = (h ^ v) * 0xff51afd7ed558ccdull;
+        return h ^ h >> 29;
+    };
+    std::uint64_t h = mix(0x9e3779b97f4a7c15ull, static_cast<std::uint64_t>(key.max_inputs) << 32 | static_cast<std::uint64_t>(key.gravity) << 24 |
+                                                     static_cast<std::uint64_t>(static_cast<std::uint8_t>(key.piece)) << 16 |
+                                                     static_cast<std::uint64_t>(key.start.orientation) << 12 |
+                                                     static_cast<std::uint64_t>(static_cast<std::uint8_t>(key.start.y)) << 4 |
+                                                     static_cast<std::uint64_t>(static_cast<std::uint8_t>(key.start.x)));
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        if (key.surface[y] != 0) { h = mix(h, static_cast<std::uint64_t>(key.surface[y]) << 8 | static_cast<std::uint64_t>(y)); }
+    }
+    return h;
+}
+
+struct MoveGenCacheStats {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t evictions;
+    std::uint64_t entries;
+};
+
+// Thread-safe LRU cache from SurfaceKey to the landings and shortest paths of
+// a MoveGenerator search. Entries are spread over independently locked shards
+// by key hash; each shard evicts its least recently used entry when full.
+class MoveGenCache {
+public:
+    MoveGenCache(int capacity, int shards) {
+        int count = 1;
+        while (count < shards) { count <<= 1; }
+        shards_.reserve(static_cast<std::size_t>(count));
+        for (int i = 0; i < count; ++i) { shards_.push_back(std::make_unique<Shard>()); }
+        shard_capacity_ = std::max<std::size_t>(1, (static_cast<std::size_t>(std::max(capacity, 1)) + count - 1) / count);
+    }
+
+    // Copies the placements of `key` into `out` (see generateCachedPlacements);
+    // returns their number, or -1 if `key` is not cached.
+    int lookup(const SurfaceKey& key, std::uint64_t hash, bool hold, PlacementPath* out, int capacity) {
+        Shard& shard = shardOf(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(hash);
+        if (it == shard.index.end() || !(it->second->key == key)) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return unpack(it->second->data, hold, out, capacity);
+    }
+
+    // Stores the landings of the last search of `movegen` under `key`.
+    void insert(const SurfaceKey& key, std::uint64_t hash, const MoveGenerator& movegen) {
+        std::vector<std::uint8_t> data;
+        data.reserve(static_cast<std::size_t>(movegen.landingCount()) * 12);
+        Action path[PLACEMENT_PATH_CAPACITY];
+        for (int i = 0; i < movegen.landingCount(); ++i) {
+            const Landing& landing = movegen.landings()[i];
+            const int length = movegen.pathTo(landing, path, PLACEMENT_PATH_CAPACITY);
+            if (length < 0) { continue; }
+            data.push_back(static_cast<std::uint8_t>(landing.position.x));
+            data.push_back(static_cast<std::uint8_t>(landing.position.y));
+            data.push_back(landing.position.orientation);
+            data.push_back(static_cast<std::uint8_t>(length));
+            for (int k = 0; k < length; ++k) { data.push_back(static_cast<std::uint8_t>(path[k])); }
+        }
+        Shard& shard = shardOf(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(hash);
+        if (it != shard.index.end()) {  // same key raced in, or a hash collision: keep the newer one
+            it->second->key = key;
+            it->second->data = std::move(data);
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            return;
+        }
+        if (shard.entries.size() >= shard_capacity_) {
+            shard.index.erase(shard.entries.back().hash);
+            shard.entries.pop_back();
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.entries.push_front({key, hash, std::move(data)});
+        shard.index.emplace(hash, shard.entries.begin());
+    }
+
+    MoveGenCacheStats stats() const {
+        std::uint64_t entries = 0;
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            entries += shard->entries.size();
+        }
+        return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+                evictions_.load(std::memory_order_relaxed), entries};
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->index.clear();
+            shard->entries.clear();
+        }
+        hits_ = 0;
+        misses_ = 0;
+        evictions_ = 0;
+    }
+
+private:
+    // Placements packed as x, y, orientation, path length, path.
+    struct Entry {
+        SurfaceKey                key;
+        std::uint64_t             hash;
+        std::vector<std::uint8_t> data;
+    };
+
+    struct Shard {
+        mutable std::mutex                                                   mutex;
+        std::list<Entry>                                                     entries;  // most recently used first
+        std::unordered_map<std::uint64_t, std::list<Entry>::iterator>        index;
+    };
+
+    Shard& shardOf(std::uint64_t hash) { return *shards_[hash >> 32 & (shards_.size() - 1)]; }
+
+    static int unpack(const std::vector<std::uint8_t>& data, bool hold, PlacementPath* out, int capacity) {
+        const int offset = hold ? 1 : 0;
+        int count = 0;
+        for (std::size_t i = 0; i < data.size() && count < capacity;) {
+            const int length = data[i + 3];
+            if (length + offset <= PLACEMENT_PATH_CAPACITY) {
+                PlacementPath& p = out[count++];
+                p.position = {static_cast<std::int8_t>(data[i]), static_cast<std::int8_t>(data[i + 1]), data[i + 2]};
+                p.path_length = static_cast<std::uint8_t>(length + offset);
+                if (hold) { p.path[0] = Action::HOLD; }
+                for (int k = 0; k < length; ++k) { p.path[offset + k] = static_cast<Action>(data[i + 4 + k]); }
+            }
+            i += 4 + static_cast<std::size_t>(length);
+        }
+        return count;
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::size_t                         shard_capacity_;
+    std::atomic<std::uint64_t>          hits_{0};
+    std::atomic<std::uint64_t>          misses_{0};
+    std::atomic<std::uint64_t>          evictions_{0};
+};
+
+// generatePlacements() through `cache` (if not null): boards whose surface was
+// seen before are answered without a search.
+inline int generateCachedPlacements(const Context* ctx, bool hold, MoveGenerator* movegen, MoveGenCache* cache,
+                                    PlacementPath* out, int capacity) {
+    if (cache == nullptr) { return generatePlacements(ctx, hold, movegen, out, capacity); }
+    PieceType piece;
+    Position start;
+    MoveRules rules;
+    if (!placementQuery(ctx, hold, &piece, &start, &rules)) { return 0; }
+    const Board& board = ctx->state.board;
+    if (!canPlace(board, piece, start)) { return 0; }
+    const SurfaceKey key = surfaceKey(board, piece, start, rules);
+    const std::uint64_t hash = surfaceHash(key);
+    const int count = cache->lookup(key, hash, hold, out, capacity);
+    if (count >= 0) { return count; }
+    movegen->generate(board, piece, start, rules);
+    cache->insert(key, hash, *movegen);
+    return writePlacements(*movegen, hold, out, capacity);
+}
+
+// generateCachedPlacements() for `count` contexts, split round-robin over
+// `threads` threads that share `cache`. The placements of context i go to
+// out + i * capacity and their number to counts[i]; `movegen` serves the
+// calling thread.
+inline void generateCachedPlacementsMany(const Context* ctxs, int count, bool hold, MoveGenerator* movegen, MoveGenCache* cache,
+                                         PlacementPath* out, int capacity, std::int32_t* counts, int threads) {
+    threads = std::clamp(threads, 1, std::max(count, 1));
+    auto run = [&](MoveGenerator* mg, int t) {
+        for (int i = t; i < count; i += threads) {
+            counts[i] = generateCachedPlacements(&ctxs[i], hold, mg, cache, out + static_cast<std::ptrdiff_t>(i) * capacity, capacity);
+        }
+    };
+    if (threads == 1) {
+        run(movegen, 0);
+        return;
+    }
+    std::vector<std::unique_ptr<MoveGenerator>> movegens;
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) {
+        movegens.push_back(std::make_unique<MoveGenerator>());
+        pool.emplace_back(run, movegens.back().get(), t);
+    }
+    run(movegen, 0);
+    for (auto& thread : pool) { thread.join(); }
+}
+
+} // namespace tetrl::search
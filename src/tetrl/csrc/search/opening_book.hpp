@@ -0,0 +1,285 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/step.hpp"
+#include "search/heuristic.hpp"
+#include "search/movegen.hpp"
+#include "search/pc.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace tetrl::search {
+
+// Opening book: the placement to play for the first pieces of a game, keyed
+// by what a bot sees at that point (the board, the current and hold pieces
+// and a prefix of the next queue), precomputed so that openings cost a table
+// lookup instead of a search.
+//
+// File (built and mapped by tetrl/search/book.py):
+//
+//   OpeningBookHeader
+//   capacity OpeningBookEntry slots at OPENING_BOOK_ALIGN, an open-addressing
+//   table probed linearly from key & (capacity - 1); key 0 marks a free slot
+//
+// The builder plays every one of the 5040 orders of the first 7-bag, one job
+// per order over the worker threads. Whenever the next decision would see a
+// piece of the second bag that is not dealt yet, the game branches over the
+// pieces that bag can still deal, so every queue prefix reachable within
+// `pieces` placements is covered. Decisions only read what the key holds: a
+// perfect clear found within the queue prefix (optional), otherwise the
+// greedy heuristic placement (HOLD brings in a piece of the prefix), so a
+// state reached by several games always gets the same entry.
+
+constexpr char          OPENING_BOOK_MAGIC[8] = {'T', 'E', 'T', 'R', 'L', 'B', 'O', 'K'};
+constexpr std::uint32_t OPENING_BOOK_VERSION  = 1;
+constexpr std::uint64_t OPENING_BOOK_ALIGN    = 64;
+constexpr int           OPENING_BOOK_PERMUTATIONS = 5040;  // orders of one 7-bag
+
+struct OpeningBookHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t file_size;
+    std::uint64_t capacity;     // table slots, a power of two
+    std::uint64_t entries;      // occupied slots
+    std::int32_t  queue_depth;  // next pieces in the key
+    std::int32_t  pieces;       // placements per game the builder played
+};
+
+enum OpeningBookSource : std::uint8_t {
+    BOOK_HEURISTIC,
+    BOOK_PERFECT_CLEAR,  // first placement of a perfect clear within the key's pieces
+};
+
+struct OpeningBookEntry {
+    std::uint64_t key;
+    std::uint8_t  hold;    // HOLD is pressed before the placement
+    Position      position;
+    std::uint8_t  source;  // OpeningBookSource
+    std::uint8_t  ply;     // placements made before this one
+    std::uint8_t  reserved[2];
+};
+
+struct OpeningBookOptions {
+    std::int32_t        pieces              = 4;  // placements per game
+    std::int32_t        queue_depth         = 5;  // next pieces in the key (>= 1)
+    std::int32_t        perfect_clear_lines = 0;  // try perfect clears of up to this many rows first (0 = off)
+    std::uint8_t        use_hold            = 1;
+    std::uint8_t        threads             = 1;
+    std::uint64_t       perfect_clear_nodes = 100000;  // node budget of each perfect-clear search
+    std::uint64_t       seed                = 0;  // pieces after the second bag (never read by a decision)
+    double              weights[HEURISTIC_FEATURES] = {};
+    envs::step::Config  config{};
+};
+
+// Book key of the state of `s`: board, current, hold and has-held, and the
+// first `queue_depth` next pieces. Never 0.
+inline std::uint64_t openingBookKey(const State& s, int queue_depth) {
+    auto mix = [](std::uint64_t h, std::uint64_t v) {
+        h = (h ^ v) * 0xff51afd7ed558ccdull;
+        return h ^ h >> 29;
+    };
+    std::uint64_t h = mix(0x9e3779b97f4a7c15ull, static_cast<std::uint64_t>(static_cast<std::uint8_t>(s.current)) |
+                                                     static_cast<std::uint64_t>(static_cast<std::uint8_t>(s.hold)) << 8 |
+                                                     static_cast<std::uint64_t>(s.has_held) << 16 |
+                                                     static_cast<std::uint64_t>(queue_depth) << 24);
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        if (s.board.data[y] != ROW_EMPTY) { h = mix(h, static_cast<std::uint64_t>(s.board.data[y]) << 8 | static_cast<std::uint64_t>(y)); }
+    }
+    for (int i = 0; i < queue_depth && i < s.next_count; ++i) {
+        h = mix(h, static_cast<std::uint64_t>(static_cast<std::uint8_t>(peekNext(&s, i))) << 8 | static_cast<std::uint64_t>(i));
+    }
+    return h != 0 ? h : 1;
+}
+
+// The entry of `key` in a table of `capacity` slots, or null.
+inline const OpeningBookEntry* openingBookFind(const OpeningBookEntry* table, std::uint64_t capacity, std::uint64_t key) {
+    if (capacity == 0) { return nullptr; }
+    const std::uint64_t mask = capacity - 1;
+    for (std::uint64_t i = key & mask, probes = 0; probes < capacity; i = (i + 1) & mask, ++probes) {
+        if (table[i].key == key) { return &table[i]; }
+        if (table[i].key == 0) { return nullptr; }
+    }
+    return nullptr;
+}
+
+// The book placement for ctx with the path that reaches it from the current
+// piece position (prefixed by HOLD when the entry holds); false if the book
+// has no entry or the landing is not reachable under the env's rules.
+inline bool openingBookPlacement(const Context* ctx, const OpeningBookEntry* table, std::uint64_t capacity, int queue_depth,
+                                 MoveGenerator* movegen, PlacementPath* out, std::uint8_t* source) {
+    const OpeningBookEntry* entry = openingBookFind(table, capacity, openingBookKey(ctx->state, queue_depth));
+    PieceType type;
+    Position start;
+    MoveRules rules;
+    if (entry == nullptr || !placementQuery(ctx, entry->hold != 0, &type, &start, &rules)) { return false; }
+    if (!canPlace(ctx->state.board, type, start)) { return false; }
+    movegen->generate(ctx->state.board, type, start, rules, &entry->position);
+    if (movegen->landingCount() == 0 || !(movegen->landings()[movegen->landingCount() - 1].position == entry->position)) { return false; }
+    const int offset = entry->hold ? 1 : 0;
+    const int length = movegen->pathTo(movegen->landings()[movegen->landingCount() - 1], out->path + offset, PLACEMENT_PATH_CAPACITY - offset);
+    if (length < 0) { return false; }
+    if (entry->hold) { out->path[0] = Action::HOLD; }
+    out->position = entry->position;
+    out->path_length = static_cast<std::uint8_t>(length + offset);
+    if (source != nullptr) { *source = entry->source; }
+    return true;
+}
+
+namespace opening_book_detail {
+
+constexpr int BAG = 7;
+
+// Permutation `index` of the 7-bag in lexicographic order of {Z, L, O, S, I, J, T}.
+inline void bagPermutation(int index, PieceType* out) {
+    int pool[BAG] = {0, 1, 2, 3, 4, 5, 6};
+    int radix = 720;  // 6!
+    for (int i = 0; i < BAG; ++i) {
+        const int k = index / radix;
+        index %= radix;
+        out[i] = static_cast<PieceType>(pool[k]);
+        for (int j = k; j < BAG - 1 - i; ++j) { pool[j] = pool[j + 1]; }
+        if (i < BAG - 1) { radix /= BAG - 1 - i; }
+    }
+}
+
+class Builder {
+public:
+    explicit Builder(const OpeningBookOptions& options) : options_(options) {
+        if (options_.perfect_clear_lines > 0) { solver_ = std::make_unique<PerfectClearSolver>(1, 16); }
+    }
+
+    // Plays the games whose first bag comes in order `permutation`.
+    void run(int permutation) {
+        using namespace envs::step;
+        Context ctx{};
+        setConfig(&ctx, options_.config);
+        std::uint32_t piece_seed, garbage_seed;
+        episodeSeeds(options_.seed, 0, static_cast<std::uint32_t>(permutation), &piece_seed, &garbage_seed);
+        setSeed(&ctx, piece_seed, garbage_seed);
+        reset(&ctx);
+        // every piece spawns at the same position, so the first bag is dealt
+        // by overwriting the current piece and the front of the queue
+        PieceType bag[BAG];
+        bagPermutation(permutation, bag);
+        State& s = ctx.state;
+        s.current = bag[0];
+        for (int i = 1; i < BAG; ++i) { s.next[(s.next_head + i - 1) & (NEXT_QUEUE_SIZE - 1)] = bag[i]; }
+        head_ = s.next_head;
+        explore(ctx, 0, 0, 0);
+    }
+
+    std::vector<OpeningBookEntry>& entries() { return entries_; }
+
+private:
+    // Pieces taken from the queue since the first bag was dealt: the current
+    // piece is piece fetched(s) of the stream and next[i] is piece fetched(s) + 1 + i.
+    int fetched(const State& s) const { return (s.next_head - head_) & (NEXT_QUEUE_SIZE - 1); }
+
+    void explore(const envs::step::Context& ctx, int ply, int dealt, std::uint32_t used) {
+        const State& s = ctx.state;
+        // stream index of the deepest piece the key (and so the decision) reads
+        const int deepest = fetched(s) + options_.queue_depth;
+        if (deepest >= 2 * BAG) { return; }  // would need the third bag
+        if (deepest >= BAG + dealt) {
+            for (int t = 0; t < BAG; ++t) {
+                if (used >> t & 1u) { continue; }
+                envs::step::Context next = ctx;
+                next.state.next[(head_ + BAG + dealt - 1) & (NEXT_QUEUE_SIZE - 1)] = static_cast<PieceType>(t);
+                explore(next, ply, dealt + 1, used | 1u << t);
+            }
+            return;
+        }
+        heuristic_detail::Choice choice;
+        std::uint8_t source;
+        if (!decide(ctx, &choice, &source)) { return; }
+        entries_.push_back({openingBookKey(s, options_.queue_depth), static_cast<std::uint8_t>(choice.hold), choice.position, source,
+                            static_cast<std::uint8_t>(ply), {}});
+        if (ply + 1 >= options_.pieces) { return; }
+        envs::step::Context next = ctx;
+        if (!heuristic_detail::playChoice(&next, choice, &movegen_) || !next.state.is_alive) { return; }
+        explore(next, ply + 1, dealt, used);
+    }
+
+    bool decide(const envs::step::Context& ctx, heuristic_detail::Choice* choice, std::uint8_t* source) {
+        if (solver_ != nullptr) {
+            PcOptions pc;
+            pc.max_lines = options_.perfect_clear_lines;
+            pc.next_pieces = options_.queue_depth;
+            pc.use_hold = options_.use_hold;
+            pc.max_nodes = options_.perfect_clear_nodes;
+            solver_->solve(&ctx, pc, &solution_);
+            if (solution_.found) {
+                *choice = {solution_.placements[0].hold != 0, solution_.placements[0].position};
+                *source = BOOK_PERFECT_CLEAR;
+                return true;
+            }
+        }
+        *source = BOOK_HEURISTIC;
+        return heuristic_detail::choosePlacement(ctx, options_.weights, options_.use_hold != 0, &movegen_, choice);
+    }
+
+    OpeningBookOptions                  options_;
+    MoveGenerator                       movegen_;
+    std::unique_ptr<PerfectClearSolver> solver_;
+    PcSolution                          solution_;
+    std::vector<OpeningBookEntry>       entries_;
+    int                                 head_ = 0;
+};
+
+} // namespace opening_book_detail
+
+// Builds the book entries for `options` over options.threads threads, sorted
+// by key with one entry per key. The result does not depend on the thread
+// count.
+inline std::vector<OpeningBookEntry> buildOpeningBook(OpeningBookOptions options) {
+    using opening_book_detail::Builder;
+    options.queue_depth = std::clamp(options.queue_depth, 1, NEXT_PREVIEW);
+    options.perfect_clear_lines = std::clamp(options.perfect_clear_lines, 0, PC_MAX_LINES);
+    const int threads = std::clamp<int>(options.threads, 1, OPENING_BOOK_PERMUTATIONS);
+    std::vector<std::unique_ptr<Builder>> builders;
+    for (int t = 0; t < threads; ++t) { builders.push_back(std::make_unique<Builder>(options)); }
+    std::atomic<int> next{0};
+    auto run = [&](Builder* builder) {
+        for (int job; (job = next.fetch_add(1, std::memory_order_relaxed)) < OPENING_BOOK_PERMUTATIONS;) { builder->run(job); }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) { pool.emplace_back(run, builders[t].get()); }
+    run(builders[0].get());
+    for (auto& thread : pool) { thread.join(); }
+
+    std::vector<OpeningBookEntry> entries;
+    for (auto& builder : builders) {
+        entries.insert(entries.end(), builder->entries().begin(), builder->entries().end());
+        builder->entries() = {};
+    }
+    // a key reached by several games was decided identically each time, so
+    // which copy survives only matters on a hash collision: keep the lowest
+    auto order = [](const OpeningBookEntry& a, const OpeningBookEntry& b) {
+        if (a.key != b.key) { return a.key < b.key; }
+        if (a.hold != b.hold) { return a.hold < b.hold; }
+        if (a.position.x != b.position.x) { return a.position.x < b.position.x; }
+        if (a.position.y != b.position.y) { return a.position.y < b.position.y; }
+        return a.position.orientation < b.position.orientation;
+    };
+    std::sort(entries.begin(), entries.end(), order);
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const OpeningBookEntry& a, const OpeningBookEntry& b) { return a.key == b.key; }),
+                  entries.end());
+    return entries;
+}
+
+// Inserts `entries` (distinct keys) into a zeroed table of `capacity` slots,
+// a power of two larger than the number of entries.
+inline void fillOpeningBook(const std::vector<OpeningBookEntry>& entries, OpeningBookEntry* table, std::uint64_t capacity) {
+    const std::uint64_t mask = capacity - 1;
+    for (const OpeningBookEntry& e : entries) {
+        std::uint64_t i = e.key & mask;
+        while (table[i].key != 0) { i = (i + 1) & mask; }
+        table[i] = e;
+    }
+}
+
+} // namespace tetrl::search
@@ -0,0 +1,705 @@
+#pragma once
+#include "search/movegen.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace tetrl::search {
+
+// Perfect-clear search over the bottom `lines` rows of the playfield.
+//
+// The field is a bitboard of up to PC_MAX_LINES rows of PC_FIELD_COLS bits
+// (bit 10 * r + c = column c of the r-th row from the bottom). A depth-first
+// search places the queue pieces (optionally swapping with hold) at every
+// landing the MoveGenerator reaches on the real board and clears full rows.
+// States already shown to fail are kept in a memo table of (field, rows,
+// queue index, hold); a state is also cut when the remaining piece set cannot
+// cover its empty cells at all (Tiler, memoized per (empty cells, piece set)
+// and kept across queries).
+//
+// Each row count is searched twice: first for solutions whose pieces are never
+// split by an earlier line clear, where checkerboard parity, region sizes and
+// the exact cover prune hard, then allowing one split piece. Solutions that
+// need two or more split pieces are not searched. Root placements are split
+// across threads; the solution with the lowest root index wins, so results do
+// not depend on the thread count.
+
+constexpr int PC_MAX_LINES   = 6;
+constexpr int PC_FIELD_COLS  = BOARD_RIGHT - BOARD_LEFT + 1;
+constexpr int PC_MAX_PIECES  = PC_MAX_LINES * PC_FIELD_COLS / 4;
+// Range of the log2 memo table sizes (16 bytes per entry and thread).
+constexpr int PC_MIN_MEMO_BITS = 4;
+constexpr int PC_MAX_MEMO_BITS = 30;
+constexpr int PC_MAX_ACTIONS = 1024;
+
+using Field = std::uint64_t;
+
+struct PcOptions {
+    std::int32_t  max_lines   = 4;   // largest number of rows to clear (<= PC_MAX_LINES)
+    std::int32_t  next_pieces = -1;  // queued pieces the search may use (-1 = all)
+    std::uint8_t  use_hold    = 1;   // allow swapping with the hold piece
+    std::uint8_t  threads     = 1;
+    std::uint32_t max_millis  = 0;   // give up after this wall time in milliseconds (0 = unlimited)
+    std::uint64_t max_nodes   = 0;   // give up after this many search nodes (0 = unlimited)
+};
+
+struct PcPlacement {
+    PieceType    piece;
+    std::uint8_t hold;  // HOLD is pressed before this placement
+    Position     position;
+};
+
+struct PcSolution {
+    std::int32_t  found;
+    std::int32_t  lines;         // rows cleared by the perfect clear
+    std::int32_t  piece_count;
+    std::int32_t  action_count;
+    std::uint64_t nodes;         // search nodes visited
+    PcPlacement   placements[PC_MAX_PIECES];
+    Action        actions[PC_MAX_ACTIONS];  // step-env actions of all placements, in order
+};
+
+namespace pc_detail {
+
+constexpr Field ROW_BITS  = (Field{1} << PC_FIELD_COLS) - 1;
+constexpr Field fieldMask(int lines) { return (Field{1} << (PC_FIELD_COLS * lines)) - 1; }
+
+constexpr Field makeColumnMask(int col) {
+    Field mask = 0;
+    for (int r = 0; r < PC_MAX_LINES; ++r) { mask |= Field{1} << (r * PC_FIELD_COLS + col); }
+    return mask;
+}
+constexpr Field FIRST_COLUMN = makeColumnMask(0);
+constexpr Field LAST_COLUMN  = makeColumnMask(PC_FIELD_COLS - 1);
+
+inline int popcount(Field f) { return __builtin_popcountll(f); }
+
+inline Field rowBits(Row row) {
+    Field bits = 0;
+    for (int c = 0; c < PC_FIELD_COLS; ++c) {
+        if (row & ops::shift(static_cast<Row>(Cell::BLOCK), BOARD_LEFT + c)) { bits |= Field{1} << c; }
+    }
+    return bits;
+}
+
+// Board with the field in its bottom rows and nothing above.
+inline void buildBoard(Field field, int lines, Board* board) {
+    for (int y = 0; y < BOARD_HEIGHT; ++y) { board->data[y] = y <= BOARD_BOTTOM ? ROW_EMPTY : ROW_FULL; }
+    for (int r = 0; r < lines; ++r) {
+        const Field bits = (field >> (r * PC_FIELD_COLS)) & ROW_BITS;
+        Row& row = board->data[BOARD_BOTTOM - r];
+        for (int c = 0; c < PC_FIELD_COLS; ++c) {
+            if (bits >> c & 1) { row |= ops::shift(static_cast<Row>(Cell::BLOCK), BOARD_LEFT + c); }
+        }
+    }
+}
+
+// Cells of a landed piece in field coordinates; false if any lies above `lines`.
+inline bool pieceMask(PieceType type, Position p, int lines, Field* mask) {
+    const Piece& piece = ops::getPiece(type, p.orientation);
+    Field m = 0;
+    for (int i = 0; i < 4; ++i) {
+        const Field bits = rowBits(ops::shift(piece.data[i], p.x));
+        if (bits == 0) { continue; }
+        const int r = BOARD_BOTTOM - (p.y + i);
+        if (r < 0 || r >= lines) { return false; }
+        m |= bits << (r * PC_FIELD_COLS);
+    }
+    *mask = m;
+    return true;
+}
+
+// Removes full rows; returns the remaining number of rows.
+inline int clearRows(Field* field, int lines) {
+    for (int r = lines - 1; r >= 0; --r) {
+        if (((*field >> (r * PC_FIELD_COLS)) & ROW_BITS) != ROW_BITS) { continue; }
+        const Field below = *field & fieldMask(r);
+        *field = below | ((*field >> PC_FIELD_COLS) & ~fieldMask(r));
+        --lines;
+    }
+    return lines;
+}
+
+// Shifts a set of cells down and left until it touches row 0 and column 0.
+inline Field normalizeCells(Field cells) {
+    cells >>= __builtin_ctzll(cells) / PC_FIELD_COLS * PC_FIELD_COLS;
+    Field columns = 0;
+    for (Field rows = cells; rows != 0; rows >>= PC_FIELD_COLS) { columns |= rows & ROW_BITS; }
+    return cells >> __builtin_ctzll(columns);
+}
+
+// Normalized cells of every piece orientation, for matching four-cell regions.
+struct PieceShapes {
+    Field     cells[static_cast<int>(PieceType::SIZE) * 4];
+    PieceType type[static_cast<int>(PieceType::SIZE) * 4];
+    int       first[static_cast<int>(PieceType::SIZE) * 4];  // column of the lowest, leftmost cell
+    int       width[static_cast<int>(PieceType::SIZE) * 4];
+    int       count = 0;
+
+    PieceShapes() {
+        for (int t = 0; t < static_cast<int>(PieceType::SIZE); ++t) {
+            for (int o = 0; o < 4; ++o) {
+                const Piece& piece = ops::getPiece(static_cast<PieceType>(t), static_cast<std::uint8_t>(o));
+                Field m = 0;
+                for (int i = 0; i < Piece::SIZE; ++i) {
+                    for (int c = 0; c < 4; ++c) {
+                        if (piece.data[i] & ops::shift(static_cast<Row>(Cell::BLOCK), c)) {
+                            m |= Field{1} << ((Piece::SIZE - 1 - i) * PC_FIELD_COLS + c);
+                        }
+                    }
+                }
+                m = normalizeCells(m);
+                if (std::find(cells, cells + count, m) != cells + count) { continue; }
+                Field columns = 0;
+                for (Field rows = m; rows != 0; rows >>= PC_FIELD_COLS) { columns |= rows & ROW_BITS; }
+                cells[count] = m;
+                type[count] = static_cast<PieceType>(t);
+                first[count] = __builtin_ctzll(m);
+                width[count++] = 64 - __builtin_clzll(columns);
+            }
+        }
+    }
+};
+
+inline const PieceShapes& pieceShapes() {
+    static const PieceShapes shapes;
+    return shapes;
+}
+
+// Every 4-connected empty region must be fillable by whole pieces.
+inline bool regionsFillable(Field field, int lines) {
+    Field empty = ~field & fieldMask(lines);
+    while (empty != 0) {
+        Field region = empty & (~empty + 1);
+        for (Field grown = 0; grown != region;) {
+            grown = region;
+            region |= ((region << 1) & ~FIRST_COLUMN) | ((region >> 1) & ~LAST_COLUMN)
+                    | (region << PC_FIELD_COLS) | (region >> PC_FIELD_COLS);
+            region &= empty;
+        }
+        if (popcount(region) % 4 != 0) { return false; }
+        empty &= ~region;
+    }
+    return true;
+}
+
+// Orders the moves of a node: placements leaving no empty cell under the
+// piece come first, lower ones before higher ones. Flat, hole-free stacks are
+// where perfect clears are found, so the search reaches one much sooner.
+inline int placementCost(Field field, Field mask) {
+    const Field below = (mask >> PC_FIELD_COLS) & ~mask;  // cells right under the piece
+    const int covered = popcount(below & ~field);
+    int height = 0;
+    for (Field m = mask; m != 0; m &= m - 1) { height += __builtin_ctzll(m) / PC_FIELD_COLS; }
+    return covered * 64 + height;
+}
+
+constexpr Field makeCheckerboard() {
+    Field mask = 0;
+    for (int r = 0; r < PC_MAX_LINES; ++r) {
+        for (int c = (r & 1); c < PC_FIELD_COLS; c += 2) { mask |= Field{1} << (r * PC_FIELD_COLS + c); }
+    }
+    return mask;
+}
+constexpr Field CHECKERBOARD = makeCheckerboard();
+
+// Checkerboard parity: every piece but T covers two cells of each colour and a
+// T covers three of one, so the colour imbalance of the empty cells must be
+// made up by between t_min and t_max T pieces.
+inline bool parityFillable(Field field, int lines, int t_min, int t_max) {
+    const Field empty = ~field & fieldMask(lines);
+    const int imbalance = std::abs(popcount(empty & CHECKERBOARD) - popcount(empty & ~CHECKERBOARD));
+    if (imbalance % 2 != 0) { return false; }
+    for (int t = t_min; t <= t_max; ++t) {
+        if (imbalance <= 2 * t && (imbalance / 2 + t) % 2 == 0) { return true; }
+    }
+    return false;
+}
+
+// Lossy hash set of (field, tag) pairs. clear() invalidates all entries at
+// once by bumping a stamp.
+class MemoTable {
+public:
+    explicit MemoTable(int bits) : mask_((std::size_t{1} << bits) - 1), entries_(mask_ + 1) {}
+
+    void clear() {
+        if (++stamp_ == 0) {
+            std::fill(entries_.begin(), entries_.end(), Entry{});
+            stamp_ = 1;
+        }
+    }
+    bool contains(Field field, std::uint32_t tag) const {
+        for (std::size_t i = hashOf(field, tag), probe = 0; probe < PROBES; ++probe, i = (i + 1) & mask_) {
+            const Entry& e = entries_[i];
+            if (e.stamp != stamp_) { return false; }
+            if (e.field == field && e.tag == tag) { return true; }
+        }
+        return false;
+    }
+    void insert(Field field, std::uint32_t tag) {
+        std::size_t i = hashOf(field, tag);
+        for (std::size_t probe = 1; probe < PROBES && entries_[i].stamp == stamp_; ++probe) { i = (i + 1) & mask_; }
+        entries_[i] = {field, tag, stamp_};  // overwrites the last probed entry when the run is full
+    }
+
+private:
+    static constexpr std::size_t PROBES = 8;
+    struct Entry {
+        Field         field = 0;
+        std::uint32_t tag   = 0;
+        std::uint32_t stamp = 0;
+    };
+    std::size_t hashOf(Field field, std::uint32_t tag) const {
+        std::uint64_t z = field ^ (static_cast<std::uint64_t>(tag) << 40) ^ tag;
+        z = (z ^ (z >> 31)) * 0x7fb5d329728ea185ull;
+        z = (z ^ (z >> 27)) * 0x81dadef4bc2dd44dull;
+        return static_cast<std::size_t>(z ^ (z >> 33)) & mask_;
+    }
+
+    std::size_t        mask_;
+    std::vector<Entry> entries_;
+    std::uint32_t      stamp_ = 1;
+};
+
+// Memo tag of a search state: field rows, queue index and hold piece.
+inline std::uint32_t stateTag(int lines, int index, PieceType hold) {
+    return static_cast<std::uint32_t>(lines) << 16 | static_cast<std::uint32_t>(index) << 8
+         | static_cast<std::uint8_t>(hold);
+}
+
+// Piece multiset packed as 4-bit counts (bits 4t..4t+3 = pieces of type t).
+using PieceSet = std::uint32_t;
+
+inline int pieceCount(PieceSet set, PieceType type) { return set >> (4 * static_cast<int>(type)) & 15; }
+inline int totalCount(PieceSet set) {
+    int total = 0;
+    for (; set != 0; set >>= 4) { total += set & 15; }
+    return total;
+}
+
+// Exact cover of the empty cells by pieces from a multiset, ignoring order,
+// reachability and pieces split by line clears. Pieces go on the lowest,
+// leftmost empty cell first, so every cover is enumerated once.
+class Tiler {
+public:
+    explicit Tiler(int memo_bits) : tileable_(memo_bits), untileable_(memo_bits) {}
+
+    // Past the deadline (when timed), unfinished cover searches answer
+    // "may tile", which only weakens pruning, and are not memoized.
+    void setDeadline(bool timed, std::chrono::steady_clock::time_point deadline) {
+        timed_ = timed;
+        deadline_ = deadline;
+        expired_ = false;
+    }
+
+    bool tileable(Field empty, PieceSet pieces) {
+        if (empty == 0) { return true; }
+        if (tileable_.contains(empty, pieces)) { return true; }
+        if (untileable_.contains(empty, pieces)) { return false; }
+        if (outOfTime()) { return true; }
+        const PieceShapes& shapes = pieceShapes();
+        const int first = __builtin_ctzll(empty);
+        bool found = false;
+        for (int i = 0; i < shapes.count && !found; ++i) {
+            const PieceType type = shapes.type[i];
+            const int column = first % PC_FIELD_COLS - shapes.first[i];
+            if (pieceCount(pieces, type) == 0 || column < 0 || column + shapes.width[i] > PC_FIELD_COLS) { continue; }
+            const Field cells = shapes.cells[i] << (first - shapes.first[i]);
+            if ((cells & empty) != cells) { continue; }
+            const Field rest = empty & ~cells;
+            const PieceSet left = pieces - (PieceSet{1} << (4 * static_cast<int>(type)));
+            found = mayTile(rest, left) && tileable(rest, left);
+        }
+        if (expired_) { return true; }
+        (found ? tileable_ : untileable_).insert(empty, pieces);
+        return found;
+    }
+
+    // As tileable(), but one piece may have its rows spread apart by rows
+    // that are cleared before it lands.
+    bool tileableWithSplit(Field empty, PieceSet pieces) {
+        if (tileable(empty, pieces)) { return true; }
+        const PieceSet tag = pieces | PieceSet{1} << 31;
+        if (tileable_.contains(empty, tag)) { return true; }
+        if (untileable_.contains(empty, tag)) { return false; }
+        const PieceShapes& shapes = pieceShapes();
+        bool found = false;
+        for (int i = 0; i < shapes.count && !found; ++i) {
+            const PieceType type = shapes.type[i];
+            if (pieceCount(pieces, type) == 0 || (shapes.cells[i] >> PC_FIELD_COLS) == 0) { continue; }
+            const PieceSet left = pieces - (PieceSet{1} << (4 * static_cast<int>(type)));
+            for (int column = 0; column + shapes.width[i] <= PC_FIELD_COLS && !found; ++column) {
+                for (int row = 0; row < PC_MAX_LINES && !found; ++row) {
+                    found = split(empty, left, shapes.cells[i] >> PC_FIELD_COLS, column, row,
+                                  (shapes.cells[i] & ROW_BITS) << (column + row * PC_FIELD_COLS), false);
+                }
+            }
+        }
+        if (expired_) { return true; }
+        (found ? tileable_ : untileable_).insert(empty, tag);
+        return found;
+    }
+
+private:
+    bool outOfTime() {
+        if (timed_ && !expired_ && (++checks_ & 31) == 0) { expired_ = std::chrono::steady_clock::now() >= deadline_; }
+        return expired_;
+    }
+
+    // Cheap necessary conditions checked before a (memoized) cover search.
+    static bool mayTile(Field empty, PieceSet pieces) {
+        const int t = pieceCount(pieces, PieceType::T);
+        const int spare = totalCount(pieces) - popcount(empty) / 4;
+        return parityFillable(~empty, PC_MAX_LINES, std::max(0, t - spare), t) && regionsFillable(~empty, PC_MAX_LINES);
+    }
+
+    // Places the remaining `rows` of a piece above `row`, at least one of
+    // them with a gap, then tiles the rest without splits.
+    bool split(Field empty, PieceSet pieces, Field rows, int column, int row, Field cells, bool gap) {
+        if ((cells & empty) != cells) { return false; }
+        if (rows == 0) { return gap && mayTile(empty & ~cells, pieces) && tileable(empty & ~cells, pieces); }
+        const Field bits = (rows & ROW_BITS) << column;
+        for (int r = row + 1; r < PC_MAX_LINES; ++r) {
+            if (split(empty, pieces, rows >> PC_FIELD_COLS, column, r, cells | bits << (r * PC_FIELD_COLS), gap || r > row + 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    MemoTable tileable_;
+    MemoTable untileable_;
+    bool      timed_ = false;
+    bool      expired_ = false;
+    std::uint32_t checks_ = 0;
+    std::chrono::steady_clock::time_point deadline_;
+};
+
+// One way to place the piece at the front of the queue.
+struct Move {
+    PieceType piece;
+    bool      hold;
+    Position  position;
+    Field     field;      // after placing and clearing
+    int       lines;
+    int       index;      // queue index of the next current piece
+    PieceType next_hold;
+    int       cost;       // search order: lower first (see placementCost)
+};
+
+// Shared description of one query.
+struct Problem {
+    const Context* ctx;
+    PieceType      queue[1 + NEXT_QUEUE_SIZE];  // current piece, then the next queue
+    int            queue_length;
+    bool           use_hold;
+    std::uint64_t  max_nodes;
+    bool           timed;     // deadline applies
+    std::chrono::steady_clock::time_point deadline;
+    bool           split;     // also search solutions with pieces split by line clears
+};
+
+// Whether the query ran out of its wall-time budget.
+inline bool expired(const Problem& pb) { return pb.timed && std::chrono::steady_clock::now() >= pb.deadline; }
+
+class Worker {
+public:
+    explicit Worker(int memo_bits) : memo_(memo_bits), tiler_(memo_bits - 2) {
+        for (auto& moves : children_) { moves.resize(2 * MoveGenerator::NODES); }
+    }
+
+    // Moves from (field, lines, index, hold); `root` selects the current
+    // piece's actual position and remaining lifetime.
+    int expand(const Problem& pb, Field field, int lines, int index, PieceType hold, bool root, Move* out) {
+        int count = 0;
+        const PieceType current = pb.queue[index];
+        const bool can_hold = pb.use_hold && !(root && pb.ctx->state.has_held);
+        expandPiece(pb, field, lines, current, false, index + 1, hold, root, out, &count);
+        if (can_hold) {
+            if (hold == PieceType::NONE) {
+                if (index + 1 < pb.queue_length && pb.queue[index + 1] != current) {
+                    expandPiece(pb, field, lines, pb.queue[index + 1], true, index + 2, current, root, out, &count);
+                } else if (index + 1 < pb.queue_length) {  // same piece: only the hold slot differs
+                    expandPiece(pb, field, lines, current, true, index + 2, current, root, out, &count);
+                }
+            } else if (hold != current) {
+                expandPiece(pb, field, lines, hold, true, index + 1, current, root, out, &count);
+            }
+        }
+        return count;
+    }
+
+    // Depth-first search below one move; fills path_[depth..] on success.
+    bool search(const Problem& pb, const Move& move, int depth, int root_index, std::atomic<int>* best_root,
+                std::atomic<std::uint64_t>* nodes) {
+        path_[depth] = move;
+        if (move.lines == 0) { depth_ = depth + 1; return true; }
+        if (++local_nodes_ == NODE_BATCH) {
+            const std::uint64_t total = nodes->fetch_add(local_nodes_) + local_nodes_;
+            local_nodes_ = 0;
+            if (pb.max_nodes != 0 && total >= pb.max_nodes) { aborted_ = true; }
+        }
+        if (aborted_ || expired(pb) || best_root->load(std::memory_order_relaxed) < root_index) { aborted_ = true; return false; }
+
+        if (memo_.contains(move.field, stateTag(move.lines, move.index, move.next_hold))) { return false; }
+        if (!fillable(pb, move.field, move.lines, move.index, move.next_hold)) { return false; }
+
+        Move* children = children_[depth].data();
+        const int count = expand(pb, move.field, move.lines, move.index, move.next_hold, false, children);
+        std::stable_sort(children, children + count, [](const Move& a, const Move& b) { return a.cost < b.cost; });
+        for (int i = 0; i < count; ++i) {
+            if (search(pb, children[i], depth + 1, root_index, best_root, nodes)) { return true; }
+            if (aborted_) { return false; }
+        }
+        memo_.insert(move.field, stateTag(move.lines, move.index, move.next_hold));
+        return false;
+    }
+
+    // Whether the remaining pieces may still clear the field: enough of them,
+    // and (without splits) checkerboard parity, empty regions and an exact
+    // cover of the empty cells; with pb.split, a cover with one split piece.
+    bool fillable(const Problem& pb, Field field, int lines, int index, PieceType hold) {
+        const int empty_cells = lines * PC_FIELD_COLS - popcount(field);
+        const int needed = empty_cells / 4;
+        const int available = pb.queue_length - index + (hold != PieceType::NONE);
+        if (empty_cells % 4 != 0 || needed > available || index >= pb.queue_length) { return false; }
+        int spare;
+        const PieceSet pieces = remainingPieces(pb, index, hold, needed, &spare);
+        const Field empty = ~field & fieldMask(lines);
+        if (pb.split) { return tiler_.tileableWithSplit(empty, pieces); }
+        const int t = pieceCount(pieces, PieceType::T);
+        return parityFillable(field, lines, std::max(0, t - spare), t) && regionsFillable(field, lines)
+            && tiler_.tileable(empty, pieces);
+    }
+
+    void setDeadline(const Problem& pb) { tiler_.setDeadline(pb.timed, pb.deadline); }
+
+    void begin() {
+        memo_.clear();
+        aborted_ = false;
+        local_nodes_ = 0;
+        depth_ = 0;
+    }
+    void flushNodes(std::atomic<std::uint64_t>* nodes) { nodes->fetch_add(local_nodes_); local_nodes_ = 0; }
+
+    const Move* path() const { return path_; }
+    int pathLength() const { return depth_; }
+    MoveGenerator& movegen() { return movegen_; }
+
+private:
+    static constexpr std::uint64_t NODE_BATCH = 256;
+
+    // The pieces the next `needed` placements choose from: the hold piece and
+    // the queue from `index`, one more than needed when hold is allowed (any
+    // one of them can stay behind in hold). Counts are capped at `needed`.
+    static PieceSet remainingPieces(const Problem& pb, int index, PieceType hold, int needed, int* spare) {
+        const int pool = needed + (pb.use_hold ? 1 : 0);
+        int counts[static_cast<int>(PieceType::SIZE)] = {};
+        int taken = 0;
+        if (hold != PieceType::NONE) { ++counts[static_cast<int>(hold)]; ++taken; }
+        for (int i = index; i < pb.queue_length && taken < pool; ++i, ++taken) { ++counts[static_cast<int>(pb.queue[i])]; }
+        PieceSet set = 0;
+        for (int t = 0; t < static_cast<int>(PieceType::SIZE); ++t) {
+            set |= static_cast<PieceSet>(std::min(counts[t], needed)) << (4 * t);
+        }
+        *spare = taken - needed;
+        return set;
+    }
+
+    void expandPiece(const Problem& pb, Field field, int lines, PieceType piece, bool hold, int next_index,
+                     PieceType next_hold, bool root, Move* out, int* count) {
+        buildBoard(field, lines, &board_);
+        const State& s = pb.ctx->state;
+        Position start;
+        MoveRules rules;
+        if (root && !hold) {
+            start = {s.x, s.y, s.orientation};
+            rules = currentMoveRules(pb.ctx);
+        } else {
+            rules = spawnMoveRules(pb.ctx);
+            start = spawnPosition(board_, piece, hold && rules.gravity);
+        }
+        movegen_.generateLandingMap(board_, piece, start, rules);
+        const auto& landings = movegen_.landingMap();
+        Field seen[MoveGenerator::NODES];
+        int seen_count = 0;
+        for (int o = 0; o < 4; ++o) {
+            // only landings inside the field can be part of a perfect clear
+            for (int y = BOARD_BOTTOM - lines - 2; y <= BOARD_BOTTOM; ++y) {
+                if (y < 0) { continue; }
+                for (std::uint32_t bits = landings[o][y]; bits != 0; bits &= bits - 1) {
+                    const Position p{static_cast<std::int8_t>(__builtin_ctz(bits)), static_cast<std::int8_t>(y),
+                                     static_cast<std::uint8_t>(o)};
+                    Field mask;
+                    if (!pieceMask(piece, p, lines, &mask)) { continue; }
+                    // orientations covering the same cells (I, S, Z, O) are one move
+                    if (std::find(seen, seen + seen_count, mask) != seen + seen_count) { continue; }
+                    seen[seen_count++] = mask;
+                    Field next = field | mask;
+                    const int next_lines = clearRows(&next, lines);
+                    out[(*count)++] = {piece, hold, p, next, next_lines, next_index, next_hold, placementCost(field, mask)};
+                }
+            }
+        }
+    }
+
+    MemoTable     memo_;
+    Tiler         tiler_;
+    MoveGenerator movegen_;
+    Board         board_;
+    std::vector<Move> children_[PC_MAX_PIECES];  // moves of each search depth
+    Move          path_[PC_MAX_PIECES];
+    int           depth_ = 0;
+    bool          aborted_ = false;
+    std::uint64_t local_nodes_ = 0;
+};
+
+} // namespace pc_detail
+
+// Reusable solver: owns one memo table and move generator per thread.
+class PerfectClearSolver {
+public:
+    PerfectClearSolver(int threads, int memo_bits) {
+        threads = std::max(1, threads);
+        memo_bits = std::clamp(memo_bits, PC_MIN_MEMO_BITS, PC_MAX_MEMO_BITS);
+        for (int i = 0; i < threads; ++i) {
+            workers_.push_back(std::make_unique<pc_detail::Worker>(memo_bits));
+        }
+    }
+
+    // Searches for a perfect clear of at most options.max_lines rows from the
+    // state of `ctx`, trying the fewest rows first. Only boards whose blocks
+    // all lie in those rows qualify.
+    void solve(const Context* ctx, const PcOptions& options, PcSolution* out) {
+        using namespace pc_detail;
+        out->found = 0;
+        out->lines = 0;
+        out->piece_count = 0;
+        out->action_count = 0;
+        out->nodes = 0;
+        const State& s = ctx->state;
+        const int max_lines = std::clamp<int>(options.max_lines, 1, PC_MAX_LINES);
+        if (!s.is_alive || s.current == PieceType::NONE) { return; }
+        for (int y = 0; y <= BOARD_BOTTOM - max_lines; ++y) {
+            if (s.board.data[y] != ROW_EMPTY) { return; }
+        }
+        Field field = 0;
+        int height = 0;
+        for (int r = 0; r < max_lines; ++r) {
+            const Field bits = rowBits(s.board.data[BOARD_BOTTOM - r]);
+            field |= bits << (r * PC_FIELD_COLS);
+            if (bits != 0) { height = r + 1; }
+        }
+
+        Problem pb;
+        pb.ctx = ctx;
+        const int next = options.next_pieces < 0 ? s.next_count : std::min<int>(options.next_pieces, s.next_count);
+        pb.queue[0] = s.current;
+        for (int i = 0; i < next; ++i) { pb.queue[1 + i] = peekNext(&s, i); }
+        pb.queue_length = 1 + next;
+        pb.use_hold = options.use_hold != 0;
+        pb.max_nodes = options.max_nodes;
+        pb.timed = options.max_millis != 0;
+        pb.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.max_millis);
+        for (auto& worker : workers_) { worker->setDeadline(pb); }
+
+        const int threads = std::clamp<int>(options.threads, 1, static_cast<int>(workers_.size()));
+        std::atomic<std::uint64_t> nodes{0};
+        for (int lines = std::max(1, height); lines <= max_lines; ++lines) {
+            // solutions without split pieces first: their pruning is much tighter
+            for (const bool split : {false, true}) {
+                pb.split = split;
+                if (!workers_[0]->fillable(pb, field, lines, 0, s.hold)) { continue; }
+                if (searchRoot(pb, field, lines, threads, &nodes, out)) { out->nodes = nodes.load(); return; }
+                if ((pb.max_nodes != 0 && nodes.load() >= pb.max_nodes) || expired(pb)) { out->nodes = nodes.load(); return; }
+            }
+        }
+        out->nodes = nodes.load();
+    }
+
+private:
+    bool searchRoot(const pc_detail::Problem& pb, Field field, int lines, int threads,
+                    std::atomic<std::uint64_t>* nodes, PcSolution* out) {
+        using namespace pc_detail;
+        const State& s = pb.ctx->state;
+        std::vector<Move> roots(2 * MoveGenerator::NODES);
+        roots.resize(workers_[0]->expand(pb, field, lines, 0, s.hold, true, roots.data()));
+        std::stable_sort(roots.begin(), roots.end(), [](const Move& a, const Move& b) { return a.cost < b.cost; });
+
+        std::atomic<int> best_root{INT_MAX};
+        std::vector<int> solved_root(threads, INT_MAX);
+        auto run = [&](int t) {
+            Worker& w = *workers_[t];
+            w.begin();
+            for (int i = t; i < static_cast<int>(roots.size()); i += threads) {
+                if (best_root.load() < i) { break; }
+                if (w.search(pb, roots[i], 0, i, &best_root, nodes)) {
+                    solved_root[t] = i;
+                    for (int b = best_root.load(); i < b && !best_root.compare_exchange_weak(b, i);) {}
+                    break;
+                }
+                if ((pb.max_nodes != 0 && nodes->load() >= pb.max_nodes) || expired(pb)) { break; }
+            }
+            w.flushNodes(nodes);
+        };
+        if (threads == 1) {
+            run(0);
+        } else {
+            std::vector<std::thread> pool;
+            for (int t = 0; t < threads; ++t) { pool.emplace_back(run, t); }
+            for (auto& th : pool) { th.join(); }
+        }
+
+        const int best = best_root.load();
+        if (best == INT_MAX) { return false; }
+        const Worker& winner = *workers_[std::find(solved_root.begin(), solved_root.end(), best) - solved_root.begin()];
+        writeSolution(pb, field, lines, winner.path(), winner.pathLength(), out);
+        return true;
+    }
+
+    // Replays the placements to recover the input sequence of each.
+    void writeSolution(const pc_detail::Problem& pb, Field field, int lines, const pc_detail::Move* path, int n,
+                       PcSolution* out) {
+        using namespace pc_detail;
+        const State& s = pb.ctx->state;
+        MoveGenerator& movegen = workers_[0]->movegen();
+        Board board;
+        out->found = 1;
+        out->lines = lines;
+        out->piece_count = n;
+        out->action_count = 0;
+        for (int k = 0; k < n; ++k) {
+            const Move& m = path[k];
+            out->placements[k] = {m.piece, static_cast<std::uint8_t>(m.hold), m.position};
+            buildBoard(field, lines, &board);
+            Position start;
+            MoveRules rules;
+            if (k == 0 && !m.hold) {
+                start = {s.x, s.y, s.orientation};
+                rules = currentMoveRules(pb.ctx);
+            } else {
+                rules = spawnMoveRules(pb.ctx);
+                start = spawnPosition(board, m.piece, m.hold && rules.gravity);
+            }
+            if (m.hold && out->action_count < PC_MAX_ACTIONS) { out->actions[out->action_count++] = Action::HOLD; }
+            movegen.generate(board, m.piece, start, rules, &m.position);
+            assert(movegen.landingCount() > 0 && movegen.landings()[movegen.landingCount() - 1].position == m.position);
+            const Landing& landing = movegen.landings()[movegen.landingCount() - 1];
+            const int length = movegen.pathTo(landing, out->actions + out->action_count, PC_MAX_ACTIONS - out->action_count);
+            if (length > 0) { out->action_count += length; }
+            field = m.field;
+            lines = m.lines;
+        }
+    }
+
+    std::vector<std::unique_ptr<pc_detail::Worker>> workers_;
+};
+
+} // namespace tetrl::search
@@ -0,0 +1,189 @@
+#pragma once
+#include "engine/tetris.hpp"
+#include "envs/step/analysis.hpp"
+#include "envs/step/step.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace tetrl::search {
+
+// Perft for the step env: counts the placement tree of a Context to a fixed
+// depth, as a correctness check and benchmark of the engine's movement, SRS
+// kick, line-clear and spin rules.
+//
+// Unlike MoveGenerator, which re-implements the movement rules on a fit map,
+// the search here only calls envs::step::step() on Context copies, so every
+// node exercises the engine itself. A breadth-first search runs over the
+// inputs the move generator uses (gravity and piece lifetime included; a step
+// that would force a hard drop ends the branch, as in MoveRules), keyed by the
+// piece position plus the part of the rotation state spin detection reads.
+// Every reached node is hard-dropped; the distinct (landing, spin type) pairs
+// are the placements of the piece. With hold, the placements after HOLD are
+// added. Placements that top out are leaves.
+
+constexpr int PERFT_MAX_DEPTH = 8;
+
+// Placements at one depth of the tree.
+struct PerftCounts {
+    std::uint64_t nodes;
+    std::uint64_t line_clears;     // placements clearing at least one line
+    std::uint64_t lines;           // lines cleared, summed
+    std::uint64_t spins[3];        // by SpinType: NONE, SPIN, SPIN_MINI
+    std::uint64_t perfect_clears;
+    std::uint64_t top_outs;
+};
+
+struct PerftOptions {
+    std::int32_t depth    = 1;
+    std::uint8_t use_hold = 0;
+    std::uint8_t threads  = 1;
+};
+
+class PerftSearch {
+public:
+    static constexpr int POSITIONS = 4 * BOARD_HEIGHT * BOARD_WIDTH;
+
+    PerftSearch() : queue_(static_cast<std::size_t>(POSITIONS) * 3) {}
+
+    // Appends the placements of ctx's current piece (and, with use_hold, of
+    // the piece HOLD brings in) to `children`, as the Contexts after the lock.
+    void expand(const envs::step::Context& ctx, bool use_hold, std::vector<envs::step::Context>* children) {
+        using envs::step::Action;
+        if (!ctx.state.is_alive) { return; }
+        search(ctx, children);
+        if (use_hold && !ctx.state.has_held) {
+            envs::step::Context held = ctx;
+            const envs::step::Info info = envs::step::step(&held, Action::HOLD);
+            if (info.action_success && held.state.is_alive && !info.forced_hard_drop) { search(held, children); }
+        }
+    }
+
+private:
+    static constexpr envs::step::Action inputs[] = {
+        envs::step::Action::MOVE_LEFT, envs::step::Action::MOVE_RIGHT, envs::step::Action::SOFT_DROP,
+        envs::step::Action::ROTATE_CW, envs::step::Action::ROTATE_CCW, envs::step::Action::ROTATE_180,
+        envs::step::Action::MOVE_LEFT_TO_WALL, envs::step::Action::MOVE_RIGHT_TO_WALL, envs::step::Action::SOFT_DROP_TO_FLOOR,
+        envs::step::Action::NOOP,
+    };
+
+    static int positionOf(int x, int y, int orientation) { return (orientation * BOARD_HEIGHT + y) * BOARD_WIDTH + x; }
+
+    // Position plus what getSpinType() reads of the rotation state: whether the
+    // last move was a rotation and, if so, whether it used the fifth kick.
+    static int nodeKey(const State& s) {
+        const int rotation = !s.was_last_rotation ? 0 : s.srs_index < 4 ? 1 : 2;
+        return positionOf(s.x, s.y, s.orientation) * 3 + rotation;
+    }
+
+    void search(const envs::step::Context& start, std::vector<envs::step::Context>* children) {
+        using envs::step::Action;
+        if (++stamp_ == 0) {
+            std::fill(std::begin(seen_), std::end(seen_), 0u);
+            std::fill(std::begin(landed_), std::end(landed_), 0u);
+            stamp_ = 1;
+        }
+        std::size_t head = 0, tail = 0;
+        seen_[nodeKey(start.state)] = stamp_;
+        queue_[tail++] = start;
+        while (head < tail) {
+            const envs::step::Context& node = queue_[head++];
+            envs::step::Context leaf = node;
+            const int landing = positionOf(leaf.state.x, envs::step::ghostY(&leaf.state), leaf.state.orientation);
+            envs::step::step(&leaf, Action::HARD_DROP);
+            const int leaf_key = landing * 3 + static_cast<int>(leaf.state.spin_type);
+            if (landed_[leaf_key] != stamp_) {
+                landed_[leaf_key] = stamp_;
+                children->push_back(leaf);
+            }
+            for (Action input : inputs) {
+                envs::step::Context next = node;
+                const envs::step::Info info = envs::step::step(&next, input);
+                if (info.forced_hard_drop) { continue; }
+                const int key = nodeKey(next.state);
+                if (seen_[key] == stamp_) { continue; }
+                seen_[key] = stamp_;
+                queue_[tail++] = next;
+            }
+        }
+    }
+
+    std::vector<envs::step::Context> queue_;
+    std::uint32_t                    stamp_ = 0;
+    std::uint32_t                    seen_[POSITIONS * 3] = {};
+    std::uint32_t                    landed_[POSITIONS * 3] = {};
+};
+
+namespace perft_detail {
+
+inline void count(const envs::step::Context& child, PerftCounts* c) {
+    const State& s = child.state;
+    ++c->nodes;
+    c->line_clears += s.lines_cleared > 0;
+    c->lines += s.lines_cleared;
+    ++c->spins[static_cast<int>(s.spin_type)];
+    c->perfect_clears += s.lines_cleared > 0 && s.perfect_clear;
+    c->top_outs += !s.is_alive;
+}
+
+// Counts the subtree below `ctx` (at depth `level`) into counts[level ..].
+inline void walk(const envs::step::Context& ctx, int level, const PerftOptions& o, PerftSearch* search,
+                 std::vector<std::vector<envs::step::Context>>* scratch, PerftCounts* counts) {
+    std::vector<envs::step::Context>& children = (*scratch)[level];
+    children.clear();
+    search->expand(ctx, o.use_hold != 0, &children);
+    for (const auto& child : children) { count(child, &counts[level]); }
+    if (level + 1 >= o.depth) { return; }
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        if (children[i].state.is_alive) { walk(children[i], level + 1, o, search, scratch, counts); }
+    }
+}
+
+} // namespace perft_detail
+
+// Fills counts[0 .. depth - 1] with the placements at depths 1 .. depth below
+// `root`. The subtrees of the root's placements are spread over o.threads
+// threads.
+inline void perft(const envs::step::Context& root, const PerftOptions& o, PerftCounts* counts) {
+    const int depth = std::clamp(o.depth, 0, PERFT_MAX_DEPTH);
+    std::fill(counts, counts + depth, PerftCounts{});
+    if (depth == 0) { return; }
+    PerftOptions options = o;
+    options.depth = depth;
+
+    PerftSearch root_search;
+    std::vector<envs::step::Context> first;
+    root_search.expand(root, options.use_hold != 0, &first);
+    for (const auto& child : first) { perft_detail::count(child, &counts[0]); }
+    if (depth == 1) { return; }
+
+    const int jobs = static_cast<int>(first.size());
+    const int threads = std::clamp<int>(options.threads, 1, std::max(jobs, 1));
+    std::vector<std::vector<PerftCounts>> partial(static_cast<std::size_t>(threads), std::vector<PerftCounts>(depth));
+    std::atomic<int> next{0};
+    auto run = [&](int t) {
+        auto search = t == 0 ? nullptr : std::make_unique<PerftSearch>();
+        PerftSearch* s = t == 0 ? &root_search : search.get();
+        std::vector<std::vector<envs::step::Context>> scratch(static_cast<std::size_t>(depth));
+        for (int job; (job = next.fetch_add(1, std::memory_order_relaxed)) < jobs;) {
+            if (first[job].state.is_alive) { perft_detail::walk(first[job], 1, options, s, &scratch, partial[t].data()); }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; ++t) { pool.emplace_back(run, t); }
+    run(0);
+    for (auto& thread : pool) { thread.join(); }
+
+    for (const auto& part : partial) {
+        for (int d = 1; d < depth; ++d) {
+            const auto* src = reinterpret_cast<const std::uint64_t*>(&part[d]);
+            auto* dst = reinterpret_cast<std::uint64_t*>(&counts[d]);
+            for (std::size_t i = 0; i < sizeof(PerftCounts) / sizeof(std::uint64_t); ++i) { dst[i] += src[i]; }
+        }
+    }
+}
+
+} // namespace tetrl::search
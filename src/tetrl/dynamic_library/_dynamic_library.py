@@ -5,6 +5,7 @@ symbols as Python callables with convenient type conversions.
 
 from __future__ import annotations
 
+import contextlib
 import getpass
 import hashlib
 import os
@@ -14,7 +15,7 @@ import subprocess
 import tempfile
 import textwrap
 from pathlib import Path
-from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+from typing import Dict, Iterable, Iterator, List, Optional, Sequence, Tuple
 
 import ctypes
 
@@ -94,7 +95,30 @@ class DynamicLibrary:
         * On Windows, ``"auto"`` tries ``cl.exe``, then ``g++`` (MinGW).
     cache_dir:
         Directory used to store compiled artefacts keyed by SHA-256 of
-        (source + flags).  If ``None``, uses platform temp dir.
+        (source + flags).  If ``None``, uses platform temp dir.  The
+        directory may be shared by many processes: each artefact is built
+        once under a per-key file lock and published with an atomic rename.
+    source_root:
+        Directory whose absolute location is excluded from the cache key.
+        Watched files below it are hashed by their relative path and the
+        root is masked out of the compile flags, so artefacts built from
+        one checkout are reusable from another (e.g. prebuilt wheels).
+    prebuilt_dirs:
+        Read-only directories searched for an artefact with a matching key
+        before compiling into *cache_dir*.
+    global_symbols:
+        Load the library with ``RTLD_GLOBAL`` so that libraries loaded
+        later can resolve their undefined symbols against it.
+    profile:
+        Profile-guided optimisation phase (GCC-style flags): ``"generate"``
+        builds an instrumented library that writes ``.gcda`` counters into
+        *profile_dir* at process exit, ``"use"`` rebuilds with those
+        counters and ``-flto`` (the counters are part of the cache key).  ``None``
+        disables PGO.
+    profile_dir:
+        Directory holding the PGO sources and counters (required with
+        *profile*).  Sources are written there under a flag-independent
+        name so both phases compile the very same file.
 
     Examples
     --------
@@ -115,7 +139,16 @@ class DynamicLibrary:
         cache_dir: str | os.PathLike | None = None,
         extra_compile_flags: Optional[Sequence[str]] = None,
         watch_files: Optional[Sequence[str | os.PathLike]] = None,
+        source_root: str | os.PathLike | None = None,
+        prebuilt_dirs: Optional[Sequence[str | os.PathLike]] = None,
+        global_symbols: bool = False,
+        profile: Optional[str] = None,
+        profile_dir: str | os.PathLike | None = None,
     ) -> None:
+        if profile not in (None, "generate", "use"):
+            raise ValueError(f"profile must be None, 'generate' or 'use', got {profile!r}")
+        if profile is not None and profile_dir is None:
+            raise ValueError("profile_dir is required when profile is set")
         self._compiler_cmd: Tuple[str, ...] = self._resolve_compiler(cc)
         self._extra_flags = tuple(extra_compile_flags or ())
         self._watch_files: Tuple[Path, ...] = tuple(Path(f).expanduser().resolve() for f in (watch_files or ()))
@@ -124,10 +157,19 @@ class DynamicLibrary:
         else:
             self._cache_dir = Path(cache_dir)
         self._cache_dir.mkdir(parents=True, exist_ok=True)
+        self._source_root: Optional[Path] = Path(source_root).expanduser().resolve() if source_root is not None else None
+        self._prebuilt_dirs: Tuple[Path, ...] = tuple(Path(d) for d in (prebuilt_dirs or ()))
+        self._load_mode = ctypes.RTLD_GLOBAL if global_symbols else ctypes.DEFAULT_MODE
+        self._profile = profile
+        self._profile_dir: Optional[Path] = Path(profile_dir).expanduser().resolve() if profile_dir is not None else None
+        if self._profile_dir is not None:
+            self._profile_dir.mkdir(parents=True, exist_ok=True)
 
         self._tmp_dir_ctx: Optional[tempfile.TemporaryDirectory[str]] = None
         self._tmp_dir_path: Optional[Path] = None
         self._lib_handle: Optional["ctypes.CDLL"] = None
+        self._lib_path: Optional[Path] = None
+        self._source_digest: Optional[str] = None
         self._exported: List[str] = []
 
         # For POSIX `dlclose`
@@ -214,6 +256,20 @@ class DynamicLibrary:
         extra = tuple(Path(f).expanduser().resolve() for f in (watch_files or ()))
         self._build_and_load(source, functions or {}, extra_watch=extra)
 
+    @property
+    def path(self) -> Optional[Path]:
+        """Filesystem path of the loaded shared library (``None`` before loading)."""
+        return self._lib_path
+
+    @property
+    def source_digest(self) -> Optional[str]:
+        """SHA-256 hex digest of the compiled source alone (``None`` before loading).
+
+        Unlike the cache key it ignores compiler, flags and watched files,
+        so it identifies the code across builds of the same source.
+        """
+        return self._source_digest
+
     def close(self) -> None:
         """Unload the shared library and clean up temp files."""
         # remove python attributes
@@ -231,6 +287,8 @@ class DynamicLibrary:
             else:
                 self._dlclose(self._lib_handle._handle)  # type: ignore[arg-type]
             self._lib_handle = None
+            self._lib_path = None
+            self._source_digest = None
 
         # dispose temp dir (if any)
         if self._tmp_dir_ctx is not None:
@@ -244,39 +302,89 @@ class DynamicLibrary:
         functions: Dict[str, Dict[str, object]],
         extra_watch: Tuple[Path, ...] = (),
     ) -> None:
-        # 1) check cache
+        # 1) check prebuilt artefacts, then the cache
+        src_path: Optional[Path] = None
+        profile_flags: Tuple[str, ...] = ()
+        profile_data: Tuple[Path, ...] = ()
+        if self._profile is not None:
+            assert self._profile_dir is not None
+            # Both PGO phases must compile the same absolute source path with
+            # the same auxiliary name, so derive both from the flag-free key.
+            src_path = self._profile_dir / f"src_{self._cache_key(source, extra_watch)}.cpp"
+            aux_name = src_path.with_suffix("")
+            if self._profile == "generate":
+                profile_flags = (f"-fprofile-generate={self._profile_dir}", "-fprofile-update=atomic", "-dumpbase", str(aux_name))
+            else:
+                profile_flags = (f"-fprofile-use={self._profile_dir}", "-fprofile-partial-training", "-Wno-missing-profile", "-flto", "-dumpbase", str(aux_name))
+                profile_data = tuple(sorted(self._profile_dir.rglob(f"{aux_name.name}*.gcda")))
+        digest = self._cache_key(source, extra_watch, profile_flags, profile_data)
+        lib_name = f"lib_{digest}{_LIB_EXT}"
+        cached_lib = next(
+            (d / lib_name for d in self._prebuilt_dirs if self._profile is None and (d / lib_name).exists()),
+            self._cache_dir / lib_name,
+        )
+        if not cached_lib.exists():
+            # 2) Compile once across processes: the first process to take the
+            #    lock builds, the others wait and then find the published file.
+            with _file_lock(self._cache_dir / f"lib_{digest}.lock"):
+                if not cached_lib.exists():
+                    if src_path is None:
+                        self._tmp_dir_ctx = tempfile.TemporaryDirectory()
+                        self._tmp_dir_path = Path(self._tmp_dir_ctx.name)
+                        src_path = self._tmp_dir_path / "lib.cpp"
+                    src_path.write_text(source, encoding="utf-8")
+
+                    # Build next to the target so the rename stays on one filesystem.
+                    staging_lib = self._cache_dir / f".lib_{digest}.{os.getpid()}.tmp{_LIB_EXT}"
+                    try:
+                        self._compile(src_path, staging_lib, log_path=cached_lib.with_suffix(".log"), extra_flags=profile_flags)
+                        os.replace(staging_lib, cached_lib)
+                    finally:
+                        staging_lib.unlink(missing_ok=True)
+        # 3) Load
+        self._lib_handle = ctypes.CDLL(str(cached_lib), mode=self._load_mode)
+        self._lib_path = cached_lib
+        self._source_digest = hashlib.sha256(source.encode()).hexdigest()
+        self._bind_functions(functions)
+
+    def _cache_key(
+        self,
+        source: str,
+        extra_watch: Tuple[Path, ...],
+        extra_flags: Tuple[str, ...] = (),
+        extra_data: Tuple[Path, ...] = (),
+    ) -> str:
+        root = str(self._source_root) if self._source_root is not None else None
         h = hashlib.sha256()
         h.update(source.encode())
         h.update(b"|cmd=")
         h.update(" ".join(self._compiler_cmd).encode())
-        h.update(" ".join(self._extra_flags).encode())
+        flags = " ".join((*self._extra_flags, *extra_flags))
+        h.update((flags.replace(root, "<root>") if root else flags).encode())
         # Hash all watched files (instance-level + call-level, deduplicated)
         seen: set = set()
-        for path in (*self._watch_files, *extra_watch):
+        for path in (*self._watch_files, *extra_watch, *extra_data):
             if path in seen:
                 continue
             seen.add(path)
             h.update(b"|file=")
-            h.update(str(path).encode())
+            if self._source_root is not None and path.is_relative_to(self._source_root):
+                h.update(path.relative_to(self._source_root).as_posix().encode())
+            else:
+                h.update(str(path).encode())
             try:
                 h.update(path.read_bytes())
             except OSError:
                 pass  # missing files will cause a compile error anyway
-        digest = h.hexdigest()
-        cached_lib = self._cache_dir / f"lib_{digest}{_LIB_EXT}"
-        if not cached_lib.exists():
-            # 2) Compile into temp dir
-            self._tmp_dir_ctx = tempfile.TemporaryDirectory()
-            self._tmp_dir_path = Path(self._tmp_dir_ctx.name)
-            src_path = self._tmp_dir_path / "lib.cpp"
-            src_path.write_text(source, encoding="utf-8")
-
-            self._compile(src_path, cached_lib)
-        # 3) Load
-        self._lib_handle = ctypes.CDLL(str(cached_lib))
-        self._bind_functions(functions)
+        return h.hexdigest()
 
-    def _compile(self, src_path: Path, output_path: Path) -> None:
+    def _compile(
+        self,
+        src_path: Path,
+        output_path: Path,
+        log_path: Optional[Path] = None,
+        extra_flags: Sequence[str] = (),
+    ) -> None:
         cmd = list(self._compiler_cmd)
 
         # Windows/MSC uses different flags
@@ -290,6 +398,7 @@ class DynamicLibrary:
             if not _IS_WINDOWS:
                 cmd.append("-fPIC")
             cmd.extend(self._extra_flags)
+            cmd.extend(extra_flags)
 
         try:
             result = subprocess.run(
@@ -303,7 +412,7 @@ class DynamicLibrary:
 
         # Optionally keep compile output for debugging:
         if result.stdout or result.stderr:
-            (output_path.parent / "compile.log").write_bytes(result.stdout + b"\n" + result.stderr)
+            (log_path or output_path.parent / "compile.log").write_bytes(result.stdout + b"\n" + result.stderr)
 
     def _bind_functions(self, functions: Dict[str, Dict[str, object]]) -> None:
         for name, meta in functions.items():
@@ -342,6 +451,35 @@ class DynamicLibrary:
         raise FileNotFoundError("No suitable C/C++ compiler found on PATH.")
 
 
+@contextlib.contextmanager
+def _file_lock(path: Path) -> Iterator[None]:
+    """Hold an exclusive advisory lock on *path* (created if missing)."""
+    with open(path, "a+b") as fp:
+        if _IS_WINDOWS:
+            import msvcrt
+
+            fp.seek(0)
+            while True:
+                try:
+                    msvcrt.locking(fp.fileno(), msvcrt.LK_LOCK, 1)
+                    break
+                except OSError:
+                    continue  # LK_LOCK gives up after ~10 s; keep waiting for long builds
+            try:
+                yield
+            finally:
+                fp.seek(0)
+                msvcrt.locking(fp.fileno(), msvcrt.LK_UNLCK, 1)
+        else:
+            import fcntl
+
+            fcntl.flock(fp.fileno(), fcntl.LOCK_EX)
+            try:
+                yield
+            finally:
+                fcntl.flock(fp.fileno(), fcntl.LOCK_UN)
+
+
 # generate extractor functions
 _EXTRACTOR_FMT = (
     r"void* __get_library_function_pointer_{0}() {{ "
@@ -1,13 +1,17 @@
 """
-Python/native bridge for the base Tetris engine (``tetris.hpp`` / ``tetris.cpp``).
+Python/native bridge for the base Tetris engine (``tetris.hpp`` / ``tetris.cpp``)
+and its frame renderer (``render.hpp`` / ``render.cpp``).
 
 Responsibility
 --------------
 This module is the **single compilation unit** for the core Tetris engine.
 It:
 
-* JIT-compiles ``tetris.cpp`` via :class:`DynamicLibrary` and exports the
+* JIT-compiles ``tetris.cpp`` and ``render.cpp`` via :class:`DynamicLibrary` and exports the
   public symbols needed by higher-level code.
+* Loads the result as the process-wide **engine core** (``RTLD_GLOBAL``):
+  the step wrapper and every plugin include only ``tetris.hpp`` and link
+  against these symbols instead of recompiling the engine.
 * Provides thin, typed Python wrappers so that callers can interact with
   the engine directly without touching ctypes.
 """
@@ -16,12 +20,22 @@ from __future__ import annotations
 
 import ctypes
 
+import numpy as np
+
 from .. import dynamic_library as dl
-from ..native_layout import CSRC_DIR, csrc_path
+from ..native_build import create_library
+from ..native_layout import csrc_path, layout_static_asserts
 from .state import State
 
 _ENGINE_CPP = "engine/tetris.cpp"
 _ENGINE_HPP = "engine/tetris.hpp"
+_RENDER_CPP = "engine/render.cpp"
+_RENDER_HPP = "engine/render.hpp"
+
+# Frame layout of the RGB renderer, in tiles (mirrors render.hpp).
+RENDER_ROWS = 21
+RENDER_COLS = 21
+RENDER_MAX_SCALE = 32
 
 # All functions in tetris.hpp that return ``bool`` are wrapped to return
 # ``uint8_t`` to avoid C++ ABI ambiguity over bool size.
@@ -29,11 +43,13 @@ _ENGINE_HPP = "engine/tetris.hpp"
 # instead of the platform-dependent ``size_t``.
 
 _WRAPPER_SOURCE = (
-    f'#include "{_ENGINE_CPP}"\n\n'
+    f'#include "{_ENGINE_CPP}"\n'
+    f'#include "{_RENDER_CPP}"\n\n'
     + r"""
 using namespace tetrl;
 
 API void     api_setSeed               (State* s, std::uint32_t seed, std::uint32_t garbage_seed) { setSeed(s, seed, garbage_seed); }
+API void     api_jumpPieceStream       (State* s, std::uint32_t bags) { jumpPieceStream(s, bags); }
 API void     api_reset                 (State* s) { reset(s); }
 
 API uint8_t  api_moveLeft              (State* s) { return moveLeft(s); }
@@ -52,29 +68,32 @@ API uint8_t  api_noop                  (State* s) { return noop(s); }
 API uint8_t  api_addGarbage            (State* s, std::uint8_t lines, std::uint8_t delay) { return addGarbage(s, lines, delay); }
 
 API void     api_toString              (State* s, char* buf, std::uint64_t size) { toString(s, buf, static_cast<std::size_t>(size)); }
+API void     api_renderRgb             (State* s, std::uint8_t* out, std::int32_t scale) { renderRgb(s, out, scale); }
+API void     api_renderRgbBatch        (State* s, std::uint64_t stride, std::int32_t n, std::uint8_t* out, std::int32_t scale) { renderRgbBatch(s, static_cast<std::size_t>(stride), n, out, scale); }
 
 API void     api_placeCurrentPiece     (State* s) { placeCurrentPiece(s); }
 API void     api_removeCurrentPiece    (State* s) { removeCurrentPiece(s); }
 API uint8_t  api_canPlaceCurrentPiece  (State* s) { return canPlaceCurrentPiece(s); }
 """
+    + layout_static_asserts("tetrl::State", State)
 )
 
-_lib = dl.DynamicLibrary(
-    extra_compile_flags=[
-        f"-I{CSRC_DIR}",
-        "-std=c++17",
-        "-O3",
-    ],
+_lib = create_library(
     watch_files=[
         csrc_path(_ENGINE_HPP),
         csrc_path(_ENGINE_CPP),
+        csrc_path(_RENDER_HPP),
+        csrc_path(_RENDER_CPP),
     ],
+    link_core=False,
+    global_symbols=True,
 )
 
 _lib.compile_string(
     _WRAPPER_SOURCE,
     functions={
         "api_setSeed": {"argtypes": [dl.void_p, dl.uint32, dl.uint32], "restype": dl.void},
+        "api_jumpPieceStream": {"argtypes": [dl.void_p, dl.uint32], "restype": dl.void},
         "api_reset": {"argtypes": [dl.void_p], "restype": dl.void},
         "api_moveLeft": {"argtypes": [dl.void_p], "restype": dl.uint8},
         "api_moveRight": {"argtypes": [dl.void_p], "restype": dl.uint8},
@@ -90,6 +109,8 @@ _lib.compile_string(
         "api_noop": {"argtypes": [dl.void_p], "restype": dl.uint8},
         "api_addGarbage": {"argtypes": [dl.void_p, dl.uint8, dl.uint8], "restype": dl.uint8},
         "api_toString": {"argtypes": [dl.void_p, dl.void_p, dl.uint64], "restype": dl.void},
+        "api_renderRgb": {"argtypes": [dl.void_p, dl.void_p, dl.int32], "restype": dl.void},
+        "api_renderRgbBatch": {"argtypes": [dl.void_p, dl.uint64, dl.int32, dl.void_p, dl.int32], "restype": dl.void},
         "api_placeCurrentPiece": {"argtypes": [dl.void_p], "restype": dl.void},
         "api_removeCurrentPiece": {"argtypes": [dl.void_p], "restype": dl.void},
         "api_canPlaceCurrentPiece": {"argtypes": [dl.void_p], "restype": dl.uint8},
@@ -105,6 +126,11 @@ def set_seed(state: State, seed: int, garbage_seed: int) -> None:
     _lib.api_setSeed(ctypes.addressof(state), seed, garbage_seed)
 
 
+def jump_piece_stream(state: State, bags: int) -> None:
+    """Skip *bags* 7-bags of the piece stream (e.g. to give parallel envs disjoint substreams)."""
+    _lib.api_jumpPieceStream(ctypes.addressof(state), bags)
+
+
 def reset(state: State) -> None:
     """Reset *state* to the initial game state."""
     _lib.api_reset(ctypes.addressof(state))
@@ -185,6 +211,47 @@ def to_string(state: State) -> str:
     return buf.value.decode()
 
 
+def render_shape(scale: int) -> tuple[int, int, int]:
+    """Shape ``(H, W, 3)`` of a frame rendered at *scale* pixels per cell."""
+    if not 1 <= scale <= RENDER_MAX_SCALE:
+        raise ValueError(f"scale must be in [1, {RENDER_MAX_SCALE}], got {scale}")
+    return (RENDER_ROWS * scale, RENDER_COLS * scale, 3)
+
+
+def _frame_buffer(out: np.ndarray | None, shape: tuple[int, ...]) -> np.ndarray:
+    if out is None:
+        return np.empty(shape, dtype=np.uint8)
+    if out.shape != shape or out.dtype != np.uint8 or not out.flags.c_contiguous:
+        raise ValueError(f"out must be a C-contiguous uint8 array of shape {shape}")
+    return out
+
+
+def render_rgb(state: State, scale: int = 8, out: np.ndarray | None = None) -> np.ndarray:
+    """Render *state* as an ``(H, W, 3)`` RGB frame (see :func:`render_shape`).
+
+    Board, ghost, current piece, hold, the next five pieces and the pending
+    garbage bar are drawn in one native call.  Pass a preallocated *out*
+    array to render without allocating.
+    """
+    out = _frame_buffer(out, render_shape(scale))
+    _lib.api_renderRgb(ctypes.addressof(state), out.ctypes.data, scale)
+    return out
+
+
+def render_rgb_batch(states: ctypes.Array, scale: int = 8, out: np.ndarray | None = None) -> np.ndarray:
+    """Render a ctypes array of states as ``(n, H, W, 3)`` frames in one native call.
+
+    The array elements are either :class:`State` or structures holding one
+    in a ``state`` field (such as ``StepEnvContext``).
+    """
+    element = states._type_
+    offset = 0 if element is State else element.state.offset
+    n = len(states)
+    out = _frame_buffer(out, (n, *render_shape(scale)))
+    _lib.api_renderRgbBatch(ctypes.addressof(states) + offset, ctypes.sizeof(element), n, out.ctypes.data, scale)
+    return out
+
+
 def place_current_piece(state: State) -> None:
     """Stamp the current piece onto the board (without locking)."""
     _lib.api_placeCurrentPiece(ctypes.addressof(state))
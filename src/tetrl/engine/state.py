@@ -3,6 +3,8 @@ from __future__ import annotations
 import ctypes
 import enum
 
+from ..native_layout import structured_dtype
+
 
 BOARD_HEIGHT = 32  # total rows
 BOARD_WIDTH = 16  # total columns (2-bit cells per 32-bit row)
@@ -17,7 +19,10 @@ BOARD_FLOOR = BOARD_HEIGHT - BOARD_BOTTOM - 1  # floor wall thickness
 PIECE_SPAWN_X = BOARD_LEFT + 3
 PIECE_SPAWN_Y = BOARD_TOP - 1
 
-GARBAGE_QUEUE_SIZE = 20
+GARBAGE_QUEUE_SIZE = 64  # ring-buffer capacity of the pending-garbage queue (power of two)
+
+NEXT_QUEUE_SIZE = 64  # ring-buffer capacity of the piece queue (power of two)
+NEXT_PREVIEW = 14  # minimum number of queued pieces after every fetch
 
 
 class Cell(enum.IntEnum):
@@ -56,7 +61,9 @@ class State(ctypes.Structure):
     _fields_ = [
         ("board", ctypes.c_uint32 * BOARD_HEIGHT),
         ("is_alive", ctypes.c_uint8),
-        ("next", ctypes.c_int8 * 14),
+        ("next", ctypes.c_int8 * NEXT_QUEUE_SIZE),
+        ("next_head", ctypes.c_uint8),
+        ("next_count", ctypes.c_uint8),
         ("hold", ctypes.c_int8),
         ("has_held", ctypes.c_uint8),
         ("current", ctypes.c_int8),
@@ -64,6 +71,7 @@ class State(ctypes.Structure):
         ("x", ctypes.c_int8),
         ("y", ctypes.c_int8),
         ("seed", ctypes.c_uint32),
+        ("bag_index", ctypes.c_uint32),
         ("srs_index", ctypes.c_int8),
         ("piece_count", ctypes.c_uint32),
         ("was_last_rotation", ctypes.c_uint8),
@@ -78,16 +86,43 @@ class State(ctypes.Structure):
         ("total_attack", ctypes.c_uint32),
         ("total_lines_sent", ctypes.c_uint32),
         ("garbage_seed", ctypes.c_uint32),
-        ("garbage_queue", ctypes.c_uint8 * GARBAGE_QUEUE_SIZE),
-        ("garbage_delay", ctypes.c_uint8 * GARBAGE_QUEUE_SIZE),
+        ("garbage_arrival", ctypes.c_uint32 * GARBAGE_QUEUE_SIZE),
+        ("garbage_lines", ctypes.c_uint8 * GARBAGE_QUEUE_SIZE),
+        ("garbage_head", ctypes.c_uint8),
+        ("garbage_count", ctypes.c_uint8),
         ("max_garbage_spawn", ctypes.c_uint8),
         ("garbage_blocking", ctypes.c_uint8),
+        ("garbage_capacity", ctypes.c_uint8),
     ]
 
     def __init__(self, **kwargs):
         kwargs.setdefault("max_garbage_spawn", 6)
         kwargs.setdefault("garbage_blocking", True)
+        kwargs.setdefault("garbage_capacity", GARBAGE_QUEUE_SIZE)
         super().__init__(**kwargs)
 
+    def peek_next(self, index: int) -> PieceType:
+        """Return the *index*-th upcoming piece (``0`` = next) from the ring-buffered queue."""
+        if not 0 <= index < self.next_count:
+            raise IndexError(f"next queue index {index} out of range (queued: {self.next_count})")
+        return PieceType(self.next[(self.next_head + index) & (NEXT_QUEUE_SIZE - 1)])
+
+    def peek_garbage(self, index: int) -> tuple[int, int]:
+        """Return ``(lines, delay)`` of the *index*-th pending garbage entry (``0`` = earliest arrival)."""
+        if not 0 <= index < self.garbage_count:
+            raise IndexError(f"garbage queue index {index} out of range (pending: {self.garbage_count})")
+        slot = (self.garbage_head + index) & (GARBAGE_QUEUE_SIZE - 1)
+        delay = ((self.garbage_arrival[slot] - self.piece_count + 2**31) % 2**32) - 2**31
+        return self.garbage_lines[slot], max(delay, 0)
+
+    @property
+    def pending_garbage(self) -> int:
+        """Total number of pending garbage lines."""
+        return sum(self.peek_garbage(i)[0] for i in range(self.garbage_count))
+
+
+# Zero-copy numpy view of ``State`` arrays: ``np.frombuffer((State * n)(), dtype=STATE_DTYPE)``.
+STATE_DTYPE = structured_dtype(State)
+
 
 # TODO: add ops
@@ -1,39 +1,82 @@
 from .native import (
+    CONTEXT_DTYPE,
+    INFO_DTYPE,
     Action,
     N_ACTIONS,
     StepEnvConfig,
     StepEnvContext,
     StepInfo,
+    env_action_mask,
     env_reset,
     env_set_config,
     env_set_seed,
     env_step,
+    env_step_batch,
+    env_step_sequence,
+    vector_reset,
+    vector_step,
 )
 from .feature import CppFeature, FeaturePlugin
 from .reward import CppReward, RewardPlugin
+from .fused import CppFusedPlugins
 from .env import StepEnv
-from .defaults import default_feature, default_reward
+from .vector import StepVectorEnv
+from .checkpoint import CheckpointError
+from .telemetry import GameTelemetry, telemetry_bin_edges
+from .start_states import StartStatePool
+from .replay import ReplayBatch, ReplayBuffer
+from .returns import compute_gae, compute_n_step_returns
+from .battle import BATTLE_TARGETING, BattleRoom
+from .defaults import FeatureSpec, default_feature, default_fused_plugins, default_reward
 
 __all__ = [
     # binding
     "Action",
+    "CONTEXT_DTYPE",
+    "INFO_DTYPE",
     "N_ACTIONS",
     "StepEnvConfig",
     "StepEnvContext",
     "StepInfo",
+    "env_action_mask",
     "env_reset",
     "env_set_config",
     "env_set_seed",
     "env_step",
+    "env_step_batch",
+    "env_step_sequence",
+    "vector_reset",
+    "vector_step",
     # feature
     "FeaturePlugin",
     "CppFeature",
     # reward
     "RewardPlugin",
     "CppReward",
+    # fused
+    "CppFusedPlugins",
     # env
     "StepEnv",
+    "StepVectorEnv",
+    # checkpoint
+    "CheckpointError",
+    # telemetry
+    "GameTelemetry",
+    "telemetry_bin_edges",
+    # start states
+    "StartStatePool",
+    # replay
+    "ReplayBatch",
+    "ReplayBuffer",
+    # returns
+    "compute_gae",
+    "compute_n_step_returns",
+    # battle
+    "BATTLE_TARGETING",
+    "BattleRoom",
     # defaults
+    "FeatureSpec",
     "default_feature",
     "default_reward",
+    "default_fused_plugins",
 ]
@@ -0,0 +1,43 @@
+"""Source prelude and watched headers shared by the JIT-compiled step-env plugins."""
+
+from __future__ import annotations
+
+import re
+from pathlib import Path
+from typing import List
+
+from ...native_layout import csrc_path
+
+__all__ = ["PLUGIN_HEADERS", "PLUGIN_PRELUDE", "defines_function", "plugin_watch_files"]
+
+# Headers every feature / reward plugin is compiled against.
+PLUGIN_HEADERS = ("engine/tetris.hpp", "envs/step/step.hpp", "envs/step/plugin.hpp", "envs/step/analysis.hpp")
+
+# Standard headers that used to come with the engine source; kept so plugin
+# code that relies on them still compiles against the header-only prelude.
+PLUGIN_PRELUDE = (
+    "#include <cstdio>\n#include <cstring>\n#include <cstdlib>\n#include <cmath>\n"
+    "#include <algorithm>\n#include <utility>\n#include <limits>\n"
+    + "".join(f'#include "{header}"\n' for header in PLUGIN_HEADERS)
+    + "\nusing namespace tetrl;\nusing namespace tetrl::envs::step;\n\n"
+)
+
+
+def plugin_watch_files() -> List[Path]:
+    """Absolute paths of :data:`PLUGIN_HEADERS`, for a plugin library's ``watch_files``."""
+    return [csrc_path(header) for header in PLUGIN_HEADERS]
+
+
+# Comments and string / character literals, which may mention entry point names.
+_NON_CODE = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\\n])*"|\'(?:\\.|[^\'\\\n])*\'', re.DOTALL)
+
+
+def defines_function(source: str, name: str) -> bool:
+    """Whether the C++ *source* defines a function *name* (a signature followed by a body).
+
+    The name must follow a return type.  Mentions in comments or strings,
+    declarations and calls do not count,
+    so optional entry points get their default exactly when they are missing.
+    """
+    code = _NON_CODE.sub(" ", source)
+    return re.search(rf"[\w>][\s*&]+{re.escape(name)}\s*\([^;{{}}]*\)\s*(?:noexcept\s*)?\{{", code) is not None
@@ -0,0 +1,210 @@
+"""
+Native battle rooms: many step-env games of one multiplayer match.
+
+A :class:`BattleRoom` holds the games of N players and steps all of them
+in one native call per tick (see ``battle.hpp``).  The garbage a player
+sends is routed inside that call to an opponent picked by the player's
+targeting strategy (:data:`BATTLE_TARGETING`) and queued in the
+opponent's garbage queue, where it cancels, blocks and spawns under the
+usual engine rules.  Players whose game ends are eliminated and ranked,
+and the opponent whose garbage reached them last is credited with the KO.
+
+Examples
+--------
+>>> room = BattleRoom(100, targeting="ko", seed=0)
+>>> room.reset()
+>>> while not room.done:
+...     room.step(policy(room.contexts))  # [100] uint8 actions
+>>> room.places  # 1 = winner
+"""
+
+from __future__ import annotations
+
+import ctypes
+from typing import Any, Sequence
+
+import numpy as np
+
+from ...native_layout import structured_dtype
+from .native import (
+    BATTLE_TARGETING,
+    CONTEXT_DTYPE,
+    BattleOptions,
+    BattlePlayer,
+    BattleRoomState,
+    StepEnvConfig,
+    StepEnvContext,
+    StepInfo,
+    battle_reset,
+    battle_step,
+)
+
+__all__ = ["BATTLE_TARGETING", "BattleRoom"]
+
+_PLAYER_DTYPE = structured_dtype(BattlePlayer)
+
+
+def _strategy(targeting: str | int) -> int:
+    if isinstance(targeting, str):
+        if targeting not in BATTLE_TARGETING:
+            raise ValueError(f"unknown targeting {targeting!r}, expected one of {BATTLE_TARGETING}")
+        return BATTLE_TARGETING.index(targeting)
+    if not 0 <= targeting < len(BATTLE_TARGETING):
+        raise ValueError(f"targeting must be in [0, {len(BATTLE_TARGETING)}), got {targeting}")
+    return int(targeting)
+
+
+class BattleRoom:
+    """N-player match stepped and routed natively.
+
+    Parameters
+    ----------
+    players:
+        Number of games in the room (at least 2).
+    targeting:
+        Strategy of every player, or one per player: ``"random"`` (a random
+        opponent per attack), ``"attackers"`` (whoever attacked the player
+        last), ``"ko"`` (the opponent with the most pending garbage, then
+        the highest stack) or ``"badges"`` (the opponent with the most
+        KOs).  Change it during a match with :meth:`set_targeting`.
+    garbage_delay:
+        Locks of the receiver before routed garbage is due.
+    same_pieces:
+        Give every player the same piece sequence (garbage holes still
+        differ).
+    threads:
+        Threads the step phase is split over.  A tick of 100 players takes
+        microseconds, so more threads only pay off for very large rooms.
+    seed:
+        Seed of the piece, garbage and targeting streams; match ``k`` of a
+        room is a pure function of the seed, ``k`` and the actions.
+    config:
+        Step-env rules of every game.
+    """
+
+    def __init__(
+        self,
+        players: int,
+        *,
+        targeting: str | int | Sequence[str | int] = "random",
+        garbage_delay: int = 0,
+        same_pieces: bool = True,
+        threads: int = 1,
+        seed: int = 0,
+        config: StepEnvConfig | None = None,
+    ) -> None:
+        if players < 2:
+            raise ValueError(f"a battle needs at least 2 players, got {players}")
+        self._contexts = (StepEnvContext * players)()
+        self._players = (BattlePlayer * players)()
+        self._infos = (StepInfo * players)()
+        self._room = BattleRoomState(
+            contexts=ctypes.addressof(self._contexts),
+            players=ctypes.addressof(self._players),
+            size=players,
+            options=BattleOptions(
+                seed=seed & (2**64 - 1),
+                garbage_delay=max(0, min(255, garbage_delay)),
+                same_pieces=int(same_pieces),
+                threads=max(1, min(255, threads)),
+                config=config if config is not None else StepEnvConfig(),
+            ),
+        )
+        self._view = np.frombuffer(self._players, dtype=_PLAYER_DTYPE)
+        self._context_view = np.frombuffer(self._contexts, dtype=CONTEXT_DTYPE)
+        strategies = [targeting] * players if isinstance(targeting, (str, int)) else list(targeting)
+        if len(strategies) != players:
+            raise ValueError(f"expected {players} targeting strategies, got {len(strategies)}")
+        self._view["strategy"] = [_strategy(t) for t in strategies]
+        battle_reset(self._room)
+
+    def __len__(self) -> int:
+        return self._room.size
+
+    def reset(self, seed: int | None = None) -> None:
+        """Start the next match (restarting the match counter when *seed* is given)."""
+        if seed is not None:
+            self._room.options.seed = seed & (2**64 - 1)
+            self._room.match = 0
+        battle_reset(self._room)
+
+    def step(self, actions: Any) -> int:
+        """Step every live player with its action, route garbage, eliminate; return the players left.
+
+        Eliminated players ignore their action.  Stepping a finished match
+        does nothing.
+        """
+        a = np.ascontiguousarray(actions, dtype=np.uint8).reshape(-1)
+        return battle_step(self._room, a, self._infos)
+
+    def set_targeting(self, player: int, targeting: str | int) -> None:
+        """Switch the strategy of *player*; it applies from the next attack on."""
+        if not 0 <= player < len(self):
+            raise IndexError(f"player {player} out of range for {len(self)} players")
+        self._players[player].strategy = _strategy(targeting)
+
+    @property
+    def contexts(self) -> "ctypes.Array[StepEnvContext]":
+        """The players' step-env contexts, accepted by every native search helper."""
+        return self._contexts
+
+    @property
+    def context_view(self) -> np.ndarray:
+        """Zero-copy structured view of :attr:`contexts`, e.g. ``room.context_view["state"]["lines_sent"]``."""
+        return self._context_view
+
+    @property
+    def infos(self) -> "ctypes.Array[StepInfo]":
+        """``StepInfo`` of every player from the last tick (zeroed for eliminated players)."""
+        return self._infos
+
+    @property
+    def players(self) -> np.ndarray:
+        """Structured view of the native ``BattlePlayer`` array (live, not a copy)."""
+        return self._view
+
+    @property
+    def alive(self) -> np.ndarray:
+        """Players still in the match."""
+        return self._view["alive"].astype(bool)
+
+    @property
+    def places(self) -> np.ndarray:
+        """Final place of every player (1 = winner; 0 while still playing)."""
+        return self._view["place"].copy()
+
+    @property
+    def kos(self) -> np.ndarray:
+        return self._view["kos"].copy()
+
+    @property
+    def sent(self) -> np.ndarray:
+        """Garbage lines each player queued on its target in the last tick (lines a saturated queue dropped excluded)."""
+        return self._view["sent"].copy()
+
+    @property
+    def received(self) -> np.ndarray:
+        """Garbage lines routed to each player this match."""
+        return self._view["received"].copy()
+
+    @property
+    def targets(self) -> np.ndarray:
+        """Opponent of each player's last attack (-1 before the first)."""
+        return self._view["target"].copy()
+
+    @property
+    def players_left(self) -> int:
+        return self._room.alive
+
+    @property
+    def tick(self) -> int:
+        """Ticks of the running match."""
+        return self._room.tick
+
+    @property
+    def done(self) -> bool:
+        """Whether at most one player is left."""
+        return self._room.alive <= 1
+
+    def __repr__(self) -> str:
+        return f"BattleRoom(players={len(self)}, left={self.players_left}, tick={self.tick})"
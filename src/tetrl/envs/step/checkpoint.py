@@ -0,0 +1,127 @@
+"""
+Whole-pool checkpoint files for :class:`~tetrl.envs.step.vector.StepVectorEnv`.
+
+A checkpoint holds every engine ``Context``, both plugins' opaque contexts,
+the last ``Info`` row, the step and episode counters, the base seed and,
+optionally, the current observations of an env pool, in the layout
+documented in ``checkpoint.hpp``.  Files are written through one mapping
+of a temporary file (sections copied in, ``msync``, ``fsync``) and then
+renamed over the target, so a preempted writer never leaves a torn
+checkpoint behind.  Reading maps the file copy-on-write and validates its
+header; the env then runs directly on the mapped sections, so resuming
+costs no per-env work and pages are only read as envs touch them.
+
+Examples
+--------
+>>> envs = StepVectorEnv(10_000)
+>>> envs.reset(seed=0)
+>>> ...
+>>> envs.save_checkpoint("pool.ckpt")
+>>>
+>>> envs = StepVectorEnv(10_000)  # after a restart, with the same plugins
+>>> observations, infos = envs.load_checkpoint("pool.ckpt")
+"""
+
+from __future__ import annotations
+
+import ctypes
+import mmap
+import os
+from pathlib import Path
+from typing import Dict
+
+from .native import (
+    CHECKPOINT_ALIGN,
+    CHECKPOINT_MAGIC,
+    CHECKPOINT_SECTIONS,
+    CHECKPOINT_VERSION,
+    CheckpointHeader,
+    context_layout_hash,
+)
+
+__all__ = ["CheckpointError", "map_checkpoint", "write_checkpoint"]
+
+
+class CheckpointError(ValueError):
+    """The file is not a checkpoint this build and env pool can resume from."""
+
+
+def _align(n: int) -> int:
+    return (n + CHECKPOINT_ALIGN - 1) // CHECKPOINT_ALIGN * CHECKPOINT_ALIGN
+
+
+def _address(buffer: memoryview) -> int:
+    return ctypes.addressof(ctypes.c_char.from_buffer(buffer)) if buffer.nbytes else 0
+
+
+def write_checkpoint(path: str | os.PathLike, header: CheckpointHeader, sections: Dict[str, memoryview]) -> int:
+    """Write *header* and the named *sections* to *path*; return the file size.
+
+    The layout, version, offsets and file size of *header* are filled in
+    here; sections not in *sections* are recorded as absent.
+    """
+    path = Path(path)
+    offset = _align(ctypes.sizeof(CheckpointHeader))
+    for i, name in enumerate(CHECKPOINT_SECTIONS):
+        if name in sections:
+            header.offsets[i] = offset
+            offset = _align(offset + sections[name].nbytes)
+        else:
+            header.offsets[i] = 0
+    header.magic = CHECKPOINT_MAGIC
+    header.version = CHECKPOINT_VERSION
+    header.header_size = ctypes.sizeof(CheckpointHeader)
+    header.layout = context_layout_hash()
+    header.file_size = offset
+
+    path.parent.mkdir(parents=True, exist_ok=True)
+    staging = path.with_name(f".{path.name}.{os.getpid()}.tmp")
+    fd = os.open(staging, os.O_RDWR | os.O_CREAT | os.O_TRUNC, 0o644)
+    try:
+        os.ftruncate(fd, offset)
+        with mmap.mmap(fd, offset) as mm:
+            anchor = ctypes.c_char.from_buffer(mm)
+            base = ctypes.addressof(anchor)
+            ctypes.memmove(base, ctypes.addressof(header), ctypes.sizeof(header))
+            for i, name in enumerate(CHECKPOINT_SECTIONS):
+                if name in sections and sections[name].nbytes:
+                    ctypes.memmove(base + header.offsets[i], _address(sections[name]), sections[name].nbytes)
+            del anchor  # the mapping cannot be closed while exported
+            mm.flush()
+        os.fsync(fd)
+    except BaseException:
+        os.close(fd)
+        staging.unlink(missing_ok=True)
+        raise
+    os.close(fd)
+    os.replace(staging, path)
+    return offset
+
+
+def map_checkpoint(path: str | os.PathLike) -> tuple[CheckpointHeader, mmap.mmap]:
+    """Map *path* copy-on-write and return its validated header and the mapping.
+
+    Writes through the mapping stay private to this process.  Raises
+    :class:`CheckpointError` if the file is not a complete checkpoint of
+    this format version written by a build with the same ``Context`` /
+    ``Info`` layout.
+    """
+    with open(path, "rb") as f:
+        size = os.fstat(f.fileno()).st_size
+        if size < ctypes.sizeof(CheckpointHeader):
+            raise CheckpointError(f"{path}: too short for a checkpoint header")
+        mm = mmap.mmap(f.fileno(), size, access=mmap.ACCESS_COPY)
+    header = CheckpointHeader.from_buffer_copy(mm)
+    try:
+        if header.magic != CHECKPOINT_MAGIC:
+            raise CheckpointError(f"{path}: not an env-pool checkpoint")
+        if header.version != CHECKPOINT_VERSION or header.header_size != ctypes.sizeof(CheckpointHeader):
+            raise CheckpointError(f"{path}: checkpoint version {header.version}, expected {CHECKPOINT_VERSION}")
+        if header.layout != context_layout_hash():
+            raise CheckpointError(f"{path}: written by a build with a different Context/Info layout")
+        if header.file_size != size:
+            raise CheckpointError(f"{path}: truncated ({size} of {header.file_size} bytes)")
+    except CheckpointError:
+        mm.close()
+        raise
+    return header, mm
@@ -8,7 +8,7 @@ and by the ``tetrl/Step-v0`` gymnasium registration.
 
 Default feature -- ``default_feature()``
 --------------------------------------
-66-channel image with shape ``(66, 20, 10)`` (``float32``).
+By default a 66-channel image with shape ``(66, 20, 10)`` (``float32``).
  0 - 3   Frame history (4 snapshots; newest includes the active piece,
          reset bootstrap frames may be board-only)
  4       Board top mask
@@ -27,6 +27,15 @@ Default feature -- ``default_feature()``
 
 All values in ``[0, 1]``.
 
+``default_feature(FeatureSpec(...))`` keeps a subset of these channels
+(fewer history frames, a shorter next-queue preview, any masks or planes
+switched off), in the same order; the plugin is generated with
+``constexpr`` channel flags, so disabled channels are never computed, and
+its observation space has ``spec.num_channels`` planes.
+
+``default_fused_plugins()`` compiles both defaults into one library; its
+feature and reward share the per-step hole and ghost analysis.
+
 Default reward -- ``default_reward()``
 --------------------------------------
 Lock-based reward with direct attack incentive:
@@ -42,47 +51,141 @@ Lock-based reward with direct attack incentive:
 
 from __future__ import annotations
 
+from dataclasses import dataclass
+from typing import Any, Dict, List, Tuple
+
 import numpy as np
 
 from .feature import CppFeature
+from .fused import CppFusedPlugins
 from .reward import CppReward
 
-# Feature - 66-channel 20x10 image
-_NUM_CHANNELS = 66
+# Feature - configurable image, 66 channels of 20x10 by default
 _ROWS = 20
 _COLS = 10
-
-_DEFAULT_FEATURE_SRC = r"""
+_MAX_NEXT = 14  # NEXT_PREVIEW: pieces always queued
+
+
+@dataclass(frozen=True)
+class FeatureSpec:
+    """Channels of the default feature, in observation order.
+
+    Disabled channels are compiled out of the generated plugin (the flags
+    are ``constexpr``), so they cost nothing and the observation shrinks
+    to :attr:`num_channels` planes.  ``FeatureSpec()`` is the 66-channel
+    default.
+
+    Parameters
+    ----------
+    frames:
+        Board snapshots of the frame history (``0`` disables it).
+    top, holes:
+        Board top and holes masks.
+    piece, orientation, piece_type:
+        Current piece on an empty board, its orientation (4 one-hot
+        planes) and type (7 one-hot planes).
+    hold:
+        Hold type (7 one-hot planes) and the has-held flag.
+    next:
+        Preview depth; 7 one-hot planes per queued piece (at most 14).
+    lifetime, shadow, garbage, back_to_back, combo:
+        The scalar and per-row planes described in the module docstring.
+    """
+
+    frames: int = 4
+    top: bool = True
+    holes: bool = True
+    piece: bool = True
+    orientation: bool = True
+    piece_type: bool = True
+    hold: bool = True
+    next: int = 5
+    lifetime: bool = True
+    shadow: bool = True
+    garbage: bool = True
+    back_to_back: bool = True
+    combo: bool = True
+
+    def __post_init__(self) -> None:
+        if self.frames < 0:
+            raise ValueError(f"frames must be non-negative, got {self.frames}")
+        if not 0 <= self.next <= _MAX_NEXT:
+            raise ValueError(f"next must be in [0, {_MAX_NEXT}], got {self.next}")
+        if not self.channels:
+            raise ValueError("FeatureSpec enables no channels")
+
+    @property
+    def channels(self) -> List[str]:
+        """Name of every channel, in observation order."""
+        names = [f"frame_{i}" for i in range(self.frames)]
+        names += [name for name, on in (("top", self.top), ("holes", self.holes), ("piece", self.piece)) if on]
+        if self.orientation:
+            names += [f"orientation_{i}" for i in range(4)]
+        if self.piece_type:
+            names += [f"piece_{t}" for t in "ZLOSIJT"]
+        if self.hold:
+            names += [f"hold_{t}" for t in "ZLOSIJT"] + ["has_held"]
+        names += [f"next_{i}_{t}" for i in range(self.next) for t in "ZLOSIJT"]
+        scalars = ("lifetime", "shadow", "garbage", "back_to_back", "combo")
+        names += [name for name in scalars if getattr(self, name)]
+        return names
+
+    @property
+    def num_channels(self) -> int:
+        return len(self.channels)
+
+    @property
+    def shape(self) -> Tuple[int, int, int]:
+        return (self.num_channels, _ROWS, _COLS)
+
+    def source(self) -> str:
+        """C++ source of the feature plugin specialised to this spec."""
+        header = (
+            f"static constexpr int  N_FRAMES      = {self.frames};\n"
+            f"static constexpr bool TOP_MASK      = {_cpp_bool(self.top)};\n"
+            f"static constexpr bool HOLES_MASK    = {_cpp_bool(self.holes)};\n"
+            f"static constexpr bool CURRENT_PIECE = {_cpp_bool(self.piece)};\n"
+            f"static constexpr bool ORIENTATION   = {_cpp_bool(self.orientation)};\n"
+            f"static constexpr bool CURRENT_TYPE  = {_cpp_bool(self.piece_type)};\n"
+            f"static constexpr bool HOLD          = {_cpp_bool(self.hold)};\n"
+            f"static constexpr int  N_NEXT        = {self.next};\n"
+            f"static constexpr bool LIFETIME      = {_cpp_bool(self.lifetime)};\n"
+            f"static constexpr bool SHADOW        = {_cpp_bool(self.shadow)};\n"
+            f"static constexpr bool GARBAGE       = {_cpp_bool(self.garbage)};\n"
+            f"static constexpr bool BACK_TO_BACK  = {_cpp_bool(self.back_to_back)};\n"
+            f"static constexpr bool COMBO         = {_cpp_bool(self.combo)};\n"
+        )
+        return _FEATURE_SRC_PREFIX + header + _FEATURE_SRC
+
+
+def _cpp_bool(value: bool) -> str:
+    return "true" if value else "false"
+
+
+_FEATURE_SRC_PREFIX = r"""
 #include <algorithm>
 using namespace ops;
 
+"""
+
+# Compiled after the constexpr channel flags of FeatureSpec.source().
+_FEATURE_SRC = r"""
 static constexpr int ROWS       = BOARD_BOTTOM - BOARD_TOP  + 1; // 20
 static constexpr int COLS       = BOARD_RIGHT  - BOARD_LEFT + 1; // 10
 static constexpr int CH         = ROWS * COLS;                   // 200
-static constexpr int N_FRAMES   = 4;
 static constexpr int N_ROTS     = 4;
 static constexpr int N_TYPES    = 7;
-static constexpr int N_NEXT     = 5;
 static constexpr int N_CHANNELS =
-    N_FRAMES + 1 + 1 + 1 + N_ROTS + N_TYPES + N_TYPES + 1
-    + N_NEXT * N_TYPES + 1 + 1 + 1 + 1 + 1;                     // 66
-static constexpr int FEATURE_SIZE = N_CHANNELS * CH;            // 13200
+    N_FRAMES + TOP_MASK + HOLES_MASK + CURRENT_PIECE + (ORIENTATION ? N_ROTS : 0)
+    + (CURRENT_TYPE ? N_TYPES : 0) + (HOLD ? N_TYPES + 1 : 0) + N_NEXT * N_TYPES
+    + LIFETIME + SHADOW + GARBAGE + BACK_TO_BACK + COMBO;
+static constexpr int FEATURE_SIZE = N_CHANNELS * CH;
 static constexpr int VIS_TOP = BOARD_TOP;
 
 struct FeatureContext {
-    float frames[N_FRAMES][CH];
+    float frames[N_FRAMES > 0 ? N_FRAMES : 1][CH];
 };
 
-static float ones_buf[CH];
-static bool  g_init = false;
-
-static void ensure_init() {
-    if (!g_init) {
-        for (int i = 0; i < CH; ++i) ones_buf[i] = 1.0f;
-        g_init = true;
-    }
-}
-
 inline void board_to_channel(const Board& board, float* ch) {
     for (int r = VIS_TOP; r <= BOARD_BOTTOM; ++r)
         for (int c = 0; c < COLS; ++c)
@@ -90,30 +193,34 @@ inline void board_to_channel(const Board& board, float* ch) {
                 (getCell(board, BOARD_LEFT + c, r) != Cell::EMPTY) ? 1.0f : 0.0f;
 }
 
-inline void fill_ones(float* ch)  { std::memcpy(ch, ones_buf, sizeof(float) * CH); }
-inline void fill_zeros(float* ch) { std::memset(ch, 0, sizeof(float) * CH); }
+inline void fill_ones(float* ch)  { std::fill_n(ch, CH, 1.0f); }
+inline void fill_zeros(float* ch) { std::fill_n(ch, CH, 0.0f); }
 
 inline void fill_value(float* ch, float v) {
     for (int i = 0; i < CH; ++i) ch[i] = v;
 }
 
-inline void make_board_features(State* s, float* top, float* holes) {
-    int col_hit[COLS] = {};
-    for (int r = VIS_TOP; r <= BOARD_BOTTOM; ++r)
+// Top mask then holes mask, whichever are enabled.
+inline void make_board_features(State* s, float* ch) {
+    BoardAnalysis scratch;
+    const BoardAnalysis& a = boardAnalysis(s, &scratch);
+    float* top   = ch;
+    float* holes = ch + (TOP_MASK ? CH : 0);
+    for (int r = 0; r < ROWS; ++r)
         for (int c = 0; c < COLS; ++c) {
-            bool occupied = (getCell(s->board, BOARD_LEFT + c, r) != Cell::EMPTY);
-            col_hit[c] |= occupied ? 1 : 0;
-            int idx = (r - VIS_TOP) * COLS + c;
-            top[idx]   = static_cast<float>(col_hit[c] != 0);
-            holes[idx] = static_cast<float>(!occupied && col_hit[c] != 0);
+            const Row cell = shift(static_cast<Row>(Cell::BLOCK), BOARD_LEFT + c);
+            if constexpr (TOP_MASK)   top[r * COLS + c]   = static_cast<float>((a.top[r] & cell) != 0);
+            if constexpr (HOLES_MASK) holes[r * COLS + c] = static_cast<float>((a.holes[r] & cell) != 0);
         }
 }
 
-inline void make_current_piece(State* s, float* piece_ch, float* rot_ch) {
+inline void make_current_piece(State* s, float* ch) {
     Board tmp = {};
     placePiece(tmp, getPiece(s->current, s->orientation), s->x, s->y);
-    board_to_channel(tmp, piece_ch);
+    board_to_channel(tmp, ch);
+}
 
+inline void make_orientation(State* s, float* rot_ch) {
     for (int i = 0; i < N_ROTS; ++i) {
         float* ch = rot_ch + i * CH;
         if (i == s->orientation) fill_ones(ch);
@@ -132,21 +239,17 @@ inline void piece_type_one_hot(float* ch, PieceType type) {
 }
 
 inline void make_shadow(State* s, float* ch) {
-    State tmp;
-    std::memcpy(&tmp, s, sizeof(State));
-    while (softDrop(&tmp)) {}
-    std::memset(tmp.board.data, 0, sizeof(tmp.board.data));
-    placeCurrentPiece(&tmp);
-    board_to_channel(tmp.board, ch);
+    Board tmp = {};
+    placePiece(tmp, getPiece(s->current, s->orientation), s->x, sharedGhostY(s));
+    board_to_channel(tmp, ch);
 }
 
 inline void make_garbage(State* s, float* ch) {
     fill_zeros(ch);
     int row = ROWS - 1;
-    for (int i = 0; i < GARBAGE_QUEUE_SIZE && row >= 0; ++i) {
-        if (s->garbage_queue[i] == 0) break;
-        int length = s->garbage_queue[i];
-        int delay  = s->garbage_delay[i];
+    for (int i = 0; i < s->garbage_count && row >= 0; ++i) {
+        int length = peekGarbageLines(s, i);
+        int delay  = peekGarbageDelay(s, i);
         int raw    = 10 - delay;
         if (raw < 1) raw = 1;
         float val  = static_cast<float>(raw) / 10.0f;
@@ -157,101 +260,133 @@ inline void make_garbage(State* s, float* ch) {
 }
 
 inline void compute(Context* env_ctx, FeatureContext* feature_ctx, float* out) {
-    ensure_init();
     State* s = &env_ctx->state;
     float* p = out;
 
-    std::memcpy(p, feature_ctx->frames, sizeof(float) * N_FRAMES * CH);
-    p += N_FRAMES * CH;
+    if constexpr (N_FRAMES > 0) {
+        std::memcpy(p, feature_ctx->frames, sizeof(float) * N_FRAMES * CH);
+        p += N_FRAMES * CH;
+    }
+
+    if constexpr (TOP_MASK || HOLES_MASK) {
+        make_board_features(s, p);
+        p += (TOP_MASK + HOLES_MASK) * CH;
+    }
 
-    make_board_features(s, p, p + CH);
-    p += 2 * CH;
+    if constexpr (CURRENT_PIECE) {
+        make_current_piece(s, p);
+        p += CH;
+    }
 
-    make_current_piece(s, p, p + CH);
-    p += (1 + N_ROTS) * CH;
+    if constexpr (ORIENTATION) {
+        make_orientation(s, p);
+        p += N_ROTS * CH;
+    }
 
-    piece_type_one_hot(p, s->current);
-    p += N_TYPES * CH;
+    if constexpr (CURRENT_TYPE) {
+        piece_type_one_hot(p, s->current);
+        p += N_TYPES * CH;
+    }
 
-    piece_type_one_hot(p, s->hold);
-    p += N_TYPES * CH;
+    if constexpr (HOLD) {
+        piece_type_one_hot(p, s->hold);
+        p += N_TYPES * CH;
 
-    if (s->has_held) fill_ones(p); else fill_zeros(p);
-    p += CH;
+        if (s->has_held) fill_ones(p); else fill_zeros(p);
+        p += CH;
+    }
 
     for (int i = 0; i < N_NEXT; ++i) {
-        piece_type_one_hot(p, s->next[i]);
+        piece_type_one_hot(p, peekNext(s, i));
         p += N_TYPES * CH;
     }
 
-    float lt = (env_ctx->lifetime - 1 < 10)
-             ? static_cast<float>(env_ctx->lifetime - 1) / 10.0f
-             : 1.0f;
-    fill_value(p, lt);
-    p += CH;
+    if constexpr (LIFETIME) {
+        float lt = (env_ctx->lifetime - 1 < 10)
+                 ? static_cast<float>(env_ctx->lifetime - 1) / 10.0f
+                 : 1.0f;
+        fill_value(p, lt);
+        p += CH;
+    }
 
-    make_shadow(s, p);
-    p += CH;
+    if constexpr (SHADOW) {
+        make_shadow(s, p);
+        p += CH;
+    }
 
-    make_garbage(s, p);
-    p += CH;
+    if constexpr (GARBAGE) {
+        make_garbage(s, p);
+        p += CH;
+    }
 
-    float b2b_val = (s->back_to_back_count > 0) ? 1.0f : 0.0f;
-    fill_value(p, b2b_val);
-    p += CH;
+    if constexpr (BACK_TO_BACK) {
+        float b2b_val = (s->back_to_back_count > 0) ? 1.0f : 0.0f;
+        fill_value(p, b2b_val);
+        p += CH;
+    }
 
-    float combo_val = std::clamp(static_cast<float>(s->combo_count) / 12.0f, 0.0f, 1.0f);
-    fill_value(p, combo_val);
+    if constexpr (COMBO) {
+        float combo_val = std::clamp(static_cast<float>(s->combo_count) / 12.0f, 0.0f, 1.0f);
+        fill_value(p, combo_val);
+    }
 }
 
-API int  feature_context_size() { return static_cast<int>(sizeof(FeatureContext)); }
+API int  feature_context_size() { return N_FRAMES > 0 ? static_cast<int>(sizeof(FeatureContext)) : 0; }
 API int  feature_size()         { return FEATURE_SIZE; }
 
 API void feature_reset(Context* env_ctx, void* plugin_ctx) {
-    ensure_init();
-    State* s = &env_ctx->state;
-    auto* feature_ctx = static_cast<FeatureContext*>(plugin_ctx);
-    for (int i = 0; i < N_FRAMES; ++i)
-        board_to_channel(s->board, feature_ctx->frames[i]);
+    if constexpr (N_FRAMES > 0) {
+        State* s = &env_ctx->state;
+        auto* feature_ctx = static_cast<FeatureContext*>(plugin_ctx);
+        for (int i = 0; i < N_FRAMES; ++i)
+            board_to_channel(s->board, feature_ctx->frames[i]);
+    }
 }
 
 API void feature_step(Context* env_ctx, Info*, void* plugin_ctx, float* out) {
-    State* s = &env_ctx->state;
     auto* feature_ctx = static_cast<FeatureContext*>(plugin_ctx);
 
-    placeCurrentPiece(s);
-    for (int i = N_FRAMES - 2; i >= 0; --i)
-        std::memcpy(feature_ctx->frames[i + 1], feature_ctx->frames[i], sizeof(float) * CH);
-    board_to_channel(s->board, feature_ctx->frames[0]);
-    removeCurrentPiece(s);
+    if constexpr (N_FRAMES > 0) {
+        State* s = &env_ctx->state;
+        placeCurrentPiece(s);
+        for (int i = N_FRAMES - 2; i >= 0; --i)
+            std::memcpy(feature_ctx->frames[i + 1], feature_ctx->frames[i], sizeof(float) * CH);
+        board_to_channel(s->board, feature_ctx->frames[0]);
+        removeCurrentPiece(s);
+    }
 
     compute(env_ctx, feature_ctx, out);
 }
 """
 
 
-def default_feature() -> CppFeature:
-    """Create the default 66-channel image feature plugin."""
+def _observation_kwargs(spec: FeatureSpec) -> Dict[str, Any]:
     import gymnasium
 
-    return CppFeature(
-        _DEFAULT_FEATURE_SRC,
-        observation_space=gymnasium.spaces.Box(
-            low=0.0,
-            high=1.0,
-            shape=(_NUM_CHANNELS, _ROWS, _COLS),
-            dtype=np.float32,
-        ),
-        unpack=lambda buf: buf.reshape(_NUM_CHANNELS, _ROWS, _COLS),
-    )
+    shape = spec.shape
+    return {
+        "observation_space": gymnasium.spaces.Box(low=0.0, high=1.0, shape=shape, dtype=np.float32),
+        "unpack": lambda buf: buf.reshape(shape),
+    }
+
+
+def default_feature(spec: FeatureSpec | None = None) -> CppFeature:
+    """Create the default image feature plugin.
+
+    *spec* selects the channels (default: all 66); the plugin is compiled
+    for exactly those, with ``observation_space`` of shape ``spec.shape``.
+    """
+    spec = spec if spec is not None else FeatureSpec()
+    return CppFeature(spec.source(), **_observation_kwargs(spec))
 
 
 # Reward - lock-based attack shaping with row-mask board statistics
 _DEFAULT_REWARD_SRC = r"""
+#include <array>
+#include <cmath>
 using namespace ops;
 
 static constexpr int ROWS = BOARD_BOTTOM - BOARD_TOP + 1;  // 20
-static constexpr int PLAYFIELD_COLS = BOARD_RIGHT - BOARD_LEFT + 1;  // 10
 
 static constexpr float line_clear_base[] = {0.0f, 3.0f, 8.0f, 14.0f, 21.0f};
 
@@ -265,35 +400,15 @@ static constexpr float placement_height_bonus[] = {
     6.0f, 5.5f, 5.0f, 4.5f, 4.0f, 3.5f, 3.0f, 2.5f, 2.0f, 1.5f, 1.0f, 1.0f, 0.8f, 0.7f, 0.6f, 0.5f, 0.4f, 0.4f, 0.4f, 0.4f, 0.4f
 };
 
+// The active piece of the previous step and where a hard drop would have put it.
 struct RewardContext {
-    State previous_state;
+    PieceType previous_piece;
+    std::uint8_t previous_orientation;
+    std::int8_t previous_ghost_y;
     int previous_hole_count;
     int previous_stack_void_count;
 };
 
-static constexpr Row make_playfield_occupied_mask() {
-    Row mask = 0;
-    for (int col = BOARD_LEFT; col <= BOARD_RIGHT; ++col) {
-        mask |= shift(static_cast<Row>(Cell::BLOCK), col);
-    }
-    return mask;
-}
-
-static constexpr Row PLAYFIELD_OCCUPIED_MASK = make_playfield_occupied_mask();
-
-static inline int bit_count_u32(Row bits) {
-#if defined(__clang__) || defined(__GNUC__)
-    return __builtin_popcount(static_cast<unsigned int>(bits));
-#else
-    int count = 0;
-    while (bits != 0) {
-        bits &= (bits - 1);
-        ++count;
-    }
-    return count;
-#endif
-}
-
 static inline float lookup_clamped(const float* table, int height) {
     if (height < 0) {
         height = 0;
@@ -303,58 +418,34 @@ static inline float lookup_clamped(const float* table, int height) {
     return table[height];
 }
 
-static int count_piece_leading_empty_rows(PieceType type, std::uint8_t orientation) {
-    const Piece& piece = getPiece(type, orientation);
-    int leading_empty_rows = 0;
-    for (int row = 0; row < 4; ++row) {
-        bool row_has_cell = false;
-        for (int col = 0; col < 4; ++col) {
-            if (getCell(piece, col, row) != Cell::EMPTY) {
-                row_has_cell = true;
-                break;
+// Empty rows above the first cell of each piece orientation.
+static constexpr auto piece_leading_empty_rows = [] {
+    std::array<std::array<std::int8_t, 4>, static_cast<int>(PieceType::SIZE)> rows{};
+    for (int type = 0; type < static_cast<int>(PieceType::SIZE); ++type) {
+        for (int orientation = 0; orientation < 4; ++orientation) {
+            const Piece& piece = getPiece(static_cast<PieceType>(type), static_cast<std::uint8_t>(orientation));
+            int leading_empty_rows = 0;
+            while (leading_empty_rows < 4 && piece.data[leading_empty_rows] == 0) {
+                leading_empty_rows++;
             }
+            rows[type][orientation] = static_cast<std::int8_t>(leading_empty_rows);
         }
-        if (row_has_cell) {
-            break;
-        }
-        leading_empty_rows++;
     }
-    return leading_empty_rows;
+    return rows;
+}();
+
+static int count_piece_leading_empty_rows(PieceType type, std::uint8_t orientation) {
+    return piece_leading_empty_rows[static_cast<int>(type)][orientation];
 }
 
 static int compute_lock_height(std::int8_t piece_y, int leading_empty_rows) {
     return ROWS - (piece_y + leading_empty_rows - BOARD_TOP);
 }
 
-static inline Row row_occupied_mask(const Board& board, int row) {
-    return board.data[row] & PLAYFIELD_OCCUPIED_MASK;
-}
-
-static int compute_hole_count(const Board& board) {
-    int hole_count = 0;
-    Row filled_above_mask = 0;
-    for (int row = BOARD_TOP; row <= BOARD_BOTTOM; ++row) {
-        const Row occupied_mask = row_occupied_mask(board, row);
-        const Row hole_mask = filled_above_mask & ~occupied_mask & PLAYFIELD_OCCUPIED_MASK;
-        hole_count += bit_count_u32(hole_mask);
-        filled_above_mask |= occupied_mask;
-    }
-    return hole_count;
-}
-
-static int compute_stack_void_count(const Board& board) {
-    int stack_void_count = 0;
-    bool stack_started = false;
-    for (int row = BOARD_TOP; row <= BOARD_BOTTOM; ++row) {
-        const Row occupied_mask = row_occupied_mask(board, row);
-        if (!stack_started && occupied_mask != 0) {
-            stack_started = true;
-        }
-        if (stack_started) {
-            stack_void_count += PLAYFIELD_COLS - bit_count_u32(occupied_mask);
-        }
-    }
-    return stack_void_count;
+static void remember_piece(RewardContext* reward_ctx, const State* state) {
+    reward_ctx->previous_piece = state->current;
+    reward_ctx->previous_orientation = state->orientation;
+    reward_ctx->previous_ghost_y = sharedGhostY(state);
 }
 
 static bool is_locking_step(const Info* info) {
@@ -368,9 +459,11 @@ API void reward_reset(Context* env_ctx, void* plugin_ctx) {
     State* state = &env_ctx->state;
     auto* reward_ctx = static_cast<RewardContext*>(plugin_ctx);
 
-    std::memcpy(&reward_ctx->previous_state, state, sizeof(State));
-    reward_ctx->previous_hole_count = compute_hole_count(state->board);
-    reward_ctx->previous_stack_void_count = compute_stack_void_count(state->board);
+    BoardAnalysis scratch;
+    const BoardAnalysis& board = boardAnalysis(state, &scratch);
+    remember_piece(reward_ctx, state);
+    reward_ctx->previous_hole_count = board.hole_count;
+    reward_ctx->previous_stack_void_count = board.stack_void_count;
 }
 
 API float reward_step(Context* env_ctx, Info* info, void* plugin_ctx) {
@@ -378,7 +471,7 @@ API float reward_step(Context* env_ctx, Info* info, void* plugin_ctx) {
     auto* reward_ctx = static_cast<RewardContext*>(plugin_ctx);
 
     if (!is_locking_step(info)) {
-        std::memcpy(&reward_ctx->previous_state, state, sizeof(State));
+        remember_piece(reward_ctx, state);
         return 0.0f;
     }
 
@@ -386,21 +479,9 @@ API float reward_step(Context* env_ctx, Info* info, void* plugin_ctx) {
         return -20.0f;
     }
 
-    PieceType locking_piece_type = reward_ctx->previous_state.current;
-    std::uint8_t locking_piece_orientation = reward_ctx->previous_state.orientation;
-    std::int8_t locking_piece_y = reward_ctx->previous_state.y;
-
-    {
-        State simulated_lock_state;
-        std::memcpy(&simulated_lock_state, &reward_ctx->previous_state, sizeof(State));
-        while (softDrop(&simulated_lock_state)) {}
-        locking_piece_orientation = simulated_lock_state.orientation;
-        locking_piece_y = simulated_lock_state.y;
-    }
-
     const int leading_empty_rows =
-        count_piece_leading_empty_rows(locking_piece_type, locking_piece_orientation);
-    const int lock_height = compute_lock_height(locking_piece_y, leading_empty_rows);
+        count_piece_leading_empty_rows(reward_ctx->previous_piece, reward_ctx->previous_orientation);
+    const int lock_height = compute_lock_height(reward_ctx->previous_ghost_y, leading_empty_rows);
 
     float reward = 1.0f;
 
@@ -417,21 +498,23 @@ API float reward_step(Context* env_ctx, Info* info, void* plugin_ctx) {
     reward += static_cast<float>(state->attack) * 10.0f;
     reward += lookup_clamped(placement_height_bonus, lock_height) / 3.0f;
 
-    const int current_hole_count = compute_hole_count(state->board);
+    BoardAnalysis scratch;
+    const BoardAnalysis& board = boardAnalysis(state, &scratch);
+    const int current_hole_count = board.hole_count;
     const int new_hole_count_delta =
         current_hole_count - reward_ctx->previous_hole_count;
     if (new_hole_count_delta > 0) {
         reward -= std::log(static_cast<float>(new_hole_count_delta + 1)) * 2.0f;
     }
 
-    const int current_stack_void_count = compute_stack_void_count(state->board);
+    const int current_stack_void_count = board.stack_void_count;
     const int new_stack_void_delta =
         current_stack_void_count - reward_ctx->previous_stack_void_count;
     if (new_stack_void_delta > 0) {
         reward -= static_cast<float>(new_stack_void_delta) / 2.0f;
     }
 
-    std::memcpy(&reward_ctx->previous_state, state, sizeof(State));
+    remember_piece(reward_ctx, state);
     reward_ctx->previous_hole_count = current_hole_count;
     reward_ctx->previous_stack_void_count = current_stack_void_count;
 
@@ -443,3 +526,9 @@ API float reward_step(Context* env_ctx, Info* info, void* plugin_ctx) {
 def default_reward() -> CppReward:
     """Create the default lock-based attack reward plugin."""
     return CppReward(_DEFAULT_REWARD_SRC)
+
+
+def default_fused_plugins(spec: FeatureSpec | None = None) -> CppFusedPlugins:
+    """Create the default feature (channels from *spec*) and reward compiled into one fused library."""
+    spec = spec if spec is not None else FeatureSpec()
+    return CppFusedPlugins(spec.source(), _DEFAULT_REWARD_SRC, **_observation_kwargs(spec))
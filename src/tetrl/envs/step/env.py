@@ -43,23 +43,28 @@ Examples
 
 from __future__ import annotations
 
-from typing import Any, SupportsFloat
+from typing import Any, Sequence, SupportsFloat
 
 import gymnasium
+import numpy as np
 
 from .native import (
     Action,
     N_ACTIONS,
     StepEnvConfig,
     StepEnvContext,
+    env_action_mask,
     env_reset,
     env_set_config,
     env_set_seed,
     env_step,
+    env_step_sequence,
 )
 from .feature import FeaturePlugin
 from .reward import RewardPlugin
 
+_ACTION_BITS = 1 << np.arange(N_ACTIONS, dtype=np.uint16)
+
 
 class StepEnv(gymnasium.Env):
     """Gymnasium environment for per-step Tetris control.
@@ -79,15 +84,22 @@ class StepEnv(gymnasium.Env):
         ``None``, uses :func:`~tetrl.envs.step.defaults.default_reward`
         (lock-based attack shaping).
     config:
-        Engine configuration (piece lifetime, auto-drop gravity).
-        Defaults to ``StepEnvConfig()`` (``piece_life=20, auto_drop=True``).
+        Engine configuration (piece lifetime, auto-drop gravity, action
+        masks).  Defaults to ``StepEnvConfig()`` (``piece_life=20,
+        auto_drop=True, action_mask=False``).  With ``action_mask=True``
+        every info dict carries ``"action_mask"``, a ``(12,)`` bool array
+        of the actions that would succeed in the returned state.
     max_steps:
         If positive, the episode is *truncated* after this many steps
         (the ``truncated`` flag is set but ``terminated`` stays ``False``).
         ``0`` means no truncation limit.
     render_mode:
         ``"ansi"`` returns the board as a multi-line string.
+        ``"rgb_array"`` returns an ``(H, W, 3)`` ``uint8`` frame rendered
+        natively (see :func:`~tetrl.engine.native.render_rgb`).
         ``None`` disables rendering.
+    render_scale:
+        Pixels per board cell of ``rgb_array`` frames (1 to 32).
 
     Attributes
     ----------
@@ -98,9 +110,9 @@ class StepEnv(gymnasium.Env):
     """
 
     metadata = {
-        "render_modes": ["ansi"],
-        # Declared for Gymnasium's metadata checks; ansi rendering is not timed here.
-        "render_fps": 1,
+        "render_modes": ["ansi", "rgb_array"],
+        # Playback rate of recorded rgb_array frames; rendering itself is not timed.
+        "render_fps": 30,
     }
 
     def __init__(
@@ -111,9 +123,13 @@ class StepEnv(gymnasium.Env):
         config: StepEnvConfig | None = None,
         max_steps: int = 0,
         render_mode: str | None = None,
+        render_scale: int = 8,
     ) -> None:
         super().__init__()
 
+        if render_mode is not None and render_mode not in self.metadata["render_modes"]:
+            raise ValueError(f"unsupported render_mode {render_mode!r}; expected one of {self.metadata['render_modes']}")
+
         if feature is None:
             from .defaults import default_feature
 
@@ -125,8 +141,15 @@ class StepEnv(gymnasium.Env):
 
         self._feature = feature
         self._reward = reward
+        # Both halves of one CppFusedPlugins: evaluate them with a single native call.
+        fused = getattr(feature, "fused", None)
+        self._fused = fused if fused is not None and getattr(reward, "fused", None) is fused else None
         self._max_steps = max_steps
         self.render_mode = render_mode
+        from ...engine.native import render_shape
+
+        render_shape(render_scale)  # ValueError now rather than on the first render()
+        self.render_scale = render_scale
 
         # Internal engine context.
         self._ctx = StepEnvContext(config=config or StepEnvConfig())
@@ -156,6 +179,10 @@ class StepEnv(gymnasium.Env):
             If ``None``, the existing RNG state continues to be used.
         options:
             ``"config"`` -- a :class:`StepEnvConfig` to apply before reset.
+            ``"start_states"`` -- a
+            :class:`~tetrl.envs.step.start_states.StartStatePool`; the
+            episode starts on the board of a pool entry drawn from the
+            env's RNG.
         """
         super().reset(seed=seed, options=options)
 
@@ -172,15 +199,21 @@ class StepEnv(gymnasium.Env):
 
         # Engine reset.
         env_reset(self._ctx)
+        if "start_states" in opts:
+            pool = opts["start_states"]
+            self._ctx.state.board = pool.boards[int(self.np_random.integers(len(pool)))]
 
         # Plugin reset.
-        self._reward.reset(self._ctx)
-        observation = self._feature.reset(self._ctx)
+        if self._fused is not None:
+            observation = self._fused.reset(self._ctx)
+        else:
+            self._reward.reset(self._ctx)
+            observation = self._feature.reset(self._ctx)
 
         self._steps = 0
         self._needs_reset = False
 
-        return observation, self._make_info()
+        return observation, self._make_info(action_mask=env_action_mask(self._ctx))
 
     def step(
         self,
@@ -207,8 +240,84 @@ class StepEnv(gymnasium.Env):
         step_info = env_step(self._ctx, int(action))
         self._steps += 1
 
+        if self._fused is not None:
+            observation, reward = self._fused.step(self._ctx, step_info)
+        else:
+            observation = self._feature.step(self._ctx, step_info)
+            reward = float(self._reward.step(self._ctx, step_info))
+
+        terminated = not bool(self._ctx.state.is_alive)
+        truncated = self._max_steps > 0 and self._steps >= self._max_steps and not terminated
+
+        if terminated or truncated:
+            self._needs_reset = True
+
+        info = self._make_info(step_info=step_info, action_mask=step_info.action_mask)
+        return observation, reward, terminated, truncated, info
+
+    def step_many(
+        self,
+        actions: Sequence[int | Action] | np.ndarray,
+        *,
+        stop_on_death: bool = True,
+        stop_on_lock: bool = False,
+    ) -> tuple[Any, SupportsFloat, bool, bool, dict[str, Any]]:
+        """Execute a whole action sequence and return one 5-tuple.
+
+        Intended for frame skip, scripted openers and replays: the engine
+        runs the sequence natively, the reward plugin is evaluated after
+        every action (rewards are summed) and the feature plugin only once,
+        after the last executed action -- stateful features such as frame
+        histories therefore see one step per call.
+
+        Parameters
+        ----------
+        actions:
+            The actions to execute in order.
+        stop_on_death:
+            Stop after the action that ends the game.
+        stop_on_lock:
+            Stop after the action that locks a piece (hard drop or forced
+            drop).
+
+        Returns
+        -------
+        The same 5-tuple as :meth:`step`, with the summed reward; ``info``
+        describes the last executed action and adds ``"steps_executed"``.
+        The sequence is cut short when ``max_steps`` is reached.
+        """
+        if self._needs_reset:
+            raise RuntimeError("Environment must be reset before calling step(). Call env.reset() first.")
+
+        actions = np.ascontiguousarray(actions, dtype=np.uint8).reshape(-1)
+        if self._max_steps > 0:
+            actions = actions[: self._max_steps - self._steps]
+        if len(actions) == 0:
+            raise ValueError("step_many() needs at least one action")
+
+        if hasattr(self._reward, "native_entry_points"):
+            _, reward_step_batch = self._reward.native_entry_points
+            executed, step_info, reward = env_step_sequence(
+                self._ctx,
+                actions,
+                stop_on_death=stop_on_death,
+                stop_on_lock=stop_on_lock,
+                reward_step_batch=reward_step_batch,
+                reward_ctx=self._reward.context_address,
+            )
+        else:
+            executed, reward = 0, 0.0
+            for action in actions:
+                step_info = env_step(self._ctx, int(action))
+                reward += float(self._reward.step(self._ctx, step_info))
+                executed += 1
+                if (stop_on_death and not self._ctx.state.is_alive) or (
+                    stop_on_lock and (step_info.action_id == Action.HARD_DROP or step_info.forced_hard_drop)
+                ):
+                    break
+        self._steps += executed
+
         observation = self._feature.step(self._ctx, step_info)
-        reward = float(self._reward.step(self._ctx, step_info))
 
         terminated = not bool(self._ctx.state.is_alive)
         truncated = self._max_steps > 0 and self._steps >= self._max_steps and not terminated
@@ -216,18 +325,24 @@ class StepEnv(gymnasium.Env):
         if terminated or truncated:
             self._needs_reset = True
 
-        info = self._make_info(step_info=step_info)
+        info = self._make_info(step_info=step_info, action_mask=step_info.action_mask)
+        info["steps_executed"] = executed
         return observation, reward, terminated, truncated, info
 
-    def render(self) -> str | None:
+    def render(self) -> str | np.ndarray | None:
         """Render the current board state.
 
-        Only ``render_mode="ansi"`` is supported -- returns an ASCII string.
+        ``render_mode="ansi"`` returns an ASCII string, ``"rgb_array"`` an
+        ``(H, W, 3)`` ``uint8`` frame.
         """
         if self.render_mode == "ansi":
             from ...engine.native import to_string
 
             return to_string(self._ctx.state)
+        if self.render_mode == "rgb_array":
+            from ...engine.native import render_rgb
+
+            return render_rgb(self._ctx.state, self.render_scale)
         return None
 
     def close(self) -> None:
@@ -253,15 +368,22 @@ class StepEnv(gymnasium.Env):
         """Current engine configuration."""
         return self._ctx.config
 
+    @property
+    def feature(self) -> FeaturePlugin:
+        """The feature plugin producing the observations."""
+        return self._feature
+
     @property
     def steps(self) -> int:
         """Number of steps taken in the current episode."""
         return self._steps
 
-    def _make_info(self, *, step_info=None) -> dict[str, Any]:
+    def _make_info(self, *, step_info=None, action_mask: int = 0) -> dict[str, Any]:
         info: dict[str, Any] = {}
         if step_info is not None:
             info["action_id"] = int(step_info.action_id)
             info["action_success"] = bool(step_info.action_success)
             info["forced_hard_drop"] = bool(step_info.forced_hard_drop)
+        if self._ctx.config.action_mask:
+            info["action_mask"] = (action_mask & _ACTION_BITS) != 0
         return info
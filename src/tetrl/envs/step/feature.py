@@ -19,15 +19,35 @@ from typing import Any, Callable, TYPE_CHECKING, Sequence
 import numpy as np
 
 from ... import dynamic_library as dl
-from ...native_layout import CSRC_DIR, csrc_path
+from ...native_build import create_library
+from ._plugin_common import PLUGIN_PRELUDE, defines_function, plugin_watch_files
 from .native import StepEnvContext, StepInfo
 
 if TYPE_CHECKING:
     import gymnasium
 
-_ENGINE_CPP = "engine/tetris.cpp"
-_ENGINE_HPP = "engine/tetris.hpp"
-_STEP_HPP = "envs/step/step.hpp"
+# Exported entry points of a feature library.
+_FUNCTIONS = {
+    "feature_init": {"argtypes": [], "restype": dl.void},
+    "feature_context_size": {"argtypes": [], "restype": dl.int32},
+    "feature_size": {"argtypes": [], "restype": dl.int32},
+    "feature_reset": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
+    "feature_step": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p], "restype": dl.void},
+    "feature_step_batch": {
+        "argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32, dl.uint64],
+        "restype": dl.void,
+    },
+}
+
+# Appended when the user source defines no init hook.
+_DEFAULT_INIT = "API void feature_init() {}\n"
+
+# Appended when the user source defines no batch entry point.
+_DEFAULT_STEP_BATCH = r"""
+API void feature_step_batch(Context* ctxs, Info* infos, void* plugin_ctxs, float* out, int n, std::size_t stride) {
+    featureStepLoop<feature_step>(ctxs, infos, plugin_ctxs, feature_context_size(), out, n, stride);
+}
+"""
 
 
 class FeaturePlugin(ABC):
@@ -85,10 +105,12 @@ class FeaturePlugin(ABC):
 class CppFeature(FeaturePlugin):
     """Feature plugin backed by JIT-compiled C++ code.
 
-    ``tetris.cpp`` and ``step.hpp`` are compiled together with the user
-    source, so all engine types/functions (``State``, ``removeCurrentPiece``,
-    ``placeCurrentPiece``, ...) **and** step-env types (``Info``,
-    ``Action``, ...) are available without additional includes.
+    ``tetris.hpp`` and ``step.hpp`` are included ahead of the user source
+    (the engine itself is linked from the shared core compiled once by
+    :mod:`tetrl.engine.native`), so all engine types/functions
+    (``State``, ``removeCurrentPiece``, ``placeCurrentPiece``, ...)
+    **and** step-env types (``Info``, ``Action``, ...) are available
+    without additional includes.
 
     Required C++ functions
     ----------------------
@@ -113,6 +135,31 @@ class CppFeature(FeaturePlugin):
     observation.  The output buffer size is defined by
     ``feature_size()`` and guaranteed by Python.
 
+    Optionally, the source may also define the batch entry point used by
+    native drivers such as :class:`~tetrl.envs.step.vector.StepVectorEnv`::
+
+        API void feature_step_batch(Context* ctxs, Info* infos,
+                                    void* plugin_ctxs, float* out,
+                                    int n, std::size_t stride)
+
+    which computes ``n`` observations at once: context ``i`` is
+    ``ctxs[i]``, its plugin context starts ``i * feature_context_size()``
+    bytes into ``plugin_ctxs`` and its row ``i * stride`` floats into
+    ``out``.  When it is missing, a loop over ``feature_step`` is
+    generated.
+
+    Entry points must be re-entrant: native drivers may call them for
+    different contexts from several threads at once, so keep per-env
+    state in the plugin context, make lookup tables ``constexpr`` and do
+    any one-time setup in the optional init hook::
+
+        API void feature_init()
+
+    which is called once, right after the library is loaded and before
+    any other entry point.  Temporary buffers too large for the stack can
+    be taken from ``pluginScratch(bytes)`` (``plugin.hpp``), a 64-byte
+    aligned per-thread arena reused across calls.
+
     Parameters
     ----------
     source:
@@ -213,36 +260,22 @@ class CppFeature(FeaturePlugin):
         self._obs_dtype = np.dtype(observation_dtype)
         self._unpack = unpack
 
-        # Include engine source + step header so the user has everything.
-        full_source = f'#include "{_ENGINE_CPP}"\n#include "{_STEP_HPP}"\n\nusing namespace tetrl;\nusing namespace tetrl::envs::step;\n\n{source}\n'
-
-        compile_flags = [
-            f"-I{CSRC_DIR}",
-            "-std=c++17",
-            "-O3",
-        ]
-        if extra_compile_flags:
-            compile_flags.extend(extra_compile_flags)
-
-        all_watch = [
-            csrc_path(_ENGINE_HPP),
-            csrc_path(_ENGINE_CPP),
-            csrc_path(_STEP_HPP),
-        ]
+        # Include engine + step headers so the user has everything.
+        full_source = f"{PLUGIN_PRELUDE}{source}\n"
+        if not defines_function(source, "feature_step_batch"):
+            full_source += _DEFAULT_STEP_BATCH
+        if not defines_function(source, "feature_init"):
+            full_source += _DEFAULT_INIT
+
+        all_watch = plugin_watch_files()
         all_watch.extend(watch_files or [])
 
-        self._lib = dl.DynamicLibrary(extra_compile_flags=compile_flags)
-        self._lib.compile_string(
-            full_source,
-            watch_files=all_watch,
-            functions={
-                "feature_context_size": {"argtypes": [], "restype": dl.int32},
-                "feature_size": {"argtypes": [], "restype": dl.int32},
-                "feature_reset": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
-                "feature_step": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p], "restype": dl.void},
-            },
-        )
+        self._lib = create_library(extra_compile_flags=extra_compile_flags)
+        self._lib.compile_string(full_source, watch_files=all_watch, functions=_FUNCTIONS)
+        self._lib.feature_init()
+        self._allocate()
 
+    def _allocate(self) -> None:
         # Allocate per-instance context buffer.
         self._ctx_size: int = int(self._lib.feature_context_size())
         self._ctx_buf = ctypes.create_string_buffer(self._ctx_size) if self._ctx_size > 0 else None
@@ -299,6 +332,21 @@ class CppFeature(FeaturePlugin):
         """Byte size of the C++ feature plugin context (0 = stateless)."""
         return self._ctx_size
 
+    @property
+    def context_address(self) -> int:
+        """Address of this instance's plugin context (0 = stateless)."""
+        return self._ctx_ptr
+
+    @property
+    def source_digest(self) -> str | None:
+        """Digest of the compiled plugin source; identifies the plugin in checkpoints."""
+        return self._lib.source_digest
+
+    @property
+    def native_entry_points(self) -> tuple[int, int]:
+        """Addresses of ``feature_reset`` and ``feature_step_batch`` for native drivers."""
+        return self._lib.feature_reset.address, self._lib.feature_step_batch.address
+
     def close(self) -> None:
         """Release the compiled shared library."""
         self._lib.close()
@@ -0,0 +1,241 @@
+"""
+Feature and reward plugins fused into one compiled translation unit.
+
+:class:`CppFusedPlugins` compiles a ``CppFeature`` source and a
+``CppReward`` source (same contracts) into a single shared library: each
+source lives in its own namespace, so their file-level helpers may share
+names, and a generated ``fused_step`` calls both single-step entry points
+directly, letting the compiler inline across the plugin boundary.
+
+Quantities both plugins need are computed once per step: while the
+fused step runs, the ``analysis.hpp`` helpers (``boardAnalysis`` for
+hole / top masks and counts, ``sharedGhostY`` for the hard-drop row)
+memoise their results for the state being stepped.  Unfused plugins use
+the same helpers and simply compute on every call.
+
+Examples
+--------
+>>> from tetrl.envs.step import CppFusedPlugins, StepEnv
+>>> from tetrl.envs.step.defaults import default_fused_plugins
+>>>
+>>> plugins = default_fused_plugins()
+>>> env = StepEnv(feature=plugins.feature, reward=plugins.reward)
+"""
+
+from __future__ import annotations
+
+import ctypes
+import os
+import re
+from typing import Any, Callable, Dict, TYPE_CHECKING, Sequence
+
+import numpy as np
+
+from ... import dynamic_library as dl
+from ...native_build import create_library
+from . import feature as _feature
+from ._plugin_common import PLUGIN_PRELUDE, defines_function, plugin_watch_files
+from . import reward as _reward
+from .native import StepEnvContext, StepInfo
+
+if TYPE_CHECKING:
+    import gymnasium
+
+_INCLUDE = re.compile(r"^[ \t]*#[ \t]*include\b.*$", re.MULTILINE)
+
+_FUSED_SOURCE = r"""
+API void fused_reset(Context* ctx, Info* info, void* feature_ctx, void* reward_ctx, float* out) {
+    StepAnalysis analysis(&ctx->state);
+    ScopedStepAnalysis scope(&analysis);
+    tetrl_fused_reward::reward_reset(ctx, reward_ctx);
+    tetrl_fused_feature::feature_reset(ctx, feature_ctx);
+    tetrl_fused_feature::feature_step(ctx, info, feature_ctx, out);
+}
+
+API float fused_step(Context* ctx, Info* info, void* feature_ctx, void* reward_ctx, float* out) {
+    float reward;
+    fusedStepLoop<tetrl_fused_feature::feature_step, tetrl_fused_reward::reward_step>(
+        ctx, info,
+        feature_ctx, tetrl_fused_feature::feature_context_size(),
+        reward_ctx, tetrl_fused_reward::reward_context_size(),
+        out, &reward, 1, 0);
+    return reward;
+}
+
+API void fused_step_batch(Context* ctxs, Info* infos, void* feature_ctxs, void* reward_ctxs,
+                          float* out, float* rewards, int n, std::size_t stride) {
+    fusedStepLoop<tetrl_fused_feature::feature_step, tetrl_fused_reward::reward_step>(
+        ctxs, infos,
+        feature_ctxs, tetrl_fused_feature::feature_context_size(),
+        reward_ctxs, tetrl_fused_reward::reward_context_size(),
+        out, rewards, n, stride);
+}
+"""
+
+_FUNCTIONS = {
+    **_feature._FUNCTIONS,
+    **_reward._FUNCTIONS,
+    "fused_reset": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p], "restype": dl.void},
+    "fused_step": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p], "restype": dl.float},
+    "fused_step_batch": {
+        "argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32, dl.uint64],
+        "restype": dl.void,
+    },
+}
+
+
+def _namespaced(namespace: str, source: str, defaults: Dict[str, str]) -> tuple[str, str]:
+    """Split *source* into its ``#include`` lines and a namespaced body.
+
+    *defaults* maps optional entry points to the code appended when
+    *source* does not define them.
+    """
+    includes = "\n".join(m.group(0).strip() for m in _INCLUDE.finditer(source))
+    body = _INCLUDE.sub("", source)
+    for name, default in defaults.items():
+        if not defines_function(source, name):
+            body += default
+    return includes, f"namespace {namespace} {{\n{body}\n}} // namespace {namespace}\n"
+
+
+class _FusedFeature(_feature.CppFeature):
+    """Feature half of a :class:`CppFusedPlugins` (shares its library)."""
+
+    def __init__(self, fused: "CppFusedPlugins", **observation_kwargs: Any) -> None:
+        self.fused = fused
+        self._custom_obs_space = observation_kwargs["observation_space"]
+        self._obs_low = observation_kwargs["observation_low"]
+        self._obs_high = observation_kwargs["observation_high"]
+        self._obs_dtype = np.dtype(observation_kwargs["observation_dtype"])
+        self._unpack = observation_kwargs["unpack"]
+        self._lib = fused._lib
+        self._allocate()
+
+    def __repr__(self) -> str:
+        return f"CppFusedPlugins.feature(size={self._size}, context_size={self._ctx_size})"
+
+
+class _FusedReward(_reward.CppReward):
+    """Reward half of a :class:`CppFusedPlugins` (shares its library)."""
+
+    def __init__(self, fused: "CppFusedPlugins") -> None:
+        self.fused = fused
+        self._lib = fused._lib
+        self._allocate()
+
+    def __repr__(self) -> str:
+        return f"CppFusedPlugins.reward(context_size={self._ctx_size})"
+
+
+class CppFusedPlugins:
+    """A feature and a reward plugin compiled into one library.
+
+    :attr:`feature` and :attr:`reward` are regular
+    :class:`~tetrl.envs.step.feature.CppFeature` /
+    :class:`~tetrl.envs.step.reward.CppReward` plugins backed by the fused
+    library.  Passed together to :class:`~tetrl.envs.step.env.StepEnv` or
+    :class:`~tetrl.envs.step.vector.StepVectorEnv`, they are evaluated by
+    a single ``fused_step`` call per env step; used separately, each half
+    behaves exactly like its unfused counterpart.
+
+    Parameters
+    ----------
+    feature_source:
+        C++ source following the :class:`CppFeature` contract.
+    reward_source:
+        C++ source following the :class:`CppReward` contract.
+    observation_space, observation_low, observation_high, observation_dtype, unpack:
+        As in :class:`CppFeature`.
+    extra_compile_flags:
+        Additional flags passed to the C++ compiler.
+    watch_files:
+        Extra header / source files whose content should invalidate
+        the compilation cache when changed.
+
+    Notes
+    -----
+    Each source is wrapped in its own namespace.  Its ``#include`` lines
+    are hoisted in front of both namespaces, so plugin sources must not
+    rely on includes placed after other declarations.  The fused step
+    calls the single-step entry points for every env; a user-defined
+    ``*_step_batch`` is only used when a half is driven on its own.
+    """
+
+    def __init__(
+        self,
+        feature_source: str,
+        reward_source: str,
+        *,
+        observation_space: "gymnasium.spaces.Space | None" = None,
+        observation_low: float = -np.inf,
+        observation_high: float = np.inf,
+        observation_dtype: np.dtype = np.float32,
+        unpack: Callable[[np.ndarray], Any] | None = None,
+        extra_compile_flags: Sequence[str] | None = None,
+        watch_files: Sequence[str | os.PathLike] | None = None,
+    ) -> None:
+        feature_includes, feature_body = _namespaced(
+            "tetrl_fused_feature",
+            feature_source,
+            {"feature_step_batch": _feature._DEFAULT_STEP_BATCH, "feature_init": _feature._DEFAULT_INIT},
+        )
+        reward_includes, reward_body = _namespaced(
+            "tetrl_fused_reward",
+            reward_source,
+            {"reward_step_batch": _reward._DEFAULT_STEP_BATCH, "reward_init": _reward._DEFAULT_INIT},
+        )
+        # Bring the C-linkage entry points back to global scope for the exporters.
+        exports = "".join(f"using tetrl_fused_feature::{name};\n" for name in _feature._FUNCTIONS) + "".join(
+            f"using tetrl_fused_reward::{name};\n" for name in _reward._FUNCTIONS
+        )
+        full_source = (
+            f"{PLUGIN_PRELUDE}{feature_includes}\n{reward_includes}\n\n"
+            f"{feature_body}\n{reward_body}\n{exports}{_FUSED_SOURCE}"
+        )
+
+        all_watch = plugin_watch_files()
+        all_watch.extend(watch_files or [])
+
+        self._lib = create_library(extra_compile_flags=extra_compile_flags)
+        self._lib.compile_string(full_source, watch_files=all_watch, functions=_FUNCTIONS)
+        self._lib.feature_init()
+        self._lib.reward_init()
+
+        self.feature = _FusedFeature(
+            self,
+            observation_space=observation_space,
+            observation_low=observation_low,
+            observation_high=observation_high,
+            observation_dtype=observation_dtype,
+            unpack=unpack,
+        )
+        self.reward = _FusedReward(self)
+
+    def reset(self, ctx: StepEnvContext) -> Any:
+        """Reset both halves and return the initial observation."""
+        f, r = self.feature, self.reward
+        dummy = StepInfo()
+        self._lib.fused_reset(ctypes.addressof(ctx), ctypes.addressof(dummy), f._ctx_ptr, r._ctx_ptr, f._buf.ctypes.data)
+        out = f._buf.copy()
+        return f._unpack(out) if f._unpack is not None else out
+
+    def step(self, ctx: StepEnvContext, step_info: StepInfo) -> tuple[Any, float]:
+        """Compute ``(observation, reward)`` after a step in one native call."""
+        f, r = self.feature, self.reward
+        reward = self._lib.fused_step(
+            ctypes.addressof(ctx), ctypes.addressof(step_info), f._ctx_ptr, r._ctx_ptr, f._buf.ctypes.data
+        )
+        out = f._buf.copy()
+        return (f._unpack(out) if f._unpack is not None else out), float(reward)
+
+    @property
+    def fused_step_batch_address(self) -> int:
+        """Address of ``fused_step_batch`` for native drivers."""
+        return self._lib.fused_step_batch.address
+
+    def close(self) -> None:
+        """Release the compiled shared library."""
+        self._lib.close()
+
+    def __repr__(self) -> str:
+        return f"CppFusedPlugins(size={self.feature.size}, feature_context_size={self.feature.context_size}, reward_context_size={self.reward.context_size})"
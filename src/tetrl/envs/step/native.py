@@ -6,9 +6,13 @@ Responsibility
 This module is the **sole** communication layer between Python and the C++
 Tetris engine for the step-based environment.  It:
 
-* JIT-compiles ``tetris.cpp`` and its inline wrappers via :class:`DynamicLibrary`.
+* JIT-compiles the ``step.hpp`` inline wrappers via :class:`DynamicLibrary`,
+  linked against the shared engine core of :mod:`tetrl.engine.native`.
 * Mirrors every relevant C++ struct as a ``ctypes.Structure`` so Python can
-  allocate and pass them by pointer with zero copies.
+  allocate and pass them by pointer with zero copies.  The mirrors of the
+  step and battle structs are pinned to the headers by generated
+  ``static_assert`` checks, and the context and info arrays also have numpy
+  structured dtypes (``CONTEXT_DTYPE``, ``INFO_DTYPE``) for batched reads.
 * Exposes a thin, typed Python API (``env_reset``, ``env_step``, ...) that
   gymnasium environment code calls without knowing anything about ctypes.
 """
@@ -18,13 +22,24 @@ from __future__ import annotations
 import ctypes
 import enum
 
+import numpy as np
+
 from ... import dynamic_library as dl
-from ...native_layout import CSRC_DIR, csrc_path
+from ...engine import native as _engine_core  # noqa: F401 -- loads the shared engine core
+from ...native_build import create_library
+from ...native_layout import csrc_path, layout_static_asserts, structured_dtype
 from ...engine.state import State
 
-_ENGINE_CPP = "engine/tetris.cpp"
 _ENGINE_HPP = "engine/tetris.hpp"
 _STEP_HPP = "envs/step/step.hpp"
+_PLUGIN_HPP = "envs/step/plugin.hpp"
+_ANALYSIS_HPP = "envs/step/analysis.hpp"
+_CHECKPOINT_HPP = "envs/step/checkpoint.hpp"
+_TELEMETRY_HPP = "envs/step/telemetry.hpp"
+_START_STATES_HPP = "envs/step/start_states.hpp"
+_REPLAY_HPP = "envs/step/replay.hpp"
+_RETURNS_HPP = "envs/step/returns.hpp"
+_BATTLE_HPP = "envs/step/battle.hpp"
 
 
 class Action(enum.IntEnum):
@@ -52,10 +67,11 @@ class StepInfo(ctypes.Structure):
         ("action_id", ctypes.c_uint8),  # which action was passed
         ("action_success", ctypes.c_uint8),  # 1 if the selected action returned success
         ("forced_hard_drop", ctypes.c_uint8),  # 1 if lifetime forced a hard drop
+        ("action_mask", ctypes.c_uint16),  # legal actions of the resulting state (bit i = Action i)
     ]
 
     def __repr__(self) -> str:
-        return f"StepInfo(action_id={self.action_id}, action_success={bool(self.action_success)}, forced_hard_drop={bool(self.forced_hard_drop)})"
+        return f"StepInfo(action_id={self.action_id}, action_success={bool(self.action_success)}, forced_hard_drop={bool(self.forced_hard_drop)}, action_mask={self.action_mask:#06x})"
 
 
 class StepEnvConfig(ctypes.Structure):
@@ -67,18 +83,22 @@ class StepEnvConfig(ctypes.Structure):
         Number of steps before the engine forces a hard-drop (default 20).
     auto_drop:
         If non-zero, a ``softDrop`` is simulated every step (gravity).
+    action_mask:
+        If non-zero, every step fills ``StepInfo.action_mask`` with the
+        legal actions of the resulting state.
     """
 
     _fields_ = [
         ("piece_life", ctypes.c_int32),
         ("auto_drop", ctypes.c_uint8),
+        ("action_mask", ctypes.c_uint8),
     ]
 
-    def __init__(self, piece_life: int = 20, auto_drop: bool = True) -> None:
-        super().__init__(piece_life=piece_life, auto_drop=int(auto_drop))
+    def __init__(self, piece_life: int = 20, auto_drop: bool = True, action_mask: bool = False) -> None:
+        super().__init__(piece_life=piece_life, auto_drop=int(auto_drop), action_mask=int(action_mask))
 
     def __repr__(self) -> str:
-        return f"StepEnvConfig(piece_life={self.piece_life}, auto_drop={bool(self.auto_drop)})"
+        return f"StepEnvConfig(piece_life={self.piece_life}, auto_drop={bool(self.auto_drop)}, action_mask={bool(self.action_mask)})"
 
 
 class StepEnvContext(ctypes.Structure):
@@ -100,9 +120,256 @@ class StepEnvContext(ctypes.Structure):
         super().__init__(state=state, lifetime=lifetime, config=config)
 
 
+# Structured dtypes of the mirrors above: ``np.frombuffer`` over a
+# ``(StepEnvContext * n)`` / ``(StepInfo * n)`` array views it without copying.
+CONTEXT_DTYPE = structured_dtype(StepEnvContext)
+INFO_DTYPE = structured_dtype(StepInfo)
+
+
+class PluginTable(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::PluginTable`` in ``plugin.hpp``.
+
+    Plugin entry points (raw function addresses) plus the per-env plugin
+    context arrays used by the native vector driver.
+    """
+
+    _fields_ = [
+        ("feature_reset", ctypes.c_void_p),
+        ("feature_step_batch", ctypes.c_void_p),
+        ("reward_reset", ctypes.c_void_p),
+        ("reward_step_batch", ctypes.c_void_p),
+        ("fused_step_batch", ctypes.c_void_p),
+        ("feature_ctxs", ctypes.c_void_p),
+        ("reward_ctxs", ctypes.c_void_p),
+        ("feature_context_size", ctypes.c_int64),
+        ("reward_context_size", ctypes.c_int64),
+        ("feature_size", ctypes.c_int64),
+    ]
+
+
+class VectorBuffers(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::VectorBuffers`` in ``plugin.hpp``."""
+
+    _fields_ = [
+        ("obs", ctypes.c_void_p),
+        ("final_obs", ctypes.c_void_p),
+        ("rewards", ctypes.c_void_p),
+        ("terminated", ctypes.c_void_p),
+        ("truncated", ctypes.c_void_p),
+        ("infos", ctypes.c_void_p),
+        ("steps", ctypes.c_void_p),
+        ("episodes", ctypes.c_void_p),
+        ("seed", ctypes.c_uint64),
+        ("max_steps", ctypes.c_int32),
+        ("episode_telemetry", ctypes.c_void_p),
+        ("telemetry", ctypes.c_void_p),
+        ("start_states", ctypes.c_void_p),
+        ("start_state_count", ctypes.c_int32),
+        ("replay", ctypes.c_void_p),
+    ]
+
+
+TELEMETRY_BINS = 64
+TELEMETRY_PIECES = 7
+TELEMETRY_SPINS = 3
+TELEMETRY_CLEARS = 5
+TELEMETRY_HISTOGRAMS = (
+    "episode_steps",
+    "episode_pieces",
+    "episode_lines",
+    "episode_attack",
+    "episode_garbage",
+    "episode_app",
+    "placement_attack",
+    "placement_garbage",
+    "back_to_back",
+    "combo",
+)
+
+
+class StartStateOptions(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::StartStateOptions`` in ``start_states.hpp``."""
+
+    _fields_ = [
+        ("seed", ctypes.c_uint64),
+        ("min_height", ctypes.c_int32),
+        ("max_height", ctypes.c_int32),
+        ("min_garbage", ctypes.c_int32),
+        ("max_garbage", ctypes.c_int32),
+        ("garbage_messiness", ctypes.c_float),
+        ("hole_rate", ctypes.c_float),
+        ("threads", ctypes.c_int32),
+    ]
+
+
+START_STATE_MAX_HEIGHT = 18  # == START_STATE_MAX_HEIGHT
+
+
+class StepEpisodeTelemetry(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::EpisodeTelemetry`` in ``telemetry.hpp``."""
+
+    _fields_ = [
+        ("steps", ctypes.c_uint32),
+        ("pieces", ctypes.c_uint32),
+        ("lines", ctypes.c_uint32),
+        ("attack", ctypes.c_uint32),
+        ("garbage", ctypes.c_uint32),
+    ]
+
+
+class StepTelemetry(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::Telemetry`` in ``telemetry.hpp``."""
+
+    _fields_ = [
+        ("episodes", ctypes.c_uint64),
+        ("terminated", ctypes.c_uint64),
+        ("steps", ctypes.c_uint64),
+        ("pieces", ctypes.c_uint64),
+        ("lines", ctypes.c_uint64),
+        ("attack", ctypes.c_uint64),
+        ("garbage", ctypes.c_uint64),
+        ("perfect_clears", ctypes.c_uint64),
+        ("clears", ctypes.c_uint64 * TELEMETRY_CLEARS),
+        ("spins", ctypes.c_uint64 * TELEMETRY_CLEARS * TELEMETRY_SPINS * TELEMETRY_PIECES),
+        ("histograms", ctypes.c_uint64 * TELEMETRY_BINS * len(TELEMETRY_HISTOGRAMS)),
+    ]
+
+
+class ReplayStorage(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::ReplayStorage`` in ``replay.hpp``."""
+
+    _fields_ = [
+        ("obs", ctypes.c_void_p),
+        ("next_obs", ctypes.c_void_p),
+        ("actions", ctypes.c_void_p),
+        ("rewards", ctypes.c_void_p),
+        ("terminated", ctypes.c_void_p),
+        ("truncated", ctypes.c_void_p),
+        ("capacity", ctypes.c_int64),
+        ("feature_size", ctypes.c_int64),
+        ("alpha", ctypes.c_float),
+        ("seed", ctypes.c_uint64),
+    ]
+
+
+class ReplayBatchBuffers(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::ReplayBatch`` in ``replay.hpp``."""
+
+    _fields_ = [
+        ("obs", ctypes.c_void_p),
+        ("next_obs", ctypes.c_void_p),
+        ("actions", ctypes.c_void_p),
+        ("rewards", ctypes.c_void_p),
+        ("terminated", ctypes.c_void_p),
+        ("truncated", ctypes.c_void_p),
+        ("indices", ctypes.c_void_p),
+        ("weights", ctypes.c_void_p),
+    ]
+
+
+REPLAY_MAX_CAPACITY = 1 << 24  # == REPLAY_MAX_CAPACITY
+
+
+class Rollout(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::Rollout`` in ``returns.hpp``."""
+
+    _fields_ = [
+        ("rewards", ctypes.c_void_p),
+        ("values", ctypes.c_void_p),
+        ("terminated", ctypes.c_void_p),
+        ("truncated", ctypes.c_void_p),
+        ("final_values", ctypes.c_void_p),
+        ("last_values", ctypes.c_void_p),
+        ("steps", ctypes.c_int32),
+        ("envs", ctypes.c_int32),
+    ]
+
+
+CHECKPOINT_MAGIC = b"TETRLCKP"
+CHECKPOINT_VERSION = 1
+CHECKPOINT_ALIGN = 64
+CHECKPOINT_SECTIONS = ("contexts", "feature_contexts", "reward_contexts", "infos", "steps", "episodes", "observations")
+
+
+class CheckpointHeader(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::CheckpointHeader`` in ``checkpoint.hpp``."""
+
+    _fields_ = [
+        ("magic", ctypes.c_char * 8),
+        ("version", ctypes.c_uint32),
+        ("header_size", ctypes.c_uint32),
+        ("layout", ctypes.c_uint64),
+        ("file_size", ctypes.c_uint64),
+        ("num_envs", ctypes.c_uint32),
+        ("feature_size", ctypes.c_uint32),
+        ("feature_context_size", ctypes.c_uint64),
+        ("reward_context_size", ctypes.c_uint64),
+        ("feature_id", ctypes.c_uint8 * 32),
+        ("reward_id", ctypes.c_uint8 * 32),
+        ("seed", ctypes.c_uint64),
+        ("max_steps", ctypes.c_int32),
+        ("has_observations", ctypes.c_uint32),
+        ("offsets", ctypes.c_uint64 * len(CHECKPOINT_SECTIONS)),
+    ]
+
+
+BATTLE_TARGETING = ("random", "attackers", "ko", "badges")  # == BattleTargeting
+
+
+class BattleOptions(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::BattleOptions`` in ``battle.hpp``."""
+
+    _fields_ = [
+        ("seed", ctypes.c_uint64),
+        ("garbage_delay", ctypes.c_int32),
+        ("same_pieces", ctypes.c_uint8),
+        ("threads", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8 * 2),
+        ("config", StepEnvConfig),
+    ]
+
+
+class BattlePlayer(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::BattlePlayer`` in ``battle.hpp``."""
+
+    _fields_ = [
+        ("target", ctypes.c_int32),
+        ("attacker", ctypes.c_int32),
+        ("kos", ctypes.c_uint32),
+        ("received", ctypes.c_uint32),
+        ("sent", ctypes.c_uint16),
+        ("place", ctypes.c_uint16),
+        ("strategy", ctypes.c_uint8),
+        ("alive", ctypes.c_uint8),
+        ("height", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8),
+    ]
+
+
+class BattleRoomState(ctypes.Structure):
+    """Mirror of ``tetrl::envs::step::BattleRoom`` in ``battle.hpp``."""
+
+    _fields_ = [
+        ("contexts", ctypes.c_void_p),
+        ("players", ctypes.c_void_p),
+        ("size", ctypes.c_int32),
+        ("alive", ctypes.c_int32),
+        ("match", ctypes.c_uint32),
+        ("tick", ctypes.c_uint32),
+        ("options", BattleOptions),
+    ]
+
+
 _WRAPPER_SOURCE = (
-    f'#include "{_ENGINE_CPP}"\n'
-    f'#include "{_STEP_HPP}"\n\n'
+    f'#include "{_ENGINE_HPP}"\n'
+    f'#include "{_STEP_HPP}"\n'
+    f'#include "{_PLUGIN_HPP}"\n'
+    f'#include "{_CHECKPOINT_HPP}"\n'
+    f'#include "{_TELEMETRY_HPP}"\n'
+    f'#include "{_START_STATES_HPP}"\n'
+    f'#include "{_REPLAY_HPP}"\n'
+    f'#include "{_RETURNS_HPP}"\n'
+    f'#include "{_BATTLE_HPP}"\n\n'
     + r"""
 using namespace tetrl::envs::step;
 
@@ -122,23 +389,126 @@ API void api_envReset(Context* ctx) {
 API void api_envStep(Context* ctx, std::uint8_t action, Info* out) {
     *out = step(ctx, static_cast<Action>(action));
 }
+
+API std::uint16_t api_envActionMask(Context* ctx) {
+    return legalActions(ctx);
+}
+
+API void api_envStepBatch(Context* ctxs, const std::uint8_t* actions, Info* infos, std::uint16_t* masks, std::int32_t n) {
+    static_assert(sizeof(Action) == sizeof(std::uint8_t));
+    stepBatch(ctxs, reinterpret_cast<const Action*>(actions), infos, masks, n);
+}
+
+API std::int32_t api_envStepSequence(Context* ctx, const std::uint8_t* actions, std::int32_t n, std::uint8_t stop, Info* last,
+                                     void* reward_step_batch, void* reward_ctx, float* reward_sum) {
+    return stepSequence(ctx, reinterpret_cast<const Action*>(actions), n, stop, last,
+                        reinterpret_cast<RewardStepBatchFn>(reward_step_batch), reward_ctx, reward_sum);
+}
+
+API void api_vectorReset(const PluginTable* table, Context* ctxs, const VectorBuffers* buffers, std::int32_t n) {
+    vectorReset(table, ctxs, buffers, n);
+}
+
+API void api_vectorStep(const PluginTable* table, Context* ctxs, const std::uint8_t* actions, const VectorBuffers* buffers, std::int32_t n) {
+    vectorStep(table, ctxs, reinterpret_cast<const Action*>(actions), buffers, n);
+}
+
+static_assert(sizeof(CheckpointHeader) == 192 && SECTION_COUNT == 7, "CheckpointHeader changed; update tetrl/envs/step/native.py");
+
+API std::uint64_t api_contextLayoutHash() {
+    return contextLayoutHash();
+}
+
+static_assert(TELEMETRY_BINS == 64 && TELEMETRY_PIECES == 7 && TELEMETRY_SPINS == 3 && TELEMETRY_CLEARS == 5
+              && TELEMETRY_HISTOGRAMS == 10, "Telemetry changed; update tetrl/envs/step/native.py");
+static_assert(sizeof(EpisodeTelemetry) == 20 && sizeof(Telemetry) == 8 * (8 + 5 + 7 * 3 * 5 + 10 * 64));
+
+API void api_telemetryMerge(Telemetry* into, const Telemetry* from) {
+    mergeTelemetry(into, from);
+}
+
+static_assert(sizeof(StartStateOptions) == 40 && START_STATE_MAX_HEIGHT == 18, "StartStateOptions changed; update tetrl/envs/step/native.py");
+
+API std::int32_t api_generateStartStates(const StartStateOptions* options, std::uint32_t first, std::int32_t count, tetrl::Board* out) {
+    return generateStartStates(*options, first, count, out);
+}
+
+static_assert(sizeof(ReplayStorage) == 80 && sizeof(ReplayBatch) == 64 && REPLAY_MAX_CAPACITY == 1 << 24,
+              "replay structs changed; update tetrl/envs/step/native.py");
+
+API void* api_replayCreate(const ReplayStorage* storage) {
+    return new ReplayBuffer(*storage);
+}
+
+API void api_replayDestroy(void* replay) {
+    delete static_cast<ReplayBuffer*>(replay);
+}
+
+API std::int64_t api_replaySize(void* replay) {
+    return static_cast<ReplayBuffer*>(replay)->size();
+}
+
+API void api_replayAdd(void* replay, const float* obs, const float* next_obs, const std::uint8_t* actions, const float* rewards,
+                       const std::uint8_t* terminated, const std::uint8_t* truncated, std::int32_t n) {
+    static_cast<ReplayBuffer*>(replay)->add(obs, next_obs, actions, rewards, terminated, truncated, n);
+}
+
+API std::int32_t api_replaySample(void* replay, std::int32_t count, float beta, std::uint64_t stream, const ReplayBatch* out) {
+    return static_cast<ReplayBuffer*>(replay)->sample(count, beta, stream, *out);
+}
+
+API void api_replayUpdatePriorities(void* replay, const std::int64_t* slots, const float* priorities, std::int32_t n) {
+    static_cast<ReplayBuffer*>(replay)->updatePriorities(slots, priorities, n);
+}
+
+API void api_replayPriorities(void* replay, double* out) {
+    const ReplayBuffer* buffer = static_cast<ReplayBuffer*>(replay);
+    for (std::int64_t i = 0; i < buffer->capacity(); ++i) { out[i] = buffer->priority(i); }
+}
+
+static_assert(sizeof(Rollout) == 56, "Rollout changed; update tetrl/envs/step/native.py");
+
+API void api_computeGae(const Rollout* rollout, float gamma, float lambda, float* advantages, float* returns, std::int32_t threads) {
+    computeGae(*rollout, gamma, lambda, advantages, returns, threads);
+}
+
+API void api_computeNStepReturns(const Rollout* rollout, std::int32_t horizon, float gamma, float* out, std::int32_t threads) {
+    computeNStepReturns(*rollout, horizon, gamma, out, threads);
+}
+
+static_assert(TARGET_COUNT == 4, "BattleTargeting changed; update tetrl/envs/step/native.py");
+
+API void api_battleReset(BattleRoom* room) {
+    battleReset(room);
+}
+
+API std::int32_t api_battleStep(BattleRoom* room, const std::uint8_t* actions, Info* infos) {
+    return battleStep(room, reinterpret_cast<const Action*>(actions), infos);
+}
 """
+    + layout_static_asserts("Config", StepEnvConfig)
+    + layout_static_asserts("Context", StepEnvContext)
+    + layout_static_asserts("Info", StepInfo)
+    + layout_static_asserts("BattleOptions", BattleOptions)
+    + layout_static_asserts("BattlePlayer", BattlePlayer)
+    + layout_static_asserts("BattleRoom", BattleRoomState)
 )
 
-_lib = dl.DynamicLibrary(
-    extra_compile_flags=[
-        f"-I{CSRC_DIR}",
-        "-std=c++17",
-        "-O3",
-    ]
-)
+_lib = create_library(extra_compile_flags=["-pthread"])
 
 _lib.compile_string(
     _WRAPPER_SOURCE,
     watch_files=[
         csrc_path(_ENGINE_HPP),
-        csrc_path(_ENGINE_CPP),
         csrc_path(_STEP_HPP),
+        csrc_path(_PLUGIN_HPP),
+        csrc_path(_ANALYSIS_HPP),
+        csrc_path(_CHECKPOINT_HPP),
+        csrc_path(_TELEMETRY_HPP),
+        csrc_path(_START_STATES_HPP),
+        csrc_path(_REPLAY_HPP),
+        csrc_path(_RETURNS_HPP),
+        csrc_path(_BATTLE_HPP),
     ],
     functions={
         # All struct pointers are passed as void* (c_void_p); we obtain the
@@ -147,6 +517,34 @@ _lib.compile_string(
         "api_envSetSeed": {"argtypes": [dl.void_p, dl.uint32, dl.uint32], "restype": dl.void},
         "api_envReset": {"argtypes": [dl.void_p], "restype": dl.void},
         "api_envStep": {"argtypes": [dl.void_p, dl.uint8, dl.void_p], "restype": dl.void},
+        "api_envActionMask": {"argtypes": [dl.void_p], "restype": dl.uint16},
+        "api_envStepBatch": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32], "restype": dl.void},
+        "api_envStepSequence": {
+            "argtypes": [dl.void_p, dl.void_p, dl.int32, dl.uint8, dl.void_p, dl.void_p, dl.void_p, dl.void_p],
+            "restype": dl.int32,
+        },
+        "api_vectorReset": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.int32], "restype": dl.void},
+        "api_vectorStep": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32], "restype": dl.void},
+        "api_contextLayoutHash": {"argtypes": [], "restype": dl.uint64},
+        "api_telemetryMerge": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
+        "api_generateStartStates": {"argtypes": [dl.void_p, dl.uint32, dl.int32, dl.void_p], "restype": dl.int32},
+        "api_replayCreate": {"argtypes": [dl.void_p], "restype": dl.void_p},
+        "api_replayDestroy": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_replaySize": {"argtypes": [dl.void_p], "restype": dl.int64},
+        "api_replayAdd": {
+            "argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32],
+            "restype": dl.void,
+        },
+        "api_replaySample": {"argtypes": [dl.void_p, dl.int32, dl.float, dl.uint64, dl.void_p], "restype": dl.int32},
+        "api_replayUpdatePriorities": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.int32], "restype": dl.void},
+        "api_replayPriorities": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
+        "api_computeGae": {
+            "argtypes": [dl.void_p, dl.float, dl.float, dl.void_p, dl.void_p, dl.int32],
+            "restype": dl.void,
+        },
+        "api_computeNStepReturns": {"argtypes": [dl.void_p, dl.int32, dl.float, dl.void_p, dl.int32], "restype": dl.void},
+        "api_battleReset": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_battleStep": {"argtypes": [dl.void_p, dl.void_p, dl.void_p], "restype": dl.int32},
     },
 )
 
@@ -159,10 +557,13 @@ def env_set_config(ctx: StepEnvContext, config: StepEnvConfig) -> None:
 def env_set_seed(ctx: StepEnvContext, seed: int, garbage_seed: int) -> None:
     """Seed both the piece-bag RNG and the garbage RNG.
 
+    The piece stream is counter-based, so any *seed* is valid and equal
+    seeds reproduce the same bag sequence.
+
     .. warning::
 
-       The engine uses **xorshift32** which has a fixed point at 0.
-       Callers must ensure neither *seed* nor *garbage_seed* is 0.
+       The garbage RNG uses **xorshift32** which has a fixed point at 0.
+       Callers must ensure *garbage_seed* is not 0.
     """
     _lib.api_envSetSeed(ctypes.addressof(ctx), seed, garbage_seed)
 
@@ -185,7 +586,8 @@ def env_step(ctx: StepEnvContext, action: Action | int) -> StepInfo:
     Returns
     -------
     StepInfo
-        Contains ``action_id`` and ``action_success``.
+        Contains ``action_id``, ``action_success``, ``forced_hard_drop``
+        and (when ``config.action_mask`` is set) ``action_mask``.
     """
     info = StepInfo()
     _lib.api_envStep(
@@ -194,3 +596,201 @@ def env_step(ctx: StepEnvContext, action: Action | int) -> StepInfo:
         ctypes.addressof(info),
     )
     return info
+
+
+def env_action_mask(ctx: StepEnvContext) -> int:
+    """Return the legal-action bitmask of *ctx* (bit ``i`` = :class:`Action` ``i``)."""
+    return int(_lib.api_envActionMask(ctypes.addressof(ctx)))
+
+
+def env_step_batch(
+    ctxs: "ctypes.Array[StepEnvContext]",
+    actions: np.ndarray,
+    infos: "ctypes.Array[StepInfo]",
+    masks: np.ndarray | None = None,
+) -> None:
+    """Step every context of a contiguous ``StepEnvContext`` array in one native call.
+
+    Parameters
+    ----------
+    ctxs:
+        ``(StepEnvContext * n)`` array, mutated in place.
+    actions:
+        ``uint8`` array of shape ``(n,)``.
+    infos:
+        ``(StepInfo * n)`` array receiving the per-env results.
+    masks:
+        Optional ``uint16`` array of shape ``(n,)`` receiving the
+        legal-action mask of every resulting state.
+    """
+    n = len(ctxs)
+    if actions.dtype != np.uint8 or not actions.flags.c_contiguous or actions.shape != (n,):
+        raise ValueError(f"actions must be a contiguous uint8 array of shape ({n},)")
+    if len(infos) != n:
+        raise ValueError(f"infos must hold {n} entries")
+    if masks is not None and (masks.dtype != np.uint16 or not masks.flags.c_contiguous or masks.shape != (n,)):
+        raise ValueError(f"masks must be a contiguous uint16 array of shape ({n},)")
+    _lib.api_envStepBatch(
+        ctypes.addressof(ctxs),
+        actions.ctypes.data,
+        ctypes.addressof(infos),
+        masks.ctypes.data if masks is not None else None,
+        n,
+    )
+
+
+def env_step_sequence(
+    ctx: StepEnvContext,
+    actions: np.ndarray,
+    *,
+    stop_on_death: bool = True,
+    stop_on_lock: bool = False,
+    reward_step_batch: int | None = None,
+    reward_ctx: int = 0,
+) -> tuple[int, StepInfo, float]:
+    """Execute a sequence of actions in one native call.
+
+    Parameters
+    ----------
+    ctx:
+        The environment context to mutate.
+    actions:
+        Contiguous ``uint8`` array of :class:`Action` values.
+    stop_on_death, stop_on_lock:
+        Stop after the step that ends the game / locks a piece.
+    reward_step_batch, reward_ctx:
+        Optional reward plugin entry point (see
+        :attr:`~tetrl.envs.step.reward.CppReward.native_entry_points`) and
+        its context address; it is evaluated after every executed step.
+
+    Returns
+    -------
+    tuple[int, StepInfo, float]
+        Number of executed actions, the ``StepInfo`` of the last one and
+        the summed reward (``0.0`` without a reward plugin).
+    """
+    if actions.dtype != np.uint8 or not actions.flags.c_contiguous or actions.ndim != 1:
+        raise ValueError("actions must be a contiguous 1-D uint8 array")
+    last = StepInfo()
+    reward_sum = ctypes.c_float(0.0)
+    stop = (1 if stop_on_death else 0) | (2 if stop_on_lock else 0)  # SequenceStop
+    executed = _lib.api_envStepSequence(
+        ctypes.addressof(ctx),
+        actions.ctypes.data,
+        len(actions),
+        stop,
+        ctypes.addressof(last),
+        reward_step_batch,
+        reward_ctx or None,
+        ctypes.addressof(reward_sum),
+    )
+    return int(executed), last, float(reward_sum.value)
+
+
+def context_layout_hash() -> int:
+    """Fingerprint of the native ``Context`` / ``Info`` layout (``contextLayoutHash``)."""
+    return int(_lib.api_contextLayoutHash())
+
+
+def telemetry_merge(into: StepTelemetry, other: StepTelemetry) -> None:
+    """Add every counter of *other* to *into* (``mergeTelemetry``)."""
+    _lib.api_telemetryMerge(ctypes.addressof(into), ctypes.addressof(other))
+
+
+def generate_start_states(options: StartStateOptions, first: int, out: ctypes.Array) -> int:
+    """Fill the board array *out* with start states ``first ..`` of *options* (``generateStartStates``).
+
+    Returns the number of states that fell back to an empty board.
+    """
+    return int(_lib.api_generateStartStates(ctypes.addressof(options), first, len(out), ctypes.addressof(out)))
+
+
+def replay_create(storage: ReplayStorage) -> int:
+    """Native ``ReplayBuffer`` over the arrays of *storage*; release with :func:`replay_destroy`."""
+    return _lib.api_replayCreate(ctypes.addressof(storage))
+
+
+def replay_destroy(handle: int) -> None:
+    _lib.api_replayDestroy(handle)
+
+
+def replay_size(handle: int) -> int:
+    """Transitions that can be sampled."""
+    return int(_lib.api_replaySize(handle))
+
+
+def replay_add(handle: int, obs: np.ndarray, next_obs: np.ndarray, actions: np.ndarray, rewards: np.ndarray,
+               terminated: np.ndarray, truncated: np.ndarray) -> None:
+    """Append ``len(actions)`` transitions from contiguous rows (``ReplayBuffer::add``)."""
+    _lib.api_replayAdd(
+        handle, obs.ctypes.data, next_obs.ctypes.data, actions.ctypes.data, rewards.ctypes.data,
+        terminated.ctypes.data, truncated.ctypes.data, len(actions),
+    )
+
+
+def replay_sample(handle: int, count: int, beta: float, stream: int, out: ReplayBatchBuffers) -> int:
+    """Draw *count* transitions into the arrays of *out*; returns how many were drawn."""
+    return int(_lib.api_replaySample(handle, count, beta, stream, ctypes.addressof(out)))
+
+
+def replay_update_priorities(handle: int, slots: np.ndarray, priorities: np.ndarray) -> None:
+    """Set the priorities of *slots* (``int64``) to *priorities* (``float32``)."""
+    _lib.api_replayUpdatePriorities(handle, slots.ctypes.data, priorities.ctypes.data, len(slots))
+
+
+def replay_priorities(handle: int, out: np.ndarray) -> None:
+    """Write priority^alpha of every slot into the ``float64`` array *out*."""
+    _lib.api_replayPriorities(handle, out.ctypes.data)
+
+
+def compute_gae(rollout: Rollout, gamma: float, lam: float, advantages: np.ndarray, returns: np.ndarray, threads: int) -> None:
+    """GAE advantages and returns of *rollout* into the ``float32`` arrays given (``computeGae``)."""
+    _lib.api_computeGae(ctypes.addressof(rollout), gamma, lam, advantages.ctypes.data, returns.ctypes.data, threads)
+
+
+def compute_n_step_returns(rollout: Rollout, horizon: int, gamma: float, out: np.ndarray, threads: int) -> None:
+    """*horizon*-step returns of *rollout* into the ``float32`` array *out* (``computeNStepReturns``)."""
+    _lib.api_computeNStepReturns(ctypes.addressof(rollout), horizon, gamma, out.ctypes.data, threads)
+
+
+def battle_reset(room: BattleRoomState) -> None:
+    """Start the next match of *room* (``battleReset``)."""
+    _lib.api_battleReset(ctypes.addressof(room))
+
+
+def battle_step(room: BattleRoomState, actions: np.ndarray, infos: "ctypes.Array[StepInfo]") -> int:
+    """Advance *room* by one tick (``battleStep``); returns the players left.
+
+    *actions* must be a contiguous ``uint8`` array with one entry per player.
+    """
+    if actions.dtype != np.uint8 or not actions.flags.c_contiguous or actions.shape != (room.size,):
+        raise ValueError(f"actions must be a contiguous uint8 array of shape ({room.size},)")
+    if len(infos) != room.size:
+        raise ValueError(f"infos must hold {room.size} entries")
+    return int(_lib.api_battleStep(ctypes.addressof(room), actions.ctypes.data, ctypes.addressof(infos)))
+
+
+def vector_reset(table: PluginTable, ctxs: "ctypes.Array[StepEnvContext]", buffers: VectorBuffers) -> None:
+    """Start the next episode of every context and write the initial observations.
+
+    The piece and garbage seeds of each episode are derived natively from
+    ``buffers.seed``, the env index and ``buffers.episodes[i]``.
+    """
+    _lib.api_vectorReset(ctypes.addressof(table), ctypes.addressof(ctxs), ctypes.addressof(buffers), len(ctxs))
+
+
+def vector_step(
+    table: PluginTable,
+    ctxs: "ctypes.Array[StepEnvContext]",
+    actions: np.ndarray,
+    buffers: VectorBuffers,
+) -> None:
+    """Step every context, run both plugins in one batch call each, autoreset finished envs.
+
+    *actions* must be a contiguous ``uint8`` array of shape ``(n,)``; all
+    results are written into the arrays referenced by *buffers*.
+    """
+    n = len(ctxs)
+    if actions.dtype != np.uint8 or not actions.flags.c_contiguous or actions.shape != (n,):
+        raise ValueError(f"actions must be a contiguous uint8 array of shape ({n},)")
+    _lib.api_vectorStep(ctypes.addressof(table), ctypes.addressof(ctxs), actions.ctypes.data, ctypes.addressof(buffers), n)
@@ -0,0 +1,257 @@
+"""
+Native replay buffer that vector envs write their transitions into.
+
+A :class:`ReplayBuffer` is a fixed-capacity ring of transitions
+``(obs, action, reward, terminated, truncated, next_obs)`` whose arrays
+are allocated here and shared with the native ``ReplayBuffer`` (see
+``replay.hpp``).  Attached to a
+:class:`~tetrl.envs.step.vector.StepVectorEnv` with
+:meth:`~tetrl.envs.step.vector.StepVectorEnv.set_replay`, every
+:meth:`~tetrl.envs.step.vector.StepVectorEnv.step` stores the pool's
+transitions inside the same native call, straight from the plugin output
+rows, so nothing passes through Python.  Several pools (e.g. stepped on
+different threads) can write into one buffer; insertion is lock-free.
+
+With ``prioritized=True`` sampling is proportional to ``priority ** alpha``
+over a sum tree, with importance-sampling weights; otherwise uniform.
+
+Examples
+--------
+>>> envs = StepVectorEnv(64)
+>>> replay = ReplayBuffer.for_env(envs, 1_000_000 // 64 * 64, prioritized=True)
+>>> envs.set_replay(replay)
+>>> envs.reset(seed=0)
+>>> for _ in range(1000):
+...     envs.step(envs.action_space.sample())
+>>> batch = replay.sample(256, beta=0.4)
+>>> replay.update_priorities(batch.indices, np.abs(td_errors) + 1e-3)
+"""
+
+from __future__ import annotations
+
+import math
+from typing import Any, NamedTuple, Sequence
+
+import numpy as np
+
+from .native import (
+    REPLAY_MAX_CAPACITY,
+    ReplayBatchBuffers,
+    ReplayStorage,
+    replay_add,
+    replay_create,
+    replay_destroy,
+    replay_priorities,
+    replay_sample,
+    replay_size,
+    replay_update_priorities,
+)
+
+__all__ = ["ReplayBatch", "ReplayBuffer"]
+
+
+class ReplayBatch(NamedTuple):
+    """Transitions drawn by :meth:`ReplayBuffer.sample`, one row per draw."""
+
+    obs: np.ndarray
+    actions: np.ndarray
+    rewards: np.ndarray
+    terminated: np.ndarray
+    truncated: np.ndarray
+    next_obs: np.ndarray
+    indices: np.ndarray  # slots, for ReplayBuffer.update_priorities
+    weights: np.ndarray  # importance-sampling weights (all 1 when uniform)
+
+
+class ReplayBuffer:
+    """Fixed-capacity circular transition storage.
+
+    Parameters
+    ----------
+    capacity:
+        Transitions kept; the oldest are overwritten.  Must exceed the
+        number of envs writing at once.
+    observation_shape:
+        Shape of one observation (a ``CppFeature`` row of
+        ``prod(observation_shape)`` floats).
+    prioritized:
+        Sample proportionally to ``priority ** alpha`` (new transitions get
+        the largest priority seen so far) instead of uniformly.
+    seed:
+        Seed of the sampling streams.
+
+    Notes
+    -----
+    Observations are stored twice per transition (before and after the
+    step), ``8 * prod(observation_shape)`` bytes in total.
+    """
+
+    def __init__(
+        self,
+        capacity: int,
+        observation_shape: int | Sequence[int],
+        *,
+        prioritized: bool = False,
+        alpha: float = 0.6,
+        seed: int = 0,
+    ) -> None:
+        if not 1 <= capacity <= REPLAY_MAX_CAPACITY:
+            raise ValueError(f"capacity must be in [1, {REPLAY_MAX_CAPACITY}], got {capacity}")
+        if prioritized and alpha <= 0:
+            raise ValueError(f"alpha must be positive for prioritized sampling, got {alpha}")
+        shape = (observation_shape,) if isinstance(observation_shape, int) else tuple(observation_shape)
+        self.capacity = capacity
+        self.observation_shape = shape
+        self.feature_size = math.prod(shape)
+        self.prioritized = prioritized
+        self._obs = np.zeros((capacity, self.feature_size), dtype=np.float32)
+        self._next_obs = np.zeros((capacity, self.feature_size), dtype=np.float32)
+        self._actions = np.zeros(capacity, dtype=np.uint8)
+        self._rewards = np.zeros(capacity, dtype=np.float32)
+        self._terminated = np.zeros(capacity, dtype=np.uint8)
+        self._truncated = np.zeros(capacity, dtype=np.uint8)
+        self._storage = ReplayStorage(
+            obs=self._obs.ctypes.data,
+            next_obs=self._next_obs.ctypes.data,
+            actions=self._actions.ctypes.data,
+            rewards=self._rewards.ctypes.data,
+            terminated=self._terminated.ctypes.data,
+            truncated=self._truncated.ctypes.data,
+            capacity=capacity,
+            feature_size=self.feature_size,
+            alpha=alpha if prioritized else 0.0,
+            seed=seed & (2**64 - 1),
+        )
+        self._stream = 0
+        self._handle = replay_create(self._storage)
+
+    @classmethod
+    def for_env(cls, envs: Any, capacity: int, **kwargs: Any) -> "ReplayBuffer":
+        """Buffer shaped for the observations of *envs* (a ``StepVectorEnv``)."""
+        return cls(capacity, envs.single_observation_space.shape, **kwargs)
+
+    @property
+    def handle(self) -> int:
+        """Address of the native ``ReplayBuffer``."""
+        if self._handle is None:
+            raise RuntimeError("replay buffer is closed")
+        return self._handle
+
+    def __len__(self) -> int:
+        return replay_size(self.handle)
+
+    # -- storage views ----------------------------------------------------------
+
+    @property
+    def observations(self) -> np.ndarray:
+        """``(capacity, *observation_shape)`` view of the stored observations."""
+        return self._obs.reshape(self.capacity, *self.observation_shape)
+
+    @property
+    def next_observations(self) -> np.ndarray:
+        return self._next_obs.reshape(self.capacity, *self.observation_shape)
+
+    @property
+    def actions(self) -> np.ndarray:
+        return self._actions
+
+    @property
+    def rewards(self) -> np.ndarray:
+        return self._rewards
+
+    @property
+    def terminated(self) -> np.ndarray:
+        return self._terminated
+
+    @property
+    def truncated(self) -> np.ndarray:
+        return self._truncated
+
+    @property
+    def priorities(self) -> np.ndarray:
+        """``priority ** alpha`` of every slot (zeros when uniform)."""
+        out = np.zeros(self.capacity, dtype=np.float64)
+        replay_priorities(self.handle, out)
+        return out
+
+    # -- producers and consumers ------------------------------------------------
+
+    def add(
+        self,
+        obs: Any,
+        actions: Any,
+        rewards: Any,
+        terminated: Any,
+        truncated: Any,
+        next_obs: Any,
+    ) -> None:
+        """Append a batch of transitions produced outside a vector env."""
+        actions = np.ascontiguousarray(actions, dtype=np.uint8).reshape(-1)
+        n = len(actions)
+        obs = np.ascontiguousarray(obs, dtype=np.float32).reshape(n, self.feature_size)
+        next_obs = np.ascontiguousarray(next_obs, dtype=np.float32).reshape(n, self.feature_size)
+        columns = [np.ascontiguousarray(rewards, dtype=np.float32).reshape(-1)]
+        columns += [np.ascontiguousarray(flags, dtype=np.uint8).reshape(-1) for flags in (terminated, truncated)]
+        if any(len(column) != n for column in columns):
+            raise ValueError("actions, rewards, terminated and truncated must have the same length")
+        if n > self.capacity:
+            raise ValueError(f"cannot add {n} transitions to a buffer of capacity {self.capacity}")
+        replay_add(self.handle, obs, next_obs, actions, *columns)
+
+    def sample(self, batch_size: int, *, beta: float = 0.4) -> ReplayBatch:
+        """Draw *batch_size* transitions (with replacement) in one native call.
+
+        *beta* is the importance-sampling exponent of prioritized sampling;
+        weights are scaled so that the largest in the batch is 1.
+        """
+        if batch_size < 1:
+            raise ValueError(f"batch_size must be positive, got {batch_size}")
+        if len(self) == 0:
+            raise ValueError("cannot sample from an empty replay buffer")
+        batch = ReplayBatch(
+            obs=np.empty((batch_size, *self.observation_shape), dtype=np.float32),
+            actions=np.empty(batch_size, dtype=np.uint8),
+            rewards=np.empty(batch_size, dtype=np.float32),
+            terminated=np.empty(batch_size, dtype=np.uint8),
+            truncated=np.empty(batch_size, dtype=np.uint8),
+            next_obs=np.empty((batch_size, *self.observation_shape), dtype=np.float32),
+            indices=np.empty(batch_size, dtype=np.int64),
+            weights=np.empty(batch_size, dtype=np.float32),
+        )
+        out = ReplayBatchBuffers(**{name: getattr(batch, name).ctypes.data for name in ReplayBatch._fields})
+        self._stream += 1
+        drawn = replay_sample(self.handle, batch_size, beta, self._stream, out)
+        if drawn < batch_size:  # only when every slot was being rewritten
+            batch = ReplayBatch(*(array[:drawn] for array in batch))
+        return batch
+
+    def update_priorities(self, indices: Any, priorities: Any) -> None:
+        """Set the priorities of the sampled *indices* (e.g. ``|TD error| + eps``).
+
+        Raises ``ValueError`` for indices outside the filled slots and for
+        negative or non-finite priorities.
+        """
+        slots = np.ascontiguousarray(indices, dtype=np.int64).reshape(-1)
+        values = np.ascontiguousarray(priorities, dtype=np.float32).reshape(-1)
+        if len(slots) != len(values):
+            raise ValueError("indices and priorities must have the same length")
+        size = len(self)
+        if len(slots) and (slots.min() < 0 or slots.max() >= size):
+            raise ValueError(f"indices must be in [0, {size}), got {slots.min()}..{slots.max()}")
+        if not np.all(np.isfinite(values) & (values >= 0)):
+            raise ValueError("priorities must be finite and non-negative")
+        replay_update_priorities(self.handle, slots, values)
+
+    def close(self) -> None:
+        """Release the native buffer (envs must no longer write into it)."""
+        if self._handle is not None:
+            replay_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self) -> None:
+        self.close()
+
+    def __repr__(self) -> str:
+        kind = "prioritized" if self.prioritized else "uniform"
+        size = len(self) if self._handle is not None else 0
+        return f"ReplayBuffer({size}/{self.capacity}, {kind}, observation_shape={self.observation_shape})"
@@ -0,0 +1,157 @@
+"""
+Native GAE and n-step returns over batched rollouts.
+
+Both kernels (``returns.hpp``) take ``[T, N]`` arrays laid out the way a
+:class:`~tetrl.envs.step.vector.StepVectorEnv` rollout is collected (row
+``t`` = the rewards / flags returned by step ``t``) plus the policy's value
+estimates, and write into preallocated ``float32`` arrays.  They are
+parallel over envs and vectorised over the env dimension.
+
+Episode ends follow the vector env's autoreset: a ``terminated`` step is
+not bootstrapped; a ``truncated`` step (``max_steps``) bootstraps from
+``final_values[t]``, the value of ``infos["final_obs"]``; neither carries
+the recursion into the next episode.
+
+Examples
+--------
+>>> T, N = 128, 64
+>>> rewards = np.empty((T, N), np.float32); terminated = np.empty((T, N), bool); ...
+>>> for t in range(T):
+...     obs, rewards[t], terminated[t], truncated[t], infos = envs.step(actions)
+>>> advantages, returns = compute_gae(rewards, values, terminated, truncated, last_values,
+...                                   final_values=final_values, gamma=0.99, lam=0.95)
+"""
+
+from __future__ import annotations
+
+import os
+from typing import Any
+
+import numpy as np
+
+from .native import Rollout, compute_gae as _compute_gae, compute_n_step_returns as _compute_n_step_returns
+
+__all__ = ["compute_gae", "compute_n_step_returns"]
+
+
+def _floats(name: str, array: Any, shape: tuple[int, ...]) -> np.ndarray:
+    out = np.ascontiguousarray(array, dtype=np.float32)
+    if out.shape != shape:
+        raise ValueError(f"{name} must have shape {shape}, got {out.shape}")
+    return out
+
+
+def _flags(name: str, array: Any, shape: tuple[int, ...]) -> np.ndarray:
+    out = np.asarray(array)
+    out = np.ascontiguousarray(out if out.dtype == np.bool_ else out != 0).view(np.uint8)  # the kernels need 0 / 1
+    if out.shape != shape:
+        raise ValueError(f"{name} must have shape {shape}, got {out.shape}")
+    return out
+
+
+def _output(name: str, array: np.ndarray | None, shape: tuple[int, ...], inputs: list) -> np.ndarray:
+    """Preallocated output *array* (or a new one); it must not overlap any of *inputs*, which the kernels read while writing."""
+    if array is None:
+        return np.empty(shape, dtype=np.float32)
+    if array.dtype != np.float32 or array.shape != shape or not array.flags.c_contiguous:
+        raise ValueError(f"{name} must be a contiguous float32 array of shape {shape}")
+    if any(np.shares_memory(array, other) for other in inputs):
+        raise ValueError(f"{name} must not share memory with another argument")
+    return array
+
+
+def _rollout(rewards: Any, values: Any, terminated: Any, truncated: Any, last_values: Any, final_values: Any) -> tuple[Rollout, list]:
+    r = np.ascontiguousarray(rewards, dtype=np.float32)
+    if r.ndim != 2:
+        raise ValueError(f"rewards must have shape (T, N), got {r.shape}")
+    shape = r.shape
+    arrays = [
+        r,
+        _floats("values", values, shape),
+        _flags("terminated", terminated, shape),
+        _flags("truncated", truncated, shape),
+        _floats("last_values", last_values, shape[1:]),
+    ]
+    if final_values is not None:
+        arrays.append(_floats("final_values", final_values, shape))
+    elif arrays[3].any():
+        raise ValueError("truncated steps need final_values, the values of infos['final_obs']")
+    rollout = Rollout(
+        rewards=arrays[0].ctypes.data,
+        values=arrays[1].ctypes.data,
+        terminated=arrays[2].ctypes.data,
+        truncated=arrays[3].ctypes.data,
+        final_values=arrays[5].ctypes.data if final_values is not None else None,
+        last_values=arrays[4].ctypes.data,
+        steps=shape[0],
+        envs=shape[1],
+    )
+    return rollout, arrays  # the arrays keep the pointers valid
+
+
+def compute_gae(
+    rewards: Any,
+    values: Any,
+    terminated: Any,
+    truncated: Any,
+    last_values: Any,
+    *,
+    final_values: Any = None,
+    gamma: float = 0.99,
+    lam: float = 0.95,
+    advantages: np.ndarray | None = None,
+    returns: np.ndarray | None = None,
+    threads: int | None = None,
+) -> tuple[np.ndarray, np.ndarray]:
+    """Generalised advantage estimates and their returns (``advantages + values``).
+
+    Parameters
+    ----------
+    rewards, values, terminated, truncated:
+        ``(T, N)`` arrays; ``values[t]`` is the value of the observation
+        step ``t`` acted on.
+    last_values:
+        ``(N,)`` values of the observations after the last step.
+    final_values:
+        ``(T, N)`` values of the final observations, read where
+        ``truncated`` is set (required if any step is truncated).
+    advantages, returns:
+        Optional preallocated ``(T, N)`` ``float32`` outputs; they must not
+        overlap the inputs or each other (``ValueError``).
+    threads:
+        Worker threads (default: ``os.cpu_count()``).
+    """
+    rollout, keep = _rollout(rewards, values, terminated, truncated, last_values, final_values)
+    shape = keep[0].shape
+    advantages = _output("advantages", advantages, shape, keep)
+    returns = _output("returns", returns, shape, keep + [advantages])
+    _compute_gae(rollout, gamma, lam, advantages, returns, threads if threads is not None else (os.cpu_count() or 1))
+    return advantages, returns
+
+
+def compute_n_step_returns(
+    rewards: Any,
+    values: Any,
+    terminated: Any,
+    truncated: Any,
+    last_values: Any,
+    *,
+    n: int,
+    final_values: Any = None,
+    gamma: float = 0.99,
+    out: np.ndarray | None = None,
+    threads: int | None = None,
+) -> np.ndarray:
+    """*n*-step bootstrapped returns ``sum_k gamma^k r_{t+k} + gamma^m V(s_{t+m})``.
+
+    The window stops at the episode end (bootstrapping from
+    ``final_values`` on truncation, not at all on termination) and at the
+    rollout end (bootstrapping from ``last_values``).  Arguments as in
+    :func:`compute_gae`.
+    """
+    if n < 1:
+        raise ValueError(f"n must be positive, got {n}")
+    rollout, keep = _rollout(rewards, values, terminated, truncated, last_values, final_values)
+    out = _output("out", out, keep[0].shape, keep)
+    _compute_n_step_returns(rollout, n, gamma, out, threads if threads is not None else (os.cpu_count() or 1))
+    return out
@@ -17,12 +17,31 @@ from abc import ABC, abstractmethod
 from typing import Sequence
 
 from ... import dynamic_library as dl
-from ...native_layout import CSRC_DIR, csrc_path
+from ...native_build import create_library
+from ._plugin_common import PLUGIN_PRELUDE, defines_function, plugin_watch_files
 from .native import StepEnvContext, StepInfo
 
-_ENGINE_CPP = "engine/tetris.cpp"
-_ENGINE_HPP = "engine/tetris.hpp"
-_STEP_HPP = "envs/step/step.hpp"
+# Exported entry points of a reward library.
+_FUNCTIONS = {
+    "reward_init": {"argtypes": [], "restype": dl.void},
+    "reward_context_size": {"argtypes": [], "restype": dl.int32},
+    "reward_reset": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
+    "reward_step": {"argtypes": [dl.void_p, dl.void_p, dl.void_p], "restype": dl.float},
+    "reward_step_batch": {
+        "argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32],
+        "restype": dl.void,
+    },
+}
+
+# Appended when the user source defines no init hook.
+_DEFAULT_INIT = "API void reward_init() {}\n"
+
+# Appended when the user source defines no batch entry point.
+_DEFAULT_STEP_BATCH = r"""
+API void reward_step_batch(Context* ctxs, Info* infos, void* plugin_ctxs, float* out, int n) {
+    rewardStepLoop<reward_step>(ctxs, infos, plugin_ctxs, reward_context_size(), out, n);
+}
+"""
 
 
 class RewardPlugin(ABC):
@@ -70,9 +89,11 @@ class RewardPlugin(ABC):
 class CppReward(RewardPlugin):
     """Reward plugin backed by JIT-compiled C++ code.
 
-    ``tetris.cpp`` and ``step.hpp`` are compiled together with the user
-    source, so all engine types/functions **and** step-env types
-    (``Info``, ``Action``, ...) are available without additional includes.
+    ``tetris.hpp`` and ``step.hpp`` are included ahead of the user source
+    (the engine itself is linked from the shared core compiled once by
+    :mod:`tetrl.engine.native`), so all engine types/functions **and**
+    step-env types (``Info``, ``Action``, ...) are available without
+    additional includes.
 
     Required C++ functions
     ----------------------
@@ -92,6 +113,22 @@ class CppReward(RewardPlugin):
     ``reward_reset`` is called once per episode.  ``reward_step`` is
     called after every action and must return a scalar ``float``.
 
+    Optionally, the source may also define the batch entry point used by
+    native drivers such as :class:`~tetrl.envs.step.vector.StepVectorEnv`::
+
+        API void reward_step_batch(Context* ctxs, Info* infos,
+                                   void* plugin_ctxs, float* out, int n)
+
+    which writes the reward of ``ctxs[i]`` to ``out[i]``; plugin context
+    ``i`` starts ``i * reward_context_size()`` bytes into
+    ``plugin_ctxs``.  When it is missing, a loop over ``reward_step`` is
+    generated.
+
+    As for :class:`~tetrl.envs.step.feature.CppFeature`, entry points
+    must be re-entrant; one-time setup goes in the optional
+    ``API void reward_init()`` hook (called once, before any other entry
+    point) and ``pluginScratch(bytes)`` provides per-thread scratch memory.
+
     Parameters
     ----------
     source:
@@ -147,34 +184,21 @@ class CppReward(RewardPlugin):
         extra_compile_flags: Sequence[str] | None = None,
         watch_files: Sequence[str | os.PathLike] | None = None,
     ) -> None:
-        full_source = f'#include "{_ENGINE_CPP}"\n#include "{_STEP_HPP}"\n\nusing namespace tetrl;\nusing namespace tetrl::envs::step;\n\n{source}\n'
-
-        compile_flags = [
-            f"-I{CSRC_DIR}",
-            "-std=c++17",
-            "-O3",
-        ]
-        if extra_compile_flags:
-            compile_flags.extend(extra_compile_flags)
-
-        all_watch = [
-            csrc_path(_ENGINE_HPP),
-            csrc_path(_ENGINE_CPP),
-            csrc_path(_STEP_HPP),
-        ]
+        full_source = f"{PLUGIN_PRELUDE}{source}\n"
+        if not defines_function(source, "reward_step_batch"):
+            full_source += _DEFAULT_STEP_BATCH
+        if not defines_function(source, "reward_init"):
+            full_source += _DEFAULT_INIT
+
+        all_watch = plugin_watch_files()
         all_watch.extend(watch_files or [])
 
-        self._lib = dl.DynamicLibrary(extra_compile_flags=compile_flags)
-        self._lib.compile_string(
-            full_source,
-            watch_files=all_watch,
-            functions={
-                "reward_context_size": {"argtypes": [], "restype": dl.int32},
-                "reward_reset": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
-                "reward_step": {"argtypes": [dl.void_p, dl.void_p, dl.void_p], "restype": dl.float},
-            },
-        )
+        self._lib = create_library(extra_compile_flags=extra_compile_flags)
+        self._lib.compile_string(full_source, watch_files=all_watch, functions=_FUNCTIONS)
+        self._lib.reward_init()
+        self._allocate()
 
+    def _allocate(self) -> None:
         # Allocate per-instance context buffer.
         self._ctx_size: int = int(self._lib.reward_context_size())
         self._ctx_buf = ctypes.create_string_buffer(self._ctx_size) if self._ctx_size > 0 else None
@@ -197,6 +221,21 @@ class CppReward(RewardPlugin):
         """Byte size of the C++ reward plugin context (0 = stateless)."""
         return self._ctx_size
 
+    @property
+    def context_address(self) -> int:
+        """Address of this instance's plugin context (0 = stateless)."""
+        return self._ctx_ptr
+
+    @property
+    def source_digest(self) -> str | None:
+        """Digest of the compiled plugin source; identifies the plugin in checkpoints."""
+        return self._lib.source_digest
+
+    @property
+    def native_entry_points(self) -> tuple[int, int]:
+        """Addresses of ``reward_reset`` and ``reward_step_batch`` for native drivers."""
+        return self._lib.reward_reset.address, self._lib.reward_step_batch.address
+
     def close(self) -> None:
         """Release the compiled shared library."""
         self._lib.close()
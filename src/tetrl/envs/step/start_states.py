@@ -0,0 +1,134 @@
+"""
+Pools of generated mid-game start boards for curriculum resets.
+
+:meth:`StartStatePool.generate` builds thousands of valid boards per
+native call (garbage rows plus a stack placed through legal engine moves,
+see ``start_states.hpp``); an env given the pool starts every episode on
+one of them, picked in O(1) from the episode's seed, with the episode's
+own piece queue.
+
+Examples
+--------
+>>> pool = StartStatePool.generate(10_000, seed=0, min_height=6, max_height=16, max_garbage=8)
+>>> envs = StepVectorEnv(64)
+>>> envs.set_start_states(pool)
+>>> observations, infos = envs.reset(seed=0)
+"""
+
+from __future__ import annotations
+
+import ctypes
+import os
+from typing import Sequence
+
+import numpy as np
+
+from ...engine.state import BOARD_BOTTOM, BOARD_HEIGHT, BOARD_LEFT, BOARD_RIGHT, BOARD_TOP, Cell
+from .native import START_STATE_MAX_HEIGHT, StartStateOptions, generate_start_states
+
+__all__ = ["StartStatePool"]
+
+_PLAYFIELD_MASK = sum(Cell.BLOCK >> (2 * x) for x in range(BOARD_LEFT, BOARD_RIGHT + 1))
+
+# Mirror of ``tetrl::Board`` (the ``State.board`` rows).
+Board = ctypes.c_uint32 * BOARD_HEIGHT
+
+
+class StartStatePool:
+    """A contiguous ``(Board * n)`` array of start boards.
+
+    Parameters
+    ----------
+    boards:
+        A contiguous :data:`Board` array, or a sequence of boards (e.g.
+        ``State.board`` values); every board must leave the spawn rows
+        free for all pieces (generated boards always do).
+
+    Attributes
+    ----------
+    failed:
+        Number of generated states that fell back to the empty board
+        because no valid stack was found for their options.
+    """
+
+    def __init__(self, boards: "ctypes.Array[Board] | Sequence[Board]") -> None:
+        if len(boards) == 0:
+            raise ValueError("a start-state pool needs at least one board")
+        if not (isinstance(boards, ctypes.Array) and boards._type_ is Board):
+            boards = (Board * len(boards))(*(Board(*board) for board in boards))
+        self._boards = boards
+        self.failed = 0
+
+    @classmethod
+    def generate(
+        cls,
+        count: int,
+        *,
+        seed: int = 0,
+        min_height: int = 4,
+        max_height: int = 12,
+        min_garbage: int = 0,
+        max_garbage: int = 4,
+        garbage_messiness: float = 0.3,
+        hole_rate: float = 0.1,
+        first: int = 0,
+        threads: int | None = None,
+    ) -> "StartStatePool":
+        """Generate start states ``first .. first + count - 1`` of *seed*.
+
+        Each state is a pure function of ``(seed, index)`` and the shape
+        options, so pools are reproducible and can be grown in chunks.
+
+        Parameters
+        ----------
+        min_height, max_height:
+            Stack height in rows above the floor, drawn uniformly (capped at
+            ``START_STATE_MAX_HEIGHT``).
+        min_garbage, max_garbage:
+            Garbage rows under the stack, drawn uniformly (at most the height).
+        garbage_messiness:
+            Chance that a garbage row moves the hole of the row below it.
+        hole_rate:
+            Chance that a piece goes to a random landing instead of one that
+            opens the fewest holes.
+        threads:
+            Generator threads (default: all cores).
+        """
+        if count < 1:
+            raise ValueError(f"count must be positive, got {count}")
+        if not 0 <= min_height <= max_height <= START_STATE_MAX_HEIGHT:
+            raise ValueError(f"need 0 <= min_height <= max_height <= {START_STATE_MAX_HEIGHT}, got {min_height}, {max_height}")
+        if not 0 <= min_garbage <= max_garbage:
+            raise ValueError(f"need 0 <= min_garbage <= max_garbage, got {min_garbage}, {max_garbage}")
+        options = StartStateOptions(
+            seed=seed & (2**64 - 1),
+            min_height=min_height,
+            max_height=max_height,
+            min_garbage=min_garbage,
+            max_garbage=max_garbage,
+            garbage_messiness=garbage_messiness,
+            hole_rate=hole_rate,
+            threads=threads if threads is not None else os.cpu_count() or 1,
+        )
+        boards = (Board * count)()
+        pool = cls(boards)
+        pool.failed = generate_start_states(options, first, boards)
+        return pool
+
+    def __len__(self) -> int:
+        return len(self._boards)
+
+    def __getitem__(self, index: int) -> np.ndarray:
+        """Copy of the rows of start board *index* (``State.board`` layout)."""
+        return np.array(self._boards[index], dtype=np.uint32)
+
+    @property
+    def boards(self) -> "ctypes.Array[Board]":
+        """The underlying contiguous :data:`Board` array."""
+        return self._boards
+
+    def heights(self) -> np.ndarray:
+        """Stack height (rows above the floor) of every board."""
+        rows = np.frombuffer(self._boards, dtype=np.uint32).reshape(-1, BOARD_HEIGHT)[:, BOARD_TOP : BOARD_BOTTOM + 1]
+        filled = (rows & _PLAYFIELD_MASK) != 0
+        return np.where(filled.any(axis=1), filled.shape[1] - filled.argmax(axis=1), 0).astype(np.int32)
@@ -0,0 +1,131 @@
+"""
+Concurrency stress check of the step env's plugins.
+
+Usage::
+
+    python -m tetrl.envs.step.stress [--envs N] [--pools P] [--steps S] [--seed S] [--separate]
+
+Splits *N* envs into *P* :class:`~tetrl.envs.step.vector.StepVectorEnv`
+pools that share one set of default plugins and steps them with seeded
+random actions, once with every pool on its own Python thread (the native
+step releases the GIL, so the plugins run concurrently) and once with the
+pools stepped one after another.  Each pool digests its observations,
+rewards and episode flags; the check fails unless both runs give the same
+digests, which catches plugins that keep mutable state outside their
+per-env contexts and ``*_init`` hooks.
+"""
+
+from __future__ import annotations
+
+import argparse
+import hashlib
+import sys
+import threading
+import time
+from dataclasses import dataclass
+from typing import Any, List, Sequence, Tuple
+
+import numpy as np
+
+from .defaults import default_feature, default_fused_plugins, default_reward
+from .vector import StepVectorEnv
+
+__all__ = ["StressResult", "main", "stress"]
+
+
+@dataclass(frozen=True)
+class StressResult:
+    """Digests and timings of one :func:`stress` run."""
+
+    concurrent: List[str]
+    sequential: List[str]
+    steps: int  # env steps per run
+    concurrent_seconds: float
+    sequential_seconds: float
+
+    @property
+    def ok(self) -> bool:
+        return self.concurrent == self.sequential
+
+
+def _run_pool(envs: StepVectorEnv, steps: int, seed: int) -> str:
+    digest = hashlib.blake2b(digest_size=16)
+    rng = np.random.default_rng(seed)
+    obs, _ = envs.reset(seed=seed)
+    digest.update(np.ascontiguousarray(obs).tobytes())
+    for _ in range(steps):
+        actions = rng.integers(0, envs.single_action_space.n, size=envs.num_envs, dtype=np.uint8)
+        obs, rewards, terminated, truncated, _ = envs.step(actions)
+        for array in (obs, rewards, terminated, truncated):
+            digest.update(np.ascontiguousarray(array).tobytes())
+    return digest.hexdigest()
+
+
+def _run(pools: Sequence[StepVectorEnv], steps: int, seed: int, concurrent: bool) -> Tuple[List[str], float]:
+    digests = [""] * len(pools)
+    errors: List[BaseException] = []
+
+    def work(i: int) -> None:
+        try:
+            digests[i] = _run_pool(pools[i], steps, seed + i)
+        except BaseException as e:  # re-raised on the calling thread
+            errors.append(e)
+
+    start = time.perf_counter()
+    if concurrent:
+        threads = [threading.Thread(target=work, args=(i,)) for i in range(len(pools))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+    else:
+        for i in range(len(pools)):
+            work(i)
+    seconds = time.perf_counter() - start
+    if errors:
+        raise errors[0]
+    return digests, seconds
+
+
+def stress(envs: int = 4096, pools: int = 8, steps: int = 200, *, seed: int = 0, fused: bool = True, **kwargs: Any) -> StressResult:
+    """Step *envs* envs in *pools* pools concurrently, then sequentially.
+
+    With *fused* the pools share :func:`default_fused_plugins`, otherwise
+    separate :func:`default_feature` and :func:`default_reward` libraries.
+    Extra keyword arguments go to every ``StepVectorEnv``.
+    """
+    if not 1 <= pools <= envs:
+        raise ValueError(f"pools must be in [1, envs], got {pools} for {envs} envs")
+    if fused:
+        plugins = default_fused_plugins()
+        feature, reward = plugins.feature, plugins.reward
+    else:
+        feature, reward = default_feature(), default_reward()
+    sizes = [envs // pools + (i < envs % pools) for i in range(pools)]
+    vector = [StepVectorEnv(n, feature=feature, reward=reward, **kwargs) for n in sizes]
+    concurrent, concurrent_seconds = _run(vector, steps, seed, concurrent=True)
+    sequential, sequential_seconds = _run(vector, steps, seed, concurrent=False)
+    for pool in vector:
+        pool.close()
+    return StressResult(concurrent, sequential, envs * steps, concurrent_seconds, sequential_seconds)
+
+
+def main(argv: Sequence[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(prog="python -m tetrl.envs.step.stress", description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--envs", type=int, default=4096, help="envs in total (default: 4096)")
+    parser.add_argument("--pools", type=int, default=8, help="vector env pools, one thread each (default: 8)")
+    parser.add_argument("--steps", type=int, default=200, help="steps per env (default: 200)")
+    parser.add_argument("--seed", type=int, default=0, help="base seed of pool i's episodes and actions is seed + i")
+    parser.add_argument("--separate", action="store_true", help="separate feature and reward libraries instead of fused")
+    args = parser.parse_args(argv)
+
+    result = stress(args.envs, args.pools, args.steps, seed=args.seed, fused=not args.separate)
+    for i, (a, b) in enumerate(zip(result.concurrent, result.sequential)):
+        print(f"pool {i:>3}: {a}  {'ok' if a == b else 'FAIL ' + b}")
+    for name, seconds in (("concurrent", result.concurrent_seconds), ("sequential", result.sequential_seconds)):
+        print(f"{name:>10}: {result.steps} steps in {seconds:.3f}s ({result.steps / seconds:.0f} steps/s)")
+    sys.exit(0 if result.ok else 1)
+
+
+if __name__ == "__main__":
+    main()
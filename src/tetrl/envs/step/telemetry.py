@@ -0,0 +1,185 @@
+"""
+Native game telemetry of :class:`~tetrl.envs.step.vector.StepVectorEnv`.
+
+With ``telemetry=True`` the vector driver records every step, every locked
+piece (lines cleared, attack, spin, garbage received, back-to-back and
+combo chains) and every finished episode into a ``Telemetry`` block (see
+``telemetry.hpp``) while it steps, so monitoring adds no Python work per
+step.  :class:`GameTelemetry` exposes such a block as numpy arrays;
+blocks of several env pools (e.g. one per worker thread) are combined with
+:meth:`GameTelemetry.merged`.
+
+Examples
+--------
+>>> envs = StepVectorEnv(64, telemetry=True)
+>>> envs.reset(seed=0)
+>>> ...
+>>> t = envs.telemetry.copy()
+>>> t.attack_per_piece, t.histogram("episode_lines")
+"""
+
+from __future__ import annotations
+
+import ctypes
+from typing import Any
+
+import numpy as np
+
+from .native import (
+    TELEMETRY_BINS,
+    TELEMETRY_HISTOGRAMS,
+    StepTelemetry,
+    telemetry_merge,
+)
+
+__all__ = ["GameTelemetry", "telemetry_bin_edges"]
+
+# Histograms binned by logBin(); the others use one bin per integer value
+# (episode_app: per 1/16 attack per piece).
+_LOG_BINNED = frozenset(name for name in TELEMETRY_HISTOGRAMS if name.startswith("episode_") and name != "episode_app")
+
+
+def telemetry_bin_edges(name: str) -> np.ndarray:
+    """Lower edge of every bin of histogram *name*; the last bin also holds everything above."""
+    if name not in TELEMETRY_HISTOGRAMS:
+        raise KeyError(f"unknown telemetry histogram {name!r}; expected one of {TELEMETRY_HISTOGRAMS}")
+    bins = np.arange(TELEMETRY_BINS, dtype=np.float64)
+    if name == "episode_app":
+        return bins / 16.0
+    if name not in _LOG_BINNED:
+        return bins
+    # logBin(): exact below 8, then four bins per power of two.
+    k = np.maximum(bins - 8, 0).astype(np.int64)
+    log_edges = (4 + k % 4) << (1 + k // 4)
+    return np.where(bins < 8, bins, log_edges).astype(np.float64)
+
+
+class GameTelemetry:
+    """Counters and histograms of a ``Telemetry`` block.
+
+    Array attributes are views of the block, so those of an env's live
+    :attr:`~tetrl.envs.step.vector.StepVectorEnv.telemetry` keep updating;
+    use :meth:`copy` for a snapshot.
+    """
+
+    def __init__(self, block: StepTelemetry | None = None, *, owner: Any = None) -> None:
+        self._block = block if block is not None else StepTelemetry()
+        self._owner = owner  # keeps the memory behind a borrowed block alive
+
+    @classmethod
+    def merged(cls, *items: "GameTelemetry") -> "GameTelemetry":
+        """New telemetry holding the sum of *items*."""
+        out = cls()
+        for item in items:
+            telemetry_merge(out._block, item._block)
+        return out
+
+    def copy(self) -> "GameTelemetry":
+        """Snapshot of the current counters."""
+        return GameTelemetry.merged(self)
+
+    def clear(self) -> None:
+        """Zero every counter."""
+        ctypes.memset(ctypes.addressof(self._block), 0, ctypes.sizeof(StepTelemetry))
+
+    # -- totals ---------------------------------------------------------------
+
+    @property
+    def episodes(self) -> int:
+        """Finished episodes (terminated or truncated)."""
+        return int(self._block.episodes)
+
+    @property
+    def terminated(self) -> int:
+        """Finished episodes that ended by topping out."""
+        return int(self._block.terminated)
+
+    @property
+    def steps(self) -> int:
+        return int(self._block.steps)
+
+    @property
+    def pieces(self) -> int:
+        return int(self._block.pieces)
+
+    @property
+    def lines(self) -> int:
+        return int(self._block.lines)
+
+    @property
+    def attack(self) -> int:
+        return int(self._block.attack)
+
+    @property
+    def garbage(self) -> int:
+        """Garbage lines pushed into the boards."""
+        return int(self._block.garbage)
+
+    @property
+    def perfect_clears(self) -> int:
+        return int(self._block.perfect_clears)
+
+    @property
+    def attack_per_piece(self) -> float:
+        return self.attack / self.pieces if self.pieces else 0.0
+
+    @property
+    def lines_per_piece(self) -> float:
+        return self.lines / self.pieces if self.pieces else 0.0
+
+    @property
+    def pieces_per_step(self) -> float:
+        """Pieces per env step (the step env's stand-in for pieces per second)."""
+        return self.pieces / self.steps if self.steps else 0.0
+
+    # -- arrays ---------------------------------------------------------------
+
+    @property
+    def clears(self) -> np.ndarray:
+        """``(5,)`` placements by lines cleared."""
+        return np.ctypeslib.as_array(self._block.clears)
+
+    @property
+    def spins(self) -> np.ndarray:
+        """``(7, 3, 5)`` placements by piece type, ``SpinType`` and lines cleared."""
+        return np.ctypeslib.as_array(self._block.spins)
+
+    @property
+    def histograms(self) -> np.ndarray:
+        """``(len(TELEMETRY_HISTOGRAMS), TELEMETRY_BINS)`` counts, rows in ``TELEMETRY_HISTOGRAMS`` order."""
+        return np.ctypeslib.as_array(self._block.histograms)
+
+    def histogram(self, name: str) -> tuple[np.ndarray, np.ndarray]:
+        """``(counts, lower bin edges)`` of histogram *name* (see :func:`telemetry_bin_edges`)."""
+        edges = telemetry_bin_edges(name)
+        return self.histograms[TELEMETRY_HISTOGRAMS.index(name)], edges
+
+    def as_dict(self) -> dict[str, Any]:
+        """Flat snapshot for loggers: totals, rates and copies of every array."""
+        out: dict[str, Any] = {
+            name: getattr(self, name)
+            for name in (
+                "episodes",
+                "terminated",
+                "steps",
+                "pieces",
+                "lines",
+                "attack",
+                "garbage",
+                "perfect_clears",
+                "attack_per_piece",
+                "lines_per_piece",
+                "pieces_per_step",
+            )
+        }
+        out["clears"] = self.clears.copy()
+        out["spins"] = self.spins.copy()
+        for name, row in zip(TELEMETRY_HISTOGRAMS, self.histograms):
+            out[f"hist/{name}"] = row.copy()
+        return out
+
+    def __repr__(self) -> str:
+        return (
+            f"GameTelemetry(episodes={self.episodes}, pieces={self.pieces}, lines={self.lines}, "
+            f"attack={self.attack}, app={self.attack_per_piece:.3f})"
+        )
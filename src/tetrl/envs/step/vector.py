@@ -0,0 +1,471 @@
+"""
+Vectorised step environment driven natively.
+
+:class:`StepVectorEnv` keeps ``num_envs`` engine contexts in one contiguous
+``StepEnvContext`` array and advances all of them with a single native
+call per :meth:`~StepVectorEnv.step`: the engine step, both plugins (via
+their ``*_step_batch`` entry points, called C-to-C through their function
+addresses) and the autoreset of finished envs all run without returning
+to Python.
+
+Examples
+--------
+>>> from tetrl.envs.step import StepVectorEnv
+>>>
+>>> envs = StepVectorEnv(64, max_steps=1000)
+>>> observations, infos = envs.reset(seed=0)
+>>> observations, rewards, terms, truncs, infos = envs.step(envs.action_space.sample())
+"""
+
+from __future__ import annotations
+
+import ctypes
+import math
+import mmap
+import os
+from typing import Any
+
+import gymnasium
+import numpy as np
+
+from ...engine.state import State
+from .checkpoint import CheckpointError, map_checkpoint, write_checkpoint
+from .native import (
+    CHECKPOINT_SECTIONS,
+    CONTEXT_DTYPE,
+    INFO_DTYPE,
+    N_ACTIONS,
+    CheckpointHeader,
+    PluginTable,
+    StepEnvConfig,
+    StepEnvContext,
+    StepEpisodeTelemetry,
+    StepInfo,
+    VectorBuffers,
+    vector_reset,
+    vector_step,
+)
+from .feature import FeaturePlugin
+from .replay import ReplayBuffer
+from .reward import RewardPlugin
+from .start_states import StartStatePool
+from .telemetry import GameTelemetry
+
+_ACTION_BITS = 1 << np.arange(N_ACTIONS, dtype=np.uint16)
+
+
+def _plugin_id(plugin: Any) -> "ctypes.Array[ctypes.c_uint8]":
+    digest = getattr(plugin, "source_digest", None)
+    return (ctypes.c_uint8 * 32)(*bytes.fromhex(digest)) if digest else (ctypes.c_uint8 * 32)()
+
+
+class StepVectorEnv(gymnasium.vector.VectorEnv):
+    """``num_envs`` step environments advanced in lock-step by native code.
+
+    Episodes are reset automatically in the same step in which they end
+    (``autoreset_mode`` ``SAME_STEP``): the returned observation is the
+    first one of the new episode and the last observation of the finished
+    episode is reported in ``infos["final_obs"]`` (valid where
+    ``infos["_final_obs"]`` is set).
+
+    Parameters
+    ----------
+    num_envs:
+        Number of environments.
+    feature:
+        A :class:`~tetrl.envs.step.feature.CppFeature` (or any plugin with
+        ``native_entry_points``).  Defaults to
+        :func:`~tetrl.envs.step.defaults.default_feature`.  Its ``unpack``
+        callable is not applied; observations are reshaped to the
+        plugin's ``Box`` space when its size matches, otherwise returned
+        as flat ``(num_envs, size)`` rows.
+    reward:
+        A :class:`~tetrl.envs.step.reward.CppReward` (or any plugin with
+        ``native_entry_points``).  Defaults to
+        :func:`~tetrl.envs.step.defaults.default_reward`.
+    config:
+        Engine configuration shared by all envs.  With
+        ``action_mask=True`` the infos carry ``"action_mask"``, a
+        ``(num_envs, 12)`` bool array.
+    max_steps:
+        If positive, episodes are truncated after this many steps.
+    copy:
+        Return copies of the internal observation buffer (default).  With
+        ``False`` the returned arrays are overwritten by the next call.
+    render_mode:
+        ``"rgb_array"`` makes :meth:`render` return all envs as one
+        ``(num_envs, H, W, 3)`` ``uint8`` array, rendered in a single
+        native call into a reused buffer.
+    render_scale:
+        Pixels per board cell of rendered frames (1 to 32).
+    telemetry:
+        Record game telemetry natively while stepping (see
+        :attr:`telemetry` and :mod:`tetrl.envs.step.telemetry`).
+    """
+
+    metadata = {
+        "autoreset_mode": gymnasium.vector.AutoresetMode.SAME_STEP,
+        "render_modes": ["rgb_array"],
+        "render_fps": 30,
+    }
+
+    def __init__(
+        self,
+        num_envs: int,
+        *,
+        feature: FeaturePlugin | None = None,
+        reward: RewardPlugin | None = None,
+        config: StepEnvConfig | None = None,
+        max_steps: int = 0,
+        copy: bool = True,
+        render_mode: str | None = None,
+        render_scale: int = 8,
+        telemetry: bool = False,
+    ) -> None:
+        if num_envs < 1:
+            raise ValueError(f"num_envs must be positive, got {num_envs}")
+        if render_mode is not None and render_mode not in self.metadata["render_modes"]:
+            raise ValueError(f"unsupported render_mode {render_mode!r}; expected one of {self.metadata['render_modes']}")
+        if feature is None:
+            from .defaults import default_feature
+
+            feature = default_feature()
+        if reward is None:
+            from .defaults import default_reward
+
+            reward = default_reward()
+        for plugin in (feature, reward):
+            if not hasattr(plugin, "native_entry_points"):
+                raise TypeError(f"{type(plugin).__name__} has no native entry points; use CppFeature / CppReward")
+
+        self._feature = feature
+        self._reward = reward
+        self._copy = copy
+        self.num_envs = num_envs
+        self.render_mode = render_mode
+        from ...engine.native import render_shape
+
+        render_shape(render_scale)  # ValueError now rather than on the first render()
+        self.render_scale = render_scale
+        self._frames: np.ndarray | None = None
+
+        size = int(feature.size)
+        space = feature.observation_space()
+        if not (isinstance(space, gymnasium.spaces.Box) and math.prod(space.shape) == size):
+            space = gymnasium.spaces.Box(-np.inf, np.inf, (size,), np.float32)
+        self.single_observation_space = space
+        self.single_action_space = gymnasium.spaces.Discrete(N_ACTIONS)
+        self.observation_space = gymnasium.vector.utils.batch_space(space, num_envs)
+        self.action_space = gymnasium.spaces.MultiDiscrete(np.full(num_envs, N_ACTIONS))
+
+        cfg = config or StepEnvConfig()
+        self._ctxs = (StepEnvContext * num_envs)()
+        for ctx in self._ctxs:
+            ctx.state = State()  # array elements skip State.__init__ and its garbage settings
+            ctx.config = cfg
+        self._infos = (StepInfo * num_envs)()
+
+        # Output and bookkeeping arrays, referenced by pointer from the native side.
+        self._obs = np.zeros((num_envs, size), dtype=np.float32)
+        self._final_obs = np.zeros((num_envs, size), dtype=np.float32)
+        self._rewards = np.zeros(num_envs, dtype=np.float32)
+        self._terminated = np.zeros(num_envs, dtype=np.uint8)
+        self._truncated = np.zeros(num_envs, dtype=np.uint8)
+        self._steps = np.zeros(num_envs, dtype=np.int32)
+        self._episodes = np.zeros(num_envs, dtype=np.uint32)
+        self._telemetry = GameTelemetry() if telemetry else None
+        self._episode_telemetry = (StepEpisodeTelemetry * num_envs)() if telemetry else None
+        self._start_states: StartStatePool | None = None
+        self._replay: ReplayBuffer | None = None
+
+        self._feature_ctxs = ctypes.create_string_buffer(max(1, feature.context_size * num_envs))
+        self._reward_ctxs = ctypes.create_string_buffer(max(1, reward.context_size * num_envs))
+        self._checkpoint_map: mmap.mmap | None = None
+        self._bind(seed=0, max_steps=max_steps)
+        self._needs_reset = True
+
+    def _bind(self, *, seed: int, max_steps: int) -> None:
+        """(Re)build the plugin table and buffer descriptor from the current arrays."""
+        feature_reset, feature_step_batch = self._feature.native_entry_points
+        reward_reset, reward_step_batch = self._reward.native_entry_points
+        # Both halves of one CppFusedPlugins: evaluate them with a single batch call.
+        fused = getattr(self._feature, "fused", None)
+        fused_step_batch = fused.fused_step_batch_address if fused is not None and getattr(self._reward, "fused", None) is fused else None
+        self._table = PluginTable(
+            feature_reset=feature_reset,
+            feature_step_batch=feature_step_batch,
+            reward_reset=reward_reset,
+            reward_step_batch=reward_step_batch,
+            fused_step_batch=fused_step_batch,
+            feature_ctxs=ctypes.addressof(self._feature_ctxs),
+            reward_ctxs=ctypes.addressof(self._reward_ctxs),
+            feature_context_size=self._feature.context_size,
+            reward_context_size=self._reward.context_size,
+            feature_size=self._obs.shape[1],
+        )
+        self._buffers = VectorBuffers(
+            obs=self._obs.ctypes.data,
+            final_obs=self._final_obs.ctypes.data,
+            rewards=self._rewards.ctypes.data,
+            terminated=self._terminated.ctypes.data,
+            truncated=self._truncated.ctypes.data,
+            infos=ctypes.addressof(self._infos),
+            steps=self._steps.ctypes.data,
+            episodes=self._episodes.ctypes.data,
+            seed=seed,
+            max_steps=max_steps,
+            episode_telemetry=ctypes.addressof(self._episode_telemetry) if self._telemetry is not None else None,
+            telemetry=ctypes.addressof(self._telemetry._block) if self._telemetry is not None else None,
+            start_states=ctypes.addressof(self._start_states.boards) if self._start_states is not None else None,
+            start_state_count=len(self._start_states) if self._start_states is not None else 0,
+            replay=self._replay.handle if self._replay is not None else None,
+        )
+        self._info_view = np.frombuffer(self._infos, dtype=INFO_DTYPE)
+        self._context_view = np.frombuffer(self._ctxs, dtype=CONTEXT_DTYPE)
+
+    def reset(
+        self,
+        *,
+        seed: int | None = None,
+        options: dict[str, Any] | None = None,
+    ) -> tuple[np.ndarray, dict[str, Any]]:
+        """Reset every env and return ``(observations, infos)``.
+
+        Parameters
+        ----------
+        seed:
+            Base seed.  Episode ``k`` of env ``i`` is seeded from
+            ``(seed, i, k)``, so a seeded run is reproducible regardless of
+            when individual envs finish.  If ``None``, the first reset
+            draws a random base seed and later resets continue the
+            existing episode counters.
+        options:
+            Unused; accepted for API compatibility.
+        """
+        if seed is not None or self._needs_reset:
+            self._buffers.seed = (seed if seed is not None else int(np.random.SeedSequence().entropy)) & (2**64 - 1)
+            self._episodes[:] = 0
+        vector_reset(self._table, self._ctxs, self._buffers)
+        self._needs_reset = False
+        return self._observations(self._obs), self._make_infos()
+
+    def step(self, actions: Any) -> tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray, dict[str, Any]]:
+        """Step every env with ``actions[i]`` and return the batched 5-tuple."""
+        if self._needs_reset:
+            raise RuntimeError("Environment must be reset before calling step(). Call envs.reset() first.")
+        actions = np.ascontiguousarray(actions, dtype=np.uint8)
+        vector_step(self._table, self._ctxs, actions, self._buffers)
+
+        terminated = self._terminated.astype(bool)
+        truncated = self._truncated.astype(bool)
+        infos = self._make_infos(with_step=True)
+        done = terminated | truncated
+        if done.any():
+            infos["final_obs"] = self._observations(self._final_obs, copy=True)
+            infos["_final_obs"] = done
+        return self._observations(self._obs), self._rewards.copy(), terminated, truncated, infos
+
+    def render(self) -> np.ndarray | None:
+        """Render every env as a ``(num_envs, H, W, 3)`` ``uint8`` array.
+
+        The frames are written into a buffer reused across calls (copied
+        unless ``copy=False``).
+        """
+        if self.render_mode != "rgb_array":
+            return None
+        from ...engine.native import render_rgb_batch, render_shape
+
+        if self._frames is None:
+            self._frames = np.empty((self.num_envs, *render_shape(self.render_scale)), dtype=np.uint8)
+        render_rgb_batch(self._ctxs, self.render_scale, out=self._frames)
+        return self._frames.copy() if self._copy else self._frames
+
+    def close_extras(self, **kwargs: Any) -> None:
+        """Release plugin resources."""
+        if hasattr(self._feature, "close"):
+            self._feature.close()
+        if hasattr(self._reward, "close"):
+            self._reward.close()
+
+    def send_garbage(self, index: int, lines: int, delay: int = 0) -> bool:
+        """Queue garbage lines to be received by env *index*."""
+        from ...engine.native import add_garbage
+
+        return add_garbage(self._ctxs[index].state, lines, delay)
+
+    def save_checkpoint(self, path: str | os.PathLike, *, observations: bool = True) -> int:
+        """Write the whole pool to *path* (see :mod:`tetrl.envs.step.checkpoint`).
+
+        Stores every ``Context``, both plugins' contexts, the last infos,
+        the step/episode counters, the base seed and ``max_steps``, plus
+        the current observations unless *observations* is false (they are
+        usually the largest section).  Returns the file size in bytes.
+        """
+        if self._needs_reset:
+            raise RuntimeError("nothing to checkpoint: the envs have not been reset")
+        header = CheckpointHeader(
+            num_envs=self.num_envs,
+            feature_size=self._obs.shape[1],
+            feature_context_size=self._feature.context_size,
+            reward_context_size=self._reward.context_size,
+            feature_id=_plugin_id(self._feature),
+            reward_id=_plugin_id(self._reward),
+            seed=self._buffers.seed,
+            max_steps=self._buffers.max_steps,
+            has_observations=int(observations),
+        )
+        n = self.num_envs
+        sections = {
+            "contexts": memoryview(self._ctxs).cast("B"),
+            "feature_contexts": memoryview(self._feature_ctxs).cast("B")[: self._feature.context_size * n],
+            "reward_contexts": memoryview(self._reward_ctxs).cast("B")[: self._reward.context_size * n],
+            "infos": memoryview(self._infos).cast("B"),
+            "steps": memoryview(self._steps).cast("B"),
+            "episodes": memoryview(self._episodes).cast("B"),
+        }
+        if observations:
+            sections["observations"] = memoryview(self._obs).cast("B")
+        return write_checkpoint(path, header, sections)
+
+    def load_checkpoint(self, path: str | os.PathLike) -> tuple[np.ndarray | None, dict[str, Any]]:
+        """Resume the pool saved in *path* and return ``(observations, infos)``.
+
+        The env must have the same ``num_envs`` and plugins (checked by
+        source digest and context sizes) as the one that saved it.  The
+        file is mapped copy-on-write and the envs keep running on the
+        mapping, so this takes the same time for any pool size.
+        ``observations`` is ``None`` if they were not saved.
+        """
+        header, mm = map_checkpoint(path)
+        try:
+            expected = {
+                "num_envs": self.num_envs,
+                "feature_size": self._obs.shape[1],
+                "feature_context_size": self._feature.context_size,
+                "reward_context_size": self._reward.context_size,
+            }
+            for name, value in expected.items():
+                if getattr(header, name) != value:
+                    raise CheckpointError(f"{path}: {name} is {getattr(header, name)}, this env has {value}")
+            for role, plugin, stored in (("feature", self._feature, header.feature_id), ("reward", self._reward, header.reward_id)):
+                ours = _plugin_id(plugin)
+                if any(stored) and any(ours) and bytes(stored) != bytes(ours):
+                    raise CheckpointError(f"{path}: saved with a different {role} plugin")
+        except CheckpointError:
+            mm.close()
+            raise
+
+        n, size = self.num_envs, self._obs.shape[1]
+        offsets = dict(zip(CHECKPOINT_SECTIONS, header.offsets))
+        self._ctxs = (StepEnvContext * n).from_buffer(mm, offsets["contexts"])
+        self._infos = (StepInfo * n).from_buffer(mm, offsets["infos"])
+        for name, attr, context_size in (
+            ("feature_contexts", "_feature_ctxs", header.feature_context_size),
+            ("reward_contexts", "_reward_ctxs", header.reward_context_size),
+        ):
+            if context_size:
+                setattr(self, attr, (ctypes.c_char * (context_size * n)).from_buffer(mm, offsets[name]))
+        self._steps = np.frombuffer(mm, dtype=np.int32, count=n, offset=offsets["steps"])
+        self._episodes = np.frombuffer(mm, dtype=np.uint32, count=n, offset=offsets["episodes"])
+        if header.has_observations:
+            self._obs = np.frombuffer(mm, dtype=np.float32, count=n * size, offset=offsets["observations"]).reshape(n, size)
+        self._checkpoint_map = mm
+        if self._episode_telemetry is not None:  # the running episodes are not the ones counted so far
+            ctypes.memset(self._episode_telemetry, 0, ctypes.sizeof(self._episode_telemetry))
+        self._bind(seed=header.seed, max_steps=header.max_steps)
+        self._needs_reset = False
+        observations = self._observations(self._obs) if header.has_observations else None
+        return observations, self._make_infos()
+
+    @property
+    def states(self) -> "ctypes.Array[StepEnvContext]":
+        """Contiguous array of the low-level engine contexts."""
+        return self._ctxs
+
+    @property
+    def context_view(self) -> np.ndarray:
+        """Zero-copy structured view of :attr:`states` (dtype :data:`~tetrl.envs.step.native.CONTEXT_DTYPE`).
+
+        A field across all envs is one strided slice, e.g.
+        ``envs.context_view["state"]["combo_count"]``; it always shows the
+        live contexts and writes go straight to them.
+        """
+        return self._context_view
+
+    @property
+    def feature(self) -> Any:
+        """The native feature plugin producing the observations."""
+        return self._feature
+
+    @property
+    def feature_contexts(self) -> np.ndarray:
+        """Zero-copy ``(num_envs, feature.context_size)`` uint8 view of the feature plugin contexts."""
+        size = self._feature.context_size
+        return np.frombuffer(self._feature_ctxs, dtype=np.uint8, count=size * self.num_envs).reshape(self.num_envs, size)
+
+    def set_start_states(self, pool: StartStatePool | None) -> None:
+        """Start every following episode on a board of *pool* (``None``: the empty board).
+
+        Episode ``k`` of env ``i`` takes the board of the pool entry picked
+        by its seed, so seeded runs stay reproducible; its pieces still
+        come from its own seeds.  Running episodes are not affected.
+        """
+        self._start_states = pool
+        self._buffers.start_states = ctypes.addressof(pool.boards) if pool is not None else None
+        self._buffers.start_state_count = len(pool) if pool is not None else 0
+
+    def set_replay(self, replay: ReplayBuffer | None) -> None:
+        """Write every following transition into *replay* (``None``: stop).
+
+        Each :meth:`step` stores, per env, the observation acted on, the
+        action, the reward, both flags and the next observation (the final
+        one for finished episodes) from the native step itself.  Several
+        envs may share one buffer, also from different threads.
+        """
+        if replay is not None:
+            if replay.feature_size != self._obs.shape[1]:
+                raise ValueError(f"replay rows have {replay.feature_size} floats, this env's observations {self._obs.shape[1]}")
+            if replay.capacity <= self.num_envs:
+                raise ValueError(f"replay capacity {replay.capacity} must exceed num_envs ({self.num_envs})")
+        self._replay = replay
+        self._buffers.replay = replay.handle if replay is not None else None
+
+    @property
+    def replay(self) -> ReplayBuffer | None:
+        """The buffer transitions are written into, if any."""
+        return self._replay
+
+    @property
+    def telemetry(self) -> GameTelemetry | None:
+        """Live telemetry of this pool (``None`` unless created with ``telemetry=True``).
+
+        Counts every step and piece, and every episode finished since
+        construction (episodes cut short by :meth:`reset` are dropped).
+        """
+        return self._telemetry
+
+    @property
+    def episode_telemetry(self) -> np.ndarray | None:
+        """Running totals of every env's current episode as a structured ``(num_envs,)`` array copy."""
+        if self._episode_telemetry is None:
+            return None
+        return np.ctypeslib.as_array(self._episode_telemetry).copy()
+
+    @property
+    def steps(self) -> np.ndarray:
+        """Steps taken in the running episode of every env."""
+        return self._steps.copy()
+
+    def _observations(self, buf: np.ndarray, copy: bool | None = None) -> np.ndarray:
+        out = buf.reshape((self.num_envs, *self.single_observation_space.shape))
+        return out.copy() if (self._copy if copy is None else copy) else out
+
+    def _make_infos(self, *, with_step: bool = False) -> dict[str, Any]:
+        infos: dict[str, Any] = {}
+        if with_step:
+            infos["action_id"] = self._info_view["action_id"].copy()
+            infos["action_success"] = self._info_view["action_success"].astype(bool)
+            infos["forced_hard_drop"] = self._info_view["forced_hard_drop"].astype(bool)
+        if self._ctxs[0].config.action_mask:
+            infos["action_mask"] = (self._info_view["action_mask"][:, None] & _ACTION_BITS) != 0
+        return infos
@@ -0,0 +1,130 @@
+"""
+Shared build configuration for every JIT-compiled TetRL library.
+
+* Cache keys are computed relative to ``csrc`` so artefacts are
+  relocatable, and :data:`~tetrl.native_layout.PREBUILT_DIR` (filled by
+  ``python -m tetrl.prebuild``) is searched before compiling.
+* ``TETRL_CACHE_DIR`` selects the cache directory.  It may be shared by
+  many processes; each artefact is built once under a file lock.
+* ``tetris.cpp`` is compiled exactly once, into the engine core loaded
+  with ``RTLD_GLOBAL`` by :mod:`tetrl.engine.native`.  Wrappers and
+  plugins include only ``tetris.hpp`` and resolve engine symbols against
+  that core at load time (:data:`CORE_LINK_FLAGS`).
+* ``TETRL_BUILD_MODE`` opts into CPU-specific builds (see
+  :data:`BUILD_MODES` and :mod:`tetrl.pgo`).  Their artefacts live in a
+  cache subdirectory keyed by the CPU model.
+"""
+
+from __future__ import annotations
+
+import getpass
+import hashlib
+import os
+import platform
+import tempfile
+from pathlib import Path
+from typing import Sequence
+
+from . import dynamic_library as dl
+from .native_layout import CSRC_DIR, PREBUILT_DIR
+
+__all__ = [
+    "BUILD_MODES",
+    "COMPILE_FLAGS",
+    "CORE_LINK_FLAGS",
+    "build_mode",
+    "cache_dir",
+    "cpu_model",
+    "create_library",
+    "mode_cache_dir",
+]
+
+# default       portable -O3 build (prebuilt artefacts allowed)
+# native        -march=native
+# pgo-generate  -march=native, instrumented (writes profile counters at exit)
+# pgo           -march=native, -fprofile-use and -flto with the collected counters
+BUILD_MODES = ("default", "native", "pgo-generate", "pgo")
+
+COMPILE_FLAGS = (
+    f"-I{CSRC_DIR}",
+    "-std=c++17",
+    "-O3",
+)
+
+# Engine symbols stay undefined in libraries linked against the core;
+# macOS needs to be told explicitly to resolve them at load time.
+CORE_LINK_FLAGS = ("-undefined", "dynamic_lookup") if platform.system() == "Darwin" else ()
+
+
+def build_mode() -> str:
+    """Return the active build mode (``TETRL_BUILD_MODE``, default ``"default"``)."""
+    mode = os.environ.get("TETRL_BUILD_MODE") or "default"
+    if mode not in BUILD_MODES:
+        raise ValueError(f"TETRL_BUILD_MODE must be one of {BUILD_MODES}, got {mode!r}")
+    return mode
+
+
+def cpu_model() -> str:
+    """Best-effort human-readable CPU model of this machine."""
+    try:
+        with open("/proc/cpuinfo", encoding="utf-8") as fp:
+            for line in fp:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or platform.machine()
+
+
+def cache_dir() -> Path:
+    """Root of the artefact cache (``TETRL_CACHE_DIR`` or a per-user temp dir)."""
+    env = os.environ.get("TETRL_CACHE_DIR")
+    return Path(env) if env else Path(tempfile.gettempdir()) / f"dynlib_cache_{getpass.getuser()}"
+
+
+def mode_cache_dir(mode: str) -> Path:
+    """Cache directory of *mode*; CPU-specific modes are keyed by :func:`cpu_model`."""
+    if mode == "default":
+        return cache_dir()
+    tag = hashlib.sha256(f"{cpu_model()}|{platform.machine()}".encode()).hexdigest()[:12]
+    # Both PGO phases share one directory so "pgo" finds the counters of "pgo-generate".
+    return cache_dir() / f"{'pgo' if mode.startswith('pgo') else mode}-{tag}"
+
+
+def create_library(
+    *,
+    extra_compile_flags: Sequence[str] | None = None,
+    watch_files: Sequence[str | os.PathLike] | None = None,
+    link_core: bool = True,
+    global_symbols: bool = False,
+) -> dl.DynamicLibrary:
+    """Create a :class:`DynamicLibrary` with the project-wide settings.
+
+    Parameters
+    ----------
+    extra_compile_flags:
+        Flags appended after :data:`COMPILE_FLAGS`.
+    watch_files:
+        Extra files mixed into the cache key.
+    link_core:
+        Resolve engine symbols against the shared engine core instead of
+        compiling ``tetris.cpp`` into this library.
+    global_symbols:
+        Export this library's symbols to libraries loaded later.
+    """
+    mode = build_mode()
+    flags = [*COMPILE_FLAGS, *(CORE_LINK_FLAGS if link_core else ())]
+    if mode != "default":
+        flags.append("-march=native")
+    flags.extend(extra_compile_flags or ())
+    directory = mode_cache_dir(mode)
+    return dl.DynamicLibrary(
+        cache_dir=directory,
+        extra_compile_flags=flags,
+        watch_files=watch_files,
+        source_root=CSRC_DIR,
+        prebuilt_dirs=[PREBUILT_DIR] if mode == "default" else (),
+        global_symbols=global_symbols,
+        profile={"pgo-generate": "generate", "pgo": "use"}.get(mode),
+        profile_dir=directory / "profile" if mode.startswith("pgo") else None,
+    )
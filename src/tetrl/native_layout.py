@@ -1,17 +1,68 @@
-"""Project-local helpers for locating native sources under csrc."""
+"""Project-local helpers for locating native sources under csrc and describing native struct layouts."""
 
 from __future__ import annotations
 
+import ctypes
 from pathlib import Path
+from typing import Any
 
-__all__ = ["CSRC_DIR", "csrc_path"]
+import numpy as np
+
+__all__ = ["CSRC_DIR", "PREBUILT_DIR", "csrc_path", "layout_static_asserts", "structured_dtype"]
 
 
 _TETRL_DIR = Path(__file__).resolve().parent
 
 CSRC_DIR = (_TETRL_DIR / "csrc").resolve()
 
+# Ahead-of-time built artefacts (see ``python -m tetrl.prebuild``).
+PREBUILT_DIR = _TETRL_DIR / "_prebuilt"
+
 
 def csrc_path(relative: str) -> Path:
     """Return an absolute filesystem path for a project-relative csrc path."""
     return CSRC_DIR.joinpath(*relative.split("/")).resolve()
+
+
+def _field_dtype(ctype: Any) -> np.dtype:
+    if issubclass(ctype, ctypes.Structure):
+        return structured_dtype(ctype)
+    if issubclass(ctype, ctypes.Array):
+        if ctype._type_ is ctypes.c_char:
+            return np.dtype(f"S{ctype._length_}")
+        return np.dtype((_field_dtype(ctype._type_), (ctype._length_,)))
+    return np.dtype(ctype)
+
+
+def structured_dtype(struct: type[ctypes.Structure]) -> np.dtype:
+    """Numpy structured dtype with the byte layout of the ``ctypes`` mirror *struct*.
+
+    Fields keep the mirror's names and offsets (padding included in the
+    item size); nested structures become nested dtypes and fixed arrays
+    subarray fields.  ``np.frombuffer`` over a ``(struct * n)`` array then
+    views native memory without copying, and any field across all ``n``
+    elements is one strided slice.
+    """
+    names, formats, offsets = [], [], []
+    for name, ctype, *_ in struct._fields_:
+        names.append(name)
+        formats.append(_field_dtype(ctype))
+        offsets.append(getattr(struct, name).offset)
+    return np.dtype({"names": names, "formats": formats, "offsets": offsets, "itemsize": ctypes.sizeof(struct)})
+
+
+def layout_static_asserts(cpp_type: str, struct: type[ctypes.Structure]) -> str:
+    """C++ ``static_assert`` checks pinning *cpp_type* to the size and field offsets/sizes of its mirror *struct*.
+
+    Compiled into a wrapper source, a mirror that drifted from its header
+    fails the build naming the field, instead of misreading memory.
+    """
+    mirror = struct.__name__
+    checks = [f'static_assert(sizeof({cpp_type}) == {ctypes.sizeof(struct)}, "sizeof({cpp_type}) differs from its mirror {mirror}");']
+    for name, *_ in struct._fields_:
+        field = getattr(struct, name)
+        checks.append(
+            f"static_assert(offsetof({cpp_type}, {name}) == {field.offset} && sizeof({cpp_type}::{name}) == {field.size}, "
+            f'"{cpp_type}::{name} differs from its mirror {mirror}.{name}");'
+        )
+    return "\n".join(checks) + "\n"
@@ -0,0 +1,188 @@
+"""
+Profile-guided, link-time-optimised build of the native libraries.
+
+Usage::
+
+    python -m tetrl.pgo [--steps N] [--report PATH]
+
+Runs three phases, each in a fresh interpreter so that every phase loads
+its own build of the engine core, the step-env wrapper and the default
+plugins:
+
+1. ``bench`` with the default (portable ``-O3``) build;
+2. ``train`` under ``TETRL_BUILD_MODE=pgo-generate``: an instrumented,
+   ``-march=native`` build runs :func:`workload` and writes profile
+   counters on exit;
+3. ``bench`` under ``TETRL_BUILD_MODE=pgo``: the libraries are rebuilt
+   with ``-fprofile-use -flto`` from those counters.
+
+The optimised artefacts are cached in
+``mode_cache_dir("pgo")`` (keyed by the CPU model) and used by every
+process started with ``TETRL_BUILD_MODE=pgo``.  A JSON speedup report is
+written next to them.  GCC only: Clang's raw profiles need an
+``llvm-profdata`` merge step that is not wired up.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+from pathlib import Path
+from typing import Any, Dict, Sequence
+
+import numpy as np
+
+from .native_build import cpu_model, mode_cache_dir
+
+__all__ = ["benchmark", "main", "workload"]
+
+# Placement macros for the scripted policy: rotate, shift, hard drop.
+_ROTATIONS = ((), (4,), (5,), (6,))  # ROTATE_CW, ROTATE_CCW, ROTATE_180
+_SHIFTS = ((8,), (9,), (0,), (1,), (0, 0), (1, 1), (0, 0, 0), (1, 1, 1), ())  # *_TO_WALL, LEFT, RIGHT
+
+
+def workload(steps: int, seed: int = 0) -> Dict[str, float]:
+    """Drive the default env with a representative mix of policies.
+
+    Half of the steps come from a uniformly random policy (exercising
+    rotation kicks, holds and gravity), the other half from a scripted
+    placement policy (rotate, shift, hard drop) with random incoming
+    garbage, which exercises line clears, attack and garbage
+    cancellation.  A native batch step over 64 contexts follows.
+
+    Returns the throughput of both parts in steps per second.
+    """
+    from .envs.step import StepEnv, StepEnvConfig, StepEnvContext, StepInfo, env_reset, env_set_seed, env_step_batch
+
+    rng = np.random.default_rng(seed)
+    env = StepEnv(config=StepEnvConfig(action_mask=True))
+    try:
+        env.reset(seed=seed)
+        t0 = time.perf_counter()
+        for _ in range(steps // 2):
+            _, _, term, trunc, _ = env.step(int(rng.integers(12)))
+            if term or trunc:
+                env.reset(seed=int(rng.integers(1 << 31)))
+
+        done = 0
+        while done < steps - steps // 2:
+            if rng.random() < 0.15:
+                env.send_garbage(int(rng.integers(1, 5)), int(rng.integers(0, 3)))
+            macro = (*_ROTATIONS[rng.integers(4)], *_SHIFTS[rng.integers(len(_SHIFTS))], 3)  # HARD_DROP
+            for action in macro:
+                _, _, term, trunc, _ = env.step(action)
+                done += 1
+                if term or trunc:
+                    env.reset(seed=int(rng.integers(1 << 31)))
+                    break
+        env_seconds = time.perf_counter() - t0
+    finally:
+        env.close()
+
+    n = 64
+    ctxs = (StepEnvContext * n)()
+    infos = (StepInfo * n)()
+    masks = np.zeros(n, dtype=np.uint16)
+    for i, ctx in enumerate(ctxs):
+        env_set_seed(ctx, seed + i, seed + i + 1)
+        env_reset(ctx)
+    rounds = max(1, steps // n)
+    t0 = time.perf_counter()
+    for _ in range(rounds):
+        env_step_batch(ctxs, rng.integers(12, size=n, dtype=np.uint8), infos, masks)
+        for i in np.flatnonzero(masks == 0):
+            env_reset(ctxs[i])
+    batch_seconds = time.perf_counter() - t0
+
+    return {
+        "env_steps_per_s": steps / env_seconds,
+        "batch_steps_per_s": rounds * n / batch_seconds,
+    }
+
+
+def benchmark(steps: int, repeats: int = 3) -> Dict[str, float]:
+    """Best-of-*repeats* :func:`workload` throughput (after one warm-up run)."""
+    workload(min(steps, 2000), seed=12345)
+    runs = [workload(steps, seed=r) for r in range(repeats)]
+    return {key: max(run[key] for run in runs) for key in runs[0]}
+
+
+def _check_compiler() -> None:
+    from .dynamic_library import DynamicLibrary
+
+    cmd = DynamicLibrary._resolve_compiler()
+    try:
+        version = subprocess.run([*cmd, "--version"], capture_output=True, text=True, check=True).stdout
+    except (OSError, subprocess.CalledProcessError) as exc:
+        raise RuntimeError(f"cannot query compiler {cmd[0]!r}: {exc}") from exc
+    if "clang" in version.lower() or "Free Software Foundation" not in version:
+        raise RuntimeError(f"PGO builds require GCC, found: {version.splitlines()[0] if version else cmd[0]}")
+
+
+def _run_phase(phase: str, mode: str, steps: int) -> Dict[str, float]:
+    env = dict(os.environ, TETRL_BUILD_MODE=mode)
+    proc = subprocess.run(
+        [sys.executable, "-m", "tetrl.pgo", "--phase", phase, "--steps", str(steps)],
+        env=env,
+        capture_output=True,
+        text=True,
+    )
+    if proc.returncode != 0:
+        raise RuntimeError(f"{phase} phase ({mode}) failed:\n{proc.stderr}")
+    return json.loads(proc.stdout.strip().splitlines()[-1])
+
+
+def optimize(steps: int = 50_000, report: str | os.PathLike | None = None) -> Dict[str, Any]:
+    """Run the three PGO phases and return (and save) the speedup report."""
+    _check_compiler()
+    profile_dir = mode_cache_dir("pgo") / "profile"
+    for stale in profile_dir.rglob("*.gcda") if profile_dir.exists() else ():
+        stale.unlink()
+
+    baseline = _run_phase("bench", "default", steps)
+    _run_phase("train", "pgo-generate", steps)
+    optimized = _run_phase("bench", "pgo", steps)
+
+    result: Dict[str, Any] = {
+        "cpu": cpu_model(),
+        "cache_dir": str(mode_cache_dir("pgo")),
+        "steps": steps,
+        "baseline": baseline,
+        "pgo": optimized,
+        "speedup": {key: optimized[key] / baseline[key] for key in baseline},
+    }
+    path = Path(report) if report is not None else mode_cache_dir("pgo") / "report.json"
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(json.dumps(result, indent=2), encoding="utf-8")
+    result["report"] = str(path)
+    return result
+
+
+def main(argv: Sequence[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(prog="python -m tetrl.pgo", description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--steps", type=int, default=50_000, help="env steps per workload run (default: 50000)")
+    parser.add_argument("--report", default=None, help="where to write the JSON report")
+    parser.add_argument("--phase", choices=("bench", "train"), help=argparse.SUPPRESS)
+    args = parser.parse_args(argv)
+
+    if args.phase == "bench":
+        print(json.dumps(benchmark(args.steps)))
+        return
+    if args.phase == "train":
+        print(json.dumps(workload(args.steps)))
+        return
+
+    result = optimize(args.steps, args.report)
+    print(f"cpu: {result['cpu']}")
+    for key, ratio in result["speedup"].items():
+        print(f"{key:>18}: {result['baseline'][key]:12.0f} -> {result['pgo'][key]:12.0f}  ({ratio:.2f}x)")
+    print(f"report: {result['report']}")
+    print("use the optimised build with TETRL_BUILD_MODE=pgo")
+
+
+if __name__ == "__main__":
+    main()
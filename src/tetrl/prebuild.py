@@ -0,0 +1,74 @@
+"""
+Ahead-of-time build of the bundled native libraries.
+
+Usage::
+
+    python -m tetrl.prebuild [--output DIR]
+
+Compiles (or loads from the cache) the engine core, the step-env wrapper
+and the default feature / reward plugins, then copies the artefacts into
+*DIR* -- by default :data:`~tetrl.native_layout.PREBUILT_DIR`, which every
+:func:`~tetrl.native_build.create_library` searches before compiling.
+Run it once when building a wheel or a container image so that actor
+processes start without invoking the compiler.
+
+Cache keys are independent of the install location, but they do include
+the compiler command, so prebuilt artefacts are only picked up when the
+same compiler (e.g. ``g++``) is resolved at runtime.
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import shutil
+from pathlib import Path
+from typing import List, Sequence
+
+from .native_layout import PREBUILT_DIR
+
+__all__ = ["build", "main"]
+
+
+def build(output_dir: str | os.PathLike | None = None) -> List[Path]:
+    """Build the bundled libraries and copy them into *output_dir*.
+
+    Returns the paths of the published artefacts.
+    """
+    from .engine import native as engine_native
+    from .envs.step import native as step_native
+    from .envs.step.defaults import default_feature, default_reward
+
+    out = Path(output_dir) if output_dir is not None else PREBUILT_DIR
+    out.mkdir(parents=True, exist_ok=True)
+
+    feature = default_feature()
+    reward = default_reward()
+    try:
+        libs = [engine_native._lib, step_native._lib, feature._lib, reward._lib]
+        published: List[Path] = []
+        for lib in libs:
+            src = lib.path
+            assert src is not None
+            dst = out / src.name
+            if src.resolve() != dst.resolve():
+                staging = out / f".{src.name}.{os.getpid()}.tmp"
+                shutil.copy2(src, staging)
+                os.replace(staging, dst)
+            published.append(dst)
+        return published
+    finally:
+        feature.close()
+        reward.close()
+
+
+def main(argv: Sequence[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(prog="python -m tetrl.prebuild", description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("--output", default=None, help=f"destination directory (default: {PREBUILT_DIR})")
+    args = parser.parse_args(argv)
+    for path in build(args.output):
+        print(path)
+
+
+if __name__ == "__main__":
+    main()
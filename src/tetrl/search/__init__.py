@@ -0,0 +1,64 @@
+from .book import OpeningBook, OpeningBookError, build_opening_book
+from .mcts import Mcts, MctsLeaves, MctsPolicy
+from .native import (
+    AFTERSTATE_PLANE_SIZE,
+    AFTERSTATE_STATS,
+    HEURISTIC_FEATURES,
+    MCTS_OBSERVATION_SIZE,
+    PERFT_COUNTS,
+    PERFT_MAX_DEPTH,
+    Afterstates,
+    HeuristicEvaluation,
+    MoveGenCache,
+    MoveGenCacheStats,
+    PerfectClear,
+    PerfectClearMove,
+    PerfectClearSolver,
+    Perft,
+    Placement,
+    afterstates,
+    default_movegen_cache,
+    evaluate_heuristic,
+    find_perfect_clear,
+    perft,
+    placements,
+    placements_many,
+)
+
+__all__ = [
+    # move generation
+    "Placement",
+    "placements",
+    "placements_many",
+    "MoveGenCache",
+    "MoveGenCacheStats",
+    "default_movegen_cache",
+    # perfect clear
+    "PerfectClear",
+    "PerfectClearMove",
+    "PerfectClearSolver",
+    "find_perfect_clear",
+    # heuristic weights
+    "HEURISTIC_FEATURES",
+    "HeuristicEvaluation",
+    "evaluate_heuristic",
+    # perft
+    "PERFT_COUNTS",
+    "PERFT_MAX_DEPTH",
+    "Perft",
+    "perft",
+    # afterstates
+    "AFTERSTATE_PLANE_SIZE",
+    "AFTERSTATE_STATS",
+    "Afterstates",
+    "afterstates",
+    # MCTS
+    "MCTS_OBSERVATION_SIZE",
+    "Mcts",
+    "MctsLeaves",
+    "MctsPolicy",
+    # opening book
+    "OpeningBook",
+    "OpeningBookError",
+    "build_opening_book",
+]
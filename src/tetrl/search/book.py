@@ -0,0 +1,287 @@
+"""
+Memory-mapped opening book of the step env's first placements.
+
+Usage::
+
+    python -m tetrl.search.book PATH [--pieces N] [--depth D] [--perfect-clear LINES] [--threads T]
+
+Every game starts from an empty board with one of the 5040 orders of the
+first 7-bag, so the placements a bot makes early on are a function of a
+small set of states.  :func:`build_opening_book` plays all 5040 orders
+natively (branching over the second bag as its pieces come into view) and
+records, for each state, the placement the search engine picks: a perfect
+clear reachable with the visible pieces when *perfect_clear_lines* is set,
+otherwise the greedy heuristic placement.  The file is an open-addressing
+table keyed by a hash of the board, current and hold pieces and the first
+*queue_depth* next pieces (see ``opening_book.hpp``).
+
+An :class:`OpeningBook` maps the file copy-on-write and answers a lookup
+with one hash probe plus a path search for the stored landing, so pages
+are only read as lookups touch them and any number of processes share
+them::
+
+    book = OpeningBook("openers.book")
+    placement = book.lookup(env)  # None once the game leaves the book
+    if placement is not None:
+        env.step_many(placement.actions)
+"""
+
+from __future__ import annotations
+
+import argparse
+import ctypes
+import mmap
+import os
+import time
+from pathlib import Path
+from typing import Any, List, Sequence
+
+import numpy as np
+
+from ..envs.step.native import StepEnvConfig, StepEnvContext
+from .native import (
+    HEURISTIC_FEATURES,
+    OPENING_BOOK_ALIGN,
+    OPENING_BOOK_MAGIC,
+    OPENING_BOOK_SOURCES,
+    OPENING_BOOK_VERSION,
+    OpeningBookEntry,
+    OpeningBookHeader,
+    OpeningBookOptions,
+    Placement,
+    opening_book_build,
+    opening_book_entries,
+    opening_book_fill,
+    opening_book_free,
+    opening_book_key,
+    opening_book_lookup,
+)
+
+__all__ = ["DELLACHERIE_WEIGHTS", "OpeningBook", "OpeningBookError", "build_opening_book", "main"]
+
+# Dellacherie's hand-tuned weights over HEURISTIC_FEATURES.
+DELLACHERIE_WEIGHTS = (-1.0, 1.0, -1.0, -1.0, -4.0, -1.0, 0.0, 0.0)
+
+
+class OpeningBookError(ValueError):
+    """The file is not an opening book this build can read."""
+
+
+def _table_offset() -> int:
+    return (ctypes.sizeof(OpeningBookHeader) + OPENING_BOOK_ALIGN - 1) // OPENING_BOOK_ALIGN * OPENING_BOOK_ALIGN
+
+
+def build_opening_book(
+    path: str | os.PathLike,
+    *,
+    pieces: int = 4,
+    queue_depth: int = 5,
+    weights: Any = DELLACHERIE_WEIGHTS,
+    perfect_clear_lines: int = 0,
+    perfect_clear_nodes: int = 100_000,
+    use_hold: bool = True,
+    threads: int | None = None,
+    seed: int = 0,
+    config: StepEnvConfig | None = None,
+) -> int:
+    """Build the book of the first *pieces* placements into *path*; return its entry count.
+
+    Parameters
+    ----------
+    pieces:
+        Placements per game recorded.  The states grow about sevenfold per
+        placement once the second bag comes into view.
+    queue_depth:
+        Next pieces in the key (what the bot is assumed to see).  Games
+        stop being recorded where the key would reach the third bag.
+    weights:
+        Heuristic weights over :data:`~tetrl.search.HEURISTIC_FEATURES`
+        for the greedy placement.
+    perfect_clear_lines:
+        If positive, first search a perfect clear of up to this many rows
+        with the visible pieces (at most *perfect_clear_nodes* nodes) and
+        book its first placement.
+    threads:
+        Worker threads the 5040 first-bag orders are spread over (default:
+        ``os.cpu_count()``).  The book does not depend on the thread count.
+    config:
+        Step-env rules the placements must be reachable under.
+    """
+    w = np.asarray(weights, dtype=np.float64).reshape(-1)
+    if len(w) != len(HEURISTIC_FEATURES):
+        raise ValueError(f"weights must have {len(HEURISTIC_FEATURES)} entries, got {len(w)}")
+    if pieces < 1:
+        raise ValueError(f"pieces must be positive, got {pieces}")
+    if not 1 <= queue_depth <= 13:
+        raise ValueError(f"queue_depth must be in [1, 13], got {queue_depth}")
+    options = OpeningBookOptions(
+        pieces=pieces,
+        queue_depth=queue_depth,
+        perfect_clear_lines=max(0, perfect_clear_lines),
+        use_hold=int(use_hold),
+        threads=max(1, min(255, threads if threads is not None else (os.cpu_count() or 1))),
+        perfect_clear_nodes=perfect_clear_nodes,
+        seed=seed & (2**64 - 1),
+        config=config if config is not None else StepEnvConfig(),
+    )
+    options.weights[:] = w.tolist()
+
+    handle = opening_book_build(options)
+    try:
+        entries = opening_book_entries(handle)
+        capacity = 1 << max(4, (2 * entries - 1).bit_length())  # load factor at most 1/2
+        offset = _table_offset()
+        header = OpeningBookHeader(
+            magic=OPENING_BOOK_MAGIC,
+            version=OPENING_BOOK_VERSION,
+            header_size=ctypes.sizeof(OpeningBookHeader),
+            file_size=offset + capacity * ctypes.sizeof(OpeningBookEntry),
+            capacity=capacity,
+            entries=entries,
+            queue_depth=queue_depth,
+            pieces=pieces,
+        )
+        path = Path(path)
+        path.parent.mkdir(parents=True, exist_ok=True)
+        staging = path.with_name(f".{path.name}.{os.getpid()}.tmp")
+        fd = os.open(staging, os.O_RDWR | os.O_CREAT | os.O_TRUNC, 0o644)
+        try:
+            os.ftruncate(fd, header.file_size)  # zero-filled: every slot free
+            with mmap.mmap(fd, header.file_size) as mm:
+                anchor = ctypes.c_char.from_buffer(mm)
+                base = ctypes.addressof(anchor)
+                ctypes.memmove(base, ctypes.addressof(header), ctypes.sizeof(header))
+                opening_book_fill(handle, base + offset, capacity)
+                del anchor  # the mapping cannot be closed while exported
+                mm.flush()
+            os.fsync(fd)
+        except BaseException:
+            os.close(fd)
+            staging.unlink(missing_ok=True)
+            raise
+        os.close(fd)
+        os.replace(staging, path)
+    finally:
+        opening_book_free(handle)
+    return entries
+
+
+class OpeningBook:
+    """Read-only view of an opening book file, mapped copy-on-write.
+
+    Raises :class:`OpeningBookError` if *path* is not a complete book of
+    this format version.
+    """
+
+    def __init__(self, path: str | os.PathLike) -> None:
+        self.path = Path(path)
+        with open(self.path, "rb") as f:
+            size = os.fstat(f.fileno()).st_size
+            if size < ctypes.sizeof(OpeningBookHeader):
+                raise OpeningBookError(f"{path}: too short for an opening book header")
+            self._map: mmap.mmap | None = mmap.mmap(f.fileno(), size, access=mmap.ACCESS_COPY)
+        self.header = OpeningBookHeader.from_buffer_copy(self._map)
+        h = self.header
+        try:
+            if h.magic != OPENING_BOOK_MAGIC:
+                raise OpeningBookError(f"{path}: not an opening book")
+            if h.version != OPENING_BOOK_VERSION or h.header_size != ctypes.sizeof(OpeningBookHeader):
+                raise OpeningBookError(f"{path}: opening book version {h.version}, expected {OPENING_BOOK_VERSION}")
+            if h.file_size != size or h.file_size != _table_offset() + h.capacity * ctypes.sizeof(OpeningBookEntry):
+                raise OpeningBookError(f"{path}: truncated ({size} of {h.file_size} bytes)")
+            if h.capacity & (h.capacity - 1) or h.entries >= h.capacity:
+                raise OpeningBookError(f"{path}: corrupt table ({h.entries} entries in {h.capacity} slots)")
+        except OpeningBookError:
+            self._map.close()
+            raise
+        self._anchor: ctypes.c_char | None = ctypes.c_char.from_buffer(self._map)
+        self._table = ctypes.addressof(self._anchor) + _table_offset()
+
+    @property
+    def queue_depth(self) -> int:
+        """Next pieces in the key."""
+        return self.header.queue_depth
+
+    @property
+    def pieces(self) -> int:
+        """Placements per game the book was built for."""
+        return self.header.pieces
+
+    def __len__(self) -> int:
+        return self.header.entries
+
+    def _address(self) -> int:
+        if self._map is None:
+            raise RuntimeError("opening book is closed")
+        return self._table
+
+    def key(self, ctx: Any) -> int:
+        """Book key of the state of *ctx* (a context or ``StepEnv``)."""
+        return opening_book_key(ctx, self.queue_depth)
+
+    def lookup(self, ctx: Any) -> Placement | None:
+        """Book placement for the state of *ctx*, or ``None`` if it is not in the book.
+
+        The actions reach the stored landing from the current piece
+        position (starting with ``HOLD`` if the book holds) and end in
+        ``HARD_DROP``.
+        """
+        placements, _ = opening_book_lookup(self._address(), self.header.capacity, self.queue_depth, ctx)
+        return placements[0]
+
+    def lookup_many(self, contexts: Any) -> List[Placement | None]:
+        """:meth:`lookup` for a ``StepVectorEnv`` or ``ctypes`` array of contexts in one native call."""
+        ctxs = getattr(contexts, "states", contexts)
+        if not isinstance(ctxs, ctypes.Array) or ctxs._type_ is not StepEnvContext:
+            raise TypeError("expected a ctypes array of StepEnvContext or a StepVectorEnv")
+        placements, _ = opening_book_lookup(self._address(), self.header.capacity, self.queue_depth, ctxs)
+        return placements
+
+    def source(self, ctx: Any) -> str | None:
+        """Which search produced the entry for *ctx* (:data:`OPENING_BOOK_SOURCES`), or ``None``."""
+        _, found = opening_book_lookup(self._address(), self.header.capacity, self.queue_depth, ctx)
+        return OPENING_BOOK_SOURCES[found[0] - 1] if found[0] else None
+
+    def close(self) -> None:
+        """Unmap the file."""
+        if self._map is not None:
+            self._anchor = None  # the mapping cannot be closed while exported
+            self._map.close()
+            self._map = None
+
+    def __del__(self) -> None:
+        if getattr(self, "_map", None) is not None:
+            self.close()
+
+    def __repr__(self) -> str:
+        return f"OpeningBook({str(self.path)!r}, entries={len(self)}, queue_depth={self.queue_depth}, pieces={self.pieces})"
+
+
+def main(argv: Sequence[str] | None = None) -> None:
+    parser = argparse.ArgumentParser(prog="python -m tetrl.search.book", description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("path", help="book file to write")
+    parser.add_argument("--pieces", type=int, default=4, help="placements per game (default: 4)")
+    parser.add_argument("--depth", type=int, default=5, help="next pieces in the key (default: 5)")
+    parser.add_argument("--perfect-clear", type=int, default=0, metavar="LINES", help="try perfect clears of up to LINES rows first")
+    parser.add_argument("--no-hold", action="store_true", help="never use HOLD")
+    parser.add_argument("--threads", type=int, default=None, help="worker threads (default: all cores)")
+    parser.add_argument("--seed", type=int, default=0, help=argparse.SUPPRESS)
+    args = parser.parse_args(argv)
+
+    start = time.perf_counter()
+    entries = build_opening_book(
+        args.path,
+        pieces=args.pieces,
+        queue_depth=args.depth,
+        perfect_clear_lines=args.perfect_clear,
+        use_hold=not args.no_hold,
+        threads=args.threads,
+        seed=args.seed,
+    )
+    seconds = time.perf_counter() - start
+    size = os.path.getsize(args.path)
+    print(f"{entries} entries, {size / 2**20:.1f} MiB, built in {seconds:.1f}s")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,349 @@
+"""
+AlphaZero-style MCTS over placements with batched leaf evaluation.
+
+An :class:`Mcts` service searches one tree per root game natively (see
+``mcts.hpp``): moves are placements (every distinct landing of the
+current piece and, with hold, of the piece ``HOLD`` brings in), nodes are
+step-env contexts, selection is PUCT with virtual loss and the trees are
+spread over worker threads.  The leaves reached in a round, across all
+trees, go to a single Python *evaluate* callback as numpy arrays, so the
+network sees one large batch per round instead of one call per node::
+
+    def evaluate(leaves: MctsLeaves) -> tuple[np.ndarray, np.ndarray]:
+        # leaves.observations [B, *observation_shape] from the feature plugin
+        # leaves.placements   [C, 4] (hold, x, y, orientation), C = leaves.offsets[-1]
+        # leaves.afterstates  [C, F] afterstate features of each placement (F may be 0)
+        return priors, values  # [C] (any scale, normalised per leaf) and [B]
+
+Placement ``offsets[i] .. offsets[i + 1] - 1`` belong to leaf ``i``.  Each
+placement earns ``attack_weight * attack + lines_weight * lines`` (plus
+``top_out_reward`` if it tops out) and values are discounted returns.
+
+Leaf observations come from the same feature plugin as the env's (the
+default feature unless *feature* is given): every node keeps its own
+plugin context and a leaf gets the observation ``env.step_many(actions)``
+returns after its placement, so the network evaluates what it sees while
+playing.  ``feature="fixed"`` opts into a compact fixed encoding instead
+(``MCTS_OBSERVATION_SIZE`` floats, see ``mcts.hpp``).
+
+Examples
+--------
+>>> games = [StepEnv() for _ in range(64)]
+>>> for i, env in enumerate(games):
+...     env.reset(seed=i)
+>>> mcts = Mcts(64, afterstate_stats=True, dirichlet_epsilon=0.25, threads=8)
+>>> mcts.set_roots(games)  # also copies each env's feature plugin context
+>>> mcts.search(evaluate, simulations=200)
+>>> for i, env in enumerate(games):
+...     policy = mcts.policy(i)  # visit counts: the policy target
+...     k = int(np.argmax(policy.visits))
+...     env.step_many(policy.placements[k].actions)
+...     mcts.advance(i, k)  # keep the subtree
+"""
+
+from __future__ import annotations
+
+import ctypes
+import math
+import os
+from dataclasses import dataclass
+from typing import Any, Callable, List, NamedTuple, Sequence, Tuple
+
+import numpy as np
+
+from ..envs.step.native import StepEnvContext
+from .native import (
+    MCTS_OBSERVATION_SIZE,
+    MctsBatch,
+    MctsEvaluateFn,
+    MctsOptions,
+    Placement,
+    mcts_advance,
+    mcts_children,
+    mcts_create,
+    mcts_destroy,
+    mcts_nodes,
+    mcts_root_context,
+    mcts_root_stats,
+    mcts_search,
+    mcts_set_root,
+)
+
+__all__ = ["Mcts", "MctsLeaves", "MctsPolicy"]
+
+
+class MctsLeaves(NamedTuple):
+    """One batch of leaves handed to the evaluate callback (views, valid during the call)."""
+
+    observations: np.ndarray  # [B, *Mcts.observation_shape] float32
+    placements: np.ndarray  # [C, 4] int8: hold, x, y, orientation
+    afterstates: np.ndarray  # [C, F] float32
+    offsets: np.ndarray  # [B + 1] int32
+
+
+@dataclass(frozen=True)
+class MctsPolicy:
+    """Search result at one root."""
+
+    placements: List[Placement]
+    visits: np.ndarray  # [K] int32, the policy target
+    priors: np.ndarray  # [K] float32, as used by the search (root noise included)
+    q: np.ndarray  # [K] float32, mean return through each placement (0 if unvisited)
+    value: float  # mean return from the root
+    root_visits: int
+
+
+def _observation_shape(feature: Any) -> Tuple[int, ...]:
+    """Shape of one leaf observation: the feature's ``observation_space`` shape when it holds ``feature.size`` floats."""
+    if feature is None:
+        return (MCTS_OBSERVATION_SIZE,)
+    import gymnasium
+
+    space = feature.observation_space()
+    if isinstance(space, gymnasium.spaces.Box) and math.prod(space.shape) == feature.size:
+        return tuple(space.shape)
+    return (feature.size,)
+
+
+def _view(address: int, ctype: Any, shape: Tuple[int, ...]) -> np.ndarray:
+    count = int(np.prod(shape))
+    if count == 0 or not address:
+        return np.zeros(shape, dtype=np.dtype(ctype))
+    return np.ctypeslib.as_array((ctype * count).from_address(address)).reshape(shape)
+
+
+class Mcts:
+    """Native MCTS service over *roots* simultaneous root games.
+
+    Parameters
+    ----------
+    roots:
+        Number of trees; set their games with :meth:`set_root` /
+        :meth:`set_roots` (a tree without a live root is skipped).
+    c_puct:
+        Exploration constant of the PUCT rule.
+    gamma:
+        Discount of the returns backed up through the tree.
+    attack_weight, lines_weight, top_out_reward:
+        Reward of a placement: ``attack_weight * attack + lines_weight *
+        lines_cleared``, plus ``top_out_reward`` when it tops out.
+    dirichlet_alpha, dirichlet_epsilon:
+        Dirichlet noise mixed into the root priors for self-play
+        exploration (``epsilon = 0`` disables it).
+    batch_size:
+        Most leaves per evaluate call, shared over the trees.
+    virtual_loss:
+        Virtual visits (counted as losses) placed on a path while its leaf
+        waits for evaluation.
+    use_hold:
+        Also search the placements of the piece ``HOLD`` brings in.
+    threads:
+        Tree worker threads (default: ``os.cpu_count()``).
+    afterstate_planes, afterstate_stats:
+        Pass the afterstate features of every placement (see
+        :func:`~tetrl.search.afterstates`) to the callback.
+    feature:
+        Native feature plugin of the leaf observations (a ``CppFeature``
+        or the feature half of ``CppFusedPlugins``; the library must stay
+        open while the service lives).  ``None`` uses
+        :func:`~tetrl.envs.step.defaults.default_feature`, like
+        ``StepEnv``; ``"fixed"`` selects the fixed ``MCTS_OBSERVATION_SIZE``
+        encoding.
+    seed:
+        Seed of the root noise.
+    """
+
+    def __init__(
+        self,
+        roots: int,
+        *,
+        c_puct: float = 1.25,
+        gamma: float = 0.99,
+        attack_weight: float = 1.0,
+        lines_weight: float = 0.0,
+        top_out_reward: float = -1.0,
+        dirichlet_alpha: float = 0.3,
+        dirichlet_epsilon: float = 0.0,
+        batch_size: int = 64,
+        virtual_loss: int = 1,
+        use_hold: bool = True,
+        threads: int | None = None,
+        afterstate_planes: bool = False,
+        afterstate_stats: bool = False,
+        feature: Any = None,
+        seed: int = 0,
+    ) -> None:
+        if roots < 1:
+            raise ValueError(f"roots must be positive, got {roots}")
+        if batch_size < 1:
+            raise ValueError(f"batch_size must be positive, got {batch_size}")
+        if isinstance(feature, str):
+            if feature != "fixed":
+                raise ValueError(f"feature must be a native feature plugin, None or 'fixed', got {feature!r}")
+            feature = None
+        elif feature is None:
+            from ..envs.step.defaults import default_feature
+
+            feature = default_feature()
+        elif not hasattr(feature, "native_entry_points"):
+            raise TypeError(f"{type(feature).__name__} has no native entry points; use CppFeature")
+        self.roots = roots
+        self.feature = feature
+        feature_reset, feature_step_batch = feature.native_entry_points if feature is not None else (None, None)
+        self.options = MctsOptions(
+            seed=seed & (2**64 - 1),
+            c_puct=c_puct,
+            gamma=gamma,
+            attack_weight=attack_weight,
+            lines_weight=lines_weight,
+            top_out_reward=top_out_reward,
+            dirichlet_alpha=dirichlet_alpha,
+            dirichlet_epsilon=dirichlet_epsilon,
+            batch_size=batch_size,
+            virtual_loss=max(0, virtual_loss),
+            use_hold=int(use_hold),
+            threads=max(1, min(255, threads if threads is not None else (os.cpu_count() or 1))),
+            afterstate_planes=int(afterstate_planes),
+            afterstate_stats=int(afterstate_stats),
+            feature_reset=feature_reset,
+            feature_step_batch=feature_step_batch,
+            feature_context_size=feature.context_size if feature is not None else 0,
+            feature_size=feature.size if feature is not None else 0,
+        )
+        self.observation_shape = _observation_shape(feature)
+        self._handle = mcts_create(roots, self.options)
+
+    @property
+    def handle(self) -> int:
+        if self._handle is None:
+            raise RuntimeError("MCTS service is closed")
+        return self._handle
+
+    def _check(self, root: int) -> int:
+        if not 0 <= root < self.roots:
+            raise IndexError(f"root {root} out of range for {self.roots} roots")
+        return root
+
+    def _same_feature(self, plugin: Any) -> bool:
+        if plugin is None or self.feature is None:
+            return False
+        if plugin is self.feature:
+            return True
+        digest = getattr(plugin, "source_digest", None)
+        return digest is not None and digest == self.feature.source_digest and plugin.context_size == self.feature.context_size
+
+    def _set_root(self, root: int, ctx: Any, feature_ctx: int | None, observation: Any) -> None:
+        row = None
+        if observation is not None and self.feature is not None:
+            row = np.ascontiguousarray(observation, dtype=np.float32).reshape(-1)
+            if row.size != self.feature.size:
+                raise ValueError(f"observation has {row.size} floats, the feature plugin {self.feature.size}")
+        mcts_set_root(self.handle, root, ctx, feature_ctx, row.ctypes.data if row is not None else None)
+
+    def set_root(self, root: int, ctx: Any, observation: Any = None) -> None:
+        """Start a new tree for *root* at the state of *ctx* (a context or ``StepEnv``).
+
+        *observation* is the env's current observation, evaluated at the
+        root.  The root's feature plugin context is copied from a
+        ``StepEnv`` with the same feature plugin; otherwise (and for the
+        observation when it is not given) the root starts as after
+        ``StepEnv.reset``, which differs for stateful features such as
+        frame histories.
+        """
+        feature_ctx = None
+        plugin = getattr(ctx, "feature", None)
+        if self._same_feature(plugin) and plugin.context_size > 0:
+            feature_ctx = plugin.context_address
+        self._set_root(self._check(root), ctx, feature_ctx, observation)
+
+    def set_roots(self, contexts: Any, observations: Any = None) -> None:
+        """:meth:`set_root` for every root from a ``StepVectorEnv`` or a sequence of contexts or ``StepEnv`` objects.
+
+        *observations* holds one observation per root (e.g. the vector
+        env's last ones); a ``StepVectorEnv`` with the same feature plugin
+        also provides the plugin contexts.
+        """
+        ctxs: Sequence[Any] = getattr(contexts, "states", contexts)
+        if len(ctxs) != self.roots:
+            raise ValueError(f"expected {self.roots} contexts, got {len(ctxs)}")
+        if observations is not None and len(observations) != self.roots:
+            raise ValueError(f"expected {self.roots} observations, got {len(observations)}")
+        if ctxs is contexts:
+            for i, ctx in enumerate(ctxs):
+                self.set_root(i, ctx, None if observations is None else observations[i])
+            return
+        plugin_ctxs = contexts.feature_contexts if self._same_feature(getattr(contexts, "feature", None)) else None
+        for i, ctx in enumerate(ctxs):
+            feature_ctx = plugin_ctxs[i].ctypes.data if plugin_ctxs is not None and plugin_ctxs.shape[1] > 0 else None
+            self._set_root(i, ctx, feature_ctx, None if observations is None else observations[i])
+
+    def search(self, evaluate: Callable[[MctsLeaves], Tuple[Any, Any]], simulations: int = 100) -> None:
+        """Add *simulations* visits to every live root.
+
+        *evaluate* is called once per round with the pending leaves of all
+        trees and returns ``(priors, values)``; priors need not be
+        normalised (negative and NaN entries count as 0, all-zero means
+        uniform).  An exception raised by *evaluate* stops the search,
+        leaving the trees as they were before that round, and propagates.
+        """
+        errors: List[BaseException] = []
+
+        def call(_user: Any, address: int) -> int:
+            try:
+                b = MctsBatch.from_address(address)
+                leaves = MctsLeaves(
+                    observations=_view(b.observations, ctypes.c_float, (b.leaves, *self.observation_shape)),
+                    placements=_view(b.placements, ctypes.c_int8, (b.children, 4)),
+                    afterstates=_view(b.afterstates, ctypes.c_float, (b.children, b.afterstate_size)),
+                    offsets=_view(b.offsets, ctypes.c_int32, (b.leaves + 1,)),
+                )
+                priors, values = evaluate(leaves)
+                np.copyto(_view(b.priors, ctypes.c_float, (b.children,)), np.asarray(priors, dtype=np.float32).reshape(b.children))
+                np.copyto(_view(b.values, ctypes.c_float, (b.leaves,)), np.asarray(values, dtype=np.float32).reshape(b.leaves))
+                return 0
+            except BaseException as e:  # re-raised once the native search has unwound
+                errors.append(e)
+                return 1
+
+        callback = MctsEvaluateFn(call)
+        mcts_search(self.handle, simulations, callback)
+        if errors:
+            raise errors[0]
+
+    def policy(self, root: int) -> MctsPolicy:
+        """Visit counts, priors and values of the placements at *root*."""
+        placements, stats = mcts_children(self.handle, self._check(root))
+        top = mcts_root_stats(self.handle, root)
+        return MctsPolicy(
+            placements=placements,
+            visits=np.array([s.visits for s in stats], dtype=np.int32),
+            priors=np.array([s.prior for s in stats], dtype=np.float32),
+            q=np.array([s.q for s in stats], dtype=np.float32),
+            value=float(top.q),
+            root_visits=int(top.visits),
+        )
+
+    def advance(self, root: int, child: int) -> None:
+        """Move *root* to its placement *child*, reusing that subtree."""
+        if not mcts_advance(self.handle, self._check(root), child):
+            raise IndexError(f"root {root} has no placement {child} (search it first)")
+
+    def root_context(self, root: int) -> StepEnvContext:
+        """Copy of the step-env context at *root*."""
+        return mcts_root_context(self.handle, self._check(root))
+
+    def tree_size(self, root: int) -> int:
+        """Nodes of the tree at *root*."""
+        return mcts_nodes(self.handle, self._check(root))
+
+    def close(self) -> None:
+        """Free the native trees."""
+        if self._handle is not None:
+            mcts_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self) -> None:
+        self.close()
+
+    def __repr__(self) -> str:
+        return f"Mcts(roots={self.roots}, observation_shape={self.observation_shape}, batch_size={self.options.batch_size}, threads={self.options.threads})"
@@ -0,0 +1,1028 @@
+"""
+Python/native bridge for the search headers (``movegen.hpp``,
+``movegen_cache.hpp``, ``pc.hpp``, ``heuristic.hpp``, ``perft.hpp``,
+``afterstate.hpp``, ``mcts.hpp``, ``opening_book.hpp``).
+
+Responsibility
+--------------
+JIT-compiles the move generator, its surface-keyed placement cache and
+the perfect-clear solver, the heuristic-weight evaluator, the perft
+counter, the afterstate featuriser, the MCTS service and the opening
+book builder and lookup, linked
+against the shared engine core, mirrors their result structs as
+``ctypes.Structure`` and exposes typed helpers that take a
+:class:`~tetrl.envs.step.native.StepEnvContext` (or a
+:class:`~tetrl.envs.step.env.StepEnv`).  Searches follow the context's
+step-env rules: gravity when ``auto_drop`` is set and at most
+``piece_life - 1`` inputs per piece, so every returned action sequence
+can be fed to ``env.step`` / ``env.step_many`` as is.
+"""
+
+from __future__ import annotations
+
+import ctypes
+import os
+import time
+from dataclasses import dataclass
+from typing import Any, List, NamedTuple
+
+import numpy as np
+
+from .. import dynamic_library as dl
+from ..engine.state import PieceType
+from ..envs.step.native import StepEnvConfig, StepEnvContext
+from ..native_build import create_library
+from ..native_layout import csrc_path
+
+_ENGINE_HPP = "engine/tetris.hpp"
+_STEP_HPP = "envs/step/step.hpp"
+_MOVEGEN_HPP = "search/movegen.hpp"
+_MOVEGEN_CACHE_HPP = "search/movegen_cache.hpp"
+_PC_HPP = "search/pc.hpp"
+_HEURISTIC_HPP = "search/heuristic.hpp"
+_PERFT_HPP = "search/perft.hpp"
+_AFTERSTATE_HPP = "search/afterstate.hpp"
+_MCTS_HPP = "search/mcts.hpp"
+_OPENING_BOOK_HPP = "search/opening_book.hpp"
+
+PLACEMENT_PATH_CAPACITY = 64
+MAX_PLACEMENTS = 1024
+PC_MAX_LINES = 6
+PC_MAX_PIECES = 15
+PC_MIN_MEMO_BITS = 4
+PC_MAX_MEMO_BITS = 30
+PC_MAX_ACTIONS = 1024
+PERFT_MAX_DEPTH = 8
+
+
+class Position(ctypes.Structure):
+    """Mirror of ``tetrl::search::Position`` in ``movegen.hpp``."""
+
+    _fields_ = [
+        ("x", ctypes.c_int8),
+        ("y", ctypes.c_int8),
+        ("orientation", ctypes.c_uint8),
+    ]
+
+
+class PlacementPath(ctypes.Structure):
+    """Mirror of ``tetrl::search::PlacementPath`` in ``movegen.hpp``."""
+
+    _fields_ = [
+        ("position", Position),
+        ("path_length", ctypes.c_uint8),
+        ("path", ctypes.c_uint8 * PLACEMENT_PATH_CAPACITY),
+    ]
+
+
+class PcOptions(ctypes.Structure):
+    """Mirror of ``tetrl::search::PcOptions`` in ``pc.hpp``."""
+
+    _fields_ = [
+        ("max_lines", ctypes.c_int32),
+        ("next_pieces", ctypes.c_int32),
+        ("use_hold", ctypes.c_uint8),
+        ("threads", ctypes.c_uint8),
+        ("max_millis", ctypes.c_uint32),
+        ("max_nodes", ctypes.c_uint64),
+    ]
+
+
+class PcPlacement(ctypes.Structure):
+    """Mirror of ``tetrl::search::PcPlacement`` in ``pc.hpp``."""
+
+    _fields_ = [
+        ("piece", ctypes.c_int8),
+        ("hold", ctypes.c_uint8),
+        ("position", Position),
+    ]
+
+
+class PcSolution(ctypes.Structure):
+    """Mirror of ``tetrl::search::PcSolution`` in ``pc.hpp``."""
+
+    _fields_ = [
+        ("found", ctypes.c_int32),
+        ("lines", ctypes.c_int32),
+        ("piece_count", ctypes.c_int32),
+        ("action_count", ctypes.c_int32),
+        ("nodes", ctypes.c_uint64),
+        ("placements", PcPlacement * PC_MAX_PIECES),
+        ("actions", ctypes.c_uint8 * PC_MAX_ACTIONS),
+    ]
+
+
+class AfterstateOptions(ctypes.Structure):
+    """Mirror of ``tetrl::search::AfterstateOptions`` in ``afterstate.hpp``."""
+
+    _fields_ = [
+        ("use_hold", ctypes.c_uint8),
+        ("planes", ctypes.c_uint8),
+        ("stats", ctypes.c_uint8),
+    ]
+
+
+class MctsOptions(ctypes.Structure):
+    """Mirror of ``tetrl::search::MctsOptions`` in ``mcts.hpp``."""
+
+    _fields_ = [
+        ("seed", ctypes.c_uint64),
+        ("c_puct", ctypes.c_float),
+        ("gamma", ctypes.c_float),
+        ("attack_weight", ctypes.c_float),
+        ("lines_weight", ctypes.c_float),
+        ("top_out_reward", ctypes.c_float),
+        ("dirichlet_alpha", ctypes.c_float),
+        ("dirichlet_epsilon", ctypes.c_float),
+        ("batch_size", ctypes.c_int32),
+        ("virtual_loss", ctypes.c_int32),
+        ("use_hold", ctypes.c_uint8),
+        ("threads", ctypes.c_uint8),
+        ("afterstate_planes", ctypes.c_uint8),
+        ("afterstate_stats", ctypes.c_uint8),
+        ("feature_reset", ctypes.c_void_p),
+        ("feature_step_batch", ctypes.c_void_p),
+        ("feature_context_size", ctypes.c_int64),
+        ("feature_size", ctypes.c_int64),
+    ]
+
+
+class MctsBatch(ctypes.Structure):
+    """Mirror of ``tetrl::search::MctsBatch`` in ``mcts.hpp``."""
+
+    _fields_ = [
+        ("observations", ctypes.c_void_p),
+        ("afterstates", ctypes.c_void_p),
+        ("placements", ctypes.c_void_p),
+        ("offsets", ctypes.c_void_p),
+        ("priors", ctypes.c_void_p),
+        ("values", ctypes.c_void_p),
+        ("leaves", ctypes.c_int32),
+        ("children", ctypes.c_int32),
+        ("afterstate_size", ctypes.c_int32),
+        ("observation_size", ctypes.c_int32),
+    ]
+
+
+class MctsStats(ctypes.Structure):
+    """Mirror of ``tetrl::search::MctsStats`` in ``mcts.hpp``."""
+
+    _fields_ = [
+        ("visits", ctypes.c_int32),
+        ("prior", ctypes.c_float),
+        ("q", ctypes.c_float),
+    ]
+
+
+# int32_t (*)(void* user, const MctsBatch* batch)
+MctsEvaluateFn = ctypes.CFUNCTYPE(ctypes.c_int32, ctypes.c_void_p, ctypes.c_void_p)
+
+
+class PerftOptions(ctypes.Structure):
+    """Mirror of ``tetrl::search::PerftOptions`` in ``perft.hpp``."""
+
+    _fields_ = [
+        ("depth", ctypes.c_int32),
+        ("use_hold", ctypes.c_uint8),
+        ("threads", ctypes.c_uint8),
+    ]
+
+
+class PerftCounts(ctypes.Structure):
+    """Mirror of ``tetrl::search::PerftCounts`` in ``perft.hpp``."""
+
+    _fields_ = [
+        ("nodes", ctypes.c_uint64),
+        ("line_clears", ctypes.c_uint64),
+        ("lines", ctypes.c_uint64),
+        ("spins", ctypes.c_uint64 * 3),
+        ("perfect_clears", ctypes.c_uint64),
+        ("top_outs", ctypes.c_uint64),
+    ]
+
+
+OPENING_BOOK_MAGIC = b"TETRLBOK"
+OPENING_BOOK_VERSION = 1
+OPENING_BOOK_ALIGN = 64
+OPENING_BOOK_SOURCES = ("heuristic", "perfect_clear")  # OpeningBookSource
+
+
+class OpeningBookHeader(ctypes.Structure):
+    """Mirror of ``tetrl::search::OpeningBookHeader`` in ``opening_book.hpp``."""
+
+    _fields_ = [
+        ("magic", ctypes.c_char * 8),
+        ("version", ctypes.c_uint32),
+        ("header_size", ctypes.c_uint32),
+        ("file_size", ctypes.c_uint64),
+        ("capacity", ctypes.c_uint64),
+        ("entries", ctypes.c_uint64),
+        ("queue_depth", ctypes.c_int32),
+        ("pieces", ctypes.c_int32),
+    ]
+
+
+class OpeningBookEntry(ctypes.Structure):
+    """Mirror of ``tetrl::search::OpeningBookEntry`` in ``opening_book.hpp``."""
+
+    _fields_ = [
+        ("key", ctypes.c_uint64),
+        ("hold", ctypes.c_uint8),
+        ("position", Position),
+        ("source", ctypes.c_uint8),
+        ("ply", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8 * 2),
+    ]
+
+
+class OpeningBookOptions(ctypes.Structure):
+    """Mirror of ``tetrl::search::OpeningBookOptions`` in ``opening_book.hpp``."""
+
+    _fields_ = [
+        ("pieces", ctypes.c_int32),
+        ("queue_depth", ctypes.c_int32),
+        ("perfect_clear_lines", ctypes.c_int32),
+        ("use_hold", ctypes.c_uint8),
+        ("threads", ctypes.c_uint8),
+        ("perfect_clear_nodes", ctypes.c_uint64),
+        ("seed", ctypes.c_uint64),
+        ("weights", ctypes.c_double * 8),
+        ("config", StepEnvConfig),
+    ]
+
+
+_WRAPPER_SOURCE = (
+    f'#include "{_ENGINE_HPP}"\n'
+    f'#include "{_STEP_HPP}"\n'
+    f'#include "{_MOVEGEN_HPP}"\n'
+    f'#include "{_MOVEGEN_CACHE_HPP}"\n'
+    f'#include "{_PC_HPP}"\n'
+    f'#include "{_HEURISTIC_HPP}"\n'
+    f'#include "{_PERFT_HPP}"\n'
+    f'#include "{_AFTERSTATE_HPP}"\n'
+    f'#include "{_MCTS_HPP}"\n'
+    f'#include "{_OPENING_BOOK_HPP}"\n\n'
+    + r"""
+using namespace tetrl::search;
+
+static_assert(sizeof(Position) == 3 && sizeof(PcPlacement) == 5, "search structs changed; update tetrl/search/native.py");
+static_assert(HEURISTIC_FEATURES == 8 && sizeof(HeuristicResult) == 5 * sizeof(double), "heuristic evaluator changed; update tetrl/search/native.py");
+static_assert(PERFT_MAX_DEPTH == 8 && sizeof(PerftOptions) == 8 && sizeof(PerftCounts) == 8 * sizeof(std::uint64_t), "perft structs changed; update tetrl/search/native.py");
+
+API void* api_moveGenCacheCreate(std::int32_t capacity, std::int32_t shards) {
+    return new MoveGenCache(capacity, shards);
+}
+
+API void api_moveGenCacheDestroy(void* cache) {
+    delete static_cast<MoveGenCache*>(cache);
+}
+
+API void api_moveGenCacheStats(void* cache, std::uint64_t* out) {
+    const MoveGenCacheStats stats = static_cast<MoveGenCache*>(cache)->stats();
+    out[0] = stats.hits;
+    out[1] = stats.misses;
+    out[2] = stats.evictions;
+    out[3] = stats.entries;
+}
+
+API void api_moveGenCacheClear(void* cache) {
+    static_cast<MoveGenCache*>(cache)->clear();
+}
+
+API std::int32_t api_generateCachedPlacements(const Context* ctx, std::uint8_t hold, void* cache, PlacementPath* out, std::int32_t capacity) {
+    thread_local MoveGenerator movegen;
+    return generateCachedPlacements(ctx, hold != 0, &movegen, static_cast<MoveGenCache*>(cache), out, capacity);
+}
+
+API void api_generateCachedPlacementsMany(const Context* ctxs, std::int32_t count, std::uint8_t hold, void* cache,
+                                          PlacementPath* out, std::int32_t capacity, std::int32_t* counts, std::int32_t threads) {
+    thread_local MoveGenerator movegen;
+    generateCachedPlacementsMany(ctxs, count, hold != 0, &movegen, static_cast<MoveGenCache*>(cache), out, capacity, counts, threads);
+}
+
+API void api_evaluateHeuristics(const double* weights, std::int32_t count, std::int32_t games, std::int32_t max_pieces,
+                                std::uint64_t seed, std::uint8_t use_hold, std::int32_t threads,
+                                const tetrl::envs::step::Config* config, HeuristicResult* out) {
+    HeuristicOptions options;
+    options.games = games;
+    options.max_pieces = max_pieces;
+    options.seed = seed;
+    options.use_hold = use_hold;
+    options.threads = static_cast<std::uint8_t>(std::clamp(threads, 1, 255));
+    options.config = *config;
+    evaluateHeuristics(weights, count, options, out);
+}
+
+API void* api_pcSolverCreate(std::int32_t threads, std::int32_t memo_bits) {
+    return new PerfectClearSolver(threads, memo_bits);
+}
+
+API void api_pcSolverDestroy(void* solver) {
+    delete static_cast<PerfectClearSolver*>(solver);
+}
+
+static_assert(sizeof(PcOptions) == 24 && PC_MIN_MEMO_BITS == 4 && PC_MAX_MEMO_BITS == 30,
+              "perfect-clear options changed; update tetrl/search/native.py");
+
+API void api_pcSolve(void* solver, const Context* ctx, const PcOptions* options, PcSolution* out) {
+    static_cast<PerfectClearSolver*>(solver)->solve(ctx, *options, out);
+}
+
+API void api_perft(const Context* ctx, const PerftOptions* options, PerftCounts* out) {
+    perft(*ctx, *options, out);
+}
+
+static_assert(sizeof(AfterstateOptions) == 3 && AFTERSTATE_STATS == 23 && AFTERSTATE_PLANE_SIZE == 200,
+              "afterstate layout changed; update tetrl/search/native.py");
+
+API std::int32_t api_generateAfterstates(const Context* ctx, const AfterstateOptions* options, PlacementPath* placements,
+                                         float* features, std::int32_t capacity) {
+    thread_local MoveGenerator movegen;
+    return generateAfterstates(ctx, *options, &movegen, placements, features, capacity);
+}
+
+static_assert(sizeof(MctsOptions) == 80 && sizeof(MctsBatch) == 64 && sizeof(MctsStats) == 12
+                  && MCTS_OBSERVATION_SIZE == 253 && MCTS_MAX_CHILDREN == 1024,
+              "MCTS structs changed; update tetrl/search/native.py");
+
+API void* api_mctsCreate(std::int32_t roots, const MctsOptions* options) {
+    return new MctsService(roots, *options);
+}
+
+API void api_mctsDestroy(void* service) {
+    delete static_cast<MctsService*>(service);
+}
+
+API void api_mctsSetRoot(void* service, std::int32_t root, const Context* ctx, const void* feature_ctx, const float* observation) {
+    static_cast<MctsService*>(service)->setRoot(root, *ctx, feature_ctx, observation);
+}
+
+API std::uint8_t api_mctsAdvance(void* service, std::int32_t root, std::int32_t child) {
+    return static_cast<MctsService*>(service)->advance(root, child);
+}
+
+API std::int32_t api_mctsSearch(void* service, std::int32_t simulations, MctsEvaluateFn evaluate, void* user) {
+    return static_cast<MctsService*>(service)->search(simulations, evaluate, user);
+}
+
+API std::int32_t api_mctsChildren(void* service, std::int32_t root, PlacementPath* paths, MctsStats* stats, std::int32_t capacity) {
+    return static_cast<MctsService*>(service)->children(root, paths, stats, capacity);
+}
+
+API void api_mctsRootStats(void* service, std::int32_t root, MctsStats* out) {
+    *out = static_cast<MctsService*>(service)->rootStats(root);
+}
+
+API void api_mctsRootContext(void* service, std::int32_t root, Context* out) {
+    *out = static_cast<MctsService*>(service)->rootContext(root);
+}
+
+API std::int64_t api_mctsNodes(void* service, std::int32_t root) {
+    return static_cast<std::int64_t>(static_cast<MctsService*>(service)->nodes(root));
+}
+
+static_assert(sizeof(OpeningBookHeader) == 48 && sizeof(OpeningBookEntry) == 16 && sizeof(OpeningBookOptions) == 104
+                  && OPENING_BOOK_VERSION == 1 && OPENING_BOOK_ALIGN == 64,
+              "opening book layout changed; update tetrl/search/native.py");
+
+API void* api_openingBookBuild(const OpeningBookOptions* options) {
+    return new std::vector<OpeningBookEntry>(buildOpeningBook(*options));
+}
+
+API std::int64_t api_openingBookEntries(void* entries) {
+    return static_cast<std::int64_t>(static_cast<std::vector<OpeningBookEntry>*>(entries)->size());
+}
+
+API void api_openingBookFill(void* entries, OpeningBookEntry* table, std::uint64_t capacity) {
+    fillOpeningBook(*static_cast<std::vector<OpeningBookEntry>*>(entries), table, capacity);
+}
+
+API void api_openingBookFree(void* entries) {
+    delete static_cast<std::vector<OpeningBookEntry>*>(entries);
+}
+
+API std::uint64_t api_openingBookKey(const Context* ctx, std::int32_t queue_depth) {
+    return openingBookKey(ctx->state, queue_depth);
+}
+
+// found[i] = 1 + OpeningBookSource of the entry played by context i, 0 on a miss.
+API void api_openingBookLookup(const OpeningBookEntry* table, std::uint64_t capacity, std::int32_t queue_depth,
+                               const Context* ctxs, std::int32_t count, PlacementPath* out, std::uint8_t* found) {
+    thread_local MoveGenerator movegen;
+    for (std::int32_t i = 0; i < count; ++i) {
+        std::uint8_t source = 0;
+        found[i] = openingBookPlacement(&ctxs[i], table, capacity, queue_depth, &movegen, &out[i], &source) ? 1 + source : 0;
+    }
+}
+"""
+)
+
+_lib = create_library(extra_compile_flags=["-pthread"])
+
+_lib.compile_string(
+    _WRAPPER_SOURCE,
+    watch_files=[
+        csrc_path(_ENGINE_HPP),
+        csrc_path(_STEP_HPP),
+        csrc_path(_MOVEGEN_HPP),
+        csrc_path(_MOVEGEN_CACHE_HPP),
+        csrc_path(_PC_HPP),
+        csrc_path(_HEURISTIC_HPP),
+        csrc_path(_PERFT_HPP),
+        csrc_path(_AFTERSTATE_HPP),
+        csrc_path(_MCTS_HPP),
+        csrc_path(_OPENING_BOOK_HPP),
+    ],
+    functions={
+        "api_moveGenCacheCreate": {"argtypes": [dl.int32, dl.int32], "restype": dl.void_p},
+        "api_moveGenCacheDestroy": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_moveGenCacheStats": {"argtypes": [dl.void_p, dl.void_p], "restype": dl.void},
+        "api_moveGenCacheClear": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_generateCachedPlacements": {
+            "argtypes": [dl.void_p, dl.uint8, dl.void_p, dl.void_p, dl.int32],
+            "restype": dl.int32,
+        },
+        "api_generateCachedPlacementsMany": {
+            "argtypes": [dl.void_p, dl.int32, dl.uint8, dl.void_p, dl.void_p, dl.int32, dl.void_p, dl.int32],
+            "restype": dl.void,
+        },
+        "api_evaluateHeuristics": {
+            "argtypes": [dl.void_p, dl.int32, dl.int32, dl.int32, dl.uint64, dl.uint8, dl.int32, dl.void_p, dl.void_p],
+            "restype": dl.void,
+        },
+        "api_pcSolverCreate": {"argtypes": [dl.int32, dl.int32], "restype": dl.void_p},
+        "api_pcSolverDestroy": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_pcSolve": {"argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p], "restype": dl.void},
+        "api_perft": {"argtypes": [dl.void_p, dl.void_p, dl.void_p], "restype": dl.void},
+        "api_generateAfterstates": {
+            "argtypes": [dl.void_p, dl.void_p, dl.void_p, dl.void_p, dl.int32],
+            "restype": dl.int32,
+        },
+        "api_mctsCreate": {"argtypes": [dl.int32, dl.void_p], "restype": dl.void_p},
+        "api_mctsDestroy": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_mctsSetRoot": {"argtypes": [dl.void_p, dl.int32, dl.void_p, dl.void_p, dl.void_p], "restype": dl.void},
+        "api_mctsAdvance": {"argtypes": [dl.void_p, dl.int32, dl.int32], "restype": dl.uint8},
+        "api_mctsSearch": {"argtypes": [dl.void_p, dl.int32, dl.void_p, dl.void_p], "restype": dl.int32},
+        "api_mctsChildren": {
+            "argtypes": [dl.void_p, dl.int32, dl.void_p, dl.void_p, dl.int32],
+            "restype": dl.int32,
+        },
+        "api_mctsRootStats": {"argtypes": [dl.void_p, dl.int32, dl.void_p], "restype": dl.void},
+        "api_mctsRootContext": {"argtypes": [dl.void_p, dl.int32, dl.void_p], "restype": dl.void},
+        "api_mctsNodes": {"argtypes": [dl.void_p, dl.int32], "restype": dl.int64},
+        "api_openingBookBuild": {"argtypes": [dl.void_p], "restype": dl.void_p},
+        "api_openingBookEntries": {"argtypes": [dl.void_p], "restype": dl.int64},
+        "api_openingBookFill": {"argtypes": [dl.void_p, dl.void_p, dl.uint64], "restype": dl.void},
+        "api_openingBookFree": {"argtypes": [dl.void_p], "restype": dl.void},
+        "api_openingBookKey": {"argtypes": [dl.void_p, dl.int32], "restype": dl.uint64},
+        "api_openingBookLookup": {
+            "argtypes": [dl.void_p, dl.uint64, dl.int32, dl.void_p, dl.int32, dl.void_p, dl.void_p],
+            "restype": dl.void,
+        },
+    },
+)
+
+
+def _context(ctx: Any) -> StepEnvContext:
+    if isinstance(ctx, StepEnvContext):
+        return ctx
+    inner = getattr(ctx, "state", None)
+    if isinstance(inner, StepEnvContext):
+        return inner
+    raise TypeError(f"expected a StepEnvContext or StepEnv, got {type(ctx).__name__}")
+
+
+class Placement(NamedTuple):
+    """A reachable landing and the actions (ending in ``HARD_DROP``) that reach it."""
+
+    x: int
+    y: int
+    orientation: int
+    actions: np.ndarray
+
+
+@dataclass(frozen=True)
+class MoveGenCacheStats:
+    """Counters of a :class:`MoveGenCache`."""
+
+    hits: int
+    misses: int
+    evictions: int
+    entries: int
+
+    @property
+    def hit_rate(self) -> float:
+        lookups = self.hits + self.misses
+        return self.hits / lookups if lookups else 0.0
+
+
+class MoveGenCache:
+    """Thread-safe LRU cache of placement searches, keyed by board surface.
+
+    Two boards share an entry when the empty cells a piece can reach from
+    its start position are the same (together with the piece, its start
+    and the move rules), whatever lies deeper in the stack, so placements
+    on boards seen before -- early in the game, after a perfect clear, or
+    in another env of a batch -- become a lookup instead of a search.
+
+    Parameters
+    ----------
+    capacity:
+        Maximum number of cached searches (typically under 1 KiB each).
+    shards:
+        Independently locked LRU shards; rounded up to a power of two.
+    """
+
+    def __init__(self, capacity: int = 16384, shards: int = 16) -> None:
+        if capacity < 1 or shards < 1:
+            raise ValueError("capacity and shards must be positive")
+        self.capacity = capacity
+        self._handle = _lib.api_moveGenCacheCreate(capacity, shards)
+
+    def stats(self) -> MoveGenCacheStats:
+        """Hit, miss and eviction counts since creation (or :meth:`clear`)."""
+        out = (ctypes.c_uint64 * 4)()
+        _lib.api_moveGenCacheStats(self._handle, ctypes.addressof(out))
+        return MoveGenCacheStats(*map(int, out))
+
+    def clear(self) -> None:
+        """Drop every entry and reset the counters."""
+        _lib.api_moveGenCacheClear(self._handle)
+
+    def __del__(self) -> None:
+        if getattr(self, "_handle", None) is not None:
+            _lib.api_moveGenCacheDestroy(self._handle)
+            self._handle = None
+
+
+_default_cache: MoveGenCache | None = None
+
+
+def default_movegen_cache() -> MoveGenCache:
+    """The process-wide cache :func:`placements` uses by default."""
+    global _default_cache
+    if _default_cache is None:
+        _default_cache = MoveGenCache()
+    return _default_cache
+
+
+def _cache_handle(cache: MoveGenCache | bool) -> Any:
+    if cache is True:
+        return default_movegen_cache()._handle
+    if cache is False:
+        return None
+    if isinstance(cache, MoveGenCache):
+        return cache._handle
+    raise TypeError(f"cache must be a MoveGenCache or a bool, got {type(cache).__name__}")
+
+
+def _unpack(buf: Any, n: int) -> List[Placement]:
+    return [
+        Placement(
+            p.position.x,
+            p.position.y,
+            p.position.orientation,
+            np.frombuffer(p.path, dtype=np.uint8, count=p.path_length).copy(),
+        )
+        for p in buf[:n]
+    ]
+
+
+def placements(ctx: Any, *, hold: bool = False, cache: MoveGenCache | bool = True) -> List[Placement]:
+    """Every distinct landing of the current piece, each with a shortest action sequence.
+
+    With *hold*, lists the landings of the piece that ``HOLD`` brings in
+    (the action sequences then start with ``HOLD``); empty if hold is
+    unavailable.  *cache* is a :class:`MoveGenCache`, ``True`` for the
+    shared :func:`default_movegen_cache` or ``False`` to always search.
+    """
+    buf = (PlacementPath * MAX_PLACEMENTS)()
+    n = _lib.api_generateCachedPlacements(
+        ctypes.addressof(_context(ctx)), int(hold), _cache_handle(cache), ctypes.addressof(buf), len(buf)
+    )
+    return _unpack(buf, n)
+
+
+def placements_many(
+    contexts: Any,
+    *,
+    hold: bool = False,
+    cache: MoveGenCache | bool = True,
+    threads: int = 1,
+    capacity: int = 256,
+) -> List[List[Placement]]:
+    """:func:`placements` for every env of a batch in one native call.
+
+    *contexts* is a ``ctypes`` array of :class:`StepEnvContext` or a
+    :class:`~tetrl.envs.step.vector.StepVectorEnv`.  The envs are split
+    over *threads* threads sharing *cache*; at most *capacity* placements
+    are returned per env.
+    """
+    ctxs = getattr(contexts, "states", contexts)
+    if not isinstance(ctxs, ctypes.Array) or ctxs._type_ is not StepEnvContext:
+        raise TypeError("expected a ctypes array of StepEnvContext or a StepVectorEnv")
+    handle = _cache_handle(cache)
+    buf = (PlacementPath * (len(ctxs) * capacity))()
+    counts = np.zeros(len(ctxs), dtype=np.int32)
+    _lib.api_generateCachedPlacementsMany(
+        ctypes.addressof(ctxs), len(ctxs), int(hold), handle, ctypes.addressof(buf), capacity,
+        counts.ctypes.data, max(1, threads),
+    )
+    return [_unpack(buf[i * capacity : (i + 1) * capacity], int(n)) for i, n in enumerate(counts)]
+
+
+@dataclass(frozen=True)
+class PerfectClearMove:
+    """One placement of a perfect-clear solution."""
+
+    piece: PieceType
+    hold: bool  # HOLD is pressed before this placement
+    x: int
+    y: int
+    orientation: int
+
+
+@dataclass(frozen=True)
+class PerfectClear:
+    """Result of :meth:`PerfectClearSolver.solve`."""
+
+    lines: int
+    moves: List[PerfectClearMove]
+    actions: np.ndarray  # step-env actions of all placements, in order
+    nodes: int
+
+
+class PerfectClearSolver:
+    """Native perfect-clear finder.
+
+    Parameters
+    ----------
+    threads:
+        Worker threads the root placements are split across (default:
+        ``os.cpu_count()``).  Results do not depend on the thread count.
+    memo_bits:
+        Log2 of the entries of each thread's memo table of failed
+        search states (16 bytes per entry), in
+        ``[PC_MIN_MEMO_BITS, PC_MAX_MEMO_BITS]``.
+
+    On one core, a 4-line search from an empty board takes a few
+    milliseconds at the median but about 9 ms on average and over
+    100 ms in the worst case, so an unbounded :meth:`solve` does not stay
+    under 10 ms.  For online use (e.g. as a teacher inside the training
+    loop) pass a *time_limit_ms* budget, as :func:`find_perfect_clear`
+    does by default.
+    """
+
+    def __init__(self, threads: int | None = None, memo_bits: int = 18) -> None:
+        self._handle = None
+        if not PC_MIN_MEMO_BITS <= memo_bits <= PC_MAX_MEMO_BITS:
+            raise ValueError(f"memo_bits must be in [{PC_MIN_MEMO_BITS}, {PC_MAX_MEMO_BITS}], got {memo_bits}")
+        self.threads = max(1, min(255, threads if threads is not None else (os.cpu_count() or 1)))
+        self._handle = _lib.api_pcSolverCreate(self.threads, memo_bits)
+
+    def solve(
+        self,
+        ctx: Any,
+        *,
+        max_lines: int = 4,
+        next_pieces: int | None = None,
+        use_hold: bool = True,
+        max_nodes: int = 0,
+        time_limit_ms: int = 0,
+    ) -> PerfectClear | None:
+        """Find a perfect clear of at most *max_lines* rows from the state of *ctx*.
+
+        Fewer rows are tried first.  Only boards whose blocks all lie in
+        the bottom *max_lines* rows can qualify.  *next_pieces* limits the
+        visible queue (default: every queued piece); *max_nodes* and
+        *time_limit_ms* bound the search (``0`` = unlimited).  A time limit
+        makes the outcome depend on the machine's speed.  Returns ``None``
+        if no perfect clear was found.
+        """
+        if self._handle is None:
+            raise RuntimeError("solver is closed")
+        if not 1 <= max_lines <= PC_MAX_LINES:
+            raise ValueError(f"max_lines must be in [1, {PC_MAX_LINES}], got {max_lines}")
+        if not 0 <= time_limit_ms < 2**32:
+            raise ValueError(f"time_limit_ms must be in [0, 2**32), got {time_limit_ms}")
+        options = PcOptions(
+            max_lines=max_lines,
+            next_pieces=-1 if next_pieces is None else next_pieces,
+            use_hold=int(use_hold),
+            threads=self.threads,
+            max_millis=time_limit_ms,
+            max_nodes=max_nodes,
+        )
+        out = PcSolution()
+        _lib.api_pcSolve(
+            self._handle, ctypes.addressof(_context(ctx)), ctypes.addressof(options), ctypes.addressof(out)
+        )
+        if not out.found:
+            return None
+        moves = [
+            PerfectClearMove(PieceType(p.piece), bool(p.hold), p.position.x, p.position.y, p.position.orientation)
+            for p in out.placements[: out.piece_count]
+        ]
+        actions = np.frombuffer(out.actions, dtype=np.uint8, count=out.action_count).copy()
+        return PerfectClear(out.lines, moves, actions, out.nodes)
+
+    def close(self) -> None:
+        """Free the native solver."""
+        if self._handle is not None:
+            _lib.api_pcSolverDestroy(self._handle)
+            self._handle = None
+
+    def __del__(self) -> None:
+        self.close()
+
+
+_default_solver: PerfectClearSolver | None = None
+
+
+# Wall-time budget of find_perfect_clear, for online use.
+PC_DEFAULT_TIME_LIMIT_MS = 10
+
+
+def find_perfect_clear(ctx: Any, **kwargs: Any) -> PerfectClear | None:
+    """:meth:`PerfectClearSolver.solve` on a shared, lazily created solver.
+
+    The search gives up after ``time_limit_ms`` (default
+    :data:`PC_DEFAULT_TIME_LIMIT_MS`); pass ``time_limit_ms=0`` for an
+    exhaustive, machine-independent search.
+    """
+    global _default_solver
+    if _default_solver is None:
+        _default_solver = PerfectClearSolver()
+    kwargs.setdefault("time_limit_ms", PC_DEFAULT_TIME_LIMIT_MS)
+    return _default_solver.solve(ctx, **kwargs)
+
+
+HEURISTIC_FEATURES = (
+    "landing_height",
+    "eroded_cells",
+    "row_transitions",
+    "column_transitions",
+    "holes",
+    "cumulative_wells",
+    "hole_depth",
+    "rows_with_holes",
+)
+
+
+@dataclass(frozen=True)
+class HeuristicEvaluation:
+    """Result of :func:`evaluate_heuristic`, one entry per weight vector."""
+
+    lines_mean: np.ndarray
+    lines_var: np.ndarray
+    attack_mean: np.ndarray
+    attack_var: np.ndarray
+    pieces_mean: np.ndarray
+
+
+def evaluate_heuristic(
+    weights: Any,
+    *,
+    games: int = 8,
+    max_pieces: int = 1000,
+    seed: int = 0,
+    use_hold: bool = True,
+    threads: int | None = None,
+    config: StepEnvConfig | None = None,
+) -> HeuristicEvaluation:
+    """Play greedy games natively for a batch of linear heuristic weights.
+
+    Every piece is placed at the reachable landing (with *use_hold*, also
+    those of the piece ``HOLD`` brings in) maximising ``weights @ f``,
+    where ``f`` are the :data:`HEURISTIC_FEATURES` of the board after the
+    placement; the chosen inputs are stepped through the step env under
+    *config*.  Game ``k`` of every vector is dealt the same pieces (seeded
+    from *seed*), so differences between vectors are not sampling noise.
+
+    Parameters
+    ----------
+    weights:
+        ``(n, len(HEURISTIC_FEATURES))`` (or a single vector).
+    games:
+        Games per weight vector.
+    max_pieces:
+        Pieces per game before it is stopped (``0`` = until top-out).
+    threads:
+        Worker threads the games are spread over (default:
+        ``os.cpu_count()``).
+
+    Returns
+    -------
+    HeuristicEvaluation
+        Mean and unbiased variance of ``total_lines_cleared`` and
+        ``total_attack`` over the games, and the mean number of pieces.
+    """
+    w = np.ascontiguousarray(np.atleast_2d(np.asarray(weights, dtype=np.float64)))
+    if w.ndim != 2 or w.shape[1] != len(HEURISTIC_FEATURES):
+        raise ValueError(f"weights must have shape (n, {len(HEURISTIC_FEATURES)}), got {np.shape(weights)}")
+    if games < 1:
+        raise ValueError(f"games must be positive, got {games}")
+    config = config if config is not None else StepEnvConfig()
+    out = np.zeros((len(w), 5), dtype=np.float64)
+    _lib.api_evaluateHeuristics(
+        w.ctypes.data, len(w), games, max_pieces, seed & 0xFFFFFFFFFFFFFFFF, int(use_hold),
+        threads if threads is not None else (os.cpu_count() or 1), ctypes.addressof(config), out.ctypes.data,
+    )
+    return HeuristicEvaluation(*(out[:, i].copy() for i in range(5)))
+
+
+PERFT_COUNTS = ("nodes", "line_clears", "lines", "spins", "mini_spins", "perfect_clears", "top_outs")
+
+
+@dataclass(frozen=True)
+class Perft:
+    """Result of :func:`perft`.
+
+    ``counts[d]`` holds the counters of the placements at depth ``d + 1``
+    (keys: :data:`PERFT_COUNTS`; ``spins`` / ``mini_spins`` count
+    ``SpinType.SPIN`` / ``SpinType.SPIN_MINI`` placements).
+    """
+
+    counts: List[dict]
+    seconds: float
+
+    @property
+    def nodes(self) -> int:
+        """Placements over all depths."""
+        return sum(c["nodes"] for c in self.counts)
+
+    @property
+    def nodes_per_second(self) -> float:
+        return self.nodes / self.seconds if self.seconds > 0 else 0.0
+
+
+def perft(ctx: Any, depth: int, *, hold: bool = False, threads: int | None = None) -> Perft:
+    """Count the placement tree below the current state to *depth* pieces.
+
+    Every distinct reachable placement of the current piece (landing plus
+    spin type, reached through the step env's own inputs under its
+    gravity and piece-life rules) is a node; with *hold*, the placements
+    of the piece ``HOLD`` brings in are added.  Deeper levels continue
+    from each placement with the next piece of the queue; placements that
+    top out are leaves.  The root's subtrees are spread over *threads*
+    (default: ``os.cpu_count()``).
+    """
+    if not 1 <= depth <= PERFT_MAX_DEPTH:
+        raise ValueError(f"depth must be in [1, {PERFT_MAX_DEPTH}], got {depth}")
+    context = _context(ctx)
+    options = PerftOptions(
+        depth=depth,
+        use_hold=int(hold),
+        threads=max(1, min(threads if threads is not None else (os.cpu_count() or 1), 255)),
+    )
+    out = (PerftCounts * depth)()
+    start = time.perf_counter()
+    _lib.api_perft(ctypes.addressof(context), ctypes.addressof(options), ctypes.addressof(out))
+    seconds = time.perf_counter() - start
+    counts = [
+        {
+            "nodes": c.nodes,
+            "line_clears": c.line_clears,
+            "lines": c.lines,
+            "spins": c.spins[1],
+            "mini_spins": c.spins[2],
+            "perfect_clears": c.perfect_clears,
+            "top_outs": c.top_outs,
+        }
+        for c in out
+    ]
+    return Perft(counts, seconds)
+
+
+AFTERSTATE_PLANE_SIZE = 200  # == AFTERSTATE_PLANE_SIZE, the visible 20x10 rows
+AFTERSTATE_STATS = HEURISTIC_FEATURES + (
+    "lines_cleared",
+    "perfect_clear",
+    "max_height",
+    "aggregate_height",
+    "bumpiness",
+) + tuple(f"height_{c}" for c in range(10))
+
+
+@dataclass(frozen=True)
+class Afterstates:
+    """Result of :func:`afterstates`: ``K`` candidate placements and their features.
+
+    ``features[k]`` holds the occupancy planes (``AFTERSTATE_PLANE_SIZE``
+    values, row-major from the top visible row) and/or the
+    :data:`AFTERSTATE_STATS` of the board after ``placements[k]``.
+    """
+
+    placements: List[Placement]
+    features: np.ndarray  # [K, F] float32
+
+    def __len__(self) -> int:
+        return len(self.placements)
+
+
+def afterstates(ctx: Any, *, hold: bool = False, planes: bool = True, stats: bool = True) -> Afterstates:
+    """Features of the board after every reachable placement, in one native call.
+
+    Enumerates the placements of the current piece (and, with *hold*, also
+    those of the piece ``HOLD`` brings in, listed after them) and locks each
+    one, with line clears, on a copy of the board's row masks; the context
+    is not modified.  Feed ``features`` to an afterstate value network and
+    play ``placements[argmax].actions``.
+    """
+    if not (planes or stats):
+        raise ValueError("need planes, stats or both")
+    options = AfterstateOptions(use_hold=int(hold), planes=int(planes), stats=int(stats))
+    size = (AFTERSTATE_PLANE_SIZE if planes else 0) + (len(AFTERSTATE_STATS) if stats else 0)
+    buf = (PlacementPath * MAX_PLACEMENTS)()
+    features = np.empty((len(buf), size), dtype=np.float32)
+    n = _lib.api_generateAfterstates(
+        ctypes.addressof(_context(ctx)), ctypes.addressof(options), ctypes.addressof(buf), features.ctypes.data, len(buf)
+    )
+    return Afterstates(_unpack(buf, n), features[:n].copy())
+
+
+MCTS_OBSERVATION_SIZE = 253  # == MCTS_OBSERVATION_SIZE
+MCTS_MAX_CHILDREN = 1024  # == MCTS_MAX_CHILDREN
+
+
+def mcts_create(roots: int, options: MctsOptions) -> int:
+    return _lib.api_mctsCreate(roots, ctypes.addressof(options))
+
+
+def mcts_destroy(handle: int) -> None:
+    _lib.api_mctsDestroy(handle)
+
+
+def mcts_set_root(handle: int, root: int, ctx: Any, feature_ctx: int | None = None, observation: int | None = None) -> None:
+    """Sets a root; *feature_ctx* and *observation* are addresses of its feature plugin context and row (or ``None``)."""
+    _lib.api_mctsSetRoot(handle, root, ctypes.addressof(_context(ctx)), feature_ctx, observation)
+
+
+def mcts_advance(handle: int, root: int, child: int) -> bool:
+    return bool(_lib.api_mctsAdvance(handle, root, child))
+
+
+def mcts_search(handle: int, simulations: int, evaluate: Any) -> int:
+    """Runs the search; *evaluate* is a :data:`MctsEvaluateFn` kept alive by the caller."""
+    return _lib.api_mctsSearch(handle, simulations, ctypes.cast(evaluate, ctypes.c_void_p).value, None)
+
+
+def mcts_children(handle: int, root: int) -> tuple[List[Placement], ctypes.Array[MctsStats]]:
+    paths = (PlacementPath * MCTS_MAX_CHILDREN)()
+    stats = (MctsStats * MCTS_MAX_CHILDREN)()
+    n = _lib.api_mctsChildren(handle, root, ctypes.addressof(paths), ctypes.addressof(stats), len(paths))
+    return _unpack(paths, n), stats[:n]
+
+
+def mcts_root_stats(handle: int, root: int) -> MctsStats:
+    out = MctsStats()
+    _lib.api_mctsRootStats(handle, root, ctypes.addressof(out))
+    return out
+
+
+def mcts_root_context(handle: int, root: int) -> StepEnvContext:
+    out = StepEnvContext()
+    _lib.api_mctsRootContext(handle, root, ctypes.addressof(out))
+    return out
+
+
+def mcts_nodes(handle: int, root: int) -> int:
+    return _lib.api_mctsNodes(handle, root)
+
+
+def opening_book_build(options: OpeningBookOptions) -> int:
+    """Builds the entries natively; returns a handle for the other ``opening_book_*`` helpers."""
+    return _lib.api_openingBookBuild(ctypes.addressof(options))
+
+
+def opening_book_entries(handle: int) -> int:
+    return _lib.api_openingBookEntries(handle)
+
+
+def opening_book_fill(handle: int, table: int, capacity: int) -> None:
+    """Inserts the built entries into the zeroed table of *capacity* slots at address *table*."""
+    _lib.api_openingBookFill(handle, table, capacity)
+
+
+def opening_book_free(handle: int) -> None:
+    _lib.api_openingBookFree(handle)
+
+
+def opening_book_key(ctx: Any, queue_depth: int) -> int:
+    return _lib.api_openingBookKey(ctypes.addressof(_context(ctx)), queue_depth)
+
+
+def opening_book_lookup(
+    table: int, capacity: int, queue_depth: int, contexts: Any
+) -> tuple[List[Placement | None], np.ndarray]:
+    """Book placement of every context (``None`` on a miss) and ``1 + source`` per context (0 on a miss)."""
+    if isinstance(contexts, ctypes.Array):
+        ctxs, address = contexts, ctypes.addressof(contexts)
+    else:
+        ctxs = [_context(contexts)]
+        address = ctypes.addressof(ctxs[0])
+    paths = (PlacementPath * len(ctxs))()
+    found = np.zeros(len(ctxs), dtype=np.uint8)
+    _lib.api_openingBookLookup(table, capacity, queue_depth, address, len(ctxs), ctypes.addressof(paths), found.ctypes.data)
+    placements = [_unpack(paths[i : i + 1], 1)[0] if f else None for i, f in enumerate(found)]
+    return placements, found
@@ -0,0 +1,118 @@
+"""
+Streaming writer for rendered episode frames.
+
+:class:`RawFrameWriter` appends ``rgb24`` frames (as returned by
+``render_mode="rgb_array"``) to a raw video file or a binary stream
+without buffering the match in memory, so arbitrarily long matches can be
+recorded at constant cost per frame.  For a file target, a JSON sidecar
+``<path>.json`` records the frame geometry, rate and count; the raw
+stream can be encoded later, e.g.::
+
+    ffmpeg -f rawvideo -pix_fmt rgb24 -s 168x168 -r 30 -i match.rgb match.mp4
+
+Examples
+--------
+>>> from tetrl.envs.step import StepEnv
+>>> from tetrl.video import RawFrameWriter
+>>>
+>>> env = StepEnv(render_mode="rgb_array")
+>>> env.reset(seed=0)
+>>> with RawFrameWriter("match.rgb", fps=env.metadata["render_fps"]) as writer:
+...     for _ in range(1000):
+...         _, _, terminated, truncated, _ = env.step(env.action_space.sample())
+...         writer.write(env.render())
+...         if terminated or truncated:
+...             break
+"""
+
+from __future__ import annotations
+
+import json
+import os
+from pathlib import Path
+from typing import Any, BinaryIO, Dict, List
+
+import numpy as np
+
+__all__ = ["RawFrameWriter"]
+
+
+class RawFrameWriter:
+    """Append ``(H, W, 3)`` ``uint8`` frames to a raw ``rgb24`` stream.
+
+    Parameters
+    ----------
+    target:
+        Output path, or an open binary stream (e.g. the ``stdin`` of an
+        ``ffmpeg`` process).  Streams are flushed but not closed by
+        :meth:`close`, and get no sidecar.
+    fps:
+        Playback rate recorded in the sidecar.
+
+    Notes
+    -----
+    All frames must share the shape of the first one.  :meth:`write`
+    also accepts a batch ``(n, H, W, 3)``, written in order.
+    """
+
+    def __init__(self, target: str | os.PathLike | BinaryIO, *, fps: float = 30) -> None:
+        if isinstance(target, (str, os.PathLike)):
+            self._path: Path | None = Path(target)
+            self._path.parent.mkdir(parents=True, exist_ok=True)
+            self._stream: BinaryIO = open(self._path, "wb")
+        else:
+            self._path = None
+            self._stream = target
+        self.fps = fps
+        self.frames = 0
+        self.shape: tuple[int, int, int] | None = None
+        self._closed = False
+
+    def write(self, frames: np.ndarray) -> None:
+        """Append one frame ``(H, W, 3)`` or a batch ``(n, H, W, 3)``."""
+        if self._closed:
+            raise ValueError("write to a closed RawFrameWriter")
+        frames = np.asarray(frames)
+        if frames.dtype != np.uint8:
+            raise TypeError(f"frames must be uint8, got {frames.dtype}")
+        if frames.ndim == 3:
+            frames = frames[None]
+        if frames.ndim != 4 or frames.shape[-1] != 3:
+            raise ValueError(f"expected (H, W, 3) or (n, H, W, 3) frames, got shape {frames.shape}")
+        if self.shape is None:
+            self.shape = frames.shape[1:]
+        elif frames.shape[1:] != self.shape:
+            raise ValueError(f"frame shape {frames.shape[1:]} differs from the stream's {self.shape}")
+        self._stream.write(memoryview(np.ascontiguousarray(frames)).cast("B"))
+        self.frames += len(frames)
+
+    def metadata(self) -> Dict[str, Any]:
+        """Geometry and length of the stream, as written to the sidecar."""
+        height, width = self.shape[:2] if self.shape is not None else (0, 0)
+        return {"pix_fmt": "rgb24", "width": width, "height": height, "fps": self.fps, "frames": self.frames}
+
+    def ffmpeg_args(self, output: str | os.PathLike) -> List[str]:
+        """``ffmpeg`` command line encoding the finished file to *output*."""
+        if self._path is None:
+            raise ValueError("ffmpeg_args needs a file target")
+        meta = self.metadata()
+        size = f"{meta['width']}x{meta['height']}"
+        return ["ffmpeg", "-y", "-f", "rawvideo", "-pix_fmt", "rgb24", "-s", size, "-r", str(self.fps),
+                "-i", str(self._path), "-pix_fmt", "yuv420p", str(output)]
+
+    def close(self) -> None:
+        """Flush the stream and, for a file target, close it and write the sidecar."""
+        if self._closed:
+            return
+        self._closed = True
+        self._stream.flush()
+        if self._path is not None:
+            self._stream.close()
+            sidecar = self._path.with_name(self._path.name + ".json")
+            sidecar.write_text(json.dumps(self.metadata(), indent=2), encoding="utf-8")
+
+    def __enter__(self) -> "RawFrameWriter":
+        return self
+
+    def __exit__(self, *exc: Any) -> None:
+        self.close()